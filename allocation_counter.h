@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+// --- Allocation Counting ---
+// The global allocation functions are replaced (every form: plain, array,
+// nothrow, aligned and sized) so the benchmarks can report how many heap
+// allocations, and bytes, a phase performs. Counting is off until a
+// benchmark turns it on; until then an allocation pays one relaxed load.
+
+void setAllocationCounting(bool enabled);
+size_t allocationCount();
+size_t allocatedBytes();
@@ -0,0 +1,55 @@
+#include "ast_arena.h"
+
+AstArena::AstArena(Strategy strategy, size_t pageSize)
+    : strategy(strategy), pageSize(pageSize) {
+}
+
+AstArena::~AstArena() {
+    release();
+}
+
+void AstArena::release() {
+    // Newest first, so a node is finalized before anything it was built from.
+    for (size_t i = finalizers.size(); i-- > 0;) {
+        finalizers[i].destroy(finalizers[i].object);
+    }
+    finalizers.clear();
+
+    for (void* page : pages) {
+        ::operator delete(page);
+    }
+    pages.clear();
+    cursor = nullptr;
+    limit = nullptr;
+    nodes = 0;
+}
+
+void AstArena::adopt(AstArena& other) {
+    // Our current page stays open for further nodes; the adopted pages are full.
+    pages.insert(pages.end(), other.pages.begin(), other.pages.end());
+    finalizers.insert(finalizers.end(), other.finalizers.begin(), other.finalizers.end());
+    nodes += other.nodes;
+    other.pages.clear();
+    other.finalizers.clear();
+    other.cursor = nullptr;
+    other.limit = nullptr;
+    other.nodes = 0;
+}
+
+void* AstArena::allocateSlow(size_t size) {
+    // A node bigger than a page gets a page of its own; the current page stays
+    // open for the nodes that follow.
+    if (size > pageSize) {
+        void* page = ::operator new(size);
+        pages.push_back(page);
+        return page;
+    }
+
+    // ::operator new returns memory aligned for any fundamental type, so the
+    // first node of a page never needs padding.
+    char* page = static_cast<char*>(::operator new(pageSize));
+    pages.push_back(page);
+    cursor = page + size;
+    limit = page + pageSize;
+    return page;
+}
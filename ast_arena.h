@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Owns every AST node the Parser builds.
+// Nodes are bump-allocated out of large pages and the whole tree is freed at
+// once by releasing the pages, so teardown costs O(pages) instead of one
+// recursive delete per node (which could also overflow the stack on deep trees).
+// Only nodes that own heap memory themselves (the ones holding a std::vector)
+// have their destructor run; everything else is simply forgotten.
+//
+// Pointers returned by make() stay valid until release() or destruction.
+class AstArena {
+public:
+    enum class Strategy {
+        Pages,  // Bump allocation in pages, bulk release
+        Heap    // One `new` per node and one `delete` per node on release (the
+                // pre-arena behaviour; kept for comparison and for heap checkers)
+    };
+
+    static constexpr size_t defaultPageSize = 64 * 1024;
+
+    explicit AstArena(Strategy strategy = Strategy::Pages, size_t pageSize = defaultPageSize);
+    ~AstArena();
+
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    // Constructs a T inside the arena.
+    template <typename T, typename... Args>
+    T* make(Args&&... args);
+
+    // Destroys every node and returns the pages. The arena can be reused afterwards.
+    void release();
+
+    // Takes over every node of `other` (which is left empty), e.g. the nodes
+    // ParallelParser's workers built in arenas of their own.
+    void adopt(AstArena& other);
+
+    size_t nodeCount() const { return nodes; }
+    size_t pageCount() const { return pages.size(); }
+
+private:
+    struct Finalizer {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    const Strategy strategy;
+    const size_t pageSize;
+
+    std::vector<void*> pages;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    std::vector<Finalizer> finalizers;
+    size_t nodes = 0;
+
+    void* allocate(size_t size, size_t alignment) {
+        size_t padding = (alignment - reinterpret_cast<size_t>(cursor) % alignment) % alignment;
+        if (cursor == nullptr || static_cast<size_t>(limit - cursor) < padding + size) {
+            return allocateSlow(size);
+        }
+        char* p = cursor + padding;
+        cursor = p + size;
+        return p;
+    }
+
+    // Starts a new page (or a dedicated one for an oversized node).
+    void* allocateSlow(size_t size);
+};
+
+template <typename T, typename... Args>
+T* AstArena::make(Args&&... args) {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "AstArena pages are only max_align_t aligned");
+    ++nodes;
+
+    if (strategy == Strategy::Heap) {
+        T* node = new (::operator new(sizeof(T))) T(std::forward<Args>(args)...);
+        finalizers.push_back({ node, [](void* p) {
+            static_cast<T*>(p)->~T();
+            ::operator delete(p);
+        } });
+        return node;
+    }
+
+    T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+        finalizers.push_back({ node, [](void* p) { static_cast<T*>(p)->~T(); } });
+    }
+    return node;
+}
@@ -0,0 +1,395 @@
+#include "ast_cache.h"
+#include "ast_arena.h"
+#include "interner.h"
+#include "source_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+// --- File Layout ---
+// A Header, then the arrays back to back: nodes (FlatNode as laid out in
+// memory), lists (uint32), tokens (CachedToken) and roots (uint32). Every
+// section is a multiple of four bytes, so all of them stay aligned in the
+// mapping. Integers are in the writer's byte order; a reader with another
+// order (or another FlatNode layout) rejects the file.
+
+namespace {
+
+const char magic[4] = { 'D', 'A', 'S', 'T' };
+constexpr uint32_t byteOrderMark = 0x01020304;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t nodeSize;  // sizeof(FlatNode) of the writer
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t payloadHash; // contentHash() of everything after the header
+    uint32_t nodeCount;
+    uint32_t listCount;
+    uint32_t tokenCount;
+    uint32_t rootCount;
+};
+
+struct CachedToken {
+    uint32_t offset; // Of the lexeme in the source
+    uint32_t length;
+    int32_t line;
+    uint8_t type;
+    uint8_t padding[3];
+};
+
+static_assert(std::is_trivially_copyable_v<FlatNode>, "FlatNode is copied to and from the file as bytes");
+static_assert(alignof(FlatNode) <= 4 && alignof(CachedToken) <= 4, "sections are only four-byte aligned");
+static_assert(sizeof(FlatNode) % 4 == 0 && sizeof(CachedToken) % 4 == 0 && sizeof(Header) % 8 == 0,
+    "cache sections must keep their successors aligned");
+
+template <typename T>
+void appendArray(std::string& out, const std::vector<T>& items) {
+    if (!items.empty()) out.append(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+}
+
+bool isExpression(NodeKind kind) {
+    return kind >= NodeKind::Assignment && kind <= NodeKind::Grouping && kind != NodeKind::PostfixTail;
+}
+
+bool isStatement(NodeKind kind) {
+    return kind >= NodeKind::Block && kind <= NodeKind::ExprStmt && kind != NodeKind::Case;
+}
+
+bool isDeclaration(NodeKind kind) {
+    return kind == NodeKind::VarDecl || kind == NodeKind::FuncDecl || isStatement(kind);
+}
+
+bool hasToken(NodeKind kind) {
+    switch (kind) {
+    case NodeKind::VarDecl:
+    case NodeKind::FuncDecl:
+    case NodeKind::Assignment:
+    case NodeKind::Logical:
+    case NodeKind::Binary:
+    case NodeKind::Unary:
+    case NodeKind::PostfixTail:
+    case NodeKind::Primary:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool holdsList(NodeKind kind) {
+    switch (kind) {
+    case NodeKind::FuncDecl:
+    case NodeKind::Block:
+    case NodeKind::For:
+    case NodeKind::Switch:
+    case NodeKind::Case:
+    case NodeKind::Postfix:
+    case NodeKind::PostfixTail:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+uint64_t AstCache::contentHash(std::string_view bytes) {
+    // Four independent lanes of 8 bytes, so the multiplies overlap and a warm
+    // load is not dominated by hashing the source; the tail goes through the
+    // Interner's hash.
+    const uint64_t prime = 0xFF51AFD7ED558CCDull;
+    uint64_t lanes[4] = {
+        0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull
+    };
+    const char* data = bytes.data();
+    size_t i = 0;
+    for (; i + 32 <= bytes.size(); i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, data + i + lane * 8, 8);
+            lanes[lane] = (lanes[lane] ^ word) * prime;
+            lanes[lane] ^= lanes[lane] >> 32;
+        }
+    }
+    uint64_t h = bytes.size();
+    for (uint64_t lane : lanes) {
+        h = (h ^ lane) * 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 29;
+    }
+    return h ^ Interner::hash(bytes.substr(i));
+}
+
+std::string AstCache::pathFor(uint64_t sourceHash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.dast", static_cast<unsigned long long>(sourceHash));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool AstCache::fail(std::string message) {
+    lastError = std::move(message);
+    return false;
+}
+
+// --- Loading ---
+
+namespace {
+
+// Validation reads every node and list entry in place, in the mapping.
+// Checks what toPointerAst() relies on: indices in range, each child after its
+// parent (so there are no cycles), and the right kind of node in each slot.
+// Returns what is wrong, or an empty string.
+std::string validateTree(const FlatAstView& ast, const Header& header) {
+    const size_t nodeCount = header.nodeCount;
+    const size_t tokenCount = header.tokenCount;
+    // Every node hangs from at most one parent (or is at most one root), so
+    // toPointerAst() builds a tree, never a DAG expanded once per path.
+    std::vector<uint8_t> referenced(nodeCount, 0);
+
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const FlatNode& node = ast.nodes[i];
+        if (node.kind > NodeKind::Grouping) return "unknown node kind at node " + std::to_string(i);
+        if (hasToken(node.kind) ? node.token >= tokenCount : node.token != noToken) {
+            return "bad token index at node " + std::to_string(i);
+        }
+
+        // A child slot: absent, or a later node accepted by `accepts` that no
+        // other slot refers to.
+        auto child = [&](NodeIndex index, bool (*accepts)(NodeKind)) {
+            if (index == noNode) return true;
+            if (index <= i || index >= nodeCount || !accepts(ast.nodes[index].kind)) return false;
+            return referenced[index]++ == 0;
+        };
+        auto unused = [](NodeIndex index) { return index == noNode; };
+        auto isBlock = [](NodeKind kind) { return kind == NodeKind::Block; };
+        auto isCase = [](NodeKind kind) { return kind == NodeKind::Case; };
+        auto isTail = [](NodeKind kind) { return kind == NodeKind::PostfixTail; };
+
+        const uint32_t* list = nullptr;
+        const uint32_t* listEnd = nullptr;
+        if (holdsList(node.kind)) {
+            if (uint64_t(node.b) + node.c > header.listCount) return "list out of range at node " + std::to_string(i);
+            list = ast.listBegin(node);
+            listEnd = ast.listEnd(node);
+        }
+        auto everyEntry = [&](bool (*accepts)(NodeKind)) {
+            for (const uint32_t* entry = list; entry != listEnd; ++entry) {
+                if (!child(*entry, accepts)) return false;
+            }
+            return true;
+        };
+
+        bool valid = true;
+        switch (node.kind) {
+        case NodeKind::VarDecl:
+            valid = child(node.a, isExpression) && unused(node.b) && unused(node.c);
+            break;
+        case NodeKind::FuncDecl:
+            valid = child(node.a, isBlock);
+            for (const uint32_t* param = list; param != listEnd; ++param) {
+                if (*param >= tokenCount) valid = false;
+            }
+            break;
+        case NodeKind::Block:
+            valid = unused(node.a) && everyEntry(isDeclaration);
+            break;
+        case NodeKind::For:
+            valid = unused(node.a) && node.c == 4 && child(list[0], isDeclaration) &&
+                child(list[1], isExpression) && child(list[2], isExpression) && child(list[3], isStatement);
+            break;
+        case NodeKind::Switch:
+            valid = child(node.a, isExpression) && everyEntry(isCase) &&
+                std::find(list, listEnd, noNode) == listEnd;
+            break;
+        case NodeKind::Postfix:
+            valid = child(node.a, isExpression) && everyEntry(isTail) &&
+                std::find(list, listEnd, noNode) == listEnd;
+            break;
+        case NodeKind::Case:
+            valid = child(node.a, isExpression) && everyEntry(isDeclaration);
+            break;
+        case NodeKind::PostfixTail:
+            valid = child(node.a, isExpression) && everyEntry(isExpression);
+            break;
+        case NodeKind::If:
+            valid = child(node.a, isExpression) && child(node.b, isStatement) && child(node.c, isStatement);
+            break;
+        case NodeKind::While:
+            valid = child(node.a, isExpression) && child(node.b, isStatement) && unused(node.c);
+            break;
+        case NodeKind::DoWhile:
+            valid = child(node.a, isStatement) && child(node.b, isExpression) && unused(node.c);
+            break;
+        case NodeKind::Break:
+        case NodeKind::Continue:
+        case NodeKind::Primary:
+            valid = unused(node.a) && unused(node.b) && unused(node.c);
+            break;
+        case NodeKind::Return:
+        case NodeKind::Print:
+        case NodeKind::ExprStmt:
+        case NodeKind::Unary:
+        case NodeKind::Grouping:
+            valid = child(node.a, isExpression) && unused(node.b) && unused(node.c);
+            break;
+        case NodeKind::Assignment:
+        case NodeKind::Logical:
+        case NodeKind::Binary:
+            valid = child(node.a, isExpression) && child(node.b, isExpression) && unused(node.c);
+            break;
+        case NodeKind::Conditional:
+            valid = child(node.a, isExpression) && child(node.b, isExpression) && child(node.c, isExpression);
+            break;
+        }
+        if (!valid) return "malformed node " + std::to_string(i);
+    }
+
+    for (size_t i = 0; i < ast.rootCount; ++i) {
+        NodeIndex root = ast.roots[i];
+        if (root == noNode) continue;
+        if (root >= nodeCount || !isDeclaration(ast.nodes[root].kind)) return "bad root node";
+        if (referenced[root]++ != 0) return "node " + std::to_string(root) + " has more than one parent";
+    }
+    return std::string();
+}
+
+// Makes TokenRefs from the file's tokens as toPointerAst() asks for them,
+// interning names exactly as Scanner::addToken does.
+struct TokenSource {
+    const CachedToken* tokens;
+    std::string_view source;
+    mutable SymbolCache symbolCache{ symbols() };
+
+    static TokenRef at(const void* context, uint32_t index) {
+        const TokenSource& self = *static_cast<const TokenSource*>(context);
+        const CachedToken& cached = self.tokens[index];
+        TokenType type = static_cast<TokenType>(cached.type);
+        std::string_view lexeme = self.source.substr(cached.offset, cached.length);
+        Symbol symbol = noSymbol;
+        if (type == TokenType::IDENTIFIER) symbol = self.symbolCache.intern(lexeme);
+        else if (type == TokenType::STRING) symbol = self.symbolCache.intern(stringFromLexeme(lexeme));
+        return Token(type, lexeme, cached.line, 0, symbol);
+    }
+};
+
+} // namespace
+
+bool AstCache::load(std::string_view source, AstArena& arena, std::vector<Declaration*>& ast) {
+    lastError.clear();
+    uint64_t sourceHash = contentHash(source);
+    SourceFile file;
+    if (!file.open(pathFor(sourceHash))) return false; // Not cached yet
+
+    std::string_view bytes = file.text();
+    Header header;
+    if (bytes.size() < sizeof(header)) return fail("truncated header");
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) return fail("not an AST cache file");
+    if (header.version != formatVersion) {
+        return fail("format version " + std::to_string(header.version) + ", expected " + std::to_string(formatVersion));
+    }
+    if (header.byteOrder != byteOrderMark || header.nodeSize != sizeof(FlatNode)) {
+        return fail("written with a different byte order or node layout");
+    }
+    if (header.sourceHash != sourceHash || header.sourceSize != source.size()) return fail("written for a different source");
+
+    uint64_t expectedSize = sizeof(header) + uint64_t(header.nodeCount) * sizeof(FlatNode) +
+        uint64_t(header.listCount) * sizeof(uint32_t) + uint64_t(header.tokenCount) * sizeof(CachedToken) +
+        uint64_t(header.rootCount) * sizeof(NodeIndex);
+    if (expectedSize != bytes.size()) return fail("file size does not match its header");
+    if (contentHash(bytes.substr(sizeof(header))) != header.payloadHash) return fail("payload checksum mismatch");
+
+    // The sections are used where they lie in the mapping: it is page aligned
+    // and every section starts on a multiple of four.
+    const char* in = bytes.data() + sizeof(header);
+    FlatAstView view;
+    view.nodes = reinterpret_cast<const FlatNode*>(in);
+    in += header.nodeCount * sizeof(FlatNode);
+    view.lists = reinterpret_cast<const uint32_t*>(in);
+    in += header.listCount * sizeof(uint32_t);
+    const CachedToken* tokens = reinterpret_cast<const CachedToken*>(in);
+    in += header.tokenCount * sizeof(CachedToken);
+    view.roots = reinterpret_cast<const NodeIndex*>(in);
+    view.rootCount = header.rootCount;
+
+    for (uint32_t i = 0; i < header.tokenCount; ++i) {
+        if (uint64_t(tokens[i].offset) + tokens[i].length > source.size()) return fail("token outside the source");
+        if (tokens[i].type > static_cast<uint8_t>(TokenType::END_OF_FILE)) return fail("unknown token type");
+    }
+    std::string problem = validateTree(view, header);
+    if (!problem.empty()) return fail(problem);
+
+    TokenSource tokenSource{ tokens, source };
+    view.tokenAt = &TokenSource::at;
+    view.context = &tokenSource;
+    ast = toPointerAst(view, arena);
+    return true;
+}
+
+// --- Storing ---
+
+bool AstCache::store(std::string_view source, const FlatAst& ast) {
+    lastError.clear();
+    std::vector<CachedToken> tokens;
+    tokens.reserve(ast.tokens.size());
+    for (const TokenRef& token : ast.tokens) {
+        // Every lexeme is a view into the source; anything else cannot be stored.
+        if (token.lexeme.data() < source.data() || token.lexeme.data() + token.lexeme.size() > source.data() + source.size()) {
+            return fail("a token does not point into the source");
+        }
+        CachedToken cached = {};
+        cached.offset = static_cast<uint32_t>(token.lexeme.data() - source.data());
+        cached.length = static_cast<uint32_t>(token.lexeme.size());
+        cached.line = token.line;
+        cached.type = static_cast<uint8_t>(token.type);
+        tokens.push_back(cached);
+    }
+
+    std::string payload;
+    appendArray(payload, ast.nodes);
+    appendArray(payload, ast.lists);
+    appendArray(payload, tokens);
+    appendArray(payload, ast.roots);
+
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = formatVersion;
+    header.byteOrder = byteOrderMark;
+    header.nodeSize = sizeof(FlatNode);
+    header.sourceHash = contentHash(source);
+    header.sourceSize = source.size();
+    header.payloadHash = contentHash(payload);
+    header.nodeCount = static_cast<uint32_t>(ast.nodes.size());
+    header.listCount = static_cast<uint32_t>(ast.lists.size());
+    header.tokenCount = static_cast<uint32_t>(tokens.size());
+    header.rootCount = static_cast<uint32_t>(ast.roots.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) return fail("cannot create " + directory + ": " + error.message());
+
+    std::string path = pathFor(header.sourceHash);
+    std::string temporary = path + "." +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return fail("cannot write " + temporary);
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return fail("cannot write " + path);
+    }
+    return true;
+}
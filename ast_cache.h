@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "flat_ast.h"
+
+// An on-disk cache of parsed programs, so a script that has not changed since
+// the last run is neither scanned nor parsed again.
+//
+// Entries are FlatAsts in a binary format, one file per source, named after a
+// 64-bit hash of the source text (a different text is a different entry, so
+// nothing is ever invalidated; stale files can simply be deleted). A load
+// maps the file and checks it before using any of it: magic, format version,
+// byte order and node size, the source's hash and size, a hash of the
+// payload, and the structure itself (every index in range, children after
+// their parent, each slot holding the kind of node it should). Anything that
+// does not check out is a miss, never a crash.
+//
+// Lexemes are stored as offsets into the source, which the caller has loaded
+// anyway to hash it; identifiers and strings are interned again on load.
+class AstCache {
+public:
+    // Bump whenever the file layout, FlatNode or NodeKind changes.
+    static constexpr uint32_t formatVersion = 1;
+
+    explicit AstCache(std::string directory) : directory(std::move(directory)) {}
+
+    // Builds the tree cached for `source` into `arena`, reading the nodes
+    // straight out of the mapped file. False on a miss or on a file that fails
+    // validation (see error()).
+    bool load(std::string_view source, AstArena& arena, std::vector<Declaration*>& ast);
+
+    // Writes `ast`, parsed from `source`. The file is written under a
+    // temporary name and renamed, so readers never see a partial entry.
+    bool store(std::string_view source, const FlatAst& ast);
+
+    // Why the last load() or store() failed; empty for a plain miss.
+    const std::string& error() const { return lastError; }
+
+    // The file holding the entry for a source with this contentHash().
+    std::string pathFor(uint64_t sourceHash) const;
+    static uint64_t contentHash(std::string_view bytes);
+
+private:
+    std::string directory;
+    std::string lastError;
+
+    bool fail(std::string message);
+};
@@ -3,14 +3,27 @@
 
 class AstVisitor;
 
+// Nodes are owned by an AstArena and never deleted one by one, so the
+// destructors are protected and not virtual (see ast_arena.h).
 class AstNode {
 public:
-    virtual ~AstNode() = default;
     virtual void accept(AstVisitor& visitor) = 0;
+
+protected:
+    ~AstNode() = default;
 };
 
-class Declaration : public AstNode {};
+class Declaration : public AstNode {
+protected:
+    ~Declaration() = default;
+};
 
-class Stmt : public Declaration {};
+class Stmt : public Declaration {
+protected:
+    ~Stmt() = default;
+};
 
-class Expr : public AstNode {};
\ No newline at end of file
+class Expr : public AstNode {
+protected:
+    ~Expr() = default;
+};
\ No newline at end of file
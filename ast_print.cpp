@@ -2,65 +2,79 @@
 #include "declaration_nodes.h"
 #include "expr_nodes.h"
 #include "stmt_nodes.h"
-#include <sstream>
-#include <stdexcept>
+#include <charconv>
+#include <cstring>
 
 // --- AstPrinter Setup and Helpers ---
 
 AstPrinter::AstPrinter(std::ostream& outputStream)
-    : output(outputStream) {
+    : output(outputStream), buffer(bufferSize) {
 }
 
-std::string AstPrinter::newId() {
-    return "N" + std::to_string(nodeIdCounter++);
-}
-
-void AstPrinter::emitNode(const std::string& id, const std::string& label) {
-    std::string escapedLabel = label;
-    // Simple quote escaping
-    size_t pos = escapedLabel.find('"');
-    while (pos != std::string::npos) {
-        escapedLabel.replace(pos, 1, "\\\"");
-        pos = escapedLabel.find('"', pos + 2);
+void AstPrinter::append(std::string_view text) {
+    if (text.empty()) return; // An empty view may carry a null data()
+    if (text.size() > bufferSize - used) {
+        flush();
+        if (text.size() > bufferSize) { // Only a huge lexeme; pass it straight on
+            output.write(text.data(), static_cast<std::streamsize>(text.size()));
+            return;
+        }
     }
-    // Minimal node definition
-    output << "    " << id << " [label=\"" << escapedLabel << "\"];\n";
+    std::memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
 }
 
-void AstPrinter::emitEdge(const std::string& parentId, const std::string& childId, const std::string& label) {
-    // Clean edge definition: NO label unless explicitly specified.
-    if (label.empty()) {
-        output << "    " << parentId << " -> " << childId << ";\n";
-    }
-    else {
-        output << "    " << parentId << " -> " << childId << " [label=\"" << label << "\"];\n";
-    }
+void AstPrinter::appendId(NodeId id) {
+    char digits[16];
+    digits[0] = 'N';
+    char* end = std::to_chars(digits + 1, digits + sizeof(digits), id).ptr;
+    append(std::string_view(digits, static_cast<size_t>(end - digits)));
 }
 
-void AstPrinter::pushParent(const std::string& id) {
-    parentIdStack.push_back(id);
+void AstPrinter::flush() {
+    output.write(buffer.data(), static_cast<std::streamsize>(used));
+    used = 0;
 }
 
-void AstPrinter::popParent() {
-    if (!parentIdStack.empty()) {
-        parentIdStack.pop_back();
+void AstPrinter::emitNode(NodeId id, std::string_view label, std::string_view text) {
+    // Minimal node definition; quotes in the lexeme are escaped in one pass.
+    append("    ");
+    appendId(id);
+    append(" [label=\"");
+    append(label);
+    for (size_t quote = text.find('"'); quote != std::string_view::npos; quote = text.find('"')) {
+        append(text.substr(0, quote));
+        append("\\\"");
+        text.remove_prefix(quote + 1);
     }
+    append(text);
+    append("\"];\n");
 }
 
-std::string AstPrinter::getCurrentParentId() {
-    if (parentIdStack.empty()) {
-        return "";
-    }
-    return parentIdStack.back();
+void AstPrinter::emitEdge(NodeId parentId, NodeId childId) {
+    // Clean edge definition: no label.
+    append("    ");
+    appendId(parentId);
+    append(" -> ");
+    appendId(childId);
+    append(";\n");
+}
+
+AstPrinter::NodeId AstPrinter::openNode(std::string_view label, std::string_view text) {
+    NodeId nodeId = newId();
+    NodeId parentId = getCurrentParentId();
+    emitNode(nodeId, label, text);
+    if (parentId != noParent) emitEdge(parentId, nodeId);
+    return nodeId;
 }
 
 // --- Main Entry Point ---
 
 void AstPrinter::print(const std::vector<Declaration*>& ast) {
-    output << "digraph AST {\n";
-    output << "    rankdir=TB;\n"; // Keep T/B layout for readability
+    append("digraph AST {\n");
+    append("    rankdir=TB;\n"); // Keep T/B layout for readability
 
-    std::string programId = newId();
+    NodeId programId = newId();
     emitNode(programId, "PROGRAM ROOT");
 
     pushParent(programId);
@@ -72,16 +86,14 @@ void AstPrinter::print(const std::vector<Declaration*>& ast) {
     }
 
     popParent();
-    output << "}\n";
+    append("}\n");
+    flush();
 }
 
 // --- Declaration Visitors ---
 
 void AstPrinter::visitVarDecl(VarDecl* decl) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "VAR: " + decl->name.lexeme);
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("VAR: ", decl->name.lexeme);
 
     pushParent(nodeId);
     if (decl->initializer) {
@@ -91,12 +103,7 @@ void AstPrinter::visitVarDecl(VarDecl* decl) {
 }
 
 void AstPrinter::visitFuncDecl(FuncDecl* decl) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-
-    std::string label = "FUN: " + decl->name.lexeme;
-    emitNode(nodeId, label);
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("FUN: ", decl->name.lexeme);
 
     pushParent(nodeId);
     decl->body->accept(*this);
@@ -106,21 +113,15 @@ void AstPrinter::visitFuncDecl(FuncDecl* decl) {
 // --- Statement Visitors (Minimal, cleaner edges) ---
 
 void AstPrinter::visitExprStmt(ExprStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "Expr Stmt");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("Expr Stmt");
 
     pushParent(nodeId);
-    stmt->expression->accept(*this);
+    if (stmt->expression) stmt->expression->accept(*this); // nullptr for an empty statement ';'
     popParent();
 }
 
 void AstPrinter::visitPrintStmt(PrintStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "PRINT");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("PRINT");
 
     pushParent(nodeId);
     if (stmt->expression) {
@@ -130,10 +131,7 @@ void AstPrinter::visitPrintStmt(PrintStmt* stmt) {
 }
 
 void AstPrinter::visitReturnStmt(ReturnStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "RETURN");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("RETURN");
 
     pushParent(nodeId);
     if (stmt->value) {
@@ -143,24 +141,15 @@ void AstPrinter::visitReturnStmt(ReturnStmt* stmt) {
 }
 
 void AstPrinter::visitBreakStmt(BreakStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "BREAK");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    openNode("BREAK");
 }
 
 void AstPrinter::visitContinueStmt(ContinueStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "CONTINUE");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    openNode("CONTINUE");
 }
 
 void AstPrinter::visitBlockStmt(BlockStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "BLOCK {}");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("BLOCK {}");
 
     pushParent(nodeId);
     for (Declaration* s : stmt->statements) {
@@ -170,10 +159,7 @@ void AstPrinter::visitBlockStmt(BlockStmt* stmt) {
 }
 
 void AstPrinter::visitIfStmt(IfStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "IF");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("IF");
 
     pushParent(nodeId);
     stmt->condition->accept(*this);
@@ -185,10 +171,7 @@ void AstPrinter::visitIfStmt(IfStmt* stmt) {
 }
 
 void AstPrinter::visitWhileStmt(WhileStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "WHILE");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("WHILE");
 
     pushParent(nodeId);
     stmt->condition->accept(*this);
@@ -197,10 +180,7 @@ void AstPrinter::visitWhileStmt(WhileStmt* stmt) {
 }
 
 void AstPrinter::visitDoWhileStmt(DoWhileStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "DO-WHILE");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("DO-WHILE");
 
     pushParent(nodeId);
     stmt->body->accept(*this);
@@ -209,10 +189,7 @@ void AstPrinter::visitDoWhileStmt(DoWhileStmt* stmt) {
 }
 
 void AstPrinter::visitForStmt(ForStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "FOR");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("FOR");
 
     pushParent(nodeId);
     if (stmt->initializer) stmt->initializer->accept(*this);
@@ -222,10 +199,9 @@ void AstPrinter::visitForStmt(ForStmt* stmt) {
     popParent();
 }
 
-void AstPrinter::printCaseStmt(const std::string& switchNodeId, CaseStmt* caseStmt, int index) {
-    std::string nodeId = newId();
-    std::string label = caseStmt->value ? "CASE" : "DEFAULT";
-    emitNode(nodeId, label);
+void AstPrinter::printCaseStmt(NodeId switchNodeId, CaseStmt* caseStmt) {
+    NodeId nodeId = newId();
+    emitNode(nodeId, caseStmt->value ? "CASE" : "DEFAULT");
     emitEdge(switchNodeId, nodeId); // Unlabeled edge from SWITCH to CASE
 
     pushParent(nodeId);
@@ -239,16 +215,13 @@ void AstPrinter::printCaseStmt(const std::string& switchNodeId, CaseStmt* caseSt
 }
 
 void AstPrinter::visitSwitchStmt(SwitchStmt* stmt) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "SWITCH");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("SWITCH");
 
     pushParent(nodeId);
     stmt->condition->accept(*this);
 
     for (size_t i = 0; i < stmt->cases.size(); ++i) {
-        printCaseStmt(nodeId, stmt->cases[i], i + 1);
+        printCaseStmt(nodeId, stmt->cases[i]);
     }
     popParent();
 }
@@ -256,20 +229,11 @@ void AstPrinter::visitSwitchStmt(SwitchStmt* stmt) {
 // --- Expression Visitors (Minimal, clean edges applied to all) ---
 
 void AstPrinter::visitPrimaryExpr(PrimaryExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-
-    std::string value = expr->value.lexeme;
-
-    emitNode(nodeId, "LIT: " + value);
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    openNode("LIT: ", expr->value.lexeme);
 }
 
 void AstPrinter::visitGroupingExpr(GroupingExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "GROUPING ()");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("GROUPING ()");
 
     pushParent(nodeId);
     expr->expression->accept(*this);
@@ -277,10 +241,7 @@ void AstPrinter::visitGroupingExpr(GroupingExpr* expr) {
 }
 
 void AstPrinter::visitUnaryExpr(UnaryExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "Unary: " + expr->op.lexeme);
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("Unary: ", expr->op.lexeme);
 
     pushParent(nodeId);
     expr->right->accept(*this);
@@ -288,10 +249,7 @@ void AstPrinter::visitUnaryExpr(UnaryExpr* expr) {
 }
 
 void AstPrinter::visitBinaryExpr(BinaryExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "Binary: " + expr->op.lexeme);
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("Binary: ", expr->op.lexeme);
 
     pushParent(nodeId);
     expr->left->accept(*this);
@@ -300,10 +258,7 @@ void AstPrinter::visitBinaryExpr(BinaryExpr* expr) {
 }
 
 void AstPrinter::visitLogicalExpr(LogicalExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "Logical: " + expr->op.lexeme);
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("Logical: ", expr->op.lexeme);
 
     pushParent(nodeId);
     expr->left->accept(*this);
@@ -312,10 +267,7 @@ void AstPrinter::visitLogicalExpr(LogicalExpr* expr) {
 }
 
 void AstPrinter::visitAssignmentExpr(AssignmentExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "Assign: " + expr->op.lexeme);
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("Assign: ", expr->op.lexeme);
 
     pushParent(nodeId);
     expr->left->accept(*this);
@@ -324,10 +276,7 @@ void AstPrinter::visitAssignmentExpr(AssignmentExpr* expr) {
 }
 
 void AstPrinter::visitConditionalExpr(ConditionalExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "Ternary ?:");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("Ternary ?:");
 
     pushParent(nodeId);
     expr->condition->accept(*this);
@@ -336,10 +285,9 @@ void AstPrinter::visitConditionalExpr(ConditionalExpr* expr) {
     popParent();
 }
 
-void AstPrinter::printPostfixTail(const std::string& parentId, PostfixTail* tail, int index) {
-    std::string nodeId = newId();
-    std::string label = tail->op.lexeme;
-    emitNode(nodeId, "Tail: " + label);
+void AstPrinter::printPostfixTail(NodeId parentId, PostfixTail* tail) {
+    NodeId nodeId = newId();
+    emitNode(nodeId, "Tail: ", tail->op.lexeme);
     emitEdge(parentId, nodeId);
 
     pushParent(nodeId);
@@ -357,16 +305,13 @@ void AstPrinter::printPostfixTail(const std::string& parentId, PostfixTail* tail
 }
 
 void AstPrinter::visitPostfixExpr(PostfixExpr* expr) {
-    std::string nodeId = newId();
-    std::string parentId = getCurrentParentId();
-    emitNode(nodeId, "POSTFIX");
-    if (!parentId.empty()) emitEdge(parentId, nodeId);
+    NodeId nodeId = openNode("POSTFIX");
 
     pushParent(nodeId);
     expr->primary->accept(*this);
 
     for (size_t i = 0; i < expr->tails.size(); ++i) {
-        printPostfixTail(nodeId, expr->tails[i], i + 1);
+        printPostfixTail(nodeId, expr->tails[i]);
     }
     popParent();
 }
\ No newline at end of file
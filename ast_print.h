@@ -1,9 +1,11 @@
 #pragma once
 #include "ast_visitor.h"
 #include "token.h"
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <string_view>
 #include <vector>
-#include <string>
 
 // Forward Declarations
 class VarDecl; class FuncDecl; class BlockStmt; class IfStmt; class ForStmt;
@@ -13,11 +15,18 @@ struct CaseStmt; class LogicalExpr; class BinaryExpr; class AssignmentExpr;
 class ConditionalExpr; class UnaryExpr; class PostfixExpr; class PrimaryExpr;
 class GroupingExpr; struct PostfixTail;
 
+// Writes the AST as a Graphviz DOT graph: one node per AST node (named N0,
+// N1, ... in pre-order) with an edge from its parent.
+// The text is assembled in a large buffer and handed to the stream in blocks
+// of bufferSize bytes, so a big tree costs few stream calls.
 class AstPrinter : public AstVisitor {
 public:
     explicit AstPrinter(std::ostream& outputStream);
     void print(const std::vector<Declaration*>& ast);
 
+    // Nodes printed so far (the program root included).
+    size_t nodeCount() const { return nextId; }
+
     // --- Overridden Visitor Methods ---
     void visitVarDecl(VarDecl* decl) override;
     void visitFuncDecl(FuncDecl* decl) override;
@@ -42,21 +51,35 @@ public:
     void visitGroupingExpr(GroupingExpr* expr) override; // Added Grouping
 
 private:
+    using NodeId = uint32_t;
+    static constexpr NodeId noParent = UINT32_MAX;
+    static constexpr size_t bufferSize = 1 << 20;
+
     std::ostream& output;
-    int nodeIdCounter = 0;
-    std::vector<std::string> parentIdStack;
+    std::vector<char> buffer;
+    size_t used = 0;
+    NodeId nextId = 0;
+    std::vector<NodeId> parentIdStack;
 
     // --- DOT Generation Helpers (Minimal) ---
-    std::string newId();
-    void emitNode(const std::string& id, const std::string& label);
-    void emitEdge(const std::string& parentId, const std::string& childId, const std::string& label = "");
+    NodeId newId() { return nextId++; }
+    // `label` is written as is, `text` (a lexeme) with quotes escaped.
+    void emitNode(NodeId id, std::string_view label, std::string_view text = {});
+    void emitEdge(NodeId parentId, NodeId childId);
+    // A new node under the current parent.
+    NodeId openNode(std::string_view label, std::string_view text = {});
+
+    // --- Output Buffer ---
+    void append(std::string_view text);
+    void appendId(NodeId id);
+    void flush();
 
     // --- Parent Stack Management ---
-    void pushParent(const std::string& id);
-    void popParent();
-    std::string getCurrentParentId();
+    void pushParent(NodeId id) { parentIdStack.push_back(id); }
+    void popParent() { if (!parentIdStack.empty()) parentIdStack.pop_back(); }
+    NodeId getCurrentParentId() const { return parentIdStack.empty() ? noParent : parentIdStack.back(); }
 
     // --- Specialized Printing Helpers ---
-    void printCaseStmt(const std::string& switchNodeId, CaseStmt* caseStmt, int index);
-    void printPostfixTail(const std::string& parentId, PostfixTail* tail, int index);
+    void printCaseStmt(NodeId switchNodeId, CaseStmt* caseStmt);
+    void printPostfixTail(NodeId parentId, PostfixTail* tail);
 };
\ No newline at end of file
@@ -0,0 +1,2279 @@
+#include "benchmark.h"
+#include "allocation_counter.h"
+#include "ast_arena.h"
+#include "ast_cache.h"
+#include "ast_print.h"
+#include "declaration_nodes.h"
+#include "flat_ast.h"
+#include "incremental_document.h"
+#include "interner.h"
+#include "interpreter.h"
+#include "keywords.h"
+#include "parallel_parser.h"
+#include "parallel_scanner.h"
+#include "parser.h"
+#include "scanner.h"
+#include "source_file.h"
+#include "token.h"
+#include "token_buffer.h"
+#include "value.h"
+#include "vm.h"
+#include "ir_interpreter.h"
+#include "ir_passes.h"
+#include "operators.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <variant>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct AllocationSnapshot {
+    size_t count = allocationCount();
+    size_t bytes = allocatedBytes();
+};
+
+template <typename F>
+double timeSeconds(F&& body) {
+    auto begin = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+// Peak resident set size of this process so far, in bytes.
+size_t peakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// Writes a generated source file of `megabytes` MB unless it already exists.
+std::string ensureBenchmarkFile(size_t megabytes) {
+    std::string path = "bench_" + std::to_string(megabytes) + "mb.dav";
+    std::ifstream existing(path);
+    if (!existing.is_open()) {
+        std::ofstream out(path, std::ios::binary);
+        out << makeBenchmarkSource(megabytes * 1024 * 1024);
+    }
+    return path;
+}
+
+size_t parseSizeArg(const std::vector<std::string>& args, size_t index, size_t fallback) {
+    if (index >= args.size()) return fallback;
+    return static_cast<size_t>(std::strtoull(args[index].c_str(), nullptr, 10));
+}
+
+// Token layout used before lexemes became views into the source buffer: an
+// owned lexeme plus an eagerly decoded literal. Kept here only for comparison.
+struct OwnedToken {
+    TokenType type;
+    std::string lexeme;
+    std::optional<std::variant<double, std::string, bool>> literal;
+    int line;
+    int start;
+    int end;
+};
+
+// True if both streams have the same tokens (type, lexeme, symbol and position).
+bool sameTokens(const std::vector<Token>& a, const std::vector<Token>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].type != b[i].type || a[i].lexeme != b[i].lexeme || a[i].line != b[i].line ||
+            a[i].start != b[i].start || a[i].symbol != b[i].symbol) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Benchmarks ---
+
+// scan [megabytes]: scanner throughput and per-token memory cost.
+int benchScan(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 8);
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+
+    std::vector<Token> tokens;
+    AllocationSnapshot before;
+    double seconds = timeSeconds([&] {
+        Scanner scanner(source);
+        tokens = scanner.scanTokens();
+    });
+    AllocationSnapshot after;
+
+    size_t count = tokens.size();
+    double mb = source.size() / (1024.0 * 1024.0);
+    std::printf("scan: %.1f MB, %zu tokens, %.3f s, %.1f MB/s\n", mb, count, seconds, mb / seconds);
+    std::printf("  view tokens : sizeof(Token)=%zu, %.3f allocs/token, %.1f heap bytes/token\n",
+        sizeof(Token),
+        double(after.count - before.count) / count,
+        double(after.bytes - before.bytes) / count);
+
+    // Rebuild the old owned representation from the same token stream.
+    std::vector<OwnedToken> owned;
+    AllocationSnapshot ownedBefore;
+    double ownedSeconds = timeSeconds([&] {
+        owned.reserve(count);
+        for (const Token& token : tokens) {
+            owned.push_back({ token.type, std::string(token.lexeme), token.literal(),
+                token.line, token.start, token.end() });
+        }
+    });
+    AllocationSnapshot ownedAfter;
+    size_t ownedBytes = ownedAfter.bytes - ownedBefore.bytes;
+    std::printf("  owned tokens: sizeof(OwnedToken)=%zu, %.3f allocs/token, %.1f heap bytes/token (+%.3f s to build)\n",
+        sizeof(OwnedToken),
+        double(ownedAfter.count - ownedBefore.count) / count,
+        double(ownedBytes) / count,
+        ownedSeconds);
+    return 0;
+}
+
+// load [megabytes] [stringstream|read|mmap]: startup latency and peak RSS of
+// one loading strategy. Peak RSS only grows, so run each mode in its own process.
+int benchLoad(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 100);
+    std::string mode = args.size() > 1 ? args[1] : "mmap";
+    std::string path = ensureBenchmarkFile(megabytes);
+
+    size_t baseline = peakResidentBytes();
+    std::string owned;      // stringstream mode: the copy the old Scanner kept
+    SourceFile file;
+    std::string_view text;
+
+    double loadSeconds = timeSeconds([&] {
+        if (mode == "stringstream") {
+            // The previous main(): rdbuf into a stringstream, str() into a string,
+            // then the Scanner constructor copied it once more.
+            std::ifstream input(path);
+            std::stringstream buffer;
+            buffer << input.rdbuf();
+            std::string sourceCode = buffer.str();
+            owned = sourceCode;
+            text = owned;
+        }
+        else {
+            file.open(path, mode == "read" ? SourceFile::LoadMode::Read : SourceFile::LoadMode::Auto);
+            text = file.text();
+        }
+    });
+    size_t afterLoad = peakResidentBytes();
+
+    size_t tokenCount = 0;
+    double scanSeconds = timeSeconds([&] {
+        Scanner scanner(text);
+        tokenCount = scanner.scanTokens().size();
+    });
+    size_t afterScan = peakResidentBytes();
+
+    const double mb = 1024.0 * 1024.0;
+    std::printf("load(%s): %.1f MB input%s\n", mode.c_str(), text.size() / mb,
+        file.isMapped() ? " (mapped)" : "");
+    std::printf("  load latency : %.1f ms\n", loadSeconds * 1000.0);
+    std::printf("  peak RSS     : %.1f MB after load, %.1f MB after scan (%zu tokens, %.3f s)\n",
+        (afterLoad - baseline) / mb, (afterScan - baseline) / mb, tokenCount, scanSeconds);
+    return 0;
+}
+
+// keywords [millions]: keyword classification of identifier-heavy input, the
+// perfect hash against the std::map lookup the scanner used before.
+int benchKeywords(const std::vector<std::string>& args) {
+    size_t count = parseSizeArg(args, 0, 20) * 1000000;
+
+    // Roughly three identifiers per keyword, like real code.
+    static const char* const identifiers[] = {
+        "i", "count", "total", "label", "value", "index", "result", "fn_12",
+        "a", "b", "node", "items", "variance", "format", "doThing", "whileLoop"
+    };
+    std::vector<std::string> pool;
+    for (const char* name : identifiers) pool.emplace_back(name);
+    for (const KeywordEntry& entry : keywordList) pool.emplace_back(entry.text);
+    for (const char* name : identifiers) pool.emplace_back(name);
+    for (const char* name : identifiers) pool.emplace_back(name);
+
+    std::vector<std::string_view> words;
+    words.reserve(count);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        state = state * 1664525u + 1013904223u;
+        words.push_back(pool[(state >> 8) % pool.size()]);
+    }
+
+    std::map<std::string, TokenType> keywords;
+    for (const KeywordEntry& entry : keywordList) keywords[std::string(entry.text)] = entry.type;
+
+    size_t mapKeywords = 0;
+    double mapSeconds = timeSeconds([&] {
+        for (std::string_view word : words) {
+            std::string text(word);
+            TokenType type = keywords.count(text) ? keywords.at(text) : TokenType::IDENTIFIER;
+            mapKeywords += type != TokenType::IDENTIFIER;
+        }
+    });
+
+    size_t hashKeywords = 0;
+    double hashSeconds = timeSeconds([&] {
+        for (std::string_view word : words) {
+            hashKeywords += lookupKeyword(word) != TokenType::IDENTIFIER;
+        }
+    });
+
+    if (mapKeywords != hashKeywords) {
+        std::cerr << "keyword counts differ: map=" << mapKeywords << " hash=" << hashKeywords << "\n";
+        return 1;
+    }
+    std::printf("keywords: %zu words, %zu keywords\n", count, hashKeywords);
+    std::printf("  std::map     : %.1f ns/word\n", mapSeconds * 1e9 / count);
+    std::printf("  perfect hash : %.1f ns/word (%.1fx)\n", hashSeconds * 1e9 / count, mapSeconds / hashSeconds);
+    return 0;
+}
+
+// Generated code interleaved with long doc comments, deep indentation and
+// long string literals: the long runs the SIMD kernels are built for.
+std::string makeCommentHeavySource(size_t targetBytes) {
+    std::string out;
+    out.reserve(targetBytes + 1024);
+    for (int n = 0; out.size() < targetBytes; ++n) {
+        std::string id = std::to_string(n);
+        out += "/*\n * Block " + id + " documentation. The generator pads every function with a\n";
+        out += " * paragraph of prose so that comment bodies dominate the byte count, which\n";
+        out += " * is typical for the annotated library files shipped alongside our scripts.\n */\n";
+        out += "fun documented_function_number_" + id + "(first_argument, second_argument) {\n";
+        out += "                // Deeply indented line comment explaining the next statement at length.\n";
+        out += "                var message = \"a fairly long string literal used as a log message " + id + "\";\n";
+        out += "                return first_argument + second_argument;\n";
+        out += "}\n\n";
+    }
+    return out;
+}
+
+// scan-backends [megabytes]: scanner throughput per SIMD backend on dense code
+// and on comment-heavy code. Every backend's token stream is checked against
+// the scalar one.
+int benchScanBackends(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 16);
+    const ScanBackend backends[] = { ScanBackend::Scalar, ScanBackend::SSE2, ScanBackend::AVX2 };
+    std::printf("scan-backends: auto = %s\n", scanBackendName(resolveScanBackend(ScanBackend::Auto)));
+
+    for (int corpus = 0; corpus < 2; ++corpus) {
+        std::string source = corpus == 0
+            ? makeBenchmarkSource(megabytes * 1024 * 1024)
+            : makeCommentHeavySource(megabytes * 1024 * 1024);
+        double mb = source.size() / (1024.0 * 1024.0);
+        std::printf("  %s corpus, %.1f MB\n", corpus == 0 ? "dense" : "comment-heavy", mb);
+
+        std::vector<Token> reference;
+        double scalarSeconds = 0.0;
+        for (ScanBackend backend : backends) {
+            if (resolveScanBackend(backend) != backend) {
+                std::printf("    %-7s: not supported on this CPU\n", scanBackendName(backend));
+                continue;
+            }
+
+            std::vector<Token> tokens;
+            double best = 0.0;
+            for (int run = 0; run < 5; ++run) {
+                double seconds = timeSeconds([&] {
+                    Scanner scanner(source, backend);
+                    tokens = scanner.scanTokens();
+                });
+                if (run == 0 || seconds < best) best = seconds;
+            }
+
+            if (backend == ScanBackend::Scalar) {
+                reference = std::move(tokens);
+                scalarSeconds = best;
+            }
+            else if (!sameTokens(reference, tokens)) {
+                std::printf("    %-7s: token stream differs from scalar!\n", scanBackendName(backend));
+                return 1;
+            }
+            std::printf("    %-7s: %7.1f MB/s (%.2fx scalar)\n", scanBackendName(backend), mb / best, scalarSeconds / best);
+        }
+    }
+    return 0;
+}
+
+// scan-parallel [megabytes] [max threads]: ParallelScanner scaling from 1 to 32
+// threads. Each result is checked token for token against the sequential scan.
+int benchScanParallel(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 64);
+    unsigned maxThreads = static_cast<unsigned>(parseSizeArg(args, 1, 32));
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+    double mb = source.size() / (1024.0 * 1024.0);
+
+    std::vector<Token> reference;
+    double sequentialSeconds = timeSeconds([&] {
+        Scanner scanner(source);
+        reference = scanner.scanTokens();
+    });
+    std::printf("scan-parallel: %.1f MB, %zu tokens, %u hardware threads\n",
+        mb, reference.size(), std::thread::hardware_concurrency());
+    std::printf("  sequential: %7.1f MB/s\n", mb / sequentialSeconds);
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::vector<Token> tokens;
+        double best = 0.0;
+        for (int run = 0; run < 3; ++run) {
+            double seconds = timeSeconds([&] {
+                ParallelScanner scanner(source, threads);
+                tokens = scanner.scanTokens();
+            });
+            if (run == 0 || seconds < best) best = seconds;
+        }
+        if (!sameTokens(reference, tokens)) {
+            std::printf("  %2u threads: token stream differs from sequential!\n", threads);
+            return 1;
+        }
+        std::printf("  %2u threads: %7.1f MB/s (%.2fx)\n", threads, mb / best, sequentialSeconds / best);
+    }
+    return 0;
+}
+
+// intern [megabytes]: what interning identifiers and string literals saves
+// over one std::string per occurrence, what it adds to scanning, and name
+// comparisons as strings versus symbols.
+int benchIntern(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 8);
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+    double mb = source.size() / (1024.0 * 1024.0);
+
+    Interner::Stats before = symbols().stats();
+    std::vector<Token> tokens;
+    double scanSeconds = timeSeconds([&] {
+        Scanner scanner(source);
+        tokens = scanner.scanTokens();
+    });
+    Interner::Stats after = symbols().stats();
+
+    std::vector<std::string_view> names;
+    std::vector<Symbol> nameSymbols;
+    size_t textBytes = 0;
+    for (const Token& token : tokens) {
+        if (token.symbol == noSymbol) continue;
+        std::string_view text = token.type == TokenType::STRING ? token.stringValue() : token.lexeme;
+        names.push_back(text);
+        nameSymbols.push_back(token.symbol);
+        textBytes += text.size();
+    }
+    size_t occurrences = names.size();
+
+    // One owned string per occurrence, as the tokens and AST used to carry.
+    std::vector<std::string> owned;
+    owned.reserve(occurrences);
+    AllocationSnapshot ownedBefore;
+    for (std::string_view text : names) owned.emplace_back(text);
+    AllocationSnapshot ownedAfter;
+    size_t ownedBytes = occurrences * sizeof(std::string) + (ownedAfter.bytes - ownedBefore.bytes);
+
+    size_t symbolCount = after.symbols - before.symbols;
+    size_t internedBytes = occurrences * sizeof(Symbol) + (after.textBytes - before.textBytes) +
+        (after.tableBytes - before.tableBytes);
+
+    // The scanner's share: every name through a fresh cache, as one Scanner does.
+    double internSeconds = timeSeconds([&] {
+        SymbolCache cache(symbols());
+        for (std::string_view text : names) cache.intern(text);
+    });
+
+    // Each name against the one 64 occurrences earlier.
+    size_t stringMatches = 0;
+    double stringSeconds = timeSeconds([&] {
+        for (int pass = 0; pass < 10; ++pass) {
+            for (size_t i = 64; i < occurrences; ++i) stringMatches += owned[i] == owned[i - 64];
+        }
+    });
+    size_t symbolMatches = 0;
+    double symbolSeconds = timeSeconds([&] {
+        for (int pass = 0; pass < 10; ++pass) {
+            for (size_t i = 64; i < occurrences; ++i) symbolMatches += nameSymbols[i] == nameSymbols[i - 64];
+        }
+    });
+    if (stringMatches != symbolMatches) {
+        std::cerr << "comparisons differ: strings=" << stringMatches << " symbols=" << symbolMatches << "\n";
+        return 1;
+    }
+    size_t comparisons = occurrences > 64 ? 10 * (occurrences - 64) : 1;
+
+    std::printf("intern: %.1f MB, %zu tokens, %zu identifier/string occurrences (%.1f MB of text), %zu distinct\n",
+        mb, tokens.size(), occurrences, textBytes / (1024.0 * 1024.0), symbolCount);
+    std::printf("  std::string per occurrence: %8.1f MB (%.1f bytes each)\n",
+        ownedBytes / (1024.0 * 1024.0), double(ownedBytes) / occurrences);
+    std::printf("  interned                  : %8.1f MB (%.1f bytes each: symbol, text once, tables)\n",
+        internedBytes / (1024.0 * 1024.0), double(internedBytes) / occurrences);
+    std::printf("  saved                     : %8.1f MB (%.1fx smaller)\n",
+        (double(ownedBytes) - double(internedBytes)) / (1024.0 * 1024.0), double(ownedBytes) / internedBytes);
+    std::printf("  interning: %.1f ns/name, %.1f%% of a %.3f s scan\n",
+        internSeconds * 1e9 / occurrences, 100.0 * internSeconds / scanSeconds, scanSeconds);
+    std::printf("  name compare: std::string %.2f ns, Symbol %.2f ns\n",
+        stringSeconds * 1e9 / comparisons, symbolSeconds * 1e9 / comparisons);
+    return 0;
+}
+
+// parse [megabytes] [arena|heap]: parse time, time to free the AST and peak RSS
+// with nodes in an AstArena or allocated one by one (the previous scheme).
+// Peak RSS only grows, so run each strategy in its own process.
+int benchParse(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 32);
+    std::string mode = args.size() > 1 ? args[1] : "arena";
+    AstArena::Strategy strategy = mode == "heap" ? AstArena::Strategy::Heap : AstArena::Strategy::Pages;
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+    std::vector<Token> tokens = Scanner(source).scanTokens();
+
+    size_t baseline = peakResidentBytes();
+    AstArena arena(strategy);
+    size_t declarations = 0;
+    AllocationSnapshot before;
+    double parseSeconds = timeSeconds([&] {
+        Parser parser(tokens, arena);
+        declarations = parser.parse().size();
+    });
+    AllocationSnapshot after;
+    size_t afterParse = peakResidentBytes();
+    size_t nodes = arena.nodeCount();
+    double freeSeconds = timeSeconds([&] { arena.release(); });
+
+    const double mb = 1024.0 * 1024.0;
+    std::printf("parse(%s): %.1f MB, %zu tokens, %zu declarations, %zu nodes\n",
+        mode == "heap" ? "heap" : "arena", source.size() / mb, tokens.size(), declarations, nodes);
+    std::printf("  parse   : %.3f s (%.1f ns/node), %zu heap allocations\n",
+        parseSeconds, parseSeconds * 1e9 / nodes, after.count - before.count);
+    std::printf("  free    : %.3f s (%.1f ns/node)\n", freeSeconds, freeSeconds * 1e9 / nodes);
+    std::printf("  peak RSS: +%.1f MB during parse\n", (afterParse - baseline) / mb);
+    return 0;
+}
+
+// parse-throughput [megabytes]: parser speed in tokens per second, from a token
+// vector and pulling from the Scanner. The stream figure includes scanning.
+int benchParseThroughput(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 16);
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+    std::vector<Token> tokens = Scanner(source).scanTokens();
+    std::printf("parse-throughput: %.1f MB, %zu tokens\n", source.size() / (1024.0 * 1024.0), tokens.size());
+
+    for (int streaming = 0; streaming < 2; ++streaming) {
+        double best = 0.0;
+        for (int run = 0; run < 5; ++run) {
+            AstArena arena;
+            double seconds = timeSeconds([&] {
+                if (streaming) {
+                    Scanner scanner(source);
+                    Parser(scanner, arena).parse();
+                }
+                else {
+                    Parser(tokens, arena).parse();
+                }
+            });
+            if (run == 0 || seconds < best) best = seconds;
+        }
+        std::printf("  %-6s: %6.1f M tokens/s (%.1f ns/token)\n", streaming ? "stream" : "vector",
+            tokens.size() / best / 1e6, best * 1e9 / tokens.size());
+    }
+    return 0;
+}
+
+// Writes random (but reproducible) expressions using every operator the
+// grammar knows: binary, logical, conditional, assignment, unary, postfix
+// and parentheses.
+class ExpressionGenerator {
+public:
+    explicit ExpressionGenerator(std::string& out) : out(out) {}
+
+    void expression(int depth) {
+        uint32_t pick = next() % 16;
+        if (depth <= 0 || pick < 4) {
+            operand();
+        }
+        else if (pick < 11) {
+            static const char* const binary[] = {
+                " || ", " && ", " | ", " ^ ", " & ", " == ", " != ", " < ", " <= ",
+                " > ", " >= ", " << ", " >> ", " + ", " - ", " * ", " / ", " % "
+            };
+            expression(depth - 1);
+            out += binary[next() % 18];
+            expression(depth - 1);
+        }
+        else if (pick < 12) {
+            expression(depth - 1);
+            out += " ? ";
+            expression(depth - 1);
+            out += " : ";
+            expression(depth - 1);
+        }
+        else if (pick < 13) {
+            static const char* const assign[] = { " = ", " += ", " -= ", " *= ", " <<= ", " |= " };
+            // Parenthesized so the target stays valid inside other operators.
+            out += "(v" + std::to_string(next() % 8);
+            out += assign[next() % 6];
+            expression(depth - 1);
+            out += ")";
+        }
+        else if (pick < 14) {
+            static const char* const unary[] = { "!", "~", "-", "+", "++", "--" };
+            out += unary[next() % 6];
+            operand();
+        }
+        else {
+            out += "(";
+            expression(depth - 1);
+            out += ")";
+        }
+    }
+
+private:
+    std::string& out;
+    uint32_t state = 2463534242u;
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    void operand() {
+        switch (next() % 6) {
+        case 0: out += std::to_string(next() % 1000); break;
+        case 1: out += "f(a, " + std::to_string(next() % 10) + ")"; break;
+        case 2: out += "items[i].size"; break;
+        case 3: out += "n++"; break;
+        default: out += "v" + std::to_string(next() % 8); break;
+        }
+    }
+};
+
+std::string makeExpressionHeavySource(size_t targetBytes) {
+    std::string out;
+    out.reserve(targetBytes + 1024);
+    ExpressionGenerator generator(out);
+    while (out.size() < targetBytes) {
+        out += "print ";
+        generator.expression(6);
+        out += ";\n";
+    }
+    return out;
+}
+
+// DOT rendering of a program, used to compare the trees of two parsers.
+std::string renderAst(const std::vector<Declaration*>& ast) {
+    std::ostringstream dot;
+    AstPrinter printer(dot);
+    printer.print(ast);
+    return dot.str();
+}
+
+// parse-pratt [megabytes]: the Pratt expression parser against the recursive
+// descent chain on expression-heavy and on ordinary code. Both must produce
+// identical trees (compared through the DOT printer) and diagnostics.
+int benchParsePratt(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 8);
+    const ExpressionParser parsers[] = { ExpressionParser::Descent, ExpressionParser::Pratt };
+
+    for (int corpus = 0; corpus < 2; ++corpus) {
+        std::string source = corpus == 0
+            ? makeExpressionHeavySource(megabytes * 1024 * 1024)
+            : makeBenchmarkSource(megabytes * 1024 * 1024);
+        std::vector<Token> tokens = Scanner(source).scanTokens();
+        std::printf("parse-pratt: %s corpus, %.1f MB, %zu tokens\n",
+            corpus == 0 ? "expression-heavy" : "dense", source.size() / (1024.0 * 1024.0), tokens.size());
+
+        std::string reference;
+        double descentSeconds = 0.0;
+        for (ExpressionParser expressionParser : parsers) {
+            double best = 0.0;
+            for (int run = 0; run < 5; ++run) {
+                AstArena arena;
+                double seconds = timeSeconds([&] {
+                    Parser(tokens, arena, expressionParser).parse();
+                });
+                if (run == 0 || seconds < best) best = seconds;
+            }
+
+            AstArena arena;
+            Parser parser(tokens, arena, expressionParser);
+            std::string dot = renderAst(parser.parse());
+            if (parser.Error()) {
+                std::printf("  generated source failed to parse!\n");
+                return 1;
+            }
+            bool pratt = expressionParser == ExpressionParser::Pratt;
+            if (!pratt) {
+                reference = std::move(dot);
+                descentSeconds = best;
+            }
+            else if (dot != reference) {
+                std::printf("  pratt AST differs from recursive descent!\n");
+                return 1;
+            }
+            std::printf("  %-7s: %6.1f M tokens/s (%.2fx descent)\n", pratt ? "pratt" : "descent",
+                tokens.size() / best / 1e6, descentSeconds / best);
+        }
+    }
+    return 0;
+}
+
+// The benchmark program with syntax errors sprinkled in: a missing
+// initializer in every 11th function and a stray closing brace after every
+// 37th.
+std::string makeBrokenSource(size_t targetBytes) {
+    std::string source = makeBenchmarkSource(targetBytes);
+    std::string out;
+    out.reserve(source.size());
+    size_t function = 0;
+    size_t lineStart = 0;
+    while (lineStart < source.size()) {
+        size_t lineEnd = source.find('\n', lineStart);
+        lineEnd = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+        std::string_view line(source.data() + lineStart, lineEnd - lineStart);
+        if (line.rfind("fun ", 0) == 0) ++function;
+        if (function % 11 == 0 && line == "    var total = 0;\n") out += "    var total = ;\n";
+        else if (function % 37 == 0 && line == "}\n") out += "}\n}\n";
+        else out += line;
+        lineStart = lineEnd;
+    }
+    return out;
+}
+
+// parse-parallel [megabytes] [max threads]: ParallelParser scaling from 1 to
+// `max threads` threads, on the benchmark program and on a copy with syntax
+// errors. Every tree and every diagnostic must match the serial parser's.
+int benchParseParallel(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 16);
+    unsigned maxThreads = static_cast<unsigned>(parseSizeArg(args, 1, 8));
+
+    for (int corpus = 0; corpus < 2; ++corpus) {
+        std::string source = corpus == 0
+            ? makeBenchmarkSource(megabytes * 1024 * 1024)
+            : makeBrokenSource(megabytes * 1024 * 1024);
+        TokenBuffer tokens = Scanner(source).scanBuffer();
+        std::printf("parse-parallel: %s corpus, %.1f MB, %zu tokens, %u hardware threads\n",
+            corpus == 0 ? "clean" : "broken", source.size() / (1024.0 * 1024.0), tokens.size(),
+            std::thread::hardware_concurrency());
+
+        // Diagnostics go to std::cerr, so capture it around each parse.
+        auto parse = [&](unsigned threads, std::string& dot, std::string& diagnostics, ParallelParser::Stats& stats) {
+            std::ostringstream captured;
+            std::streambuf* saved = std::cerr.rdbuf(captured.rdbuf());
+            AstArena arena;
+            ParallelParser parser(tokens, arena, threads);
+            dot = renderAst(parser.parse());
+            std::cerr.rdbuf(saved);
+            diagnostics = captured.str();
+            stats = parser.stats();
+        };
+
+        std::string referenceDot, referenceDiagnostics;
+        ParallelParser::Stats stats;
+        parse(1, referenceDot, referenceDiagnostics, stats);
+        double serial = 0.0;
+        for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+            std::string dot, diagnostics;
+            parse(threads, dot, diagnostics, stats);
+            if (dot != referenceDot || diagnostics != referenceDiagnostics) {
+                std::printf("  %u threads: %s differ from the serial parser's!\n", threads,
+                    dot != referenceDot ? "tree" : "diagnostics");
+                return 1;
+            }
+            double best = 0.0;
+            for (int run = 0; run < 3; ++run) {
+                std::ostringstream discarded;
+                std::streambuf* saved = std::cerr.rdbuf(discarded.rdbuf());
+                AstArena arena;
+                double seconds = timeSeconds([&] { ParallelParser(tokens, arena, threads).parse(); });
+                std::cerr.rdbuf(saved);
+                if (run == 0 || seconds < best) best = seconds;
+            }
+            if (threads == 1) serial = best;
+            std::printf("  %2u threads: %6.1f M tokens/s (%.2fx), %zu pieces, %zu parsed again, %zu stolen\n",
+                threads, tokens.size() / best / 1e6, serial / best, stats.pieces, stats.piecesReparsed, stats.stolen);
+        }
+        if (corpus == 1) {
+            size_t lines = std::count(referenceDiagnostics.begin(), referenceDiagnostics.end(), '\n');
+            std::printf("  (%zu diagnostics, identical in every run)\n", lines);
+        }
+    }
+    return 0;
+}
+
+// Accepts and drops everything written to it, so timing the printer against
+// it leaves out the cost of storing the output.
+class DiscardBuffer : public std::streambuf {
+protected:
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+};
+
+// dot [megabytes]: AstPrinter throughput in nodes per second on the benchmark
+// program, writing to a discarding stream, to memory and to a file, with the
+// heap allocations each print performs.
+int benchDot(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 16);
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+    TokenBuffer tokens = Scanner(source).scanBuffer();
+    AstArena arena;
+    std::vector<Declaration*> ast = Parser(tokens, arena).parse();
+    std::ostringstream reference;
+    AstPrinter referencePrinter(reference);
+    referencePrinter.print(ast);
+    const std::string dot = reference.str();
+    const size_t nodes = referencePrinter.nodeCount();
+    std::printf("dot: %.1f MB program, %zu nodes, %.1f MB of DOT\n",
+        source.size() / (1024.0 * 1024.0), nodes, dot.size() / (1024.0 * 1024.0));
+
+    const char* sinks[] = { "discard", "memory", "file" };
+    for (int sink = 0; sink < 3; ++sink) {
+        double best = 0.0;
+        size_t allocations = 0;
+        for (int run = 0; run < 3; ++run) {
+            DiscardBuffer discard;
+            std::ostream discarded(&discard);
+            std::ostringstream memory;
+            std::ofstream file;
+            if (sink == 2) file.open("bench_ast.dot", std::ios::binary);
+            std::ostream& out = sink == 0 ? discarded : sink == 1 ? static_cast<std::ostream&>(memory) : file;
+            AllocationSnapshot before;
+            double seconds = timeSeconds([&] {
+                AstPrinter printer(out);
+                printer.print(ast);
+                out.flush();
+            });
+            AllocationSnapshot after;
+            if (sink == 1 && memory.str() != dot) {
+                std::printf("  output differs between runs!\n");
+                return 1;
+            }
+            if (run == 0 || seconds < best) best = seconds;
+            allocations = after.count - before.count;
+        }
+        std::printf("  %-7s: %6.1f M nodes/s, %6.1f MB/s, %zu heap allocations\n", sinks[sink],
+            nodes / best / 1e6, dot.size() / best / (1024.0 * 1024.0), allocations);
+    }
+    std::remove("bench_ast.dot");
+    return 0;
+}
+
+// --- Hardware Counters ---
+// What `perf stat` would report for one region of code: cache misses,
+// L1 data read misses, instructions and cycles for this thread. On Linux the
+// counters come from perf_event_open; elsewhere (or when the kernel refuses,
+// e.g. under a strict perf_event_paranoid) they read as unavailable.
+
+class PerfCounters {
+public:
+    enum Counter { CacheMisses, L1dMisses, Instructions, Cycles, Count };
+
+    PerfCounters() {
+#ifdef __linux__
+        const uint64_t configs[Count][2] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        };
+        for (int i = 0; i < Count; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = static_cast<uint32_t>(configs[i][0]);
+            attr.config = configs[i][1];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (int i = 0; i < Count; ++i) {
+            values[i] = -1;
+            if (fds[i] < 0) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value = 0;
+            if (read(fds[i], &value, sizeof(value)) == sizeof(value)) values[i] = static_cast<long long>(value);
+        }
+#endif
+    }
+
+    // -1 when the counter could not be opened or read.
+    long long value(Counter counter) const { return values[counter]; }
+
+private:
+    int fds[Count] = { -1, -1, -1, -1 };
+    long long values[Count] = { -1, -1, -1, -1 };
+};
+
+std::string perCounter(long long value, size_t per) {
+    if (value < 0) return "unavailable";
+    char text[64];
+    std::snprintf(text, sizeof(text), "%lld (%.3f/token)", value, static_cast<double>(value) / per);
+    return text;
+}
+
+// parse-soa [megabytes]: parsing from a vector<Token> against the structure of
+// arrays TokenBuffer: bytes per token, parse time and, where the hardware
+// counters are available, cache misses. Both must produce identical trees.
+int benchParseSoa(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 16);
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+    std::vector<Token> tokens = Scanner(source).scanTokens();
+    TokenBuffer buffer = Scanner(source).scanBuffer();
+    tokens.shrink_to_fit();
+    std::printf("parse-soa: %.1f MB, %zu tokens\n", source.size() / (1024.0 * 1024.0), tokens.size());
+
+    std::string reference;
+    for (int soa = 0; soa < 2; ++soa) {
+        double best = 0.0;
+        PerfCounters counters;
+        for (int run = 0; run < 5; ++run) {
+            AstArena arena;
+            // Counted on the final run only, with the arena already warm.
+            if (run == 4) counters.start();
+            double seconds = timeSeconds([&] {
+                if (soa) Parser(buffer, arena).parse();
+                else Parser(tokens, arena).parse();
+            });
+            if (run == 4) counters.stop();
+            if (run == 0 || seconds < best) best = seconds;
+        }
+
+        AstArena arena;
+        std::string dot;
+        bool failed = false;
+        if (soa) {
+            Parser parser(buffer, arena);
+            dot = renderAst(parser.parse());
+            failed = parser.Error();
+        }
+        else {
+            Parser parser(tokens, arena);
+            dot = renderAst(parser.parse());
+            failed = parser.Error();
+        }
+        if (failed) {
+            std::printf("  generated source failed to parse!\n");
+            return 1;
+        }
+        if (!soa) reference = std::move(dot);
+        else if (dot != reference) {
+            std::printf("  TokenBuffer AST differs from vector<Token>!\n");
+            return 1;
+        }
+
+        size_t bytes = soa ? buffer.memoryBytes() : tokens.capacity() * sizeof(Token);
+        std::printf("  %-6s: %5.1f bytes/token, %6.1f M tokens/s (%.1f ns/token)\n", soa ? "soa" : "vector",
+            static_cast<double>(bytes) / tokens.size(), tokens.size() / best / 1e6, best * 1e9 / tokens.size());
+        std::printf("          cache misses %s, L1d read misses %s\n",
+            perCounter(counters.value(PerfCounters::CacheMisses), tokens.size()).c_str(),
+            perCounter(counters.value(PerfCounters::L1dMisses), tokens.size()).c_str());
+        std::printf("          instructions %s, cycles %s\n",
+            perCounter(counters.value(PerfCounters::Instructions), tokens.size()).c_str(),
+            perCounter(counters.value(PerfCounters::Cycles), tokens.size()).c_str());
+    }
+    return 0;
+}
+
+// --- Flat AST ---
+
+// What a full-tree traversal computes: the number of nodes (CaseStmt and
+// PostfixTail included) and the sum of their tokens' lines, so the walks
+// cannot be optimized away and can be checked against each other.
+struct TreeSum {
+    size_t nodes = 0;
+    size_t lines = 0;
+
+    bool operator==(const TreeSum& other) const { return nodes == other.nodes && lines == other.lines; }
+};
+
+// Walks the pointer AST through the virtual accept().
+class PointerTreeWalker : public AstVisitor {
+public:
+    TreeSum sum;
+
+    void walk(AstNode* node) {
+        if (node != nullptr) node->accept(*this);
+    }
+
+    void visitVarDecl(VarDecl* decl) override { count(&decl->name); walk(decl->initializer); }
+    void visitFuncDecl(FuncDecl* decl) override { count(&decl->name); walk(decl->body); }
+    void visitBlockStmt(BlockStmt* stmt) override {
+        count();
+        for (Declaration* statement : stmt->statements) walk(statement);
+    }
+    void visitIfStmt(IfStmt* stmt) override {
+        count();
+        walk(stmt->condition);
+        walk(stmt->thenBranch);
+        walk(stmt->elseBranch);
+    }
+    void visitForStmt(ForStmt* stmt) override {
+        count();
+        walk(stmt->initializer);
+        walk(stmt->condition);
+        walk(stmt->increment);
+        walk(stmt->body);
+    }
+    void visitWhileStmt(WhileStmt* stmt) override { count(); walk(stmt->condition); walk(stmt->body); }
+    void visitDoWhileStmt(DoWhileStmt* stmt) override { count(); walk(stmt->body); walk(stmt->condition); }
+    void visitSwitchStmt(SwitchStmt* stmt) override {
+        count();
+        walk(stmt->condition);
+        for (CaseStmt* caseStmt : stmt->cases) {
+            count();
+            walk(caseStmt->value);
+            for (Declaration* statement : caseStmt->body) walk(statement);
+        }
+    }
+    void visitBreakStmt(BreakStmt*) override { count(); }
+    void visitContinueStmt(ContinueStmt*) override { count(); }
+    void visitReturnStmt(ReturnStmt* stmt) override { count(); walk(stmt->value); }
+    void visitPrintStmt(PrintStmt* stmt) override { count(); walk(stmt->expression); }
+    void visitExprStmt(ExprStmt* stmt) override { count(); walk(stmt->expression); }
+    void visitAssignmentExpr(AssignmentExpr* expr) override { count(&expr->op); walk(expr->left); walk(expr->right); }
+    void visitConditionalExpr(ConditionalExpr* expr) override {
+        count();
+        walk(expr->condition);
+        walk(expr->thenExpr);
+        walk(expr->elseExpr);
+    }
+    void visitLogicalExpr(LogicalExpr* expr) override { count(&expr->op); walk(expr->left); walk(expr->right); }
+    void visitBinaryExpr(BinaryExpr* expr) override { count(&expr->op); walk(expr->left); walk(expr->right); }
+    void visitUnaryExpr(UnaryExpr* expr) override { count(&expr->op); walk(expr->right); }
+    void visitPostfixExpr(PostfixExpr* expr) override {
+        count();
+        walk(expr->primary);
+        for (PostfixTail* tail : expr->tails) {
+            count(&tail->op);
+            walk(tail->indexOrCondition);
+            for (Expr* argument : tail->arguments) walk(argument);
+        }
+    }
+    void visitPrimaryExpr(PrimaryExpr* expr) override { count(&expr->value); }
+    void visitGroupingExpr(GroupingExpr* expr) override { count(); walk(expr->expression); }
+
+private:
+    void count(const TokenRef* token = nullptr) {
+        ++sum.nodes;
+        if (token != nullptr) sum.lines += token->line;
+    }
+};
+
+// The same traversal over the flat AST, dispatching with a switch.
+void walkFlat(const FlatAst& ast, NodeIndex index, TreeSum& sum) {
+    const FlatNode& node = ast[index];
+    ++sum.nodes;
+    if (node.token != noToken) sum.lines += ast.tokens[node.token].line;
+    ast.forEachChild(index, [&](NodeIndex child) { walkFlat(ast, child, sum); });
+}
+
+// flat-ast [megabytes]: the flat index-based AST against the pointer AST:
+// memory footprint, conversion time, and a full-tree traversal (virtual
+// accept, switch over the flat nodes, and a plain scan of the node array,
+// which the flat layout allows when the order does not matter).
+int benchFlatAst(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 16);
+    std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+    TokenBuffer tokens = Scanner(source).scanBuffer();
+    AstArena parseArena;
+    std::vector<Declaration*> ast = Parser(tokens, parseArena).parse();
+
+    FlatAst flat;
+    double flattenSeconds = timeSeconds([&] { flat = toFlatAst(ast); });
+    flat.nodes.shrink_to_fit();
+    flat.lists.shrink_to_fit();
+    flat.tokens.shrink_to_fit();
+
+    // Rebuilding the pointer tree from the flat one allocates exactly what the
+    // pointer AST holds (arena pages plus the child vectors).
+    AstArena arena;
+    AllocationSnapshot before;
+    std::vector<Declaration*> rebuilt;
+    double unflattenSeconds = timeSeconds([&] { rebuilt = toPointerAst(flat, arena); });
+    AllocationSnapshot after;
+    if (renderAst(rebuilt) != renderAst(ast)) {
+        std::printf("  AST changed in the round trip through FlatAst!\n");
+        return 1;
+    }
+
+    const double mb = 1024.0 * 1024.0;
+    size_t pointerBytes = after.bytes - before.bytes;
+    std::printf("flat-ast: %.1f MB, %zu tokens, %zu nodes\n", source.size() / mb, tokens.size(), flat.nodes.size());
+    std::printf("  memory : pointer %.1f MB (%.1f B/node), flat %.1f MB (%.1f B/node)\n",
+        pointerBytes / mb, static_cast<double>(pointerBytes) / flat.nodes.size(),
+        flat.memoryBytes() / mb, static_cast<double>(flat.memoryBytes()) / flat.nodes.size());
+    std::printf("           flat nodes %.1f MB, lists %.1f MB, tokens %.1f MB\n",
+        flat.nodes.capacity() * sizeof(FlatNode) / mb, flat.lists.capacity() * sizeof(uint32_t) / mb,
+        flat.tokens.capacity() * sizeof(TokenRef) / mb);
+    std::printf("  convert: to flat %.3f s, back %.3f s\n", flattenSeconds, unflattenSeconds);
+
+    TreeSum reference;
+    const char* const names[] = { "virtual accept", "flat switch", "flat scan" };
+    for (int walk = 0; walk < 3; ++walk) {
+        double best = 0.0;
+        TreeSum sum;
+        for (int run = 0; run < 5; ++run) {
+            double seconds = timeSeconds([&] {
+                sum = TreeSum();
+                if (walk == 0) {
+                    PointerTreeWalker walker;
+                    for (Declaration* declaration : rebuilt) walker.walk(declaration);
+                    sum = walker.sum;
+                }
+                else if (walk == 1) {
+                    for (NodeIndex root : flat.roots) {
+                        if (root != noNode) walkFlat(flat, root, sum);
+                    }
+                }
+                else {
+                    for (const FlatNode& node : flat.nodes) {
+                        ++sum.nodes;
+                        if (node.token != noToken) sum.lines += flat.tokens[node.token].line;
+                    }
+                }
+            });
+            if (run == 0 || seconds < best) best = seconds;
+        }
+        if (walk == 0) reference = sum;
+        else if (!(sum == reference)) {
+            std::printf("  %s visited a different tree!\n", names[walk]);
+            return 1;
+        }
+        std::printf("  %-14s: %.3f s (%.1f ns/node)\n", names[walk], best, best * 1e9 / sum.nodes);
+    }
+    return 0;
+}
+
+// ast-cache [megabytes]: startup with and without the AST cache. Cold is
+// loading, scanning and parsing the file; warm is loading it, hashing it,
+// validating the mapped cache entry and building the pointer nodes from it.
+// Both trees must print the same.
+int benchAstCache(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 16);
+    std::string path = ensureBenchmarkFile(megabytes);
+    AstCache cache("bench_ast_cache");
+    const double mb = 1024.0 * 1024.0;
+
+    std::string coldDot;
+    double cold = 0.0;
+    double store = 0.0;
+    for (int run = 0; run < 5; ++run) {
+        SourceFile file;
+        AstArena arena;
+        std::vector<Declaration*> ast;
+        double seconds = timeSeconds([&] {
+            file.open(path);
+            TokenBuffer tokens = Scanner(file.text()).scanBuffer();
+            ast = Parser(tokens, arena).parse();
+        });
+        if (run == 0 || seconds < cold) cold = seconds;
+        if (run == 0) {
+            store = timeSeconds([&] { cache.store(file.text(), toFlatAst(ast)); });
+            if (!cache.error().empty()) {
+                std::printf("  could not store the cache: %s\n", cache.error().c_str());
+                return 1;
+            }
+            coldDot = renderAst(ast);
+        }
+    }
+
+    std::string warmDot;
+    double warm = 0.0, hash = 0.0;
+    size_t cacheBytes = 0;
+    for (int run = 0; run < 5; ++run) {
+        SourceFile file;
+        AstArena arena;
+        std::vector<Declaration*> ast;
+        bool loaded = false;
+        double seconds = timeSeconds([&] {
+            file.open(path);
+            loaded = cache.load(file.text(), arena, ast);
+        });
+        if (!loaded) {
+            std::printf("  cache miss on a warm run: %s\n", cache.error().c_str());
+            return 1;
+        }
+        if (run == 0 || seconds < warm) {
+            warm = seconds;
+            hash = timeSeconds([&] { AstCache::contentHash(file.text()); });
+        }
+        if (run == 0) {
+            warmDot = renderAst(ast);
+            SourceFile entry;
+            entry.open(cache.pathFor(AstCache::contentHash(file.text())));
+            cacheBytes = entry.size();
+        }
+    }
+    if (warmDot != coldDot) {
+        std::printf("  cached AST differs from the parsed one!\n");
+        return 1;
+    }
+
+    std::printf("ast-cache: %s (%.1f MB), cache entry %.1f MB\n", path.c_str(), megabytes * 1.0, cacheBytes / mb);
+    std::printf("  cold : %.3f s (load, scan, parse)\n", cold);
+    std::printf("  store: %.3f s (flatten and write, first run only)\n", store);
+    std::printf("  warm : %.3f s (%.1fx faster; hashing the source takes %.3f s of it)\n", warm, cold / warm, hash);
+    return 0;
+}
+
+// True if both trees have the same shape and the same tokens (kind, text,
+// symbol and line) in every node.
+bool sameFlatAst(const FlatAst& a, const FlatAst& b) {
+    if (a.nodes.size() != b.nodes.size() || a.lists != b.lists || a.roots != b.roots ||
+        a.tokens.size() != b.tokens.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.nodes.size(); ++i) {
+        const FlatNode& x = a.nodes[i];
+        const FlatNode& y = b.nodes[i];
+        if (x.kind != y.kind || x.token != y.token || x.a != y.a || x.b != y.b || x.c != y.c) return false;
+    }
+    for (size_t i = 0; i < a.tokens.size(); ++i) {
+        const TokenRef& x = a.tokens[i];
+        const TokenRef& y = b.tokens[i];
+        if (x.type != y.type || x.lexeme != y.lexeme || x.line != y.line || x.symbol != y.symbol) return false;
+    }
+    return true;
+}
+
+// Random edits for the incremental fuzzer. Most are what typing does (a few
+// characters inserted or deleted, a line split, a statement pasted); the rest
+// reach further: opening a string or a block comment, deleting a whole
+// region, or occasionally putting the original text back.
+class EditGenerator {
+public:
+    struct Edit {
+        size_t offset;
+        size_t removed;
+        std::string inserted;
+    };
+
+    explicit EditGenerator(uint64_t seed) : random(seed) {}
+
+    Edit next(size_t textSize, const std::string& original) {
+        static const char* const pieces[] = {
+            "x", "total", "1", "2.5", "1e", "e3", ".", " ", "\n", "\t", "(", ")", "{", "}", "[", "]",
+            ";", ",", "\"", "/*", "*/", "//", "=", "==", "+", "-", "<<", "?", ":", "@",
+            "var ", "fun ", "if ", "else ", "return ", "while ", "print 1;\n", "var q = 2;\n",
+            "while (x) { x = x - 1; }\n", "\"s\\n\"", "\"two\nlines\"", "/* c\n */", "// note\n",
+        };
+        Edit edit{ pick(textSize + 1), 0, {} };
+        unsigned kind = static_cast<unsigned>(pick(100));
+        if (kind == 0) return { 0, textSize, original };
+        if (kind < 45 || kind >= 85) {
+            size_t count = 1 + pick(3);
+            for (size_t i = 0; i < count; ++i) edit.inserted += pieces[pick(sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        if (kind >= 45 && kind < 95) edit.removed = kind < 90 ? 1 + pick(8) : 1 + pick(200);
+        return edit;
+    }
+
+private:
+    std::mt19937_64 random;
+
+    size_t pick(size_t bound) { return static_cast<size_t>(random() % bound); }
+};
+
+// Latency percentile of a sorted list of seconds, in microseconds.
+double percentileMicros(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[index] * 1e6;
+}
+
+// incremental [edits] [megabytes] [seed]: fuzzes IncrementalDocument with
+// random edits on a small program, comparing the tokens, the tree (with line
+// numbers) and the diagnostic counts after every edit to a scan and parse from
+// scratch. Then times edits on a `megabytes` MB program against parsing it
+// whole, checking the result once at the end.
+int benchIncremental(const std::vector<std::string>& args) {
+    size_t edits = parseSizeArg(args, 0, 5000);
+    size_t megabytes = parseSizeArg(args, 1, 4);
+    uint64_t seed = parseSizeArg(args, 2, 1);
+
+    // Compares the document to a parse of its text from scratch.
+    auto check = [](const IncrementalDocument& document) {
+        std::string text(document.text());
+        std::ostringstream diagnostics;
+        Scanner scanner(text, 1, diagnostics);
+        std::vector<Token> tokens = scanner.scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        parser.setErrorOutput(diagnostics);
+        std::vector<Declaration*> ast = parser.parse();
+        return sameTokens(document.tokens(), tokens) && scanner.errorCount() == document.scanErrorCount() &&
+            parser.errorCount() == document.parseErrorCount() &&
+            sameFlatAst(toFlatAst(document.declarations()), toFlatAst(ast));
+    };
+
+    struct Run {
+        std::vector<double> seconds;
+        size_t relexed = 0, reparsed = 0, full = 0;
+
+        void add(double editSeconds, const IncrementalDocument::EditStats& stats) {
+            seconds.push_back(editSeconds);
+            relexed += stats.tokensRelexed;
+            reparsed += stats.declarationsReparsed;
+            full += stats.fullReparse;
+        }
+        void print(const char* label) {
+            std::sort(seconds.begin(), seconds.end());
+            std::printf("  %s: per edit p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us; "
+                "avg %.1f tokens relexed, %.2f declarations reparsed, %zu full reparses\n",
+                label, percentileMicros(seconds, 0.5), percentileMicros(seconds, 0.9), percentileMicros(seconds, 0.99),
+                seconds.back() * 1e6, static_cast<double>(relexed) / seconds.size(),
+                static_cast<double>(reparsed) / seconds.size(), full);
+        }
+    };
+
+    // Fuzzing: a few dozen functions, checked after every edit.
+    std::string original = makeBenchmarkSource(8 * 1024);
+    std::ostringstream diagnostics;
+    IncrementalDocument document(original, diagnostics);
+    EditGenerator generator(seed);
+    Run fuzz;
+    for (size_t i = 0; i < edits; ++i) {
+        EditGenerator::Edit edit = generator.next(document.text().size(), original);
+        IncrementalDocument::EditStats stats;
+        double seconds = timeSeconds([&] { stats = document.edit(edit.offset, edit.removed, edit.inserted); });
+        fuzz.add(seconds, stats);
+        diagnostics.str("");
+        if (!check(document)) {
+            std::printf("  edit %zu (offset %zu, removed %zu, inserted \"%s\") left the document out of step "
+                "with a parse from scratch!\n", i, edit.offset, edit.removed, edit.inserted.c_str());
+            return 1;
+        }
+    }
+    std::printf("incremental: %zu random edits on %.1f KB (seed %llu), each checked against a parse from scratch\n",
+        edits, original.size() / 1024.0, static_cast<unsigned long long>(seed));
+    fuzz.print("fuzz");
+
+    // Latency on a large program. Whole-text resets would only time a full
+    // parse, so the edits here stay local.
+    std::string large = makeBenchmarkSource(megabytes * 1024 * 1024);
+    double fullSeconds = 0.0;
+    for (int run = 0; run < 3; ++run) {
+        double seconds = timeSeconds([&] {
+            std::vector<Token> tokens = Scanner(large).scanTokens();
+            AstArena arena;
+            Parser(tokens, arena).parse();
+        });
+        if (run == 0 || seconds < fullSeconds) fullSeconds = seconds;
+    }
+    IncrementalDocument big(large, diagnostics);
+    Run latency;
+    for (size_t i = 0; i < 500; ++i) {
+        EditGenerator::Edit edit = generator.next(big.text().size(), large);
+        if (edit.removed == big.text().size()) continue;
+        IncrementalDocument::EditStats stats;
+        double seconds = timeSeconds([&] { stats = big.edit(edit.offset, edit.removed, edit.inserted); });
+        latency.add(seconds, stats);
+        diagnostics.str("");
+    }
+    if (!check(big)) {
+        std::printf("  the large document is out of step with a parse from scratch!\n");
+        return 1;
+    }
+    std::printf("  %.1f MB program: scan and parse from scratch %.1f ms\n", large.size() / (1024.0 * 1024.0), fullSeconds * 1e3);
+    latency.print("edit");
+    return 0;
+}
+
+// Flattens captured program output onto one line for the benchmark tables.
+std::string oneLine(std::string output) {
+    while (!output.empty() && output.back() == '\n') output.pop_back();
+    for (char& c : output) {
+        if (c == '\n') c = ' ';
+    }
+    return output;
+}
+
+// interp [files...]: the tree-walking interpreter on the programs in bench/
+// (or the given files). "Ops" are AST nodes evaluated or executed; program
+// output is captured rather than printed.
+int benchInterp(const std::vector<std::string>& args) {
+    std::vector<std::string> paths = args;
+    if (paths.empty()) {
+        paths = { "bench/fib.dav", "bench/loops.dav", "bench/strings.dav", "bench/switch.dav", "bench/arith.dav",
+            "bench/arrays.dav", "bench/fields.dav" };
+    }
+
+    for (const std::string& path : paths) {
+        SourceFile file;
+        if (!file.open(path)) {
+            std::printf("interp: cannot open %s\n", path.c_str());
+            return 1;
+        }
+        std::vector<Token> tokens = Scanner(file.text()).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        if (parser.Error()) {
+            std::printf("interp: %s failed to parse\n", path.c_str());
+            return 1;
+        }
+
+        double best = 0.0;
+        uint64_t operations = 0;
+        std::string output;
+        for (int run = 0; run < 3; ++run) {
+            std::ostringstream captured;
+            Interpreter interpreter(captured);
+            bool ok = true;
+            double seconds = timeSeconds([&] { ok = interpreter.interpret(program); });
+            if (!ok) {
+                std::printf("interp: %s stopped with a runtime error\n", path.c_str());
+                return 1;
+            }
+            if (run == 0 || seconds < best) best = seconds;
+            operations = interpreter.operationCount();
+            output = captured.str();
+        }
+        std::printf("  %-20s %8.1f ms %10llu ops %7.1f M ops/s   -> %s\n", path.c_str(), best * 1e3,
+            static_cast<unsigned long long>(operations), operations / best / 1e6, oneLine(output).c_str());
+    }
+    return 0;
+}
+
+// vm [files...]: the bytecode VM against the tree-walking interpreter on the
+// programs in bench/ (or the given files). VM times include compiling to
+// bytecode; both engines must print the same output.
+int benchVm(const std::vector<std::string>& args) {
+    std::vector<std::string> paths = args;
+    if (paths.empty()) {
+        paths = { "bench/fib.dav", "bench/loops.dav", "bench/strings.dav", "bench/switch.dav", "bench/arith.dav",
+            "bench/arrays.dav", "bench/fields.dav" };
+    }
+
+    std::printf("  %-20s %10s %10s %8s\n", "program", "ast ms", "vm ms", "speedup");
+    for (const std::string& path : paths) {
+        SourceFile file;
+        if (!file.open(path)) {
+            std::printf("vm: cannot open %s\n", path.c_str());
+            return 1;
+        }
+        std::vector<Token> tokens = Scanner(file.text()).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        if (parser.Error()) {
+            std::printf("vm: %s failed to parse\n", path.c_str());
+            return 1;
+        }
+
+        double astBest = 0.0, vmBest = 0.0;
+        std::string astOutput, vmOutput;
+        for (int run = 0; run < 3; ++run) {
+            std::ostringstream captured;
+            Interpreter interpreter(captured);
+            bool ok = true;
+            double seconds = timeSeconds([&] { ok = interpreter.interpret(program); });
+            if (!ok) {
+                std::printf("vm: %s stopped with a runtime error\n", path.c_str());
+                return 1;
+            }
+            if (run == 0 || seconds < astBest) astBest = seconds;
+            astOutput = captured.str();
+        }
+        for (int run = 0; run < 3; ++run) {
+            std::ostringstream captured;
+            Vm vm(captured);
+            bool ok = true;
+            double seconds = timeSeconds([&] { ok = vm.interpret(program); });
+            if (!ok) {
+                std::printf("vm: %s stopped with an error\n", path.c_str());
+                return 1;
+            }
+            if (run == 0 || seconds < vmBest) vmBest = seconds;
+            vmOutput = captured.str();
+        }
+        if (vmOutput != astOutput) {
+            std::printf("vm: %s printed different output than the AST interpreter\n", path.c_str());
+            return 1;
+        }
+        std::printf("  %-20s %10.1f %10.1f %7.2fx   -> %s\n", path.c_str(), astBest * 1e3, vmBest * 1e3,
+            astBest / vmBest, oneLine(vmOutput).c_str());
+    }
+    return 0;
+}
+
+// ir [megabytes] [files...]: the IR pass pipeline on a generated program
+// (time per pass and instruction counts), then the programs in bench/ (or the
+// given files) run as IR with and without the passes. Both runs must print
+// what the VM prints.
+int benchIr(const std::vector<std::string>& args) {
+    size_t megabytes = parseSizeArg(args, 0, 1);
+    std::vector<std::string> paths(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+    if (paths.empty()) {
+        paths = { "bench/fib.dav", "bench/loops.dav", "bench/strings.dav", "bench/switch.dav", "bench/arith.dav",
+            "bench/arrays.dav", "bench/fields.dav" };
+    }
+
+    {
+        std::string source = makeBenchmarkSource(megabytes * 1024 * 1024);
+        std::vector<Token> tokens = Scanner(source).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        std::ostringstream captured;
+        IrInterpreter interpreter(captured);
+        std::unique_ptr<IrModule> module;
+        double buildSeconds = timeSeconds([&] { module = interpreter.build(program); });
+        if (module == nullptr) {
+            std::printf("ir: generated program failed to compile\n");
+            return 1;
+        }
+        std::printf("ir: %.1f MB generated, %zu functions, built in %.1f ms\n", source.size() / (1024.0 * 1024.0),
+            module->functions.size(), buildSeconds * 1e3);
+        PassManager passes;
+        passes.addPipeline(PassManager::defaultPipeline);
+        passes.run(*module);
+        std::ostringstream timings;
+        passes.printTimings(timings);
+        std::istringstream lines(timings.str());
+        for (std::string line; std::getline(lines, line);) std::printf("  %s\n", line.c_str());
+    }
+
+    std::printf("  %-20s %10s %10s %10s %8s\n", "program", "vm ms", "ir ms", "ir -O ms", "speedup");
+    for (const std::string& path : paths) {
+        SourceFile file;
+        if (!file.open(path)) {
+            std::printf("ir: cannot open %s\n", path.c_str());
+            return 1;
+        }
+        std::vector<Token> tokens = Scanner(file.text()).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        if (parser.Error()) {
+            std::printf("ir: %s failed to parse\n", path.c_str());
+            return 1;
+        }
+
+        double vmBest = 0.0;
+        std::string vmOutput;
+        for (int run = 0; run < 3; ++run) {
+            std::ostringstream captured;
+            Vm vm(captured);
+            bool ok = true;
+            double seconds = timeSeconds([&] { ok = vm.interpret(program); });
+            if (!ok) {
+                std::printf("ir: %s stopped with an error\n", path.c_str());
+                return 1;
+            }
+            if (run == 0 || seconds < vmBest) vmBest = seconds;
+            vmOutput = captured.str();
+        }
+        // Run times only: building and optimizing are measured above.
+        double irBest[2] = { 0.0, 0.0 };
+        for (int optimized = 0; optimized < 2; ++optimized) {
+            for (int run = 0; run < 3; ++run) {
+                std::ostringstream captured;
+                IrInterpreter interpreter(captured);
+                std::unique_ptr<IrModule> module = interpreter.build(program);
+                PassManager passes;
+                passes.addPipeline(optimized ? PassManager::defaultPipeline : "");
+                bool ok = module != nullptr && passes.run(*module);
+                double seconds = timeSeconds([&] { ok = ok && interpreter.run(*module); });
+                if (!ok) {
+                    std::printf("ir: %s stopped with an error\n", path.c_str());
+                    return 1;
+                }
+                if (run == 0 || seconds < irBest[optimized]) irBest[optimized] = seconds;
+                if (captured.str() != vmOutput) {
+                    std::printf("ir: %s printed different output than the VM%s\n", path.c_str(),
+                        optimized ? " after optimization" : "");
+                    return 1;
+                }
+            }
+        }
+        std::printf("  %-20s %10.1f %10.1f %10.1f %7.2fx   -> %s\n", path.c_str(), vmBest * 1e3, irBest[0] * 1e3,
+            irBest[1] * 1e3, irBest[0] / irBest[1], oneLine(vmOutput).c_str());
+    }
+    return 0;
+}
+
+// gc [nursery KB...] [files...]: the collector under the allocation-heavy
+// programs in bench/ (or the given files), run on the VM and on the IR with
+// each nursery size (64 KB, the default 1 MB and 4 MB unless given).
+// Throughput is MB allocated per second of run time; pauses are per
+// collection, minor and full alike. Every run must print what the
+// tree-walking interpreter prints.
+int benchGc(const std::vector<std::string>& args) {
+    std::vector<size_t> nurseries;
+    std::vector<std::string> paths;
+    for (const std::string& arg : args) {
+        char* end = nullptr;
+        unsigned long kilobytes = std::strtoul(arg.c_str(), &end, 10);
+        if (!arg.empty() && *end == '\0') nurseries.push_back(kilobytes * 1024);
+        else paths.push_back(arg);
+    }
+    if (nurseries.empty()) nurseries = { 64 * 1024, Heap::defaultNurseryBytes, 4 * 1024 * 1024 };
+    if (paths.empty()) {
+        paths = { "bench/gc_trees.dav", "bench/gc_churn.dav", "bench/gc_closures.dav", "bench/gc_tenured.dav" };
+    }
+
+    std::printf("  %-22s %-3s %8s %9s %9s %7s %6s %9s %9s %9s\n", "program", "", "nursery", "ms", "MB/s", "minor",
+        "full", "p99 us", "max us", "old KB");
+    for (const std::string& path : paths) {
+        SourceFile file;
+        if (!file.open(path)) {
+            std::printf("gc: cannot open %s\n", path.c_str());
+            return 1;
+        }
+        std::vector<Token> tokens = Scanner(file.text()).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        if (parser.Error()) {
+            std::printf("gc: %s failed to parse\n", path.c_str());
+            return 1;
+        }
+
+        std::ostringstream expected;
+        Interpreter interpreter(expected);
+        if (!interpreter.interpret(program)) {
+            std::printf("gc: %s stopped with a runtime error\n", path.c_str());
+            return 1;
+        }
+
+        for (const char* engine : { "vm", "ir" }) {
+            for (size_t nurseryBytes : nurseries) {
+                std::ostringstream captured;
+                Heap::Stats stats;
+                bool ok = true;
+                double seconds = 0.0;
+                if (engine[0] == 'v') {
+                    Vm vm(captured, nurseryBytes);
+                    seconds = timeSeconds([&] { ok = vm.interpret(program); });
+                    stats = vm.heapStats();
+                }
+                else {
+                    IrInterpreter ir(captured, nurseryBytes);
+                    std::unique_ptr<IrModule> module = ir.build(program);
+                    PassManager passes;
+                    passes.addPipeline(PassManager::defaultPipeline);
+                    ok = module != nullptr && passes.run(*module);
+                    seconds = timeSeconds([&] { ok = ok && ir.run(*module); });
+                    stats = ir.heapStats();
+                }
+                if (!ok) {
+                    std::printf("gc: %s stopped with an error on the %s\n", path.c_str(), engine);
+                    return 1;
+                }
+                if (captured.str() != expected.str()) {
+                    std::printf("gc: %s printed different output on the %s with a %zu KB nursery\n", path.c_str(),
+                        engine, nurseryBytes / 1024);
+                    return 1;
+                }
+                std::vector<double> pauses = stats.pauses;
+                std::sort(pauses.begin(), pauses.end());
+                std::printf("  %-22s %-3s %6zu K %9.1f %9.1f %7zu %6zu %9.1f %9.1f %9zu\n", path.c_str(), engine,
+                    nurseryBytes / 1024, seconds * 1e3, stats.allocatedBytes / seconds / (1024.0 * 1024.0),
+                    stats.minorCollections, stats.fullCollections, percentileMicros(pauses, 0.99),
+                    stats.maxPauseSeconds * 1e6, stats.oldBytes / 1024);
+            }
+        }
+    }
+    return 0;
+}
+
+// --- Value Representation ---
+
+// The runtime value as a std::variant, the shape a runtime modelled on
+// Token's literal slot would take: 16 bytes, the tag beside the payload.
+// Kept here only for comparison with the NaN-boxed Value.
+using VariantValue = std::variant<std::monostate, bool, double, Obj*>;
+
+// The few operations the kernels below need, for each representation. The
+// arithmetic checks its operands the way the engines do.
+struct BoxedOps {
+    using V = Value;
+    static V number(double n) { return Value::number(n); }
+    static bool isNumber(V v) { return v.isNumber(); }
+    static double asNumber(V v) { return v.asNumber(); }
+    static bool isTruthy(V v) { return v.isTruthy(); }
+};
+
+struct VariantOps {
+    using V = VariantValue;
+    static V number(double n) { return V(n); }
+    static bool isNumber(const V& v) { return std::holds_alternative<double>(v); }
+    static double asNumber(const V& v) { return *std::get_if<double>(&v); }
+    static bool isTruthy(const V& v) {
+        if (std::holds_alternative<std::monostate>(v)) return false;
+        if (const bool* b = std::get_if<bool>(&v)) return *b;
+        return true;
+    }
+};
+
+template <typename Ops>
+struct Arithmetic {
+    using V = typename Ops::V;
+
+    static void check(const V& a, const V& b) {
+        if (!Ops::isNumber(a) || !Ops::isNumber(b)) throw RuntimeError("Operands must be numbers.");
+    }
+    static V add(V a, V b) { check(a, b); return Ops::number(Ops::asNumber(a) + Ops::asNumber(b)); }
+    static V subtract(V a, V b) { check(a, b); return Ops::number(Ops::asNumber(a) - Ops::asNumber(b)); }
+    static V multiply(V a, V b) { check(a, b); return Ops::number(Ops::asNumber(a) * Ops::asNumber(b)); }
+    static V divide(V a, V b) { check(a, b); return Ops::number(Ops::asNumber(a) / Ops::asNumber(b)); }
+};
+
+// A loop body of register instructions (op, destination, two operands) run
+// over a frame of slots, each dispatched through a table the way a VM would,
+// so values cross a call boundary on every operation.
+template <typename Ops>
+double arithmeticKernel(size_t iterations) {
+    using V = typename Ops::V;
+    using A = Arithmetic<Ops>;
+    V (*const binary[4])(V, V) = { A::add, A::subtract, A::multiply, A::divide };
+    struct Instruction { uint8_t op, target, left, right; };
+    const Instruction body[] = {
+        { 0, 0, 0, 2 }, // i = i + step
+        { 2, 4, 0, 3 }, // t = i * scale
+        { 0, 1, 1, 4 }, // sum = sum + t
+        { 3, 5, 1, 0 }, // average = sum / i
+        { 1, 5, 5, 4 }, // average = average - t
+    };
+    std::vector<V> slots = { Ops::number(0.0), Ops::number(0.0), Ops::number(1.0), Ops::number(0.5),
+        Ops::number(0.0), Ops::number(0.0) };
+    double checksum = 0.0;
+    for (size_t i = 0; i < iterations; i += 5) {
+        for (const Instruction& instruction : body) {
+            slots[instruction.target] = binary[instruction.op](slots[instruction.left], slots[instruction.right]);
+        }
+        if (Ops::isTruthy(slots[5])) checksum += Ops::asNumber(slots[5]);
+    }
+    return checksum + Ops::asNumber(slots[1]);
+}
+
+// Fill an array, run a prefix sum and a reversal over it, then sum it.
+template <typename Ops>
+double arrayKernel(size_t size, int passes) {
+    using V = typename Ops::V;
+    std::vector<V> elements;
+    for (size_t i = 0; i < size; ++i) elements.push_back(Ops::number(static_cast<double>(i % 97) * 0.5));
+    for (int pass = 0; pass < passes; ++pass) {
+        for (size_t i = 1; i < size; ++i) elements[i] = Arithmetic<Ops>::add(elements[i], elements[i - 1]);
+        for (size_t i = 0, j = size - 1; i < j; ++i, --j) std::swap(elements[i], elements[j]);
+        for (V& element : elements) element = Ops::number(Ops::asNumber(element) * 1e-6);
+    }
+    double sum = 0.0;
+    for (const V& element : elements) sum += Ops::asNumber(element);
+    return sum;
+}
+
+// value [millions]: the NaN-boxed Value against a std::variant value on an
+// arithmetic kernel (`millions` million binary operations) and an array
+// kernel; both representations must compute the same results. The engines
+// themselves are measured by interp, vm and ir on bench/arith.dav and
+// bench/arrays.dav.
+int benchValue(const std::vector<std::string>& args) {
+    size_t millions = parseSizeArg(args, 0, 50);
+    const size_t iterations = millions * 1000000;
+    const size_t arraySize = 1 << 22;
+    std::printf("value: sizeof(Value) %zu bytes, sizeof(std::variant value) %zu bytes\n",
+        sizeof(Value), sizeof(VariantValue));
+
+    double results[2][2] = {};
+    double best[2][2] = {};
+    for (int run = 0; run < 3; ++run) {
+        double seconds[2][2] = {
+            { timeSeconds([&] { results[0][0] = arithmeticKernel<BoxedOps>(iterations); }),
+              timeSeconds([&] { results[0][1] = arithmeticKernel<VariantOps>(iterations); }) },
+            { timeSeconds([&] { results[1][0] = arrayKernel<BoxedOps>(arraySize, 8); }),
+              timeSeconds([&] { results[1][1] = arrayKernel<VariantOps>(arraySize, 8); }) },
+        };
+        for (int kernel = 0; kernel < 2; ++kernel) {
+            for (int representation = 0; representation < 2; ++representation) {
+                double& slot = best[kernel][representation];
+                if (run == 0 || seconds[kernel][representation] < slot) slot = seconds[kernel][representation];
+            }
+        }
+    }
+    if (results[0][0] != results[0][1] || results[1][0] != results[1][1]) {
+        std::printf("  the representations computed different results!\n");
+        return 1;
+    }
+
+    std::printf("  %-10s %12s %12s %8s\n", "kernel", "nan-box ms", "variant ms", "speedup");
+    const char* names[2] = { "arithmetic", "arrays" };
+    for (int kernel = 0; kernel < 2; ++kernel) {
+        std::printf("  %-10s %12.1f %12.1f %7.2fx\n", names[kernel], best[kernel][0] * 1e3, best[kernel][1] * 1e3,
+            best[kernel][1] / best[kernel][0]);
+    }
+    std::printf("  array of %zu values: %.1f MB nan-boxed, %.1f MB variant\n", arraySize,
+        arraySize * sizeof(Value) / (1024.0 * 1024.0), arraySize * sizeof(VariantValue) / (1024.0 * 1024.0));
+    return 0;
+}
+
+// --- Property Access ---
+
+// Sum of `count` reads cycling through `objects` (a power of two) objects,
+// the way one access site in a loop would see them.
+template <typename Read>
+double sumField(size_t count, size_t objects, Read&& read) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; ++i) sum += read(i & (objects - 1)).asNumber();
+    return sum;
+}
+
+// fields [millions] [files...]: one field read site, `millions` million
+// times, over objects of 1 layout (monomorphic), 4 (polymorphic) and 16
+// (megamorphic): from a hash map per object (the representation before
+// shapes), by name through the object's shape, and through an inline cache.
+// Then the engines on bench/fields.dav (or the given files) with their cache
+// hit rates; every engine must print the same.
+int benchFields(const std::vector<std::string>& args) {
+    size_t millions = parseSizeArg(args, 0, 20);
+    std::vector<std::string> paths(args.size() > 1 ? args.begin() + 1 : args.end(), args.end());
+    if (paths.empty()) paths = { "bench/fields.dav" };
+    const size_t count = millions * 1000000;
+    const size_t objectCount = 64;
+
+    Heap heap; // No roots: it never collects
+    Symbol field = symbols().intern("target");
+    std::vector<Symbol> fillers;
+    for (int i = 0; i < 16; ++i) fillers.push_back(symbols().intern("filler" + std::to_string(i)));
+
+    std::printf("  %-8s %10s %10s %10s %10s %9s\n", "layouts", "hash ns", "shape ns", "cache ns", "speedup",
+        "hit rate");
+    for (size_t layouts : { 1, 4, 16 }) {
+        // Object k has k % layouts fields before `target`, so each layout
+        // keeps it in a different slot.
+        std::vector<Value> objects;
+        std::vector<std::unordered_map<Symbol, Value>> maps(objectCount);
+        for (size_t k = 0; k < objectCount; ++k) {
+            Value object = Value::object(heap.makeInstance());
+            for (size_t j = 0; j < k % layouts; ++j) {
+                setField(heap, object, fillers[j], Value::number(0));
+                maps[k][fillers[j]] = Value::number(0);
+            }
+            setField(heap, object, field, Value::number(static_cast<double>(k)));
+            maps[k][field] = Value::number(static_cast<double>(k));
+            objects.push_back(object);
+        }
+
+        double sums[3] = {};
+        double best[3] = {};
+        InlineCacheStats cached;
+        for (int run = 0; run < 3; ++run) {
+            InlineCache cache;
+            inlineCacheStats = InlineCacheStats();
+            double seconds[3] = {
+                timeSeconds([&] {
+                    sums[0] = sumField(count, objectCount, [&](size_t k) { return maps[k].find(field)->second; });
+                }),
+                timeSeconds([&] {
+                    sums[1] = sumField(count, objectCount, [&](size_t k) { return getField(objects[k], field); });
+                }),
+                timeSeconds([&] {
+                    sums[2] = sumField(count, objectCount,
+                        [&](size_t k) { return getField(objects[k], field, cache); });
+                }),
+            };
+            cached = inlineCacheStats;
+            for (int path = 0; path < 3; ++path) {
+                if (run == 0 || seconds[path] < best[path]) best[path] = seconds[path];
+            }
+        }
+        if (sums[0] != sums[1] || sums[0] != sums[2]) {
+            std::printf("fields: the access paths read different values!\n");
+            return 1;
+        }
+        std::printf("  %-8zu %10.2f %10.2f %10.2f %9.2fx %8.1f%%\n", layouts, best[0] * 1e9 / count,
+            best[1] * 1e9 / count, best[2] * 1e9 / count, best[0] / best[2],
+            100.0 * cached.hits / (cached.hits + cached.misses));
+    }
+
+    std::printf("  %-20s %-3s %10s %12s %12s %8s\n", "program", "", "ms", "hits", "misses", "hit rate");
+    for (const std::string& path : paths) {
+        SourceFile file;
+        if (!file.open(path)) {
+            std::printf("fields: cannot open %s\n", path.c_str());
+            return 1;
+        }
+        std::vector<Token> tokens = Scanner(file.text()).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        if (parser.Error()) {
+            std::printf("fields: %s failed to parse\n", path.c_str());
+            return 1;
+        }
+
+        std::string expected;
+        for (const char* engine : { "ast", "vm", "ir" }) {
+            std::ostringstream captured;
+            inlineCacheStats = InlineCacheStats();
+            bool ok = true;
+            double seconds = 0.0;
+            if (engine[0] == 'a') {
+                Interpreter interpreter(captured);
+                seconds = timeSeconds([&] { ok = interpreter.interpret(program); });
+            }
+            else if (engine[0] == 'v') {
+                Vm vm(captured);
+                seconds = timeSeconds([&] { ok = vm.interpret(program); });
+            }
+            else {
+                IrInterpreter ir(captured);
+                std::unique_ptr<IrModule> module = ir.build(program);
+                PassManager passes;
+                passes.addPipeline(PassManager::defaultPipeline);
+                ok = module != nullptr && passes.run(*module);
+                seconds = timeSeconds([&] { ok = ok && ir.run(*module); });
+            }
+            if (!ok) {
+                std::printf("fields: %s stopped with an error on the %s engine\n", path.c_str(), engine);
+                return 1;
+            }
+            if (expected.empty()) expected = captured.str();
+            else if (captured.str() != expected) {
+                std::printf("fields: %s printed different output on the %s engine\n", path.c_str(), engine);
+                return 1;
+            }
+            const InlineCacheStats& stats = inlineCacheStats;
+            uint64_t lookups = stats.hits + stats.misses;
+            std::printf("  %-20s %-3s %10.1f %12llu %12llu %7.2f%%\n", path.c_str(), engine, seconds * 1e3,
+                static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                lookups > 0 ? 100.0 * stats.hits / lookups : 0.0);
+        }
+    }
+    return 0;
+}
+
+// --- Dispatch ---
+
+// True if `op` may carry on somewhere other than the next instruction, so it
+// cannot be the first half of a superinstruction.
+bool transfersControl(OpCode op) {
+    switch (op) {
+    case OpCode::JUMP:
+    case OpCode::JUMP_IF_FALSE:
+    case OpCode::JUMP_IF_TRUE:
+    case OpCode::POP_JUMP_IF_FALSE:
+    case OpCode::JUMP_IF_EQUAL:
+    case OpCode::LOOP:
+    case OpCode::CALL:
+    case OpCode::CLOSURE: // Variable length: the second half would have no fixed offset
+    case OpCode::RETURN:
+    case OpCode::INVALID_TARGET:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// dispatch [pairs] [files...]: the VM on the programs in bench/ (or the given
+// files) compiled without and with superinstructions: instructions
+// dispatched and run time. Then the `pairs` (default 12) most frequent
+// adjacent opcode pairs over all the programs, counted without
+// superinstructions, with the superinstruction each is fused into (the
+// candidates for DAV_SUPERINSTRUCTIONS are the unfused ones). Both builds
+// must print the same.
+int benchDispatch(const std::vector<std::string>& args) {
+    size_t pairCount = 12;
+    std::vector<std::string> paths = args;
+    if (!paths.empty() && std::strtoul(paths[0].c_str(), nullptr, 10) > 0) {
+        pairCount = std::strtoul(paths[0].c_str(), nullptr, 10);
+        paths.erase(paths.begin());
+    }
+    if (paths.empty()) {
+        paths = { "bench/fib.dav", "bench/loops.dav", "bench/strings.dav", "bench/switch.dav", "bench/arith.dav",
+            "bench/arrays.dav", "bench/fields.dav" };
+    }
+
+    auto corpus = std::make_unique<DispatchProfile>(); // Without superinstructions, summed
+    uint64_t totals[2] = {};
+    double totalSeconds[2] = {};
+    std::printf("  %-20s %12s %12s %7s %10s %10s %8s\n", "program", "dispatches", "fused", "saved", "plain ms",
+        "fused ms", "speedup");
+    for (const std::string& path : paths) {
+        SourceFile file;
+        if (!file.open(path)) {
+            std::printf("dispatch: cannot open %s\n", path.c_str());
+            return 1;
+        }
+        std::vector<Token> tokens = Scanner(file.text()).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        if (parser.Error()) {
+            std::printf("dispatch: %s failed to parse\n", path.c_str());
+            return 1;
+        }
+
+        uint64_t dispatches[2] = {};
+        double best[2] = {};
+        std::string outputs[2];
+        for (int fused = 0; fused < 2; ++fused) {
+            // One profiled run for the counts, then the timed ones.
+            auto profile = std::make_unique<DispatchProfile>();
+            for (int run = 0; run < 4; ++run) {
+                std::ostringstream captured;
+                Vm vm(captured);
+                CompilerOptions options;
+                options.superinstructions = fused == 1;
+                vm.setCompilerOptions(options);
+                vm.setProfile(run == 0 ? profile.get() : nullptr);
+                bool ok = true;
+                double seconds = timeSeconds([&] { ok = vm.interpret(program); });
+                if (!ok) {
+                    std::printf("dispatch: %s stopped with an error\n", path.c_str());
+                    return 1;
+                }
+                if (run == 1 || (run > 1 && seconds < best[fused])) best[fused] = seconds;
+                outputs[fused] = captured.str();
+            }
+            dispatches[fused] = profile->dispatches;
+            if (fused == 0) {
+                for (int first = 0; first < opCodeCount; ++first) {
+                    for (int second = 0; second < opCodeCount; ++second) {
+                        corpus->pairs[first][second] += profile->pairs[first][second];
+                    }
+                }
+                corpus->dispatches += profile->dispatches;
+            }
+            totals[fused] += dispatches[fused];
+            totalSeconds[fused] += best[fused];
+        }
+        if (outputs[0] != outputs[1]) {
+            std::printf("dispatch: %s printed different output with superinstructions\n", path.c_str());
+            return 1;
+        }
+        std::printf("  %-20s %12llu %12llu %6.1f%% %10.1f %10.1f %7.2fx\n", path.c_str(),
+            static_cast<unsigned long long>(dispatches[0]), static_cast<unsigned long long>(dispatches[1]),
+            100.0 - 100.0 * dispatches[1] / dispatches[0], best[0] * 1e3, best[1] * 1e3, best[0] / best[1]);
+    }
+    std::printf("  %-20s %12llu %12llu %6.1f%% %10.1f %10.1f %7.2fx\n", "total",
+        static_cast<unsigned long long>(totals[0]), static_cast<unsigned long long>(totals[1]),
+        100.0 - 100.0 * totals[1] / totals[0], totalSeconds[0] * 1e3, totalSeconds[1] * 1e3,
+        totalSeconds[0] / totalSeconds[1]);
+
+    struct Pair {
+        OpCode first;
+        OpCode second;
+        uint64_t count;
+    };
+    std::vector<Pair> pairs;
+    for (int first = 0; first < opCodeCount; ++first) {
+        for (int second = 0; second < opCodeCount; ++second) {
+            if (corpus->pairs[first][second] == 0) continue;
+            pairs.push_back({ static_cast<OpCode>(first), static_cast<OpCode>(second), corpus->pairs[first][second] });
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.count > b.count; });
+
+    std::printf("\n  %-40s %12s %7s  %s\n", "pair (without superinstructions)", "count", "share", "fused as");
+    for (size_t i = 0; i < pairs.size() && i < pairCount; ++i) {
+        const Pair& pair = pairs[i];
+        std::string name = std::string(opCodeName(pair.first)) + " " + opCodeName(pair.second);
+        OpCode fused;
+        const char* fusedAs = "-";
+        if (fuseOpCodes(pair.first, pair.second, fused)) fusedAs = opCodeName(fused);
+        else if (transfersControl(pair.first)) fusedAs = "(first half transfers control)";
+        std::printf("  %-40s %12llu %6.1f%%  %s\n", name.c_str(), static_cast<unsigned long long>(pair.count),
+            100.0 * pair.count / corpus->dispatches, fusedAs);
+    }
+    return 0;
+}
+
+// Programs that run each superinstruction, on the values its halves treat
+// differently and into the errors they raise.
+struct SuperinstructionCase {
+    OpCode op;
+    const char* source;
+};
+
+const SuperinstructionCase superinstructionCases[] = {
+    { OpCode::GET_LOCAL_CONSTANT, "fun f(a) { print a + 1; print a < 2; print a + \"s\"; } f(1); f(\"t\"); f(nil);" },
+    { OpCode::GET_FIELD_GET_FIELD, "var o = object(); o.a = object(); o.a.b = 5; print o.a.b; o.a.b = \"x\"; print o.a.b;" },
+    { OpCode::GET_FIELD_GET_FIELD, "var o = object(); o.a = 1; print o.a.b;" },
+    { OpCode::GET_FIELD_GET_FIELD, "var o = object(); print o.a.b;" },
+    { OpCode::SET_LOCAL_POP, "fun f() { var a = 1; a = a * 5; print a; a = \"s\"; print a; } f();" },
+    { OpCode::SET_GLOBAL_POP, "var g = 1; g = g + 2; print g; g = nil; print g;" },
+    { OpCode::POP_POP, "fun f() { { var a = 1; var b = 2; print a + b; } { var c = 3; var d = 4; } print 0; } f();" },
+    { OpCode::POP_LOOP, "fun g(x) { return x; } fun f() { var i = 0; while (i < 3) { i = i + 1; g(i); } print i; } f();" },
+    { OpCode::GET_LOCAL_DUP, "fun f(i) { i++; print i; i--; print i; } f(1); f(0.5); f(\"s\");" },
+    { OpCode::INCREMENT_SET_LOCAL, "fun f(i) { var j = i++; print j; print i; print ++i; } f(1); f(-0.5); f(nil);" },
+    { OpCode::DECREMENT_SET_LOCAL, "fun f(i) { var j = i--; print j; print i; print --i; } f(1); f(-0.5); f(true);" },
+    { OpCode::GET_LOCAL_PRINT, "fun f(a) { print a; } f(1); f(\"s\"); f(nil); f(object());" },
+    { OpCode::EQUAL_POP_JUMP_IF_FALSE,
+        "fun f(a, b) { if (a == b) print 1; else print 2; } f(1, 1); f(1, 2); f(\"a\", \"a\"); f(nil, false);" },
+    { OpCode::NOT_EQUAL_POP_JUMP_IF_FALSE,
+        "fun f(a, b) { if (a != b) print 1; else print 2; } f(1, 1); f(1, 2); f(\"a\", \"a\"); f(nil, false);" },
+    { OpCode::LESS_POP_JUMP_IF_FALSE, "fun f(a, b) { if (a < b) print 1; else print 2; } f(1, 2); f(2, 1); f(1, 1); f(\"a\", 1);" },
+    { OpCode::LESS_EQUAL_POP_JUMP_IF_FALSE,
+        "fun f(a, b) { if (a <= b) print 1; else print 2; } f(1, 2); f(2, 1); f(1, 1); f(1, nil);" },
+    { OpCode::GREATER_POP_JUMP_IF_FALSE, "fun f(a, b) { if (a > b) print 1; else print 2; } f(1, 2); f(2, 1); f(1, 1); f(\"a\", 1);" },
+    { OpCode::GREATER_EQUAL_POP_JUMP_IF_FALSE,
+        "fun f(a, b) { if (a >= b) print 1; else print 2; } f(1, 2); f(2, 1); f(1, 1); f(1, nil);" },
+};
+
+// superinstructions: checks each superinstruction against the pair it
+// stands for. Every case runs compiled without and with superinstructions;
+// both must print the same (errors included), and the fused build must
+// dispatch the superinstruction under test. Every superinstruction needs a
+// case.
+int benchSuperinstructions(const std::vector<std::string>&) {
+    uint64_t executed[opCodeCount] = {};
+    bool failed = false;
+    for (const SuperinstructionCase& test : superinstructionCases) {
+        std::vector<Token> tokens = Scanner(test.source).scanTokens();
+        AstArena arena;
+        Parser parser(tokens, arena);
+        std::vector<Declaration*> program = parser.parse();
+        if (parser.Error()) {
+            std::printf("superinstructions: a %s case failed to parse\n", opCodeName(test.op));
+            return 1;
+        }
+
+        std::string outputs[2];
+        uint64_t dispatched[2] = {};
+        for (int fused = 0; fused < 2; ++fused) {
+            auto profile = std::make_unique<DispatchProfile>();
+            std::ostringstream captured;
+            std::streambuf* saved = std::cerr.rdbuf(captured.rdbuf());
+            {
+                Vm vm(captured);
+                CompilerOptions options;
+                options.superinstructions = fused == 1;
+                vm.setCompilerOptions(options);
+                vm.setProfile(profile.get());
+                vm.interpret(program);
+            }
+            std::cerr.rdbuf(saved);
+            outputs[fused] = captured.str();
+            dispatched[fused] = profile->counts[static_cast<int>(test.op)];
+        }
+        executed[static_cast<int>(test.op)] += dispatched[1];
+        if (dispatched[0] != 0 || dispatched[1] == 0) {
+            std::printf("superinstructions: %s ran %llu times unfused and %llu times fused in\n    %s\n",
+                opCodeName(test.op), static_cast<unsigned long long>(dispatched[0]),
+                static_cast<unsigned long long>(dispatched[1]), test.source);
+            failed = true;
+        }
+        if (outputs[0] != outputs[1]) {
+            std::printf("superinstructions: %s differs from its pair in\n    %s\n  unfused:\n%s  fused:\n%s",
+                opCodeName(test.op), test.source, outputs[0].c_str(), outputs[1].c_str());
+            failed = true;
+        }
+    }
+
+    std::printf("  %-34s %8s  %-14s %s\n", "superinstruction", "executed", "first", "second");
+    for (int op = 0; op < opCodeCount; ++op) {
+        OpCode first, second;
+        if (!splitOpCode(static_cast<OpCode>(op), first, second)) continue;
+        std::printf("  %-34s %8llu  %-14s %s\n", opCodeName(static_cast<OpCode>(op)),
+            static_cast<unsigned long long>(executed[op]), opCodeName(first), opCodeName(second));
+    }
+    for (int op = 0; op < opCodeCount; ++op) {
+        OpCode first, second;
+        if (splitOpCode(static_cast<OpCode>(op), first, second) && executed[op] == 0) {
+            std::printf("superinstructions: no case runs %s\n", opCodeName(static_cast<OpCode>(op)));
+            failed = true;
+        }
+    }
+    std::printf(failed ? "FAILED\n" : "ok\n");
+    return failed ? 1 : 0;
+}
+
+// A loop running one switch `iterations` times over `cases` integer cases,
+// each subject selecting every case equally often, plus a default that is
+// never taken. Dense values are 0..cases-1; sparse ones k*k*7 + k.
+std::string makeSwitchProgram(size_t cases, bool dense, size_t iterations) {
+    std::string out = "fun run() {\n    var sum = 0;\n";
+    out += "    for (var i = 0; i < " + std::to_string(iterations) + "; i++) {\n";
+    out += "        var k = i % " + std::to_string(cases) + ";\n";
+    out += dense ? "        switch (k) {\n" : "        switch (k * k * 7 + k) {\n";
+    for (size_t k = 0; k < cases; ++k) {
+        size_t value = dense ? k : k * k * 7 + k;
+        out += "        case " + std::to_string(value) + ": sum = sum + " + std::to_string(k % 13) + "; break;\n";
+    }
+    out += "        default: sum = sum - 1;\n        }\n    }\n    return sum;\n}\nprint run();\n";
+    return out;
+}
+
+// switch [thousands]: one switch of 4 to 1024 integer cases, dense and
+// sparse, run `thousands` thousand times (default 500) on the VM comparing
+// the cases in order and through a SwitchTable, and on the tree-walking
+// interpreter (which uses the tables). All three must print the same.
+int benchSwitch(const std::vector<std::string>& args) {
+    size_t iterations = parseSizeArg(args, 0, 500) * 1000;
+
+    std::printf("  %-6s %-7s %-7s %10s %10s %8s %10s\n", "cases", "values", "table", "chain ms", "table ms",
+        "speedup", "ast ms");
+    for (size_t cases : { 4, 16, 64, 256, 1024 }) {
+        for (bool dense : { true, false }) {
+            std::string source = makeSwitchProgram(cases, dense, iterations);
+            std::vector<Token> tokens = Scanner(source).scanTokens();
+            AstArena arena;
+            Parser parser(tokens, arena);
+            std::vector<Declaration*> program = parser.parse();
+            if (parser.Error()) {
+                std::printf("switch: the generated program failed to parse\n");
+                return 1;
+            }
+
+            // Chain and table on the VM, then the tree-walker.
+            double best[3] = {};
+            std::string outputs[3];
+            const char* kind = "-";
+            for (int engine = 0; engine < 3; ++engine) {
+                for (int run = 0; run < 3; ++run) {
+                    std::ostringstream captured;
+                    bool ok = true;
+                    double seconds = 0.0;
+                    if (engine < 2) {
+                        Vm vm(captured);
+                        CompilerOptions options;
+                        options.switchTables = engine == 1;
+                        vm.setCompilerOptions(options);
+                        ObjProto* script = vm.compile(program);
+                        ok = script != nullptr;
+                        if (ok && engine == 1) {
+                            // run() is the script's first constant.
+                            const Chunk& chunk = asProto(script->chunk.constants[0])->chunk;
+                            if (!chunk.switches.empty()) kind = switchTableKindName(chunk.switches[0].kind());
+                        }
+                        seconds = timeSeconds([&] { ok = ok && vm.run(script); });
+                    }
+                    else {
+                        Interpreter interpreter(captured);
+                        seconds = timeSeconds([&] { ok = interpreter.interpret(program); });
+                    }
+                    if (!ok) {
+                        std::printf("switch: the %zu-case program stopped with an error\n", cases);
+                        return 1;
+                    }
+                    if (run == 0 || seconds < best[engine]) best[engine] = seconds;
+                    outputs[engine] = captured.str();
+                }
+            }
+            if (outputs[0] != outputs[1] || outputs[0] != outputs[2]) {
+                std::printf("switch: the %zu-case program printed different results\n", cases);
+                return 1;
+            }
+            std::printf("  %-6zu %-7s %-7s %10.1f %10.1f %7.2fx %10.1f\n", cases, dense ? "dense" : "sparse", kind,
+                best[0] * 1e3, best[1] * 1e3, best[0] / best[1], best[2] * 1e3);
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+std::string makeBenchmarkSource(size_t targetBytes) {
+    std::string out;
+    out.reserve(targetBytes + 512);
+    for (int n = 0; out.size() < targetBytes; ++n) {
+        std::string id = std::to_string(n);
+        out += "// generated block " + id + "\n";
+        out += "fun fn_" + id + "(a, b, count) {\n";
+        out += "    var total = 0;\n";
+        out += "    var label = \"item " + id + "\";\n";
+        out += "    for (var i = 0; i < count; i++) {\n";
+        out += "        total += a * i + b / 2.5e1 - (i << 2);\n";
+        out += "        if (total > 1000 && label != \"done\") { total = total % 7; } else { total -= 1; }\n";
+        out += "    }\n";
+        out += "    /* block comment\n       spanning two lines */\n";
+        out += "    return total == 0 ? -1 : total;\n";
+        out += "}\n";
+        out += "print fn_" + id + "(" + id + ", 2, 10);\n";
+    }
+    return out;
+}
+
+int runBenchmark(const std::string& name, const std::vector<std::string>& args) {
+    setAllocationCounting(true);
+    if (name == "scan") return benchScan(args);
+    if (name == "load") return benchLoad(args);
+    if (name == "keywords") return benchKeywords(args);
+    if (name == "scan-backends") return benchScanBackends(args);
+    if (name == "scan-parallel") return benchScanParallel(args);
+    if (name == "intern") return benchIntern(args);
+    if (name == "parse") return benchParse(args);
+    if (name == "parse-throughput") return benchParseThroughput(args);
+    if (name == "parse-pratt") return benchParsePratt(args);
+    if (name == "parse-soa") return benchParseSoa(args);
+    if (name == "parse-parallel") return benchParseParallel(args);
+    if (name == "dot") return benchDot(args);
+    if (name == "flat-ast") return benchFlatAst(args);
+    if (name == "ast-cache") return benchAstCache(args);
+    if (name == "incremental") return benchIncremental(args);
+    if (name == "interp") return benchInterp(args);
+    if (name == "vm") return benchVm(args);
+    if (name == "ir") return benchIr(args);
+    if (name == "value") return benchValue(args);
+    if (name == "gc") return benchGc(args);
+    if (name == "fields") return benchFields(args);
+    if (name == "dispatch") return benchDispatch(args);
+    if (name == "superinstructions") return benchSuperinstructions(args);
+    if (name == "switch") return benchSwitch(args);
+
+    std::cerr << "Unknown benchmark: " << name << "\n";
+    std::cerr << "Available: scan, load, keywords, scan-backends, scan-parallel, intern, parse, parse-throughput, parse-pratt, parse-soa, parse-parallel, dot, flat-ast, ast-cache, incremental, interp, vm, ir, value, gc, fields, dispatch, superinstructions, switch\n";
+    return 1;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Builds a synthetic, syntactically valid .dav program of roughly `targetBytes`
+// bytes. The benchmarks use it as a stand-in for large generated scripts.
+std::string makeBenchmarkSource(size_t targetBytes);
+
+// Entry point for `--bench <name> [args...]`. Returns the process exit code.
+int runBenchmark(const std::string& name, const std::vector<std::string>& args);
@@ -0,0 +1,197 @@
+#include "chunk.h"
+#include "object.h"
+#include <cstdio>
+#include <ostream>
+
+namespace {
+
+struct OpCodeInfo {
+    const char* name;
+    int operandBytes;
+    int stackEffect;
+};
+
+constexpr OpCodeInfo opCodeInfo[] = {
+#define DAV_OPCODE_INFO(name, operands, effect) { #name, operands, effect },
+    DAV_OPCODES(DAV_OPCODE_INFO)
+#undef DAV_OPCODE_INFO
+};
+constexpr size_t plainOpCodeCount = sizeof(opCodeInfo) / sizeof(opCodeInfo[0]);
+
+struct Superinstruction {
+    const char* name;
+    OpCode first;
+    OpCode second;
+};
+
+constexpr Superinstruction superinstructions[] = {
+#define DAV_SUPERINSTRUCTION_INFO(name, first, second) { #name, OpCode::first, OpCode::second },
+    DAV_SUPERINSTRUCTIONS(DAV_SUPERINSTRUCTION_INFO)
+#undef DAV_SUPERINSTRUCTION_INFO
+    { nullptr, OpCode::NIL, OpCode::NIL } // Keeps the array non-empty
+};
+
+uint16_t readShort(const Chunk& chunk, size_t offset) {
+    return static_cast<uint16_t>(chunk.code[offset] | (chunk.code[offset + 1] << 8));
+}
+
+// Constants are shown the way `print` shows them; strings are quoted.
+std::string describeConstant(Value value) {
+    if (value.isString()) return "\"" + asString(value)->chars + "\"";
+    return valueToString(value);
+}
+
+// Prints the operands of `op`, which start at `offset`; returns the offset
+// after them.
+size_t disassembleOperands(const Chunk& chunk, OpCode op, size_t offset, std::ostream& out) {
+    size_t next = offset + opCodeInfo[static_cast<size_t>(op)].operandBytes;
+    switch (op) {
+    case OpCode::CONSTANT: {
+        uint16_t index = readShort(chunk, offset);
+        out << ' ' << index << " (" << describeConstant(chunk.constants[index]) << ')';
+        break;
+    }
+    case OpCode::GET_FIELD:
+    case OpCode::SET_FIELD:
+    case OpCode::INCREMENT_FIELD: {
+        uint16_t index = readShort(chunk, offset);
+        out << ' ' << index << " (" << describeConstant(chunk.constants[index]) << ") cache "
+            << readShort(chunk, offset + 2);
+        if (op == OpCode::INCREMENT_FIELD) out << " flags " << static_cast<int>(chunk.code[offset + 4]);
+        break;
+    }
+    case OpCode::GET_GLOBAL:
+    case OpCode::SET_GLOBAL:
+    case OpCode::DEFINE_GLOBAL:
+        out << ' ' << readShort(chunk, offset);
+        break;
+    case OpCode::GET_LOCAL:
+    case OpCode::SET_LOCAL:
+    case OpCode::GET_UPVALUE:
+    case OpCode::SET_UPVALUE:
+    case OpCode::CALL:
+    case OpCode::INCREMENT_INDEX:
+        out << ' ' << static_cast<int>(chunk.code[offset]);
+        break;
+    case OpCode::JUMP:
+    case OpCode::JUMP_IF_FALSE:
+    case OpCode::JUMP_IF_TRUE:
+    case OpCode::POP_JUMP_IF_FALSE:
+    case OpCode::JUMP_IF_EQUAL:
+        out << " -> " << next + readShort(chunk, offset);
+        break;
+    case OpCode::LOOP:
+        out << " -> " << next - readShort(chunk, offset);
+        break;
+    case OpCode::SWITCH: {
+        const SwitchTable& table = chunk.switches[readShort(chunk, offset)];
+        out << ' ' << readShort(chunk, offset) << " (" << switchTableKindName(table.kind()) << ", "
+            << table.caseCount() << " cases)";
+        break;
+    }
+    case OpCode::CLOSURE: {
+        uint16_t index = readShort(chunk, offset);
+        ObjProto* proto = asProto(chunk.constants[index]);
+        out << ' ' << index << " (" << valueToString(chunk.constants[index]) << ')';
+        for (int i = 0; i < proto->upvalueCount; ++i) {
+            out << (chunk.code[next] ? " local " : " upvalue ") << static_cast<int>(chunk.code[next + 1]);
+            next += 2;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return next;
+}
+
+} // namespace
+
+const char* opCodeName(OpCode op) {
+    size_t index = static_cast<size_t>(op);
+    if (index >= plainOpCodeCount) return superinstructions[index - plainOpCodeCount].name;
+    return opCodeInfo[index].name;
+}
+
+int opCodeOperandBytes(OpCode op) {
+    OpCode first, second;
+    if (splitOpCode(op, first, second)) return opCodeOperandBytes(first) + opCodeOperandBytes(second);
+    return opCodeInfo[static_cast<size_t>(op)].operandBytes;
+}
+
+int opCodeStackEffect(OpCode op) {
+    OpCode first, second;
+    if (splitOpCode(op, first, second)) return opCodeStackEffect(first) + opCodeStackEffect(second);
+    return opCodeInfo[static_cast<size_t>(op)].stackEffect;
+}
+
+bool fuseOpCodes(OpCode first, OpCode second, OpCode& fused) {
+    for (size_t i = 0; i + 1 < sizeof(superinstructions) / sizeof(superinstructions[0]); ++i) {
+        if (superinstructions[i].first == first && superinstructions[i].second == second) {
+            fused = static_cast<OpCode>(plainOpCodeCount + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool splitOpCode(OpCode op, OpCode& first, OpCode& second) {
+    size_t index = static_cast<size_t>(op);
+    if (index < plainOpCodeCount) return false;
+    first = superinstructions[index - plainOpCodeCount].first;
+    second = superinstructions[index - plainOpCodeCount].second;
+    return true;
+}
+
+int Chunk::lineAt(size_t offset) const {
+    // Last run starting at or before `offset`.
+    size_t low = 0, high = lines.size();
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (lines[mid].offset <= offset) low = mid;
+        else high = mid;
+    }
+    return lines.empty() ? 0 : lines[low].line;
+}
+
+size_t disassembleInstruction(const Chunk& chunk, size_t offset, std::ostream& out) {
+    char prefix[32];
+    int line = chunk.lineAt(offset);
+    if (offset > 0 && chunk.lineAt(offset - 1) == line) {
+        std::snprintf(prefix, sizeof(prefix), "%04zu    | ", offset);
+    }
+    else {
+        std::snprintf(prefix, sizeof(prefix), "%04zu %4d ", offset, line);
+    }
+    out << prefix;
+
+    // A superinstruction shows the operands of both halves, in order.
+    OpCode op = static_cast<OpCode>(chunk.code[offset]);
+    OpCode first, second;
+    out << opCodeName(op);
+    size_t next = offset + 1;
+    if (splitOpCode(op, first, second)) {
+        next = disassembleOperands(chunk, first, next, out);
+        if (opCodeOperandBytes(first) > 0 && opCodeOperandBytes(second) > 0) out << ',';
+        next = disassembleOperands(chunk, second, next, out);
+    }
+    else {
+        next = disassembleOperands(chunk, op, next, out);
+    }
+    out << '\n';
+    return next;
+}
+
+void disassembleChunk(const Chunk& chunk, std::string_view name, std::ostream& out) {
+    out << "== " << name << " ==\n";
+    for (size_t offset = 0; offset < chunk.code.size();) {
+        offset = disassembleInstruction(chunk, offset, out);
+    }
+    for (Value constant : chunk.constants) {
+        if (constant.isObjType(ObjType::Proto)) {
+            ObjProto* proto = asProto(constant);
+            out << '\n';
+            disassembleChunk(proto->chunk, proto->name, out);
+        }
+    }
+}
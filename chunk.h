@@ -0,0 +1,166 @@
+#pragma once
+#include "shape.h"
+#include "switch_table.h"
+#include "value.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+// --- Instruction Set ---
+// X(name, operand bytes, stack effect). Operands follow the opcode byte;
+// 16-bit operands are little-endian. "slot" operands index the current
+// frame's locals, "const" operands the chunk's constant pool, "global"
+// operands the VM's GlobalTable, "cache" operands the chunk's inline
+// caches and "table" operands its switch tables. Jump offsets (SwitchTable
+// targets included) are unsigned and relative to the end of the
+// instruction. Stack effects marked * depend on the operands
+// and are accounted for by the compiler.
+#define DAV_OPCODES(X)                                                                       \
+    X(CONSTANT,          2,  1) /* const16: push a constant */                               \
+    X(NIL,               0,  1)                                                              \
+    X(TRUE,              0,  1)                                                              \
+    X(FALSE,             0,  1)                                                              \
+    X(POP,               0, -1)                                                              \
+    X(DUP,               0,  1) /* a -> a a */                                              \
+    X(DUP2,              0,  2) /* a b -> a b a b */                                        \
+    X(GET_LOCAL,         1,  1) /* slot8 */                                                  \
+    X(SET_LOCAL,         1,  0) /* slot8: store the top, leaving it on the stack */          \
+    X(GET_GLOBAL,        2,  1) /* global16 */                                               \
+    X(SET_GLOBAL,        2,  0) /* global16 */                                               \
+    X(DEFINE_GLOBAL,     2, -1) /* global16: declare and pop the initial value */            \
+    X(GET_UPVALUE,       1,  1) /* upvalue8 */                                               \
+    X(SET_UPVALUE,       1,  0) /* upvalue8 */                                               \
+    X(GET_INDEX,         0, -1) /* container key -> element */                              \
+    X(SET_INDEX,         0, -2) /* container key value -> value */                          \
+    X(GET_FIELD,         4,  0) /* const16 name, cache16: object -> field */                \
+    X(SET_FIELD,         4, -1) /* const16 name, cache16: object value -> value */          \
+    X(INCREMENT_INDEX,   1, -1) /* flags8: container key -> result (see IncrementFlags) */  \
+    X(INCREMENT_FIELD,   5,  0) /* const16 name, cache16, flags8: object -> result */       \
+    X(EQUAL,             0, -1)                                                              \
+    X(NOT_EQUAL,         0, -1)                                                              \
+    X(LESS,              0, -1)                                                              \
+    X(LESS_EQUAL,        0, -1)                                                              \
+    X(GREATER,           0, -1)                                                              \
+    X(GREATER_EQUAL,     0, -1)                                                              \
+    X(ADD,               0, -1)                                                              \
+    X(SUBTRACT,          0, -1)                                                              \
+    X(MULTIPLY,          0, -1)                                                              \
+    X(DIVIDE,            0, -1)                                                              \
+    X(MODULO,            0, -1)                                                              \
+    X(BIT_AND,           0, -1)                                                              \
+    X(BIT_OR,            0, -1)                                                              \
+    X(BIT_XOR,           0, -1)                                                              \
+    X(SHIFT_LEFT,        0, -1)                                                              \
+    X(SHIFT_RIGHT,       0, -1)                                                              \
+    X(NOT,               0,  0)                                                              \
+    X(NEGATE,            0,  0)                                                              \
+    X(UNARY_PLUS,        0,  0)                                                              \
+    X(BIT_NOT,           0,  0)                                                              \
+    X(INCREMENT,         0,  0) /* number -> number + 1 */                                   \
+    X(DECREMENT,         0,  0)                                                              \
+    X(JUMP,              2,  0) /* offset16 forward */                                       \
+    X(JUMP_IF_FALSE,     2,  0) /* offset16: jump if the top is falsey, keep it */          \
+    X(JUMP_IF_TRUE,      2,  0) /* offset16: jump if the top is truthy, keep it */          \
+    X(POP_JUMP_IF_FALSE, 2, -1) /* offset16: pop the top, jump if it was falsey */          \
+    X(JUMP_IF_EQUAL,     2, -1) /* offset16: pop a case value, jump if it equals the top */ \
+    X(SWITCH,            2,  0) /* table16: jump by the top via a SwitchTable, keep it */  \
+    X(LOOP,              2,  0) /* offset16 backward */                                      \
+    X(CALL,              1,  0) /* argc8: callee args -> result (*) */                       \
+    X(CLOSURE,           2,  1) /* const16 proto, then (isLocal8, index8) per upvalue */     \
+    X(CLOSE_UPVALUE,     0, -1) /* move the top local into its upvalue and pop it */         \
+    X(RETURN,            0, -1)                                                              \
+    X(PRINT,             0, -1)                                                              \
+    X(INVALID_TARGET,    0,  0) /* raise "Invalid assignment target." */
+
+// --- Superinstructions ---
+// X(name, first, second): `first` immediately followed by `second`, in one
+// dispatch. The operands are first's followed by second's, as the pair has
+// them unfused: a superinstruction is the pair without the second opcode
+// byte. The Compiler fuses pairs as it emits them (never across a jump
+// target or a line change); the VM implements each one by hand.
+//
+// The list starts with the most frequent adjacent pairs on the bench/
+// programs, as `--bench dispatch` ranks them (for any corpus), and rounds
+// out the families they belong to: every comparison feeding a branch,
+// decrements beside increments. A first half that may jump, or CLOSURE,
+// whose operands vary in length, never fuses. `--bench superinstructions`
+// runs each entry against its unfused pair; a new one needs a case there.
+#define DAV_SUPERINSTRUCTIONS(X)                                                                \
+    X(GET_LOCAL_CONSTANT,              GET_LOCAL,     CONSTANT)          /* i < 10, x + 1 */    \
+    X(GET_FIELD_GET_FIELD,             GET_FIELD,     GET_FIELD)         /* a.b.c */            \
+    X(SET_LOCAL_POP,                   SET_LOCAL,     POP)               /* x = ...; */         \
+    X(SET_GLOBAL_POP,                  SET_GLOBAL,    POP)                                      \
+    X(POP_POP,                         POP,           POP)                                      \
+    X(POP_LOOP,                        POP,           LOOP)              /* f(x); } (loop end) */ \
+    X(GET_LOCAL_DUP,                   GET_LOCAL,     DUP)               /* i++ */              \
+    X(INCREMENT_SET_LOCAL,             INCREMENT,     SET_LOCAL)                                \
+    X(DECREMENT_SET_LOCAL,             DECREMENT,     SET_LOCAL)                                \
+    X(GET_LOCAL_PRINT,                 GET_LOCAL,     PRINT)                                    \
+    X(EQUAL_POP_JUMP_IF_FALSE,         EQUAL,         POP_JUMP_IF_FALSE) /* if, while, for */   \
+    X(NOT_EQUAL_POP_JUMP_IF_FALSE,     NOT_EQUAL,     POP_JUMP_IF_FALSE)                        \
+    X(LESS_POP_JUMP_IF_FALSE,          LESS,          POP_JUMP_IF_FALSE)                        \
+    X(LESS_EQUAL_POP_JUMP_IF_FALSE,    LESS_EQUAL,    POP_JUMP_IF_FALSE)                        \
+    X(GREATER_POP_JUMP_IF_FALSE,       GREATER,       POP_JUMP_IF_FALSE)                        \
+    X(GREATER_EQUAL_POP_JUMP_IF_FALSE, GREATER_EQUAL, POP_JUMP_IF_FALSE)
+
+enum class OpCode : uint8_t {
+#define DAV_OPCODE_ENUM(name, operands, effect) name,
+    DAV_OPCODES(DAV_OPCODE_ENUM)
+#undef DAV_OPCODE_ENUM
+#define DAV_SUPERINSTRUCTION_ENUM(name, first, second) name,
+    DAV_SUPERINSTRUCTIONS(DAV_SUPERINSTRUCTION_ENUM)
+#undef DAV_SUPERINSTRUCTION_ENUM
+};
+
+#define DAV_COUNT_OPCODE(...) +1
+constexpr int opCodeCount = 0 DAV_OPCODES(DAV_COUNT_OPCODE) DAV_SUPERINSTRUCTIONS(DAV_COUNT_OPCODE);
+#undef DAV_COUNT_OPCODE
+
+// Operand of INCREMENT_INDEX and INCREMENT_FIELD
+enum IncrementFlags : uint8_t {
+    INCREMENT_DECREMENT = 1, // -- instead of ++
+    INCREMENT_POSTFIX = 2    // Result is the old value instead of the new one
+};
+
+const char* opCodeName(OpCode op);
+int opCodeOperandBytes(OpCode op); // Fixed part only; CLOSURE adds 2 per upvalue
+int opCodeStackEffect(OpCode op);
+// The superinstruction for `first` followed by `second`, if there is one.
+bool fuseOpCodes(OpCode first, OpCode second, OpCode& fused);
+// The pair a superinstruction stands for; false for the other opcodes.
+bool splitOpCode(OpCode op, OpCode& first, OpCode& second);
+
+// --- Chunk ---
+
+// Bytecode for one function: the instructions, the constants they refer to
+// and a run-length line table mapping instruction offsets back to source lines.
+struct Chunk {
+    struct LineStart {
+        uint32_t offset; // First byte emitted for `line`
+        int line;
+    };
+
+    std::vector<uint8_t> code;
+    std::vector<Value> constants;
+    std::vector<LineStart> lines;
+    std::vector<InlineCache> caches; // One per field access instruction
+    std::vector<SwitchTable> switches; // One per SWITCH instruction
+
+    void write(uint8_t byte, int line) {
+        if (lines.empty() || lines.back().line != line) {
+            lines.push_back({ static_cast<uint32_t>(code.size()), line });
+        }
+        code.push_back(byte);
+    }
+
+    // Source line of the instruction byte at `offset`.
+    int lineAt(size_t offset) const;
+};
+
+// Human-readable listing of `chunk` (and of the functions in its constant
+// pool), one instruction per line.
+void disassembleChunk(const Chunk& chunk, std::string_view name, std::ostream& out);
+// Prints the instruction at `offset`; returns the offset of the next one.
+size_t disassembleInstruction(const Chunk& chunk, size_t offset, std::ostream& out);
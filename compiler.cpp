@@ -0,0 +1,831 @@
+#include "compiler.h"
+#include "declaration_nodes.h"
+#include "expr_nodes.h"
+#include "operators.h"
+#include "stmt_nodes.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+bool isIncrement(const PostfixTail* tail) {
+    return tail->op.type == TokenType::PLUS_PLUS || tail->op.type == TokenType::MINUS_MINUS;
+}
+
+uint8_t incrementFlags(TokenType op, bool postfix) {
+    uint8_t flags = op == TokenType::MINUS_MINUS ? INCREMENT_DECREMENT : 0;
+    if (postfix) flags |= INCREMENT_POSTFIX;
+    return flags;
+}
+
+} // namespace
+
+int GlobalTable::slotFor(Symbol name) {
+    auto it = slots.find(name);
+    if (it != slots.end()) return it->second;
+    if (names.size() > UINT16_MAX) return -1;
+    uint16_t slot = static_cast<uint16_t>(names.size());
+    names.push_back(symbols().text(name));
+    values.push_back(Value::nil());
+    defined.push_back(0);
+    slots.emplace(name, slot);
+    return slot;
+}
+
+OpCode binaryOpCode(TokenType op) {
+    switch (op) {
+    case TokenType::PLUS: return OpCode::ADD;
+    case TokenType::MINUS: return OpCode::SUBTRACT;
+    case TokenType::STAR: return OpCode::MULTIPLY;
+    case TokenType::SLASH: return OpCode::DIVIDE;
+    case TokenType::PERCENT: return OpCode::MODULO;
+    case TokenType::AMP: return OpCode::BIT_AND;
+    case TokenType::PIPE: return OpCode::BIT_OR;
+    case TokenType::CARET: return OpCode::BIT_XOR;
+    case TokenType::SHIFT_LEFT: return OpCode::SHIFT_LEFT;
+    case TokenType::SHIFT_RIGHT: return OpCode::SHIFT_RIGHT;
+    case TokenType::EQUAL_EQUAL: return OpCode::EQUAL;
+    case TokenType::BANG_EQUAL: return OpCode::NOT_EQUAL;
+    case TokenType::LESS: return OpCode::LESS;
+    case TokenType::LESS_EQUAL: return OpCode::LESS_EQUAL;
+    case TokenType::GREATER: return OpCode::GREATER;
+    default: return OpCode::GREATER_EQUAL;
+    }
+}
+
+Compiler::Compiler(Heap& heap, GlobalTable& globals, CompilerOptions options)
+    : heap(heap), globals(globals), options(options) {
+}
+
+ObjProto* Compiler::compile(const std::vector<Declaration*>& program) {
+    FunctionState script{ nullptr, heap.makeProto() };
+    current = &script;
+    script.locals.push_back({ noSymbol, 0 }); // Slot 0 holds the running closure
+    adjustStack(1);
+    try {
+        compileStatements(program);
+        emitOp(OpCode::NIL);
+        emitOp(OpCode::RETURN);
+    }
+    catch (CompileError&) {
+        current = nullptr;
+        return nullptr;
+    }
+    current = nullptr;
+    return script.proto;
+}
+
+// --- Emission ---
+
+Chunk& Compiler::chunk() {
+    return current->proto->chunk;
+}
+
+void Compiler::emitByte(uint8_t byte) {
+    chunk().write(byte, line);
+}
+
+void Compiler::emitOp(OpCode op) {
+    adjustStack(opCodeStackEffect(op));
+    // The pair fuses unless a jump lands between the two or they are on
+    // different lines (a runtime error must still report the right one).
+    Chunk& code = chunk();
+    std::ptrdiff_t last = current->lastInstruction;
+    OpCode fused;
+    if (options.superinstructions && last >= static_cast<std::ptrdiff_t>(current->label) &&
+        code.lines.back().line == line && code.lines.back().offset <= static_cast<size_t>(last) &&
+        fuseOpCodes(static_cast<OpCode>(code.code[last]), op, fused)) {
+        code.code[last] = static_cast<uint8_t>(fused);
+        return;
+    }
+    current->lastInstruction = static_cast<std::ptrdiff_t>(code.code.size());
+    emitByte(static_cast<uint8_t>(op));
+}
+
+void Compiler::emitOp(OpCode op, uint8_t operand) {
+    emitOp(op);
+    emitByte(operand);
+}
+
+void Compiler::emitOpShort(OpCode op, uint16_t operand) {
+    emitOp(op);
+    emitByte(static_cast<uint8_t>(operand & 0xff));
+    emitByte(static_cast<uint8_t>(operand >> 8));
+}
+
+void Compiler::emitField(OpCode op, uint16_t constant) {
+    if (chunk().caches.size() > UINT16_MAX) throw error("Too many field accesses in one function.");
+    uint16_t cache = static_cast<uint16_t>(chunk().caches.size());
+    chunk().caches.emplace_back();
+    emitOpShort(op, constant);
+    emitByte(static_cast<uint8_t>(cache & 0xff));
+    emitByte(static_cast<uint8_t>(cache >> 8));
+}
+
+void Compiler::adjustStack(int delta) {
+    current->stackDepth += delta;
+    if (current->stackDepth > current->proto->maxStack) {
+        current->proto->maxStack = current->stackDepth;
+    }
+}
+
+size_t Compiler::emitJump(OpCode op) {
+    emitOpShort(op, 0xffff);
+    return chunk().code.size() - 2;
+}
+
+void Compiler::patchJump(size_t operandOffset) {
+    patchJumpTo(operandOffset, chunk().code.size());
+}
+
+void Compiler::patchJumpTo(size_t operandOffset, size_t target) {
+    size_t distance = target - (operandOffset + 2);
+    if (distance > UINT16_MAX) throw error("Too much code to jump over.");
+    current->label = target;
+    chunk().code[operandOffset] = static_cast<uint8_t>(distance & 0xff);
+    chunk().code[operandOffset + 1] = static_cast<uint8_t>(distance >> 8);
+}
+
+size_t Compiler::label() {
+    current->label = chunk().code.size();
+    return current->label;
+}
+
+void Compiler::emitLoop(size_t loopStart) {
+    emitOp(OpCode::LOOP);
+    size_t distance = chunk().code.size() + 2 - loopStart;
+    if (distance > UINT16_MAX) throw error("Loop body too large.");
+    emitByte(static_cast<uint8_t>(distance & 0xff));
+    emitByte(static_cast<uint8_t>(distance >> 8));
+}
+
+uint16_t Compiler::makeConstant(Value value) {
+    std::vector<Value>& constants = chunk().constants;
+    if (constants.size() > UINT16_MAX) throw error("Too many constants in one function.");
+    constants.push_back(value);
+    return static_cast<uint16_t>(constants.size() - 1);
+}
+
+uint16_t Compiler::numberConstant(double number) {
+    uint64_t bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+    auto it = current->numberConstants.find(bits);
+    if (it != current->numberConstants.end()) return it->second;
+    uint16_t index = makeConstant(Value::number(number));
+    current->numberConstants.emplace(bits, index);
+    return index;
+}
+
+uint16_t Compiler::stringConstant(Symbol chars) {
+    auto it = current->stringConstants.find(chars);
+    if (it != current->stringConstants.end()) return it->second;
+    // Field names are looked up by symbol; the VM reads it from the constant.
+    ObjString* string = heap.makeString(std::string(symbols().text(chars)));
+    string->symbol = chars;
+    uint16_t index = makeConstant(Value::object(string));
+    current->stringConstants.emplace(chars, index);
+    return index;
+}
+
+Compiler::CompileError Compiler::error(const std::string& message) {
+    std::cerr << "[Line " << line << "] Error: " << message << std::endl;
+    return CompileError();
+}
+
+// --- Scopes and Variables ---
+
+void Compiler::compileStatement(Declaration* decl) {
+    if (decl) decl->accept(*this);
+}
+
+void Compiler::compileStatements(const std::vector<Declaration*>& statements) {
+    for (Declaration* statement : statements) {
+        compileStatement(statement);
+    }
+}
+
+void Compiler::compile(Expr* expr) {
+    expr->accept(*this);
+}
+
+void Compiler::beginScope() {
+    ++current->scopeDepth;
+}
+
+void Compiler::endScope() {
+    --current->scopeDepth;
+    std::vector<Local>& locals = current->locals;
+    while (!locals.empty() && locals.back().depth > current->scopeDepth) {
+        emitOp(locals.back().captured ? OpCode::CLOSE_UPVALUE : OpCode::POP);
+        locals.pop_back();
+    }
+}
+
+void Compiler::discardLocals(size_t localCount) {
+    for (size_t i = current->locals.size(); i > localCount; --i) {
+        emitOp(current->locals[i - 1].captured ? OpCode::CLOSE_UPVALUE : OpCode::POP);
+    }
+}
+
+void Compiler::addLocal(Symbol name) {
+    if (current->locals.size() > UINT8_MAX) throw error("Too many local variables in function.");
+    current->locals.push_back({ name, current->scopeDepth });
+}
+
+int Compiler::resolveLocal(FunctionState* state, Symbol name) {
+    for (size_t i = state->locals.size(); i > 0; --i) {
+        if (state->locals[i - 1].name == name) return static_cast<int>(i - 1);
+    }
+    return -1;
+}
+
+int Compiler::resolveUpvalue(FunctionState* state, Symbol name) {
+    if (state->enclosing == nullptr) return -1;
+    int local = resolveLocal(state->enclosing, name);
+    if (local >= 0) {
+        state->enclosing->locals[local].captured = true;
+        return addUpvalue(state, static_cast<uint8_t>(local), true);
+    }
+    int upvalue = resolveUpvalue(state->enclosing, name);
+    if (upvalue >= 0) return addUpvalue(state, static_cast<uint8_t>(upvalue), false);
+    return -1;
+}
+
+int Compiler::addUpvalue(FunctionState* state, uint8_t index, bool isLocal) {
+    for (size_t i = 0; i < state->upvalues.size(); ++i) {
+        if (state->upvalues[i].index == index && state->upvalues[i].isLocal == isLocal) {
+            return static_cast<int>(i);
+        }
+    }
+    if (state->upvalues.size() > UINT8_MAX) throw error("Too many closure variables in function.");
+    state->upvalues.push_back({ index, isLocal });
+    return static_cast<int>(state->upvalues.size() - 1);
+}
+
+void Compiler::emitGetVariable(Symbol name) {
+    int slot = resolveLocal(current, name);
+    if (slot >= 0) {
+        emitOp(OpCode::GET_LOCAL, static_cast<uint8_t>(slot));
+        return;
+    }
+    slot = resolveUpvalue(current, name);
+    if (slot >= 0) {
+        emitOp(OpCode::GET_UPVALUE, static_cast<uint8_t>(slot));
+        return;
+    }
+    slot = globals.slotFor(name);
+    if (slot < 0) throw error("Too many global variables.");
+    emitOpShort(OpCode::GET_GLOBAL, static_cast<uint16_t>(slot));
+}
+
+void Compiler::emitSetVariable(Symbol name) {
+    int slot = resolveLocal(current, name);
+    if (slot >= 0) {
+        emitOp(OpCode::SET_LOCAL, static_cast<uint8_t>(slot));
+        return;
+    }
+    slot = resolveUpvalue(current, name);
+    if (slot >= 0) {
+        emitOp(OpCode::SET_UPVALUE, static_cast<uint8_t>(slot));
+        return;
+    }
+    slot = globals.slotFor(name);
+    if (slot < 0) throw error("Too many global variables.");
+    emitOpShort(OpCode::SET_GLOBAL, static_cast<uint16_t>(slot));
+}
+
+Compiler::JumpTarget* Compiler::innermostTarget(bool loopOnly) {
+    for (size_t i = current->targets.size(); i > 0; --i) {
+        JumpTarget& target = current->targets[i - 1];
+        if (target.isLoop || !loopOnly) return &target;
+    }
+    return nullptr;
+}
+
+void Compiler::compileFunction(FuncDecl* decl) {
+    FunctionState function{ current, heap.makeProto() };
+    function.proto->name = decl->name.lexeme;
+    function.proto->arity = static_cast<int>(decl->params.size());
+    current = &function;
+
+    // Parameters and the body's top-level declarations share one scope, as
+    // in the tree-walking interpreter.
+    beginScope();
+    function.locals.push_back({ noSymbol, 1 }); // Slot 0 holds the callee
+    adjustStack(1);
+    for (const TokenRef& param : decl->params) {
+        line = param.line;
+        addLocal(param.symbol);
+        adjustStack(1);
+    }
+    compileStatements(decl->body->statements);
+    emitOp(OpCode::NIL);
+    emitOp(OpCode::RETURN);
+
+    function.proto->upvalueCount = static_cast<int>(function.upvalues.size());
+    current = function.enclosing;
+    line = decl->name.line;
+    emitOpShort(OpCode::CLOSURE, makeConstant(Value::object(function.proto)));
+    for (const UpvalueRef& upvalue : function.upvalues) {
+        emitByte(upvalue.isLocal ? 1 : 0);
+        emitByte(upvalue.index);
+    }
+}
+
+// --- Declarations ---
+
+void Compiler::visitVarDecl(VarDecl* decl) {
+    line = decl->name.line;
+    Symbol name = decl->name.symbol;
+    // The initializer is compiled before the variable exists, so a use of
+    // `name` inside it refers to an outer variable (as in the interpreter).
+    if (decl->initializer) compile(decl->initializer);
+    else emitOp(OpCode::NIL);
+    line = decl->name.line;
+
+    if (current->scopeDepth == 0) {
+        int slot = globals.slotFor(name);
+        if (slot < 0) throw error("Too many global variables.");
+        emitOpShort(OpCode::DEFINE_GLOBAL, static_cast<uint16_t>(slot));
+        return;
+    }
+    // Redeclaring a name in the same scope reuses its slot.
+    int existing = resolveLocal(current, name);
+    if (existing >= 0 && current->locals[existing].depth == current->scopeDepth) {
+        emitOp(OpCode::SET_LOCAL, static_cast<uint8_t>(existing));
+        emitOp(OpCode::POP);
+        return;
+    }
+    addLocal(name);
+}
+
+void Compiler::visitFuncDecl(FuncDecl* decl) {
+    line = decl->name.line;
+    Symbol name = decl->name.symbol;
+    if (current->scopeDepth == 0) {
+        int slot = globals.slotFor(name);
+        if (slot < 0) throw error("Too many global variables.");
+        compileFunction(decl);
+        emitOpShort(OpCode::DEFINE_GLOBAL, static_cast<uint16_t>(slot));
+        return;
+    }
+    int existing = resolveLocal(current, name);
+    if (existing >= 0 && current->locals[existing].depth == current->scopeDepth) {
+        compileFunction(decl);
+        emitOp(OpCode::SET_LOCAL, static_cast<uint8_t>(existing));
+        emitOp(OpCode::POP);
+        return;
+    }
+    // Declared before the body is compiled so the function can call itself;
+    // CLOSURE pushes the value into the new slot.
+    addLocal(name);
+    compileFunction(decl);
+}
+
+// --- Statements ---
+
+void Compiler::visitBlockStmt(BlockStmt* stmt) {
+    beginScope();
+    compileStatements(stmt->statements);
+    endScope();
+}
+
+void Compiler::visitIfStmt(IfStmt* stmt) {
+    compile(stmt->condition);
+    size_t elseJump = emitJump(OpCode::POP_JUMP_IF_FALSE);
+    compileStatement(stmt->thenBranch);
+    if (stmt->elseBranch) {
+        size_t endJump = emitJump(OpCode::JUMP);
+        patchJump(elseJump);
+        compileStatement(stmt->elseBranch);
+        patchJump(endJump);
+    }
+    else {
+        patchJump(elseJump);
+    }
+}
+
+void Compiler::visitForStmt(ForStmt* stmt) {
+    // The initializer's variable lives in a scope of its own around the loop.
+    beginScope();
+    compileStatement(stmt->initializer);
+    size_t loopStart = label();
+    size_t exitJump = 0;
+    if (stmt->condition) {
+        compile(stmt->condition);
+        exitJump = emitJump(OpCode::POP_JUMP_IF_FALSE);
+    }
+
+    current->targets.push_back({ true, current->locals.size(), -1 });
+    compileStatement(stmt->body);
+    JumpTarget target = std::move(current->targets.back());
+    current->targets.pop_back();
+
+    for (size_t jump : target.continueJumps) patchJump(jump);
+    if (stmt->increment) {
+        compile(stmt->increment);
+        emitOp(OpCode::POP);
+    }
+    emitLoop(loopStart);
+    if (stmt->condition) patchJump(exitJump);
+    for (size_t jump : target.breakJumps) patchJump(jump);
+    endScope();
+}
+
+void Compiler::visitWhileStmt(WhileStmt* stmt) {
+    size_t loopStart = label();
+    compile(stmt->condition);
+    size_t exitJump = emitJump(OpCode::POP_JUMP_IF_FALSE);
+
+    current->targets.push_back({ true, current->locals.size(), static_cast<std::ptrdiff_t>(loopStart) });
+    compileStatement(stmt->body);
+    JumpTarget target = std::move(current->targets.back());
+    current->targets.pop_back();
+
+    emitLoop(loopStart);
+    patchJump(exitJump);
+    for (size_t jump : target.breakJumps) patchJump(jump);
+}
+
+void Compiler::visitDoWhileStmt(DoWhileStmt* stmt) {
+    size_t loopStart = label();
+    current->targets.push_back({ true, current->locals.size(), -1 });
+    compileStatement(stmt->body);
+    JumpTarget target = std::move(current->targets.back());
+    current->targets.pop_back();
+
+    for (size_t jump : target.continueJumps) patchJump(jump);
+    compile(stmt->condition);
+    size_t exitJump = emitJump(OpCode::POP_JUMP_IF_FALSE);
+    emitLoop(loopStart);
+    patchJump(exitJump);
+    for (size_t jump : target.breakJumps) patchJump(jump);
+}
+
+void Compiler::visitSwitchStmt(SwitchStmt* stmt) {
+    // The subject stays in a hidden local while the case values are compared
+    // against it in order; the first match jumps into its body and bodies
+    // fall through to the next one until a break. No match runs 'default'
+    // (the last one, if there are several) or skips the switch.
+    beginScope();
+    compile(stmt->condition);
+    addLocal(noSymbol);
+    if (options.switchTables && compileSwitchTable(stmt)) {
+        endScope();
+        return;
+    }
+
+    std::vector<size_t> caseJumps(stmt->cases.size());
+    for (size_t i = 0; i < stmt->cases.size(); ++i) {
+        if (stmt->cases[i]->value == nullptr) continue;
+        compile(stmt->cases[i]->value);
+        caseJumps[i] = emitJump(OpCode::JUMP_IF_EQUAL);
+    }
+    size_t noMatchJump = emitJump(OpCode::JUMP);
+    bool hasDefault = false;
+
+    current->targets.push_back({ false, current->locals.size(), -1 });
+    for (size_t i = 0; i < stmt->cases.size(); ++i) {
+        CaseStmt* c = stmt->cases[i];
+        if (c->value) {
+            patchJump(caseJumps[i]);
+        }
+        else {
+            patchJump(noMatchJump);
+            hasDefault = true;
+        }
+        // Each case body is a scope of its own.
+        beginScope();
+        compileStatements(c->body);
+        endScope();
+    }
+    if (!hasDefault) patchJump(noMatchJump);
+
+    JumpTarget target = std::move(current->targets.back());
+    current->targets.pop_back();
+    for (size_t jump : target.breakJumps) patchJump(jump);
+    endScope();
+}
+
+bool Compiler::compileSwitchTable(SwitchStmt* stmt) {
+    // Comparing integer constants has no side effects, so one SWITCH can
+    // find the case the comparisons would have.
+    std::vector<int64_t> values;
+    for (CaseStmt* c : stmt->cases) {
+        if (c->value == nullptr) continue;
+        int64_t value = 0;
+        if (!integerCaseValue(c->value, value)) return false;
+        values.push_back(value);
+    }
+    if (values.size() < SwitchTable::minimumCases) return false;
+    if (chunk().switches.size() > UINT16_MAX) throw error("Too many switch tables in one function.");
+
+    uint16_t index = static_cast<uint16_t>(chunk().switches.size());
+    chunk().switches.emplace_back();
+    emitOpShort(OpCode::SWITCH, index);
+    size_t base = chunk().code.size();
+
+    std::vector<uint32_t> targets;
+    uint32_t missTarget = 0;
+    bool hasDefault = false;
+    current->targets.push_back({ false, current->locals.size(), -1 });
+    for (CaseStmt* c : stmt->cases) {
+        uint32_t target = static_cast<uint32_t>(label() - base);
+        if (c->value) {
+            targets.push_back(target);
+        }
+        else {
+            missTarget = target;
+            hasDefault = true;
+        }
+        beginScope();
+        compileStatements(c->body);
+        endScope();
+    }
+    if (!hasDefault) missTarget = static_cast<uint32_t>(label() - base);
+    chunk().switches[index] = SwitchTable(values, targets, missTarget);
+
+    JumpTarget target = std::move(current->targets.back());
+    current->targets.pop_back();
+    for (size_t jump : target.breakJumps) patchJump(jump);
+    return true;
+}
+
+void Compiler::visitBreakStmt(BreakStmt*) {
+    JumpTarget* target = innermostTarget(false);
+    if (target == nullptr) throw error("Can't use 'break' outside of a loop or switch.");
+    // The code after a jump is unreachable; keep compiling at this height.
+    int depth = current->stackDepth;
+    discardLocals(target->localCount);
+    target->breakJumps.push_back(emitJump(OpCode::JUMP));
+    current->stackDepth = depth;
+}
+
+void Compiler::visitContinueStmt(ContinueStmt*) {
+    JumpTarget* target = innermostTarget(true);
+    if (target == nullptr) throw error("Can't use 'continue' outside of a loop.");
+    int depth = current->stackDepth;
+    discardLocals(target->localCount);
+    if (target->continueTarget >= 0) {
+        emitLoop(static_cast<size_t>(target->continueTarget));
+    }
+    else {
+        target->continueJumps.push_back(emitJump(OpCode::JUMP));
+    }
+    current->stackDepth = depth;
+}
+
+void Compiler::visitReturnStmt(ReturnStmt* stmt) {
+    if (current->enclosing == nullptr) throw error("Can't return from top-level code.");
+    int depth = current->stackDepth;
+    if (stmt->value) compile(stmt->value);
+    else emitOp(OpCode::NIL);
+    emitOp(OpCode::RETURN);
+    current->stackDepth = depth;
+}
+
+void Compiler::visitPrintStmt(PrintStmt* stmt) {
+    compile(stmt->expression);
+    emitOp(OpCode::PRINT);
+}
+
+void Compiler::visitExprStmt(ExprStmt* stmt) {
+    // An empty statement (';') has no expression.
+    if (stmt->expression == nullptr) return;
+    compile(stmt->expression);
+    emitOp(OpCode::POP);
+}
+
+// --- Assignment Targets ---
+
+Compiler::PlaceKind Compiler::compilePlace(Expr* target, Symbol& name) {
+    int depth = current->stackDepth;
+    if (PrimaryExpr* primary = dynamic_cast<PrimaryExpr*>(target)) {
+        if (primary->value.type == TokenType::IDENTIFIER) {
+            name = primary->value.symbol;
+            return PlaceKind::Variable;
+        }
+    }
+    else if (PostfixExpr* postfix = dynamic_cast<PostfixExpr*>(target)) {
+        // Everything but the last tail is evaluated; the last one names the place.
+        compileChain(postfix, postfix->tails.size() - 1);
+        PostfixTail* last = postfix->tails.back();
+        line = last->op.line;
+        if (last->op.type == TokenType::LEFT_BRACKET) {
+            compile(last->indexOrCondition);
+            return PlaceKind::Index;
+        }
+        if (last->op.type == TokenType::DOT) {
+            name = static_cast<PrimaryExpr*>(last->indexOrCondition)->value.symbol;
+            return PlaceKind::Field;
+        }
+    }
+    emitOp(OpCode::INVALID_TARGET);
+    current->stackDepth = depth;
+    return PlaceKind::None;
+}
+
+// --- Expressions ---
+
+void Compiler::visitAssignmentExpr(AssignmentExpr* expr) {
+    Symbol name = noSymbol;
+    PlaceKind place = compilePlace(expr->left, name);
+    TokenType op = compoundAssignmentOperator(expr->op.type);
+    bool compound = op != TokenType::EQUAL;
+
+    switch (place) {
+    case PlaceKind::Variable:
+        if (compound) {
+            line = expr->op.line;
+            emitGetVariable(name);
+        }
+        compile(expr->right);
+        line = expr->op.line;
+        if (compound) emitOp(binaryOpCode(op));
+        emitSetVariable(name);
+        break;
+    case PlaceKind::Index:
+        line = expr->op.line;
+        if (compound) {
+            emitOp(OpCode::DUP2);
+            emitOp(OpCode::GET_INDEX);
+        }
+        compile(expr->right);
+        line = expr->op.line;
+        if (compound) emitOp(binaryOpCode(op));
+        emitOp(OpCode::SET_INDEX);
+        break;
+    case PlaceKind::Field: {
+        line = expr->op.line;
+        uint16_t constant = stringConstant(name);
+        if (compound) {
+            emitOp(OpCode::DUP);
+            emitField(OpCode::GET_FIELD, constant);
+        }
+        compile(expr->right);
+        line = expr->op.line;
+        if (compound) emitOp(binaryOpCode(op));
+        emitField(OpCode::SET_FIELD, constant);
+        break;
+    }
+    default:
+        adjustStack(1); // INVALID_TARGET never produces its value
+        break;
+    }
+}
+
+void Compiler::visitConditionalExpr(ConditionalExpr* expr) {
+    compile(expr->condition);
+    size_t elseJump = emitJump(OpCode::POP_JUMP_IF_FALSE);
+    compile(expr->thenExpr);
+    size_t endJump = emitJump(OpCode::JUMP);
+    patchJump(elseJump);
+    adjustStack(-1); // Only one branch's value is ever pushed
+    compile(expr->elseExpr);
+    patchJump(endJump);
+}
+
+void Compiler::visitLogicalExpr(LogicalExpr* expr) {
+    // Short-circuits and yields the deciding operand, not a boolean.
+    compile(expr->left);
+    line = expr->op.line;
+    size_t endJump = emitJump(expr->op.type == TokenType::PIPE_PIPE ? OpCode::JUMP_IF_TRUE : OpCode::JUMP_IF_FALSE);
+    emitOp(OpCode::POP);
+    compile(expr->right);
+    patchJump(endJump);
+}
+
+void Compiler::visitBinaryExpr(BinaryExpr* expr) {
+    compile(expr->left);
+    compile(expr->right);
+    line = expr->op.line;
+    emitOp(binaryOpCode(expr->op.type));
+}
+
+void Compiler::visitUnaryExpr(UnaryExpr* expr) {
+    TokenType op = expr->op.type;
+    if (op != TokenType::PLUS_PLUS && op != TokenType::MINUS_MINUS) {
+        compile(expr->right);
+        line = expr->op.line;
+        switch (op) {
+        case TokenType::BANG: emitOp(OpCode::NOT); break;
+        case TokenType::MINUS: emitOp(OpCode::NEGATE); break;
+        case TokenType::PLUS: emitOp(OpCode::UNARY_PLUS); break;
+        default: emitOp(OpCode::BIT_NOT); break;
+        }
+        return;
+    }
+
+    // Prefix increment: yields the updated value.
+    line = expr->op.line;
+    Symbol name = noSymbol;
+    PlaceKind place = compilePlace(expr->right, name);
+    line = expr->op.line;
+    switch (place) {
+    case PlaceKind::Variable:
+        emitGetVariable(name);
+        emitOp(op == TokenType::PLUS_PLUS ? OpCode::INCREMENT : OpCode::DECREMENT);
+        emitSetVariable(name);
+        break;
+    case PlaceKind::Index:
+        emitOp(OpCode::INCREMENT_INDEX, incrementFlags(op, false));
+        break;
+    case PlaceKind::Field:
+        emitField(OpCode::INCREMENT_FIELD, stringConstant(name));
+        emitByte(incrementFlags(op, false));
+        break;
+    default:
+        adjustStack(1);
+        break;
+    }
+}
+
+void Compiler::compileChain(PostfixExpr* expr, size_t count) {
+    size_t i = 0;
+    PrimaryExpr* primary = dynamic_cast<PrimaryExpr*>(expr->primary);
+    if (count > 0 && isIncrement(expr->tails[0]) && primary && primary->value.type == TokenType::IDENTIFIER) {
+        // Postfix increment of a variable: yields the value before the update.
+        line = primary->value.line;
+        emitGetVariable(primary->value.symbol);
+        line = expr->tails[0]->op.line;
+        emitOp(OpCode::DUP);
+        emitOp(expr->tails[0]->op.type == TokenType::PLUS_PLUS ? OpCode::INCREMENT : OpCode::DECREMENT);
+        emitSetVariable(primary->value.symbol);
+        emitOp(OpCode::POP);
+        i = 1;
+    }
+    else {
+        compile(expr->primary);
+    }
+
+    for (; i < count; ++i) {
+        PostfixTail* tail = expr->tails[i];
+        // An element or field followed by ++/-- is updated in place.
+        PostfixTail* increment = i + 1 < count && isIncrement(expr->tails[i + 1]) ? expr->tails[i + 1] : nullptr;
+        switch (tail->op.type) {
+        case TokenType::LEFT_PAREN: {
+            if (tail->arguments.size() > UINT8_MAX) throw error("Can't have more than 255 arguments.");
+            for (Expr* arg : tail->arguments) {
+                compile(arg);
+            }
+            line = tail->op.line;
+            emitOp(OpCode::CALL, static_cast<uint8_t>(tail->arguments.size()));
+            adjustStack(-static_cast<int>(tail->arguments.size()));
+            break;
+        }
+        case TokenType::LEFT_BRACKET:
+            compile(tail->indexOrCondition);
+            if (increment) {
+                line = increment->op.line;
+                emitOp(OpCode::INCREMENT_INDEX, incrementFlags(increment->op.type, true));
+                ++i;
+            }
+            else {
+                line = tail->op.line;
+                emitOp(OpCode::GET_INDEX);
+            }
+            break;
+        case TokenType::DOT: {
+            uint16_t constant = stringConstant(static_cast<PrimaryExpr*>(tail->indexOrCondition)->value.symbol);
+            if (increment) {
+                line = increment->op.line;
+                emitField(OpCode::INCREMENT_FIELD, constant);
+                emitByte(incrementFlags(increment->op.type, true));
+                ++i;
+            }
+            else {
+                line = tail->op.line;
+                emitField(OpCode::GET_FIELD, constant);
+            }
+            break;
+        }
+        default:
+            // ++/-- on something that is not a place (a call result, say).
+            line = tail->op.line;
+            emitOp(OpCode::INCREMENT);
+            emitOp(OpCode::INVALID_TARGET);
+            break;
+        }
+    }
+}
+
+void Compiler::visitPostfixExpr(PostfixExpr* expr) {
+    compileChain(expr, expr->tails.size());
+}
+
+void Compiler::visitPrimaryExpr(PrimaryExpr* expr) {
+    const TokenRef& token = expr->value;
+    line = token.line;
+    switch (token.type) {
+    case TokenType::NUMBER: emitOpShort(OpCode::CONSTANT, numberConstant(token.numberValue())); break;
+    case TokenType::STRING: emitOpShort(OpCode::CONSTANT, stringConstant(token.symbol)); break;
+    case TokenType::TRUE: emitOp(OpCode::TRUE); break;
+    case TokenType::FALSE: emitOp(OpCode::FALSE); break;
+    case TokenType::NIL: emitOp(OpCode::NIL); break;
+    default: emitGetVariable(token.symbol); break;
+    }
+}
+
+void Compiler::visitGroupingExpr(GroupingExpr* expr) {
+    compile(expr->expression);
+}
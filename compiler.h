@@ -0,0 +1,184 @@
+#pragma once
+#include "ast_visitor.h"
+#include "chunk.h"
+#include "object.h"
+#include "token.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Expr;
+class Stmt;
+class PostfixExpr;
+class SwitchStmt;
+
+// Global variables of a VM. The compiler gives every global name a slot
+// when it first sees it; the VM stores the values by slot, so a global
+// access never hashes a name at run time.
+struct GlobalTable {
+    std::vector<std::string_view> names; // Interned text, for error messages
+    std::vector<Value> values;
+    std::vector<uint8_t> defined; // Assigned by a declaration (or a builtin) yet?
+    std::unordered_map<Symbol, uint16_t> slots;
+
+    // Slot of `name`, added (undefined) if it is new. -1 when the table is full.
+    int slotFor(Symbol name);
+    int slotFor(std::string_view name) { return slotFor(symbols().intern(name)); }
+};
+
+// Optional parts of the lowering, all on by default; turning one off is for
+// measuring what it buys.
+struct CompilerOptions {
+    bool superinstructions = true; // Fuse instruction pairs (see DAV_SUPERINSTRUCTIONS)
+    bool switchTables = true;      // SWITCH for switches on integer constants (see SwitchTable)
+};
+
+// Lowers a parsed program to bytecode for the VM.
+// Top-level variables become GlobalTable slots; everything declared inside a
+// function or block lives in a stack slot of the enclosing function's frame,
+// and variables captured by nested functions become upvalues.
+class Compiler : public AstVisitor {
+public:
+    // Constants (strings, compiled functions) are allocated on `heap`.
+    Compiler(Heap& heap, GlobalTable& globals, CompilerOptions options = CompilerOptions());
+
+    // The top-level script as a zero-argument function, or nullptr after a
+    // compile error (reported on std::cerr like a parse error).
+    ObjProto* compile(const std::vector<Declaration*>& program);
+
+    // --- Visitor Methods ---
+    void visitVarDecl(VarDecl* decl) override;
+    void visitFuncDecl(FuncDecl* decl) override;
+    void visitBlockStmt(BlockStmt* stmt) override;
+    void visitIfStmt(IfStmt* stmt) override;
+    void visitForStmt(ForStmt* stmt) override;
+    void visitWhileStmt(WhileStmt* stmt) override;
+    void visitDoWhileStmt(DoWhileStmt* stmt) override;
+    void visitSwitchStmt(SwitchStmt* stmt) override;
+    void visitBreakStmt(BreakStmt* stmt) override;
+    void visitContinueStmt(ContinueStmt* stmt) override;
+    void visitReturnStmt(ReturnStmt* stmt) override;
+    void visitPrintStmt(PrintStmt* stmt) override;
+    void visitExprStmt(ExprStmt* stmt) override;
+    void visitAssignmentExpr(AssignmentExpr* expr) override;
+    void visitConditionalExpr(ConditionalExpr* expr) override;
+    void visitLogicalExpr(LogicalExpr* expr) override;
+    void visitBinaryExpr(BinaryExpr* expr) override;
+    void visitUnaryExpr(UnaryExpr* expr) override;
+    void visitPostfixExpr(PostfixExpr* expr) override;
+    void visitPrimaryExpr(PrimaryExpr* expr) override;
+    void visitGroupingExpr(GroupingExpr* expr) override;
+
+private:
+    class CompileError {}; // Unwinds to compile() after the error is reported
+
+    struct Local {
+        Symbol name; // noSymbol for hidden slots (the callee, a switch subject)
+        int depth;
+        bool captured = false; // Needs CLOSE_UPVALUE rather than POP at scope exit
+    };
+
+    struct UpvalueRef {
+        uint8_t index;  // Slot in the enclosing frame, or its upvalue index
+        bool isLocal;   // Captures an enclosing local (else an enclosing upvalue)
+    };
+
+    // A loop or switch that break (and, for loops, continue) can leave.
+    struct JumpTarget {
+        JumpTarget(bool isLoop, size_t localCount, std::ptrdiff_t continueTarget)
+            : isLoop(isLoop), localCount(localCount), continueTarget(continueTarget) {
+        }
+
+        bool isLoop;
+        size_t localCount;                 // Locals to keep when jumping out
+        std::ptrdiff_t continueTarget;     // Loop start when continue jumps back, else -1
+        std::vector<size_t> breakJumps;    // Patched to the end of the statement
+        std::vector<size_t> continueJumps; // Forward continues, patched to the continue point
+    };
+
+    // Per-function compilation state; nested function declarations push one.
+    struct FunctionState {
+        FunctionState(FunctionState* enclosing, ObjProto* proto) : enclosing(enclosing), proto(proto) {}
+
+        FunctionState* enclosing;
+        ObjProto* proto;
+        std::vector<Local> locals;
+        std::vector<UpvalueRef> upvalues;
+        std::vector<JumpTarget> targets;
+        int scopeDepth = 0;
+        int stackDepth = 0; // Current operand stack height, locals included
+        std::ptrdiff_t lastInstruction = -1; // Offset of the latest opcode, for fusing
+        size_t label = 0;   // Latest jump target; code before it never fuses with code after
+
+        // Constant pool deduplication
+        std::unordered_map<uint64_t, uint16_t> numberConstants; // Keyed by bit pattern
+        std::unordered_map<Symbol, uint16_t> stringConstants;
+    };
+
+    Heap& heap;
+    GlobalTable& globals;
+    CompilerOptions options;
+    FunctionState* current = nullptr;
+    int line = 1;    // Line of the most recent token seen; stamped on emitted code
+
+    // --- Emission ---
+    Chunk& chunk();
+    void emitByte(uint8_t byte);
+    // Emits `op`, fused into the previous instruction where a superinstruction
+    // covers the pair.
+    void emitOp(OpCode op);
+    void emitOp(OpCode op, uint8_t operand);
+    void emitOpShort(OpCode op, uint16_t operand);
+    // GET_FIELD, SET_FIELD or INCREMENT_FIELD of the name `constant`, with an
+    // inline cache of its own. (INCREMENT_FIELD's flags byte follows.)
+    void emitField(OpCode op, uint16_t constant);
+    void adjustStack(int delta);
+    size_t emitJump(OpCode op);
+    void patchJump(size_t operandOffset);
+    void patchJumpTo(size_t operandOffset, size_t target);
+    // Offset of the next instruction, as the target of a backward jump.
+    size_t label();
+    void emitLoop(size_t loopStart);
+    uint16_t makeConstant(Value value);
+    uint16_t numberConstant(double number);
+    uint16_t stringConstant(Symbol chars);
+    CompileError error(const std::string& message);
+
+    // --- Scopes and Variables ---
+    void compileFunction(FuncDecl* decl);
+    void compileStatement(Declaration* decl);
+    void compileStatements(const std::vector<Declaration*>& statements);
+    void compile(Expr* expr);
+    void beginScope();
+    void endScope();
+    // Emits the POPs / CLOSE_UPVALUEs for the locals above `localCount`
+    // without forgetting them (for jumps out of a scope).
+    void discardLocals(size_t localCount);
+    void addLocal(Symbol name);
+    int resolveLocal(FunctionState* state, Symbol name);
+    int resolveUpvalue(FunctionState* state, Symbol name);
+    int addUpvalue(FunctionState* state, uint8_t index, bool isLocal);
+    void emitGetVariable(Symbol name);
+    void emitSetVariable(Symbol name);
+    JumpTarget* innermostTarget(bool loopOnly);
+    // The cases of `stmt` (whose subject is in place) as a SWITCH and the
+    // bodies, if its case values are integer constants and there are enough
+    // of them; false, having emitted nothing, otherwise.
+    bool compileSwitchTable(SwitchStmt* stmt);
+
+    // --- Assignment Targets ---
+    enum class PlaceKind { None, Variable, Index, Field };
+    // Compiles the parts of an assignment target evaluated before the value:
+    // nothing for a variable, container and key for an element, the object
+    // for a field. `name` receives the variable or field name. For an invalid
+    // target (a call result, say) it emits the code that raises the error.
+    PlaceKind compilePlace(Expr* target, Symbol& name);
+    // Compiles `expr->primary` and the first `count` tails.
+    void compileChain(PostfixExpr* expr, size_t count);
+};
+
+// Opcode of a binary operator token (PLUS -> ADD, ...).
+OpCode binaryOpCode(TokenType op);
@@ -4,27 +4,30 @@
 #include "token.h"
 #include "expr_nodes.h"
 #include "stmt_nodes.h"
+#include <cstdint>
 #include <vector>
 
 class VarDecl : public Declaration {
 public:
-    Token name;
+    TokenRef name;
     Expr* initializer;
+    VariableSlot variable; // Where the declaration stores (depth 0 or Global)
 
-    VarDecl(Token name, Expr* initializer) : name(name), initializer(initializer) {}
-    ~VarDecl() { delete initializer; }
+    VarDecl(TokenRef name, Expr* initializer) : name(name), initializer(initializer) {}
     void accept(AstVisitor& visitor) override { visitor.visitVarDecl(this); }
 };
 
 class FuncDecl : public Declaration {
 public:
-    Token name;
-    std::vector<Token> params;
+    TokenRef name;
+    std::vector<TokenRef> params;
     BlockStmt* body;
+    VariableSlot variable;            // Where the function is stored (depth 0 or Global)
+    std::vector<uint32_t> paramSlots; // Frame slot of each parameter
+    uint32_t frameSize = 0;           // Parameters plus the body's top-level locals
 
-    FuncDecl(Token name, std::vector<Token> params, BlockStmt* body)
+    FuncDecl(TokenRef name, std::vector<TokenRef> params, BlockStmt* body)
         : name(name), params(std::move(params)), body(body) {
     }
-    ~FuncDecl() { delete body; }
     void accept(AstVisitor& visitor) override { visitor.visitFuncDecl(this); }
 };
\ No newline at end of file
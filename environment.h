@@ -0,0 +1,27 @@
+#pragma once
+#include "value.h"
+#include <cstdint>
+#include <memory>
+
+// One frame of local variables for the tree-walking Interpreter: the slots
+// of a scope that declares something (see Resolver). Frames are shared: a
+// closure keeps the frame it was declared in, and the frames around it,
+// alive after the block that created them has finished.
+class Environment {
+public:
+    Environment(std::shared_ptr<Environment> enclosing, uint32_t size)
+        : enclosing(std::move(enclosing)), values(new Value[size]) {
+    }
+
+    // Slot `slot` of the frame `depth` frames out from this one.
+    Value& at(int depth, uint32_t slot) {
+        Environment* frame = this;
+        for (; depth > 0; --depth) frame = frame->enclosing.get();
+        return frame->values[slot];
+    }
+
+    const std::shared_ptr<Environment> enclosing;
+
+private:
+    std::unique_ptr<Value[]> values; // Start out nil
+};
@@ -1,34 +1,47 @@
 #pragma once
 #include "ast_node.h"
 #include "ast_visitor.h"
+#include "shape.h"
 #include "token.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 
+// Where a variable lives, filled in by the Resolver (resolver.h): slot `slot`
+// of the frame `depth` frames out from the innermost one, or global slot
+// `slot` when depth is Global.
+struct VariableSlot {
+    static constexpr int Global = -1;
+    static constexpr int Unresolved = -2;
+
+    int depth = Unresolved;
+    uint32_t slot = 0;
+};
+
 class PrimaryExpr : public Expr {
 public:
-    PrimaryExpr(Token value) : value(value) {}
+    PrimaryExpr(TokenRef value) : value(value) {}
     ~PrimaryExpr() = default;
 
-    Token value;
+    TokenRef value;
+    VariableSlot variable; // For IDENTIFIER
     void accept(AstVisitor& visitor) override { visitor.visitPrimaryExpr(this); }
 };
 
 struct PostfixTail {
-    PostfixTail(Token op) :
+    PostfixTail(TokenRef op) :
         op{ op } {
     }
 
-    ~PostfixTail(); // Requires definition in .cpp
-
-    Token op;
+    TokenRef op;
 	std::vector<Expr*> arguments; // For function calls
     Expr* indexOrCondition = nullptr;
+    std::unique_ptr<InlineCache> cache; // For '.', made by the Resolver
 };
 
 class PostfixExpr : public Expr {
 public:
     PostfixExpr(Expr* primary) : primary(primary) {}
-    ~PostfixExpr(); // Requires definition in .cpp
 
     Expr* primary;
     std::vector<PostfixTail*> tails;
@@ -38,10 +51,9 @@ public:
 
 class UnaryExpr : public Expr {
 public:
-    UnaryExpr(Token op, Expr* right) : op(op), right(right) {}
-    ~UnaryExpr() { delete right; }
+    UnaryExpr(TokenRef op, Expr* right) : op(op), right(right) {}
 
-    Token op;
+    TokenRef op;
     Expr* right;
 
     void accept(AstVisitor& visitor) override { visitor.visitUnaryExpr(this); }
@@ -49,11 +61,10 @@ public:
 
 class BinaryExpr : public Expr {
 public:
-    BinaryExpr(Expr* left, Token op, Expr* right) : left(left), op(op), right(right) {}
-    ~BinaryExpr() { delete left; delete right; }
+    BinaryExpr(Expr* left, TokenRef op, Expr* right) : left(left), op(op), right(right) {}
 
     Expr* left;
-    Token op;
+    TokenRef op;
     Expr* right;
 
     void accept(AstVisitor& visitor) override { visitor.visitBinaryExpr(this); }
@@ -61,11 +72,10 @@ public:
 
 class LogicalExpr : public Expr {
 public:
-    LogicalExpr(Expr* left, Token op, Expr* right) : left(left), op(op), right(right) {}
-    ~LogicalExpr() { delete left; delete right; }
+    LogicalExpr(Expr* left, TokenRef op, Expr* right) : left(left), op(op), right(right) {}
 
     Expr* left;
-    Token op; // Should only be AMP_AMP or PIPE_PIPE
+    TokenRef op; // Should only be AMP_AMP or PIPE_PIPE
     Expr* right;
 
     void accept(AstVisitor& visitor) override { visitor.visitLogicalExpr(this); }
@@ -76,7 +86,6 @@ public:
     ConditionalExpr(Expr* condition, Expr* thenExpr, Expr* elseExpr)
         : condition(condition), thenExpr(thenExpr), elseExpr(elseExpr) {
     }
-    ~ConditionalExpr() { delete condition; delete thenExpr; delete elseExpr; }
 
     Expr* condition;
     Expr* thenExpr;
@@ -87,11 +96,10 @@ public:
 
 class AssignmentExpr : public Expr {
 public:
-    AssignmentExpr(Expr* left, Token op, Expr* right) : left(left), op(op), right(right) {}
-    ~AssignmentExpr() { delete left; delete right; }
+    AssignmentExpr(Expr* left, TokenRef op, Expr* right) : left(left), op(op), right(right) {}
 
     Expr* left;
-    Token op;
+    TokenRef op;
     Expr* right;
 
     void accept(AstVisitor& visitor) override { visitor.visitAssignmentExpr(this); }
@@ -100,7 +108,6 @@ public:
 class GroupingExpr : public Expr {
 public:
     GroupingExpr(Expr* expression) : expression(expression) {}
-    ~GroupingExpr() { delete expression; }
     void accept(AstVisitor& visitor) override { visitor.visitGroupingExpr(this); }
     Expr* expression;
 };
\ No newline at end of file
@@ -0,0 +1,386 @@
+#include "flat_ast.h"
+#include "ast_arena.h"
+#include "ast_visitor.h"
+#include "declaration_nodes.h"
+#include "expr_nodes.h"
+#include "stmt_nodes.h"
+
+size_t FlatAst::memoryBytes() const {
+    return nodes.capacity() * sizeof(FlatNode) + lists.capacity() * sizeof(uint32_t) +
+        tokens.capacity() * sizeof(TokenRef) + roots.capacity() * sizeof(NodeIndex);
+}
+
+FlatAstView FlatAst::view() const {
+    FlatAstView view;
+    view.nodes = nodes.data();
+    view.lists = lists.data();
+    view.roots = roots.data();
+    view.rootCount = roots.size();
+    view.tokenAt = [](const void* context, uint32_t index) {
+        return static_cast<const FlatAst*>(context)->tokens[index];
+    };
+    view.context = this;
+    return view;
+}
+
+// --- Pointer AST -> FlatAst ---
+
+namespace {
+
+// Each visit appends its node before its children (pre-order) and leaves the
+// node's index in `result`. Fields are written through the index because
+// visiting the children may reallocate `nodes`.
+class FlatAstBuilder : public AstVisitor {
+public:
+    FlatAst ast;
+
+    NodeIndex build(AstNode* node) {
+        if (node == nullptr) return noNode;
+        node->accept(*this);
+        return result;
+    }
+
+    void visitVarDecl(VarDecl* decl) override {
+        NodeIndex index = add(NodeKind::VarDecl, &decl->name);
+        NodeIndex initializer = build(decl->initializer);
+        ast.nodes[index].a = initializer;
+        result = index;
+    }
+
+    void visitFuncDecl(FuncDecl* decl) override {
+        NodeIndex index = add(NodeKind::FuncDecl, &decl->name);
+        ast.nodes[index].b = static_cast<uint32_t>(ast.lists.size());
+        ast.nodes[index].c = static_cast<uint32_t>(decl->params.size());
+        for (const TokenRef& param : decl->params) ast.lists.push_back(addToken(param));
+        NodeIndex body = build(decl->body);
+        ast.nodes[index].a = body;
+        result = index;
+    }
+
+    void visitBlockStmt(BlockStmt* stmt) override {
+        NodeIndex index = add(NodeKind::Block);
+        setList(index, buildAll(stmt->statements));
+        result = index;
+    }
+
+    void visitIfStmt(IfStmt* stmt) override {
+        NodeIndex index = add(NodeKind::If);
+        NodeIndex a = build(stmt->condition);
+        NodeIndex b = build(stmt->thenBranch);
+        NodeIndex c = build(stmt->elseBranch);
+        setChildren(index, a, b, c);
+    }
+
+    void visitForStmt(ForStmt* stmt) override {
+        NodeIndex index = add(NodeKind::For);
+        std::vector<uint32_t> parts;
+        parts.push_back(build(stmt->initializer));
+        parts.push_back(build(stmt->condition));
+        parts.push_back(build(stmt->increment));
+        parts.push_back(build(stmt->body));
+        setList(index, parts);
+        result = index;
+    }
+
+    void visitWhileStmt(WhileStmt* stmt) override {
+        NodeIndex index = add(NodeKind::While);
+        NodeIndex a = build(stmt->condition);
+        NodeIndex b = build(stmt->body);
+        setChildren(index, a, b);
+    }
+
+    void visitDoWhileStmt(DoWhileStmt* stmt) override {
+        NodeIndex index = add(NodeKind::DoWhile);
+        NodeIndex a = build(stmt->body);
+        NodeIndex b = build(stmt->condition);
+        setChildren(index, a, b);
+    }
+
+    void visitSwitchStmt(SwitchStmt* stmt) override {
+        NodeIndex index = add(NodeKind::Switch);
+        NodeIndex condition = build(stmt->condition);
+        std::vector<uint32_t> cases;
+        cases.reserve(stmt->cases.size());
+        for (CaseStmt* caseStmt : stmt->cases) {
+            NodeIndex caseIndex = add(NodeKind::Case);
+            NodeIndex value = build(caseStmt->value);
+            ast.nodes[caseIndex].a = value;
+            setList(caseIndex, buildAll(caseStmt->body));
+            cases.push_back(caseIndex);
+        }
+        ast.nodes[index].a = condition;
+        setList(index, cases);
+        result = index;
+    }
+
+    void visitBreakStmt(BreakStmt*) override { result = add(NodeKind::Break); }
+    void visitContinueStmt(ContinueStmt*) override { result = add(NodeKind::Continue); }
+
+    void visitReturnStmt(ReturnStmt* stmt) override {
+        NodeIndex index = add(NodeKind::Return);
+        NodeIndex a = build(stmt->value);
+        setChildren(index, a);
+    }
+
+    void visitPrintStmt(PrintStmt* stmt) override {
+        NodeIndex index = add(NodeKind::Print);
+        NodeIndex a = build(stmt->expression);
+        setChildren(index, a);
+    }
+
+    void visitExprStmt(ExprStmt* stmt) override {
+        NodeIndex index = add(NodeKind::ExprStmt);
+        NodeIndex a = build(stmt->expression);
+        setChildren(index, a);
+    }
+
+    void visitAssignmentExpr(AssignmentExpr* expr) override {
+        NodeIndex index = add(NodeKind::Assignment, &expr->op);
+        NodeIndex a = build(expr->left);
+        NodeIndex b = build(expr->right);
+        setChildren(index, a, b);
+    }
+
+    void visitConditionalExpr(ConditionalExpr* expr) override {
+        NodeIndex index = add(NodeKind::Conditional);
+        NodeIndex a = build(expr->condition);
+        NodeIndex b = build(expr->thenExpr);
+        NodeIndex c = build(expr->elseExpr);
+        setChildren(index, a, b, c);
+    }
+
+    void visitLogicalExpr(LogicalExpr* expr) override {
+        NodeIndex index = add(NodeKind::Logical, &expr->op);
+        NodeIndex a = build(expr->left);
+        NodeIndex b = build(expr->right);
+        setChildren(index, a, b);
+    }
+
+    void visitBinaryExpr(BinaryExpr* expr) override {
+        NodeIndex index = add(NodeKind::Binary, &expr->op);
+        NodeIndex a = build(expr->left);
+        NodeIndex b = build(expr->right);
+        setChildren(index, a, b);
+    }
+
+    void visitUnaryExpr(UnaryExpr* expr) override {
+        NodeIndex index = add(NodeKind::Unary, &expr->op);
+        NodeIndex a = build(expr->right);
+        setChildren(index, a);
+    }
+
+    void visitPostfixExpr(PostfixExpr* expr) override {
+        NodeIndex index = add(NodeKind::Postfix);
+        NodeIndex primary = build(expr->primary);
+        std::vector<uint32_t> tails;
+        tails.reserve(expr->tails.size());
+        for (PostfixTail* tail : expr->tails) {
+            NodeIndex tailIndex = add(NodeKind::PostfixTail, &tail->op);
+            NodeIndex indexOrCondition = build(tail->indexOrCondition);
+            ast.nodes[tailIndex].a = indexOrCondition;
+            setList(tailIndex, buildAll(tail->arguments));
+            tails.push_back(tailIndex);
+        }
+        ast.nodes[index].a = primary;
+        setList(index, tails);
+        result = index;
+    }
+
+    void visitPrimaryExpr(PrimaryExpr* expr) override {
+        result = add(NodeKind::Primary, &expr->value);
+    }
+
+    void visitGroupingExpr(GroupingExpr* expr) override {
+        NodeIndex index = add(NodeKind::Grouping);
+        NodeIndex a = build(expr->expression);
+        setChildren(index, a);
+    }
+
+private:
+    NodeIndex result = noNode;
+
+    uint32_t addToken(const TokenRef& token) {
+        ast.tokens.push_back(token);
+        return static_cast<uint32_t>(ast.tokens.size() - 1);
+    }
+
+    NodeIndex add(NodeKind kind, const TokenRef* token = nullptr) {
+        FlatNode node;
+        node.kind = kind;
+        if (token != nullptr) node.token = addToken(*token);
+        ast.nodes.push_back(node);
+        return static_cast<NodeIndex>(ast.nodes.size() - 1);
+    }
+
+    void setChildren(NodeIndex index, NodeIndex a, NodeIndex b = noNode, NodeIndex c = noNode) {
+        FlatNode& node = ast.nodes[index];
+        node.a = a;
+        node.b = b;
+        node.c = c;
+        result = index;
+    }
+
+    // A list's entries are copied in only after every child is built, since
+    // the children append lists of their own.
+    template <typename T>
+    std::vector<uint32_t> buildAll(const std::vector<T*>& children) {
+        std::vector<uint32_t> indices;
+        indices.reserve(children.size());
+        for (T* child : children) indices.push_back(build(child));
+        return indices;
+    }
+
+    void setList(NodeIndex index, const std::vector<uint32_t>& entries) {
+        ast.nodes[index].b = static_cast<uint32_t>(ast.lists.size());
+        ast.nodes[index].c = static_cast<uint32_t>(entries.size());
+        ast.lists.insert(ast.lists.end(), entries.begin(), entries.end());
+    }
+};
+
+} // namespace
+
+FlatAst toFlatAst(const std::vector<Declaration*>& declarations) {
+    FlatAstBuilder builder;
+    builder.ast.roots.reserve(declarations.size());
+    for (Declaration* declaration : declarations) {
+        builder.ast.roots.push_back(builder.build(declaration));
+    }
+    return std::move(builder.ast);
+}
+
+// --- FlatAst -> Pointer AST ---
+
+namespace {
+
+class PointerAstBuilder {
+public:
+    PointerAstBuilder(const FlatAstView& ast, AstArena& arena) : ast(ast), arena(arena) {}
+
+    Declaration* declaration(NodeIndex index) {
+        if (index == noNode) return nullptr;
+        const FlatNode& node = ast[index];
+        switch (node.kind) {
+        case NodeKind::VarDecl:
+            return arena.make<VarDecl>(token(node), expression(node.a));
+        case NodeKind::FuncDecl: {
+            std::vector<TokenRef> params;
+            params.reserve(node.c);
+            for (const uint32_t* param = ast.listBegin(node); param != ast.listEnd(node); ++param) {
+                params.push_back(ast.token(*param));
+            }
+            return arena.make<FuncDecl>(token(node), std::move(params), block(node.a));
+        }
+        default:
+            return statement(index);
+        }
+    }
+
+    Stmt* statement(NodeIndex index) {
+        if (index == noNode) return nullptr;
+        const FlatNode& node = ast[index];
+        switch (node.kind) {
+        case NodeKind::Block:
+            return block(index);
+        case NodeKind::If:
+            return arena.make<IfStmt>(expression(node.a), statement(node.b), statement(node.c));
+        case NodeKind::For: {
+            const uint32_t* parts = ast.listBegin(node);
+            return arena.make<ForStmt>(declaration(parts[0]), expression(parts[1]),
+                expression(parts[2]), statement(parts[3]));
+        }
+        case NodeKind::While:
+            return arena.make<WhileStmt>(expression(node.a), statement(node.b));
+        case NodeKind::DoWhile:
+            return arena.make<DoWhileStmt>(statement(node.a), expression(node.b));
+        case NodeKind::Switch: {
+            std::vector<CaseStmt*> cases;
+            cases.reserve(node.c);
+            for (const uint32_t* entry = ast.listBegin(node); entry != ast.listEnd(node); ++entry) {
+                const FlatNode& caseNode = ast[*entry];
+                cases.push_back(arena.make<CaseStmt>(expression(caseNode.a), declarations(caseNode)));
+            }
+            return arena.make<SwitchStmt>(expression(node.a), std::move(cases));
+        }
+        case NodeKind::Break:
+            return arena.make<BreakStmt>();
+        case NodeKind::Continue:
+            return arena.make<ContinueStmt>();
+        case NodeKind::Return:
+            return arena.make<ReturnStmt>(expression(node.a));
+        case NodeKind::Print:
+            return arena.make<PrintStmt>(expression(node.a));
+        case NodeKind::ExprStmt:
+            return arena.make<ExprStmt>(expression(node.a));
+        default:
+            return nullptr; // Not a statement
+        }
+    }
+
+    Expr* expression(NodeIndex index) {
+        if (index == noNode) return nullptr;
+        const FlatNode& node = ast[index];
+        switch (node.kind) {
+        case NodeKind::Assignment:
+            return arena.make<AssignmentExpr>(expression(node.a), token(node), expression(node.b));
+        case NodeKind::Conditional:
+            return arena.make<ConditionalExpr>(expression(node.a), expression(node.b), expression(node.c));
+        case NodeKind::Logical:
+            return arena.make<LogicalExpr>(expression(node.a), token(node), expression(node.b));
+        case NodeKind::Binary:
+            return arena.make<BinaryExpr>(expression(node.a), token(node), expression(node.b));
+        case NodeKind::Unary:
+            return arena.make<UnaryExpr>(token(node), expression(node.a));
+        case NodeKind::Postfix: {
+            PostfixExpr* postfix = arena.make<PostfixExpr>(expression(node.a));
+            postfix->tails.reserve(node.c);
+            for (const uint32_t* entry = ast.listBegin(node); entry != ast.listEnd(node); ++entry) {
+                const FlatNode& tailNode = ast[*entry];
+                PostfixTail* tail = arena.make<PostfixTail>(token(tailNode));
+                tail->indexOrCondition = expression(tailNode.a);
+                tail->arguments.reserve(tailNode.c);
+                for (const uint32_t* argument = ast.listBegin(tailNode); argument != ast.listEnd(tailNode); ++argument) {
+                    tail->arguments.push_back(expression(*argument));
+                }
+                postfix->tails.push_back(tail);
+            }
+            return postfix;
+        }
+        case NodeKind::Primary:
+            return arena.make<PrimaryExpr>(token(node));
+        case NodeKind::Grouping:
+            return arena.make<GroupingExpr>(expression(node.a));
+        default:
+            return nullptr; // Not an expression
+        }
+    }
+
+    BlockStmt* block(NodeIndex index) {
+        if (index == noNode) return nullptr;
+        return arena.make<BlockStmt>(declarations(ast[index]));
+    }
+
+    std::vector<Declaration*> declarations(const FlatNode& node) {
+        std::vector<Declaration*> result;
+        result.reserve(node.c);
+        for (const uint32_t* entry = ast.listBegin(node); entry != ast.listEnd(node); ++entry) {
+            result.push_back(declaration(*entry));
+        }
+        return result;
+    }
+
+private:
+    const FlatAstView& ast;
+    AstArena& arena;
+
+    TokenRef token(const FlatNode& node) const { return ast.token(node.token); }
+};
+
+} // namespace
+
+std::vector<Declaration*> toPointerAst(const FlatAstView& ast, AstArena& arena) {
+    PointerAstBuilder builder(ast, arena);
+    std::vector<Declaration*> declarations;
+    declarations.reserve(ast.rootCount);
+    for (size_t i = 0; i < ast.rootCount; ++i) declarations.push_back(builder.declaration(ast.roots[i]));
+    return declarations;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "token.h"
+
+class AstArena;
+class Declaration;
+
+// The AST as one contiguous array of fixed-size nodes linked by 32-bit
+// indices, as an alternative to the pointer-linked node classes.
+// A node is a kind tag, a token and three child slots; code walks it with a
+// `switch` on the kind instead of the virtual accept(). Nodes are stored in
+// pre-order, so a depth-first walk reads the array front to back.
+//
+// Child lists (a block's statements, call arguments, postfix tails, switch
+// cases, a for loop's four parts) live in `lists`: the node holds the index of
+// the first entry and the count. Tokens live in their own table and
+// FuncDecl's parameters are a list of token indices.
+//
+// Only the syntax is kept: the resolver's annotations (variable slots, frame
+// sizes) are not, so resolve a tree converted back with toPointerAst().
+using NodeIndex = uint32_t;
+constexpr NodeIndex noNode = UINT32_MAX; // An absent child, e.g. a missing else
+constexpr uint32_t noToken = UINT32_MAX;
+
+enum class NodeKind : uint8_t {
+    // Declarations
+    VarDecl,      // token = name, a = initializer
+    FuncDecl,     // token = name, a = body (Block), b/c = parameter token list
+    // Statements
+    Block,        // b/c = statement list
+    If,           // a = condition, b = then, c = else
+    For,          // b/c = list of initializer, condition, increment, body
+    While,        // a = condition, b = body
+    DoWhile,      // a = body, b = condition
+    Switch,       // a = condition, b/c = list of Case nodes
+    Case,         // a = value (noNode for default), b/c = statement list
+    Break,
+    Continue,
+    Return,       // a = value
+    Print,        // a = expression
+    ExprStmt,     // a = expression (noNode for an empty statement)
+    // Expressions
+    Assignment,   // a = target, token = operator, b = value
+    Conditional,  // a = condition, b = then, c = else
+    Logical,      // a = left, token = operator, b = right
+    Binary,       // a = left, token = operator, b = right
+    Unary,        // token = operator, a = operand
+    Postfix,      // a = primary, b/c = list of PostfixTail nodes
+    PostfixTail,  // token = operator, a = index or condition, b/c = argument list
+    Primary,      // token = value
+    Grouping,     // a = expression
+};
+
+struct FlatNode {
+    NodeKind kind;
+    uint8_t spare[3] = {};    // Explicit and zeroed, as nodes are written to disk as bytes
+    uint32_t token = noToken; // Into FlatAst::tokens
+    NodeIndex a = noNode;
+    NodeIndex b = noNode;
+    NodeIndex c = noNode;
+};
+
+// Read-only access to a flat AST wherever its arrays live: a FlatAst's
+// vectors (FlatAst::view()) or a mapped cache file (see ast_cache.h). Tokens
+// are produced on demand through `tokenAt`, so the owner can store them in
+// whatever form suits it.
+struct FlatAstView {
+    const FlatNode* nodes = nullptr;
+    const uint32_t* lists = nullptr;
+    const NodeIndex* roots = nullptr;
+    size_t rootCount = 0;
+    TokenRef (*tokenAt)(const void* context, uint32_t index) = nullptr;
+    const void* context = nullptr;
+
+    const FlatNode& operator[](NodeIndex index) const { return nodes[index]; }
+    const uint32_t* listBegin(const FlatNode& node) const { return lists + node.b; }
+    const uint32_t* listEnd(const FlatNode& node) const { return lists + node.b + node.c; }
+    TokenRef token(uint32_t index) const { return tokenAt(context, index); }
+};
+
+class FlatAst {
+public:
+    std::vector<FlatNode> nodes;
+    std::vector<uint32_t> lists;  // Node (or, for parameters, token) indices
+    std::vector<TokenRef> tokens;
+    std::vector<NodeIndex> roots; // The top-level declarations
+
+    const FlatNode& operator[](NodeIndex index) const { return nodes[index]; }
+
+    // The children of a list-holding node (`b` is the first entry, `c` the count).
+    const uint32_t* listBegin(const FlatNode& node) const { return lists.data() + node.b; }
+    const uint32_t* listEnd(const FlatNode& node) const { return lists.data() + node.b + node.c; }
+
+    // Calls `visit(child)` for every present child of `index`, in source order.
+    template <typename F>
+    void forEachChild(NodeIndex index, F&& visit) const;
+
+    // Bytes held by the arrays (their capacity).
+    size_t memoryBytes() const;
+
+    FlatAstView view() const;
+};
+
+// Converts between the two representations. toPointerAst() builds the nodes
+// in `arena`; the result prints with AstPrinter exactly as the original did.
+FlatAst toFlatAst(const std::vector<Declaration*>& declarations);
+std::vector<Declaration*> toPointerAst(const FlatAstView& ast, AstArena& arena);
+inline std::vector<Declaration*> toPointerAst(const FlatAst& ast, AstArena& arena) { return toPointerAst(ast.view(), arena); }
+
+template <typename F>
+void FlatAst::forEachChild(NodeIndex index, F&& visit) const {
+    const FlatNode& node = nodes[index];
+    switch (node.kind) {
+    case NodeKind::Block:
+    case NodeKind::For:
+    case NodeKind::Switch:
+    case NodeKind::Case:
+    case NodeKind::Postfix:
+    case NodeKind::PostfixTail:
+        if (node.a != noNode) visit(node.a);
+        for (const uint32_t* child = listBegin(node); child != listEnd(node); ++child) {
+            if (*child != noNode) visit(*child);
+        }
+        return;
+    case NodeKind::FuncDecl: // Its list holds tokens, not nodes
+        if (node.a != noNode) visit(node.a);
+        return;
+    default:
+        if (node.a != noNode) visit(node.a);
+        if (node.b != noNode) visit(node.b);
+        if (node.c != noNode) visit(node.c);
+        return;
+    }
+}
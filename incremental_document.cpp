@@ -0,0 +1,359 @@
+#include "incremental_document.h"
+#include "ast_visitor.h"
+#include "declaration_nodes.h"
+#include "expr_nodes.h"
+#include "parser.h"
+#include "scanner.h"
+#include "stmt_nodes.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+
+// The scanner reads at most two bytes past a lexeme ("1" peeks at ".5"), so a
+// token ending this far before an edit cannot have seen it.
+constexpr size_t scannerLookahead = 2;
+
+// Compact once the arena holds this many nodes more than twice the live tree.
+constexpr size_t arenaSlack = 64 * 1024;
+
+// Adds `delta` to the line of every token in a subtree, for declarations
+// reused after an edit that added or removed lines before them.
+class LineShifter : public AstVisitor {
+public:
+    explicit LineShifter(int delta) : delta(delta) {}
+
+    void shift(AstNode* node) {
+        if (node != nullptr) node->accept(*this);
+    }
+
+    void visitVarDecl(VarDecl* decl) override {
+        decl->name.line += delta;
+        shift(decl->initializer);
+    }
+    void visitFuncDecl(FuncDecl* decl) override {
+        decl->name.line += delta;
+        for (TokenRef& param : decl->params) param.line += delta;
+        shift(decl->body);
+    }
+    void visitBlockStmt(BlockStmt* stmt) override {
+        for (Declaration* statement : stmt->statements) shift(statement);
+    }
+    void visitIfStmt(IfStmt* stmt) override {
+        shift(stmt->condition);
+        shift(stmt->thenBranch);
+        shift(stmt->elseBranch);
+    }
+    void visitForStmt(ForStmt* stmt) override {
+        shift(stmt->initializer);
+        shift(stmt->condition);
+        shift(stmt->increment);
+        shift(stmt->body);
+    }
+    void visitWhileStmt(WhileStmt* stmt) override {
+        shift(stmt->condition);
+        shift(stmt->body);
+    }
+    void visitDoWhileStmt(DoWhileStmt* stmt) override {
+        shift(stmt->body);
+        shift(stmt->condition);
+    }
+    void visitSwitchStmt(SwitchStmt* stmt) override {
+        shift(stmt->condition);
+        for (CaseStmt* branch : stmt->cases) {
+            shift(branch->value);
+            for (Declaration* statement : branch->body) shift(statement);
+        }
+    }
+    void visitBreakStmt(BreakStmt*) override {}
+    void visitContinueStmt(ContinueStmt*) override {}
+    void visitReturnStmt(ReturnStmt* stmt) override { shift(stmt->value); }
+    void visitPrintStmt(PrintStmt* stmt) override { shift(stmt->expression); }
+    void visitExprStmt(ExprStmt* stmt) override { shift(stmt->expression); }
+
+    void visitAssignmentExpr(AssignmentExpr* expr) override {
+        shift(expr->left);
+        expr->op.line += delta;
+        shift(expr->right);
+    }
+    void visitConditionalExpr(ConditionalExpr* expr) override {
+        shift(expr->condition);
+        shift(expr->thenExpr);
+        shift(expr->elseExpr);
+    }
+    void visitLogicalExpr(LogicalExpr* expr) override {
+        shift(expr->left);
+        expr->op.line += delta;
+        shift(expr->right);
+    }
+    void visitBinaryExpr(BinaryExpr* expr) override {
+        shift(expr->left);
+        expr->op.line += delta;
+        shift(expr->right);
+    }
+    void visitUnaryExpr(UnaryExpr* expr) override {
+        expr->op.line += delta;
+        shift(expr->right);
+    }
+    void visitPostfixExpr(PostfixExpr* expr) override {
+        shift(expr->primary);
+        for (PostfixTail* tail : expr->tails) {
+            tail->op.line += delta;
+            shift(tail->indexOrCondition);
+            for (Expr* argument : tail->arguments) shift(argument);
+        }
+    }
+    void visitPrimaryExpr(PrimaryExpr* expr) override { expr->value.line += delta; }
+    void visitGroupingExpr(GroupingExpr* expr) override { shift(expr->expression); }
+
+private:
+    const int delta;
+};
+
+// Same kind, text and line (columns do not reach the tree). `lineDelta` is
+// what the edit added to the lines of tokens after it.
+bool sameToken(const Token& now, const Token& before, int lineDelta) {
+    return now.type == before.type && now.line == before.line + lineDelta && now.lexeme == before.lexeme;
+}
+
+} // namespace
+
+IncrementalDocument::IncrementalDocument(std::string text, std::ostream& errorOutput)
+    : errorOutput(errorOutput) {
+    versions[currentVersion].text = std::move(text);
+    scanAll();
+    parseAll();
+}
+
+size_t IncrementalDocument::offsetOf(const Token& token, std::string_view text) const {
+    // END_OF_FILE has no lexeme; it sits at the end of the text.
+    if (token.type == TokenType::END_OF_FILE) return text.size();
+    return static_cast<size_t>(token.lexeme.data() - text.data());
+}
+
+void IncrementalDocument::scanAll() {
+    std::string_view source = text();
+    Scanner scanner(source, 0, 1, 0, errorOutput);
+    tokenList.clear();
+    tokenList.reserve(source.size() / 4 + 16);
+    scanErrors.clear();
+    while (true) {
+        size_t errorsBefore = scanner.errorCount();
+        tokenList.push_back(scanner.nextToken());
+        scanErrors.insert(scanErrors.end(), scanner.errorCount() - errorsBefore, tokenList.size() - 1);
+        if (tokenList.back().type == TokenType::END_OF_FILE) break;
+    }
+}
+
+void IncrementalDocument::parseAll() {
+    entries.clear();
+    parseErrors = 0;
+    for (auto& version : versions) version.second.uses = 0;
+    arena = std::make_unique<AstArena>();
+
+    Parser parser(tokenList, *arena);
+    parser.setErrorOutput(errorOutput);
+    size_t position = 0;
+    while (tokenList[position].type != TokenType::END_OF_FILE) {
+        size_t errorsBefore = parser.errorCount();
+        Declaration* declaration = parser.parseDeclarationAt(position);
+        addEntry(entries, { position, declaration, parser.errorCount() - errorsBefore, currentVersion });
+        position = parser.position();
+    }
+    liveNodes = arena->nodeCount();
+    releaseVersions();
+}
+
+void IncrementalDocument::addEntry(std::vector<Entry>& list, Entry entry) {
+    ++versions[entry.version].uses;
+    parseErrors += entry.errors;
+    list.push_back(entry);
+}
+
+void IncrementalDocument::releaseVersions() {
+    for (auto it = versions.begin(); it != versions.end();) {
+        if (it->second.uses == 0 && it->first != currentVersion) it = versions.erase(it);
+        else ++it;
+    }
+}
+
+std::vector<Declaration*> IncrementalDocument::declarations() const {
+    std::vector<Declaration*> result;
+    result.reserve(entries.size());
+    for (const Entry& entry : entries) {
+        if (entry.declaration != nullptr) result.push_back(entry.declaration);
+    }
+    return result;
+}
+
+IncrementalDocument::EditStats IncrementalDocument::edit(size_t offset, size_t removed, std::string_view inserted) {
+    EditStats stats;
+
+    // --- The new text ---
+    // Map nodes never move, so `before` stays valid next to the new version.
+    const std::string& before = versions.rbegin()->second.text;
+    offset = std::min(offset, before.size());
+    removed = std::min(removed, before.size() - offset);
+    std::string after;
+    after.reserve(before.size() - removed + inserted.size());
+    after.append(before, 0, offset);
+    after.append(inserted);
+    after.append(before, offset + removed, std::string::npos);
+    const ptrdiff_t byteDelta = static_cast<ptrdiff_t>(inserted.size()) - static_cast<ptrdiff_t>(removed);
+    const size_t editEnd = offset + inserted.size(); // In the new text
+    currentVersion++;
+    std::string_view text = versions[currentVersion].text = std::move(after);
+
+    // --- Re-lex ---
+    // Resume just after the last token that ends far enough before the edit,
+    // in the state the scanner was in there. The gap after it is scanned
+    // again, so errors reported in it are reported again.
+    size_t first = std::partition_point(tokenList.begin(), tokenList.end() - 1, [&](const Token& token) {
+        return offsetOf(token, before) + token.lexeme.size() + scannerLookahead <= offset;
+    }) - tokenList.begin();
+    size_t resumeOffset = 0;
+    int resumeLine = 1, resumeLineStart = 0;
+    if (first > 0) {
+        const Token& anchor = tokenList[first - 1];
+        resumeOffset = offsetOf(anchor, before) + anchor.lexeme.size();
+        resumeLine = anchor.line; // A string spanning lines has its last line
+        resumeLineStart = static_cast<int>(offsetOf(anchor, before)) - anchor.start;
+    }
+
+    // Scan until a token past the edit lines up with an old one: same offset
+    // (shifted by the edit), column, kind and length. END_OF_FILE is always
+    // scanned again, as its column is its offset.
+    Scanner scanner(text, resumeOffset, resumeLine, resumeLineStart, errorOutput);
+    std::vector<Token> fresh;
+    std::vector<size_t> freshErrors;
+    size_t oldEnd = tokenList.size(); // Old tokens from here on are kept
+    size_t old = first;
+    int lineDelta = 0;
+    while (true) {
+        size_t errorsBefore = scanner.errorCount();
+        Token token = scanner.nextToken();
+        freshErrors.insert(freshErrors.end(), scanner.errorCount() - errorsBefore, first + fresh.size());
+        size_t at = offsetOf(token, text);
+        if (token.type != TokenType::END_OF_FILE && at >= editEnd) {
+            size_t mapped = static_cast<size_t>(static_cast<ptrdiff_t>(at) - byteDelta);
+            while (old + 1 < tokenList.size() && offsetOf(tokenList[old], before) < mapped) ++old;
+            const Token& match = tokenList[old];
+            if (offsetOf(match, before) == mapped && match.start == token.start && match.type == token.type &&
+                match.lexeme.size() == token.lexeme.size()) {
+                oldEnd = old;
+                lineDelta = token.line - match.line;
+                break;
+            }
+        }
+        fresh.push_back(token);
+        if (token.type == TokenType::END_OF_FILE) {
+            lineDelta = token.line - tokenList.back().line;
+            break;
+        }
+    }
+    stats.tokensRelexed = fresh.size();
+
+    // The tokens that actually changed: old [changedFirst, changedEnd) became
+    // new [changedFirst, changedEnd + tokenDelta). Scanning usually starts
+    // and stops on a few tokens that come out the same.
+    size_t same = 0;
+    while (same < fresh.size() && first + same < oldEnd && sameToken(fresh[same], tokenList[first + same], 0)) ++same;
+    size_t sameAfter = 0;
+    while (sameAfter < fresh.size() - same && oldEnd - sameAfter > first + same &&
+        sameToken(fresh[fresh.size() - 1 - sameAfter], tokenList[oldEnd - 1 - sameAfter], lineDelta)) {
+        ++sameAfter;
+    }
+    const size_t changedFirst = first + same;
+    const size_t changedEnd = oldEnd - sameAfter;
+    const ptrdiff_t tokenDelta = static_cast<ptrdiff_t>(first + fresh.size()) - static_cast<ptrdiff_t>(oldEnd);
+
+    // --- Splice the tokens ---
+    // Kept tokens are pointed at the new text; those after the edit move with it.
+    for (size_t i = 0; i < first; ++i) {
+        Token& token = tokenList[i];
+        token.lexeme = text.substr(offsetOf(token, before), token.lexeme.size());
+    }
+    for (size_t i = oldEnd; i < tokenList.size(); ++i) {
+        Token& token = tokenList[i];
+        token.line += lineDelta;
+        if (token.type == TokenType::END_OF_FILE) token.start = static_cast<int>(text.size());
+        else token.lexeme = text.substr(offsetOf(token, before) + byteDelta, token.lexeme.size());
+    }
+    size_t overlap = std::min(fresh.size(), oldEnd - first);
+    std::copy(fresh.begin(), fresh.begin() + overlap, tokenList.begin() + first);
+    if (fresh.size() > overlap) {
+        tokenList.insert(tokenList.begin() + first + overlap, fresh.begin() + overlap, fresh.end());
+    }
+    else {
+        tokenList.erase(tokenList.begin() + first + overlap, tokenList.begin() + oldEnd);
+    }
+    stats.tokensReused = tokenList.size() - fresh.size();
+
+    // Errors reported while scanning a token are kept with it. The scan also
+    // covered the gap before the token it stopped at, so its errors go too.
+    auto dropFirst = std::lower_bound(scanErrors.begin(), scanErrors.end(), first);
+    auto dropEnd = std::upper_bound(dropFirst, scanErrors.end(), oldEnd);
+    for (auto it = dropEnd; it != scanErrors.end(); ++it) *it = static_cast<size_t>(static_cast<ptrdiff_t>(*it) + tokenDelta);
+    scanErrors.insert(scanErrors.erase(dropFirst, dropEnd), freshErrors.begin(), freshErrors.end());
+
+    // --- Re-parse ---
+    if (changedFirst == changedEnd && tokenDelta == 0 && lineDelta == 0) {
+        // Only whitespace, comments or columns changed: the tree still holds.
+        stats.declarationsReused = entries.size();
+        releaseVersions();
+        return stats;
+    }
+    if (arena->nodeCount() > 2 * liveNodes + arenaSlack) {
+        parseAll();
+        stats.fullReparse = true;
+        stats.declarationsReparsed = entries.size();
+        return stats;
+    }
+
+    // The last declaration starting before the first changed token: the one
+    // before it ends before that token without having peeked at it.
+    size_t reparseFirst = std::partition_point(entries.begin(), entries.end(), [&](const Entry& entry) {
+        return entry.start < changedFirst;
+    }) - entries.begin();
+    reparseFirst = reparseFirst > 0 ? reparseFirst - 1 : 0;
+
+    Parser parser(tokenList, *arena);
+    parser.setErrorOutput(errorOutput);
+    std::vector<Entry> parsed;
+    size_t reuseFirst = entries.size(); // Old declarations from here on are kept
+    size_t oldEntry = reparseFirst;
+    const size_t newChangedEnd = static_cast<size_t>(static_cast<ptrdiff_t>(changedEnd) + tokenDelta);
+    size_t position = reparseFirst < entries.size() ? entries[reparseFirst].start : 0;
+    while (tokenList[position].type != TokenType::END_OF_FILE) {
+        if (position >= newChangedEnd) {
+            size_t mapped = static_cast<size_t>(static_cast<ptrdiff_t>(position) - tokenDelta);
+            while (oldEntry < entries.size() && entries[oldEntry].start < mapped) ++oldEntry;
+            if (oldEntry < entries.size() && entries[oldEntry].start == mapped) {
+                reuseFirst = oldEntry;
+                break;
+            }
+        }
+        size_t errorsBefore = parser.errorCount();
+        Declaration* declaration = parser.parseDeclarationAt(position);
+        addEntry(parsed, { position, declaration, parser.errorCount() - errorsBefore, currentVersion });
+        position = parser.position();
+    }
+    stats.declarationsReparsed = parsed.size();
+
+    // Splice the declarations, shifting the reused ones after the edit.
+    for (size_t i = reparseFirst; i < reuseFirst; ++i) {
+        --versions[entries[i].version].uses;
+        parseErrors -= entries[i].errors;
+    }
+    LineShifter shifter(lineDelta);
+    for (size_t i = reuseFirst; i < entries.size(); ++i) {
+        Entry& entry = entries[i];
+        entry.start = static_cast<size_t>(static_cast<ptrdiff_t>(entry.start) + tokenDelta);
+        if (lineDelta != 0) shifter.shift(entry.declaration);
+    }
+    entries.erase(entries.begin() + reparseFirst, entries.begin() + reuseFirst);
+    entries.insert(entries.begin() + reparseFirst, parsed.begin(), parsed.end());
+    stats.declarationsReused = entries.size() - parsed.size();
+    releaseVersions();
+    return stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast_arena.h"
+#include "token.h"
+
+class Declaration;
+
+// A source buffer that stays scanned and parsed while it is edited, as an
+// editor or language server needs. After an edit only the text around it is
+// scanned again, and only the top-level declarations it touches are parsed
+// again. The tokens, tree and diagnostic counts always equal what scanning and
+// parsing the new text from scratch gives (`--bench incremental` fuzzes this).
+//
+// Re-lexing resumes at a token the scanner's lookahead cannot have read the
+// edited bytes from, in the state a full scan is in there (the line start is
+// the token's offset minus its column). It stops at the first token past the
+// edit that starts where an old token did, shifted by the edit, in the same
+// column: the scanner keeps no other state between tokens, so every old token
+// from there on is still valid, with its line shifted.
+//
+// Re-parsing works the same way one level up. The parser is LL(1), so a
+// top-level declaration depends only on the tokens from its first one on.
+// Parsing restarts at the last declaration boundary before the first changed
+// token. It stops at the first boundary after the changed tokens that maps to
+// an old boundary. The declarations from there on are reused, with their line
+// numbers adjusted.
+//
+// Reused nodes still point into the text they were parsed from, so older
+// versions of the text are kept until no declaration refers to them. Replaced
+// nodes stay in the arena until it holds twice the live tree, at which point
+// the whole document is parsed again into a fresh one.
+class IncrementalDocument {
+public:
+    // What one edit() did.
+    struct EditStats {
+        size_t tokensRelexed = 0;
+        size_t tokensReused = 0;
+        size_t declarationsReparsed = 0;
+        size_t declarationsReused = 0;
+        bool fullReparse = false; // The arena was compacted
+    };
+
+    // Scans and parses `text`. Diagnostics, here and after each edit (only
+    // those from the region scanned or parsed again), go to `errorOutput`.
+    explicit IncrementalDocument(std::string text, std::ostream& errorOutput = std::cerr);
+
+    IncrementalDocument(const IncrementalDocument&) = delete;
+    IncrementalDocument& operator=(const IncrementalDocument&) = delete;
+
+    // Replaces `removed` bytes at `offset` with `inserted` and brings the
+    // tokens and the tree up to date. Both are clamped to the text.
+    EditStats edit(size_t offset, size_t removed, std::string_view inserted);
+
+    std::string_view text() const { return versions.rbegin()->second.text; }
+    // Lexemes point into text(). The last token is END_OF_FILE.
+    const std::vector<Token>& tokens() const { return tokenList; }
+    // The top-level declarations, as Parser::parse() returns them.
+    std::vector<Declaration*> declarations() const;
+
+    size_t scanErrorCount() const { return scanErrors.size(); }
+    size_t parseErrorCount() const { return parseErrors; }
+
+private:
+    struct TextVersion {
+        std::string text;
+        size_t uses = 0; // Entries whose nodes point into it
+    };
+
+    // One top-level parse: the declaration starting at token `start` (nullptr
+    // after a syntax error), the errors it reported and the text version its
+    // nodes point into.
+    struct Entry {
+        size_t start;
+        Declaration* declaration;
+        size_t errors;
+        uint64_t version;
+    };
+
+    std::ostream& errorOutput;
+    std::map<uint64_t, TextVersion> versions; // The current text is the last one
+    uint64_t currentVersion = 0;
+    std::vector<Token> tokenList;
+    std::vector<size_t> scanErrors; // Per scan error, the token being scanned; sorted
+    std::vector<Entry> entries;
+    size_t parseErrors = 0;
+    std::unique_ptr<AstArena> arena;
+    size_t liveNodes = 0; // Arena nodes after the last full parse
+
+    size_t offsetOf(const Token& token, std::string_view text) const;
+    void scanAll();
+    void parseAll();
+    void addEntry(std::vector<Entry>& list, Entry entry);
+    void releaseVersions();
+};
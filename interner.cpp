@@ -0,0 +1,119 @@
+#include "interner.h"
+#include <cstring>
+
+uint64_t Interner::hash(std::string_view text) {
+    // Eight bytes at a time: names are short, so the length and the final
+    // partial word dominate.
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ text.size();
+    const char* data = text.data();
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    if (i < text.size()) std::memcpy(&tail, data + i, text.size() - i);
+    h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 29;
+    return h;
+}
+
+Symbol Interner::intern(std::string_view text, uint64_t hash) {
+    uint32_t shardIndex = static_cast<uint32_t>(hash) & ((1u << shardBits) - 1);
+    uint32_t high = static_cast<uint32_t>(hash >> 32);
+    Shard& shard = shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // Keep the table at most half full.
+    if ((shard.texts.size() + 1) * 2 > shard.slots.size()) shard.grow();
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = high & mask;; i = (i + 1) & mask) {
+        Slot& slot = shard.slots[i];
+        if (slot.index == 0) {
+            shard.texts.push_back(shard.store(text));
+            slot = { high, static_cast<uint32_t>(shard.texts.size()) };
+            return static_cast<Symbol>((shard.texts.size() - 1) << shardBits) | shardIndex;
+        }
+        if (slot.hash == high && shard.texts[slot.index - 1] == text) {
+            return static_cast<Symbol>((slot.index - 1) << shardBits) | shardIndex;
+        }
+    }
+}
+
+std::string_view Interner::text(Symbol symbol) const {
+    const Shard& shard = shards[symbol & ((1u << shardBits) - 1)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.texts[symbol >> shardBits];
+}
+
+Interner::Stats Interner::stats() const {
+    Stats stats;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t textBytes = 0;
+        for (std::string_view text : shard.texts) textBytes += text.size();
+        stats.symbols += shard.texts.size();
+        stats.textBytes += textBytes;
+        stats.tableBytes += shard.slots.capacity() * sizeof(Slot) +
+            shard.texts.capacity() * sizeof(std::string_view) +
+            shard.blocks.capacity() * sizeof(std::unique_ptr<char[]>);
+        // Only the current block has unused space.
+        if (!shard.blocks.empty()) stats.tableBytes += blockSize - shard.blockUsed;
+    }
+    return stats;
+}
+
+std::string_view Interner::Shard::store(std::string_view text) {
+    if (text.empty()) return std::string_view("", 0);
+    if (text.size() > blockSize / 4) {
+        // Long strings get a block of their own, in front of the current one
+        // so its free space is not lost.
+        std::unique_ptr<char[]> own(new char[text.size()]);
+        std::memcpy(own.get(), text.data(), text.size());
+        std::string_view stored(own.get(), text.size());
+        blocks.insert(blocks.empty() ? blocks.end() : blocks.end() - 1, std::move(own));
+        return stored;
+    }
+    if (blockUsed + text.size() > blockSize) {
+        blocks.emplace_back(new char[blockSize]);
+        blockUsed = 0;
+    }
+    char* stored = blocks.back().get() + blockUsed;
+    std::memcpy(stored, text.data(), text.size());
+    blockUsed += text.size();
+    return std::string_view(stored, text.size());
+}
+
+void Interner::Shard::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.empty() ? 64 : old.size() * 2, Slot{ 0, 0 });
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.index == 0) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].index != 0) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+Interner& symbols() {
+    static Interner interner;
+    return interner;
+}
+
+// --- SymbolCache ---
+
+Symbol SymbolCache::intern(std::string_view text) {
+    uint64_t hash = Interner::hash(text);
+    Entry& entry = entries[(hash >> 32) & (size - 1)];
+    if (entry.hash == hash && entry.length == text.size() && entry.symbol != noSymbol &&
+        std::memcmp(entry.text, text.data(), text.size()) == 0) {
+        return entry.symbol;
+    }
+    Symbol symbol = interner.intern(text, hash);
+    std::string_view stored = interner.text(symbol);
+    entry = { hash, stored.data(), static_cast<uint32_t>(stored.size()), symbol };
+    return symbol;
+}
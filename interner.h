@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// A 32-bit handle for an interned string: two symbols are equal exactly when
+// their texts are, so names are compared and hashed as integers.
+using Symbol = uint32_t;
+constexpr Symbol noSymbol = UINT32_MAX; // Tokens that are not names or strings
+
+// Stores every distinct string once and hands out its Symbol. Texts are never
+// freed or moved, so text() views stay valid for the life of the program.
+//
+// Safe to use from several threads (ParallelScanner's workers intern at the
+// same time): the table is split into shards by hash, each behind its own
+// lock, and a symbol's low bits name its shard.
+class Interner {
+public:
+    Symbol intern(std::string_view text) { return intern(text, hash(text)); }
+    Symbol intern(std::string_view text, uint64_t hash); // hash == Interner::hash(text)
+    std::string_view text(Symbol symbol) const;
+
+    struct Stats {
+        size_t symbols = 0;
+        size_t textBytes = 0;  // Characters stored, one copy per symbol
+        size_t tableBytes = 0; // Hash tables, text index and unused block space
+    };
+    Stats stats() const;
+
+    static uint64_t hash(std::string_view text);
+
+private:
+    static constexpr unsigned shardBits = 4;
+    static constexpr size_t blockSize = 16 * 1024;
+
+    struct Slot {
+        uint32_t hash;  // High half of the text's hash
+        uint32_t index; // Into `texts` plus one; 0 marks an empty slot
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<std::string_view> texts; // By index within the shard
+        std::vector<Slot> slots;             // Open addressing, power-of-two size
+        std::vector<std::unique_ptr<char[]>> blocks;
+        size_t blockUsed = blockSize;
+
+        std::string_view store(std::string_view text);
+        void grow();
+    };
+
+    Shard shards[1u << shardBits];
+};
+
+// The interner the scanner and every engine share.
+Interner& symbols();
+
+// A front for the shared Interner owned by one thread (each Scanner has one):
+// a small direct-mapped cache of recent names, so the common ones are found
+// without taking a shard lock. It stays small enough to live in L1/L2 however
+// many distinct names the input has; a miss simply asks the Interner.
+class SymbolCache {
+public:
+    explicit SymbolCache(Interner& interner) : interner(interner) {}
+
+    Symbol intern(std::string_view text);
+
+private:
+    static constexpr size_t size = 2048;
+
+    struct Entry {
+        uint64_t hash = 0;
+        const char* text = nullptr; // The Interner's copy
+        uint32_t length = 0;
+        Symbol symbol = noSymbol;
+    };
+
+    Interner& interner;
+    std::unique_ptr<Entry[]> entries{ new Entry[size] };
+};
@@ -0,0 +1,502 @@
+#include "interpreter.h"
+#include "declaration_nodes.h"
+#include "expr_nodes.h"
+#include "natives.h"
+#include "operators.h"
+#include "resolver.h"
+#include "stmt_nodes.h"
+
+namespace {
+
+// Deep enough for real recursion, shallow enough to stay clear of the C++ stack.
+constexpr int maxCallDepth = 1000;
+
+// Runs `body`, attributing a RuntimeError that has no line yet to `line`.
+template <typename F>
+auto atLine(int line, F&& body) -> decltype(body()) {
+    try {
+        return body();
+    }
+    catch (RuntimeError& error) {
+        if (error.line == 0) error.line = line;
+        throw;
+    }
+}
+
+} // namespace
+
+Interpreter::Interpreter(std::ostream& output) : output(output) {
+    for (const NativeEntry& native : builtinNatives()) {
+        int slot = globals.slotFor(native.name);
+        globals.values[slot] = Value::object(heap.makeNative(native.name, native.function, native.arity));
+        globals.defined[slot] = 1;
+    }
+}
+
+bool Interpreter::interpret(const std::vector<Declaration*>& program) {
+    Resolver resolver(globals);
+    if (!resolver.resolve(program)) return false;
+    try {
+        for (Declaration* decl : program) {
+            execute(decl);
+        }
+    }
+    catch (const RuntimeError& error) {
+        std::cerr << "[Line " << error.line << "] Runtime error: " << error.what() << std::endl;
+        // Unwind whatever the error interrupted so the interpreter stays usable.
+        environment = nullptr;
+        signal = Signal::None;
+        callDepth = 0;
+        return false;
+    }
+    return true;
+}
+
+// --- Helpers ---
+
+Value Interpreter::evaluate(Expr* expr) {
+    ++operations;
+    expr->accept(*this);
+    return result;
+}
+
+void Interpreter::execute(Declaration* decl) {
+    // Statements that failed to parse are left out of the tree as nullptr.
+    if (decl == nullptr) return;
+    ++operations;
+    decl->accept(*this);
+}
+
+void Interpreter::executeBlock(const std::vector<Declaration*>& statements, uint32_t frameSize) {
+    if (frameSize == 0) {
+        for (Declaration* statement : statements) {
+            execute(statement);
+            if (signal != Signal::None) break;
+        }
+        return;
+    }
+    executeIn(statements, std::make_shared<Environment>(environment, frameSize));
+}
+
+void Interpreter::executeIn(const std::vector<Declaration*>& statements, std::shared_ptr<Environment> frame) {
+    std::shared_ptr<Environment> previous = std::move(environment);
+    environment = std::move(frame);
+    try {
+        for (Declaration* statement : statements) {
+            execute(statement);
+            if (signal != Signal::None) break;
+        }
+    }
+    catch (...) {
+        environment = std::move(previous);
+        throw;
+    }
+    environment = std::move(previous);
+}
+
+bool Interpreter::runLoopBody(Stmt* body) {
+    execute(body);
+    switch (signal) {
+    case Signal::Break:
+        signal = Signal::None;
+        return false;
+    case Signal::Continue:
+        signal = Signal::None;
+        return true;
+    case Signal::Return:
+        return false;
+    default:
+        return true;
+    }
+}
+
+Value Interpreter::call(Value callee, std::vector<Value>& args, int line) {
+    int argCount = static_cast<int>(args.size());
+    if (callee.isObjType(ObjType::Native)) {
+        ObjNative* native = asNative(callee);
+        if (native->arity >= 0 && argCount != native->arity) {
+            throw RuntimeError("Expected " + std::to_string(native->arity) + " arguments but got " +
+                std::to_string(argCount) + ".", line);
+        }
+        return atLine(line, [&] { return native->function(heap, args.data(), argCount); });
+    }
+
+    if (!callee.isObjType(ObjType::Function)) {
+        throw RuntimeError("Can only call functions.", line);
+    }
+    ObjFunction* function = asFunction(callee);
+    FuncDecl* decl = function->declaration;
+    if (argCount != static_cast<int>(decl->params.size())) {
+        throw RuntimeError("Expected " + std::to_string(decl->params.size()) + " arguments but got " +
+            std::to_string(argCount) + ".", line);
+    }
+    if (callDepth >= maxCallDepth) {
+        throw RuntimeError("Stack overflow.", line);
+    }
+
+    // The parameters and the body's top-level locals share one frame.
+    std::shared_ptr<Environment> frame = function->closure;
+    if (decl->frameSize > 0) {
+        frame = std::make_shared<Environment>(std::move(frame), decl->frameSize);
+        for (size_t i = 0; i < args.size(); ++i) {
+            frame->at(0, decl->paramSlots[i]) = args[i];
+        }
+    }
+
+    ++callDepth;
+    result = Value::nil();
+    executeIn(decl->body->statements, std::move(frame));
+    --callDepth;
+
+    Value returned = Value::nil();
+    if (signal == Signal::Return) {
+        returned = result;
+        signal = Signal::None;
+    }
+    return returned;
+}
+
+// --- Variables ---
+
+Value& Interpreter::variable(const VariableSlot& slot, std::string_view name, int line) {
+    if (slot.depth == VariableSlot::Global) {
+        if (!globals.defined[slot.slot]) {
+            throw RuntimeError("Undefined variable '" + std::string(name) + "'.", line);
+        }
+        return globals.values[slot.slot];
+    }
+    return environment->at(slot.depth, slot.slot);
+}
+
+void Interpreter::define(const VariableSlot& slot, Value value) {
+    if (slot.depth == VariableSlot::Global) {
+        globals.values[slot.slot] = value;
+        globals.defined[slot.slot] = 1;
+        return;
+    }
+    environment->at(0, slot.slot) = value;
+}
+
+// --- Places (assignment targets) ---
+
+Value Interpreter::read(const Place& place, int line) {
+    switch (place.kind) {
+    case Place::Kind::Variable:
+        return variable(place.variable, place.name, line);
+    case Place::Kind::Index:
+        return atLine(line, [&] { return getIndex(heap, place.container, place.key); });
+    case Place::Kind::Field:
+        return atLine(line, [&] { return getField(place.container, place.field, *place.cache); });
+    default:
+        throw RuntimeError("Invalid assignment target.", line);
+    }
+}
+
+void Interpreter::write(const Place& place, Value value, int line) {
+    switch (place.kind) {
+    case Place::Kind::Variable:
+        variable(place.variable, place.name, line) = value;
+        return;
+    case Place::Kind::Index:
+        atLine(line, [&] { setIndex(heap, place.container, place.key, value); });
+        return;
+    case Place::Kind::Field:
+        atLine(line, [&] { setField(heap, place.container, place.field, value, *place.cache); });
+        return;
+    default:
+        throw RuntimeError("Invalid assignment target.", line);
+    }
+}
+
+Interpreter::Place Interpreter::placeOf(Expr* target, int line) {
+    if (PrimaryExpr* primary = dynamic_cast<PrimaryExpr*>(target)) {
+        if (primary->value.type == TokenType::IDENTIFIER) {
+            Place place;
+            place.kind = Place::Kind::Variable;
+            place.name = primary->value.lexeme;
+            place.variable = primary->variable;
+            return place;
+        }
+    }
+    else if (PostfixExpr* postfix = dynamic_cast<PostfixExpr*>(target)) {
+        // Everything but the last tail is evaluated; the last one names the
+        // place. The element or field is not read here: a plain assignment
+        // only checks the container and key when it stores.
+        Place place;
+        Value container = evaluateChain(postfix, postfix->tails.size() - 1, place);
+        PostfixTail* last = postfix->tails.back();
+        if (last->op.type == TokenType::LEFT_BRACKET) {
+            place = Place();
+            place.kind = Place::Kind::Index;
+            place.container = container;
+            place.key = evaluate(last->indexOrCondition);
+            return place;
+        }
+        if (last->op.type == TokenType::DOT) return fieldPlace(container, last);
+    }
+    throw RuntimeError("Invalid assignment target.", line);
+}
+
+// --- Declarations ---
+
+void Interpreter::visitVarDecl(VarDecl* decl) {
+    Value value = decl->initializer ? evaluate(decl->initializer) : Value::nil();
+    define(decl->variable, value);
+}
+
+void Interpreter::visitFuncDecl(FuncDecl* decl) {
+    define(decl->variable, Value::object(heap.makeFunction(decl, environment)));
+}
+
+// --- Statements ---
+
+void Interpreter::visitBlockStmt(BlockStmt* stmt) {
+    executeBlock(stmt->statements, stmt->frameSize);
+}
+
+void Interpreter::visitIfStmt(IfStmt* stmt) {
+    if (evaluate(stmt->condition).isTruthy()) {
+        execute(stmt->thenBranch);
+    }
+    else if (stmt->elseBranch) {
+        execute(stmt->elseBranch);
+    }
+}
+
+void Interpreter::visitForStmt(ForStmt* stmt) {
+    // The initializer's variable lives in a frame of its own around the loop.
+    std::shared_ptr<Environment> previous = environment;
+    if (stmt->frameSize > 0) environment = std::make_shared<Environment>(previous, stmt->frameSize);
+    try {
+        execute(stmt->initializer);
+        while (!stmt->condition || evaluate(stmt->condition).isTruthy()) {
+            if (!runLoopBody(stmt->body)) break;
+            if (stmt->increment) evaluate(stmt->increment);
+        }
+    }
+    catch (...) {
+        environment = std::move(previous);
+        throw;
+    }
+    environment = std::move(previous);
+}
+
+void Interpreter::visitWhileStmt(WhileStmt* stmt) {
+    while (evaluate(stmt->condition).isTruthy()) {
+        if (!runLoopBody(stmt->body)) break;
+    }
+}
+
+void Interpreter::visitDoWhileStmt(DoWhileStmt* stmt) {
+    do {
+        if (!runLoopBody(stmt->body)) break;
+    } while (evaluate(stmt->condition).isTruthy());
+}
+
+void Interpreter::visitSwitchStmt(SwitchStmt* stmt) {
+    // Runs from the first case equal to the condition (or from 'default' when
+    // none is) and falls through the following cases until a break. Integer
+    // constant cases are looked up in the Resolver's table instead.
+    Value condition = evaluate(stmt->condition);
+    size_t start = stmt->cases.size();
+    if (stmt->table) {
+        start = stmt->table->lookup(condition);
+    }
+    else {
+        size_t defaultCase = stmt->cases.size();
+        for (size_t i = 0; i < stmt->cases.size(); ++i) {
+            CaseStmt* c = stmt->cases[i];
+            if (c->value == nullptr) {
+                defaultCase = i;
+            }
+            else if (valuesEqual(condition, evaluate(c->value))) {
+                start = i;
+                break;
+            }
+        }
+        if (start == stmt->cases.size()) start = defaultCase;
+    }
+
+    // Each case body is a scope of its own, so a variable declared in one case
+    // is not visible in the cases it falls through to.
+    for (size_t i = start; i < stmt->cases.size() && signal == Signal::None; ++i) {
+        executeBlock(stmt->cases[i]->body, stmt->cases[i]->frameSize);
+    }
+
+    // 'break' ends the switch; 'continue' and 'return' belong to the enclosing code.
+    if (signal == Signal::Break) signal = Signal::None;
+}
+
+void Interpreter::visitBreakStmt(BreakStmt*) {
+    signal = Signal::Break;
+}
+
+void Interpreter::visitContinueStmt(ContinueStmt*) {
+    signal = Signal::Continue;
+}
+
+void Interpreter::visitReturnStmt(ReturnStmt* stmt) {
+    result = stmt->value ? evaluate(stmt->value) : Value::nil();
+    signal = Signal::Return;
+}
+
+void Interpreter::visitPrintStmt(PrintStmt* stmt) {
+    output << valueToString(evaluate(stmt->expression)) << '\n';
+}
+
+void Interpreter::visitExprStmt(ExprStmt* stmt) {
+    // An empty statement (';') has no expression.
+    if (stmt->expression) evaluate(stmt->expression);
+}
+
+// --- Expressions ---
+
+void Interpreter::visitAssignmentExpr(AssignmentExpr* expr) {
+    int line = expr->op.line;
+    Place place = placeOf(expr->left, line);
+    TokenType op = compoundAssignmentOperator(expr->op.type);
+    if (op == TokenType::EQUAL) {
+        Value value = evaluate(expr->right);
+        write(place, value, line);
+        result = value;
+        return;
+    }
+
+    Value current = read(place, line);
+    Value operand = evaluate(expr->right);
+    Value value = atLine(line, [&] { return applyBinary(heap, op, current, operand); });
+    write(place, value, line);
+    result = value;
+}
+
+void Interpreter::visitConditionalExpr(ConditionalExpr* expr) {
+    result = evaluate(evaluate(expr->condition).isTruthy() ? expr->thenExpr : expr->elseExpr);
+}
+
+void Interpreter::visitLogicalExpr(LogicalExpr* expr) {
+    // Short-circuits and yields the deciding operand, not a boolean.
+    Value left = evaluate(expr->left);
+    if (expr->op.type == TokenType::PIPE_PIPE ? left.isTruthy() : !left.isTruthy()) {
+        result = left;
+        return;
+    }
+    result = evaluate(expr->right);
+}
+
+void Interpreter::visitBinaryExpr(BinaryExpr* expr) {
+    Value left = evaluate(expr->left);
+    Value right = evaluate(expr->right);
+    result = atLine(expr->op.line, [&] { return applyBinary(heap, expr->op.type, left, right); });
+}
+
+void Interpreter::visitUnaryExpr(UnaryExpr* expr) {
+    int line = expr->op.line;
+    if (expr->op.type == TokenType::PLUS_PLUS || expr->op.type == TokenType::MINUS_MINUS) {
+        // Prefix increment: yields the updated value.
+        Place place = placeOf(expr->right, line);
+        Value current = read(place, line);
+        if (!current.isNumber()) throw RuntimeError("Operand must be a number.", line);
+        Value updated = Value::number(current.asNumber() + (expr->op.type == TokenType::PLUS_PLUS ? 1 : -1));
+        write(place, updated, line);
+        result = updated;
+        return;
+    }
+
+    Value operand = evaluate(expr->right);
+    result = atLine(line, [&] { return applyUnary(expr->op.type, operand); });
+}
+
+Interpreter::Place Interpreter::fieldPlace(Value container, PostfixTail* tail) {
+    Place place;
+    place.kind = Place::Kind::Field;
+    place.container = container;
+    place.field = static_cast<PrimaryExpr*>(tail->indexOrCondition)->value.symbol;
+    place.cache = tail->cache.get();
+    return place;
+}
+
+Value Interpreter::applyTail(Value target, PostfixTail* tail, Place& place) {
+    int line = tail->op.line;
+    switch (tail->op.type) {
+    case TokenType::LEFT_PAREN: {
+        std::vector<Value> args;
+        args.reserve(tail->arguments.size());
+        for (Expr* arg : tail->arguments) {
+            args.push_back(evaluate(arg));
+        }
+        place = Place();
+        return call(target, args, line);
+    }
+    case TokenType::LEFT_BRACKET: {
+        Value key = evaluate(tail->indexOrCondition);
+        place = Place();
+        // Strings can be indexed but not assigned through.
+        if (target.isObjType(ObjType::Array) || target.isObjType(ObjType::Instance)) {
+            place.kind = Place::Kind::Index;
+            place.container = target;
+            place.key = key;
+        }
+        return atLine(line, [&] { return getIndex(heap, target, key); });
+    }
+    case TokenType::DOT:
+        place = fieldPlace(target, tail);
+        return read(place, line);
+    default: {
+        // Postfix increment: yields the value before the update.
+        if (!target.isNumber()) throw RuntimeError("Operand must be a number.", line);
+        write(place, Value::number(target.asNumber() + (tail->op.type == TokenType::PLUS_PLUS ? 1 : -1)), line);
+        place = Place();
+        return target;
+    }
+    }
+}
+
+Value Interpreter::evaluateChain(PostfixExpr* expr, size_t count, Place& place) {
+    place = Place();
+    if (PrimaryExpr* primary = dynamic_cast<PrimaryExpr*>(expr->primary)) {
+        if (primary->value.type == TokenType::IDENTIFIER) {
+            place.kind = Place::Kind::Variable;
+            place.name = primary->value.lexeme;
+            place.variable = primary->variable;
+        }
+    }
+    Value value = evaluate(expr->primary);
+    for (size_t i = 0; i < count; ++i) {
+        value = applyTail(value, expr->tails[i], place);
+    }
+    return value;
+}
+
+void Interpreter::visitPostfixExpr(PostfixExpr* expr) {
+    Place place;
+    result = evaluateChain(expr, expr->tails.size(), place);
+}
+
+void Interpreter::visitPrimaryExpr(PrimaryExpr* expr) {
+    const TokenRef& token = expr->value;
+    switch (token.type) {
+    case TokenType::NUMBER:
+        result = Value::number(token.numberValue());
+        return;
+    case TokenType::STRING: {
+        auto it = stringLiterals.find(token.symbol);
+        if (it == stringLiterals.end()) {
+            ObjString* literal = heap.makeString(std::string(token.stringValue()));
+            literal->symbol = token.symbol;
+            it = stringLiterals.emplace(token.symbol, Value::object(literal)).first;
+        }
+        result = it->second;
+        return;
+    }
+    case TokenType::TRUE: result = Value::boolean(true); return;
+    case TokenType::FALSE: result = Value::boolean(false); return;
+    case TokenType::NIL: result = Value::nil(); return;
+    default:
+        result = variable(expr->variable, token.lexeme, token.line);
+        return;
+    }
+}
+
+void Interpreter::visitGroupingExpr(GroupingExpr* expr) {
+    result = evaluate(expr->expression);
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "ast_visitor.h"
+#include "compiler.h"
+#include "environment.h"
+#include "expr_nodes.h"
+#include "object.h"
+#include "token.h"
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Stmt;
+
+// Executes a program by walking its AST.
+// Variables are found through the Resolver's annotations: locals in frames of
+// slots (Environment), globals in a GlobalTable. Statements run through the visitor; an expression visit leaves its value in
+// `result`. break, continue and return are not exceptions: they set `signal`,
+// which every statement list and loop checks after each statement.
+class Interpreter : public AstVisitor {
+public:
+    // `print` writes to `output`; runtime errors are reported on std::cerr.
+    explicit Interpreter(std::ostream& output);
+
+    // Resolves the declarations (see Resolver) and runs them in order.
+    // Returns false if a resolution or runtime error stopped the program.
+    // Globals persist across calls.
+    bool interpret(const std::vector<Declaration*>& program);
+
+    // Number of AST nodes evaluated or executed so far (the benchmarks' "ops").
+    uint64_t operationCount() const { return operations; }
+
+    // This engine never collects (see Heap), but counts what it allocates.
+    const Heap::Stats& heapStats() const { return heap.stats(); }
+
+    // --- Visitor Methods ---
+    void visitVarDecl(VarDecl* decl) override;
+    void visitFuncDecl(FuncDecl* decl) override;
+    void visitBlockStmt(BlockStmt* stmt) override;
+    void visitIfStmt(IfStmt* stmt) override;
+    void visitForStmt(ForStmt* stmt) override;
+    void visitWhileStmt(WhileStmt* stmt) override;
+    void visitDoWhileStmt(DoWhileStmt* stmt) override;
+    void visitSwitchStmt(SwitchStmt* stmt) override;
+    void visitBreakStmt(BreakStmt* stmt) override;
+    void visitContinueStmt(ContinueStmt* stmt) override;
+    void visitReturnStmt(ReturnStmt* stmt) override;
+    void visitPrintStmt(PrintStmt* stmt) override;
+    void visitExprStmt(ExprStmt* stmt) override;
+    void visitAssignmentExpr(AssignmentExpr* expr) override;
+    void visitConditionalExpr(ConditionalExpr* expr) override;
+    void visitLogicalExpr(LogicalExpr* expr) override;
+    void visitBinaryExpr(BinaryExpr* expr) override;
+    void visitUnaryExpr(UnaryExpr* expr) override;
+    void visitPostfixExpr(PostfixExpr* expr) override;
+    void visitPrimaryExpr(PrimaryExpr* expr) override;
+    void visitGroupingExpr(GroupingExpr* expr) override;
+
+private:
+    enum class Signal { None, Break, Continue, Return };
+
+    // Where an assignment, ++ or -- writes: a variable, an element or a field.
+    struct Place {
+        enum class Kind { None, Variable, Index, Field } kind = Kind::None;
+        std::string_view name;  // Variable name, for errors
+        VariableSlot variable;  // For Variable
+        Symbol field = noSymbol; // For Field
+        InlineCache* cache = nullptr; // For Field: the '.' tail's
+        Value container;        // Array or object for Index and Field
+        Value key;              // Index (number) or key (string) for Index
+    };
+
+    std::ostream& output;
+    Heap heap;
+    GlobalTable globals;
+    std::shared_ptr<Environment> environment; // Innermost frame, nullptr at top level
+
+    Value result;                  // Value of the expression just evaluated
+    Signal signal = Signal::None;
+    uint64_t operations = 0;
+    int callDepth = 0;
+
+    // String literals are created once per distinct text, not per evaluation.
+    std::unordered_map<Symbol, Value> stringLiterals;
+
+    Value evaluate(Expr* expr);
+    void execute(Declaration* decl);
+    // Runs `statements` in a new frame of `frameSize` slots (in the current
+    // one if the scope declares nothing), stopping early when a signal is raised.
+    void executeBlock(const std::vector<Declaration*>& statements, uint32_t frameSize);
+    // Runs `statements` with `frame` as the innermost frame.
+    void executeIn(const std::vector<Declaration*>& statements, std::shared_ptr<Environment> frame);
+    // Runs a loop body; returns false if the loop must stop (break or return).
+    bool runLoopBody(Stmt* body);
+
+    Value call(Value callee, std::vector<Value>& args, int line);
+
+    // Postfix chains: evaluates `expr->primary` and the first `count` tails.
+    // On return `place` says where the value was read from (Kind::None after
+    // a call or an increment), so a following ++, -- or assignment can write.
+    Value evaluateChain(PostfixExpr* expr, size_t count, Place& place);
+    Value applyTail(Value target, PostfixTail* tail, Place& place);
+    // A Field place for the '.' tail `tail` of `container`.
+    static Place fieldPlace(Value container, PostfixTail* tail);
+
+    // A resolved variable's storage; globals must have been declared.
+    Value& variable(const VariableSlot& slot, std::string_view name, int line);
+    void define(const VariableSlot& slot, Value value);
+
+    Value read(const Place& place, int line);
+    void write(const Place& place, Value value, int line);
+    // The place an assignment or prefix ++/-- targets.
+    Place placeOf(Expr* target, int line);
+};
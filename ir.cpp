@@ -0,0 +1,355 @@
+#include "ir.h"
+#include "object.h"
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+namespace {
+
+struct IrOpInfo {
+    const char* name;
+    bool hasResult;
+};
+
+constexpr IrOpInfo irOpInfo[] = {
+#define DAV_IR_OP_INFO(name, result) { #name, result },
+    DAV_IR_OPS(DAV_IR_OP_INFO)
+#undef DAV_IR_OP_INFO
+};
+
+const char* operatorText(TokenType op) {
+    switch (op) {
+    case TokenType::PLUS: return "+";
+    case TokenType::MINUS: return "-";
+    case TokenType::STAR: return "*";
+    case TokenType::SLASH: return "/";
+    case TokenType::PERCENT: return "%";
+    case TokenType::AMP: return "&";
+    case TokenType::PIPE: return "|";
+    case TokenType::CARET: return "^";
+    case TokenType::SHIFT_LEFT: return "<<";
+    case TokenType::SHIFT_RIGHT: return ">>";
+    case TokenType::EQUAL_EQUAL: return "==";
+    case TokenType::BANG_EQUAL: return "!=";
+    case TokenType::LESS: return "<";
+    case TokenType::LESS_EQUAL: return "<=";
+    case TokenType::GREATER: return ">";
+    case TokenType::GREATER_EQUAL: return ">=";
+    case TokenType::BANG: return "!";
+    case TokenType::TILDE: return "~";
+    case TokenType::PLUS_PLUS: return "++";
+    case TokenType::MINUS_MINUS: return "--";
+    default: return "?";
+    }
+}
+
+std::string describeConstant(Value value) {
+    if (value.isString()) return "\"" + asString(value)->chars + "\"";
+    return valueToString(value);
+}
+
+std::string functionLabel(const IrFunction* function) {
+    std::string label = "#" + std::to_string(function->number) + " ";
+    label += function->name.empty() ? "<script>" : std::string(function->name);
+    return label;
+}
+
+void printInstr(const IrInstr* instr, std::ostream& out) {
+    out << "    ";
+    if (irOpHasResult(instr->op)) out << "%" << instr->id << " = ";
+    out << irOpName(instr->op);
+
+    auto operand = [&](size_t i) { return "%" + std::to_string(instr->operands[i]->id); };
+    switch (instr->op) {
+    case IrOp::CONST: out << " " << describeConstant(instr->constant); break;
+    case IrOp::PARAM:
+    case IrOp::CAPTURE: out << " " << instr->index; break;
+    case IrOp::PHI:
+        for (size_t i = 0; i < instr->operands.size(); ++i) {
+            out << (i == 0 ? " [" : ", [") << operand(i) << ", b" << instr->block->preds[i]->id << "]";
+        }
+        break;
+    case IrOp::COPY: out << " " << operand(0) << "  ; " << instr->name; break;
+    case IrOp::UNARY: out << " " << operatorText(instr->token) << " " << operand(0); break;
+    case IrOp::BINARY: out << " " << operand(0) << " " << operatorText(instr->token) << " " << operand(1); break;
+    case IrOp::GET_GLOBAL: out << " " << instr->name; break;
+    case IrOp::SET_GLOBAL:
+    case IrOp::DEFINE_GLOBAL: out << " " << instr->name << ", " << operand(0); break;
+    case IrOp::GET_FIELD: out << " " << operand(0) << "." << instr->name; break;
+    case IrOp::SET_FIELD: out << " " << operand(0) << "." << instr->name << ", " << operand(1); break;
+    case IrOp::CLOSURE:
+        out << " " << functionLabel(instr->function);
+        for (size_t i = 0; i < instr->operands.size(); ++i) out << (i == 0 ? " [" : ", ") << operand(i);
+        if (!instr->operands.empty()) out << "]";
+        break;
+    case IrOp::CALL:
+        out << " " << operand(0) << "(";
+        for (size_t i = 1; i < instr->operands.size(); ++i) out << (i == 1 ? "" : ", ") << operand(i);
+        out << ")";
+        break;
+    case IrOp::JUMP: out << " b" << instr->targets[0]->id; break;
+    case IrOp::BRANCH: out << " " << operand(0) << ", b" << instr->targets[0]->id << ", b" << instr->targets[1]->id; break;
+    default:
+        for (size_t i = 0; i < instr->operands.size(); ++i) out << (i == 0 ? " " : ", ") << operand(i);
+        break;
+    }
+    out << "\n";
+}
+
+} // namespace
+
+const char* irOpName(IrOp op) {
+    return irOpInfo[static_cast<size_t>(op)].name;
+}
+
+bool irOpHasResult(IrOp op) {
+    return irOpInfo[static_cast<size_t>(op)].hasResult;
+}
+
+// --- Instructions, Blocks and Functions ---
+
+size_t IrBlock::successorCount() const {
+    IrInstr* last = terminator();
+    if (last == nullptr) return 0;
+    if (last->op == IrOp::JUMP) return 1;
+    if (last->op == IrOp::BRANCH) return 2;
+    return 0;
+}
+
+size_t IrBlock::phiCount() const {
+    size_t count = 0;
+    while (count < instrs.size() && instrs[count]->op == IrOp::PHI) ++count;
+    return count;
+}
+
+size_t IrBlock::predIndex(const IrBlock* pred) const {
+    return static_cast<size_t>(std::find(preds.begin(), preds.end(), pred) - preds.begin());
+}
+
+IrBlock* IrFunction::newBlock() {
+    blocks.push_back(std::make_unique<IrBlock>());
+    blocks.back()->id = blockIds++;
+    return blocks.back().get();
+}
+
+IrInstr* IrFunction::newInstr(IrOp op, int line) {
+    values.push_back(std::make_unique<IrInstr>());
+    IrInstr* instr = values.back().get();
+    instr->op = op;
+    instr->id = static_cast<uint32_t>(values.size() - 1);
+    instr->line = line;
+    return instr;
+}
+
+size_t IrFunction::instructionCount() const {
+    size_t count = 0;
+    for (const auto& block : blocks) count += block->instrs.size();
+    return count;
+}
+
+IrFunction* IrModule::newFunction(std::string_view name, int arity) {
+    functions.push_back(std::make_unique<IrFunction>());
+    IrFunction* function = functions.back().get();
+    function->name = name;
+    function->arity = arity;
+    function->number = static_cast<uint32_t>(functions.size() - 1);
+    return function;
+}
+
+size_t IrModule::instructionCount() const {
+    size_t count = 0;
+    for (const auto& function : functions) count += function->instructionCount();
+    return count;
+}
+
+size_t IrModule::blockCount() const {
+    size_t count = 0;
+    for (const auto& function : functions) count += function->blocks.size();
+    return count;
+}
+
+// --- Editing Helpers ---
+
+void removePredecessor(IrBlock* block, IrBlock* pred) {
+    size_t index = block->predIndex(pred);
+    if (index == block->preds.size()) return;
+    block->preds.erase(block->preds.begin() + index);
+    for (size_t i = 0, phis = block->phiCount(); i < phis; ++i) {
+        std::vector<IrInstr*>& operands = block->instrs[i]->operands;
+        operands.erase(operands.begin() + index);
+    }
+}
+
+bool sameConstant(Value a, Value b) {
+    if (a.kind() != b.kind()) return false;
+    switch (a.kind()) {
+    case Value::Type::Nil: return true;
+    case Value::Type::Bool: return a.asBool() == b.asBool();
+    case Value::Type::Number: {
+        double x = a.asNumber(), y = b.asNumber();
+        return std::memcmp(&x, &y, sizeof(double)) == 0;
+    }
+    default:
+        if (a.isString() && b.isString()) return asString(a)->chars == asString(b)->chars;
+        return a.asObject() == b.asObject();
+    }
+}
+
+// --- Dominators ---
+
+DominatorTree::DominatorTree(const IrFunction& function)
+    : position(function.blockIds, -1), immediate(function.blockIds, nullptr), kids(function.blockIds) {
+    // Postorder by an explicit DFS, then reversed.
+    std::vector<char> visited(function.blockIds, 0);
+    std::vector<std::pair<IrBlock*, size_t>> stack{ { function.entry(), 0 } };
+    visited[function.entry()->id] = 1;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < block->successorCount()) {
+            IrBlock* successor = block->successor(next++);
+            if (!visited[successor->id]) {
+                visited[successor->id] = 1;
+                stack.push_back({ successor, 0 });
+            }
+            continue;
+        }
+        order.push_back(block);
+        stack.pop_back();
+    }
+    std::reverse(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); ++i) position[order[i]->id] = static_cast<int>(i);
+
+    auto intersect = [&](IrBlock* a, IrBlock* b) {
+        while (a != b) {
+            while (position[a->id] > position[b->id]) a = immediate[a->id];
+            while (position[b->id] > position[a->id]) b = immediate[b->id];
+        }
+        return a;
+    };
+    IrBlock* entry = function.entry();
+    immediate[entry->id] = entry;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            IrBlock* block = order[i];
+            IrBlock* dominator = nullptr;
+            for (IrBlock* pred : block->preds) {
+                if (position[pred->id] < 0 || immediate[pred->id] == nullptr) continue;
+                dominator = dominator == nullptr ? pred : intersect(pred, dominator);
+            }
+            if (dominator != immediate[block->id]) {
+                immediate[block->id] = dominator;
+                changed = true;
+            }
+        }
+    }
+    immediate[entry->id] = nullptr;
+    for (size_t i = 1; i < order.size(); ++i) kids[immediate[order[i]->id]->id].push_back(order[i]);
+}
+
+bool DominatorTree::reachable(const IrBlock* block) const {
+    return position[block->id] >= 0;
+}
+
+IrBlock* DominatorTree::idom(const IrBlock* block) const {
+    return immediate[block->id];
+}
+
+bool DominatorTree::dominates(const IrBlock* a, const IrBlock* b) const {
+    for (const IrBlock* block = b; block != nullptr; block = immediate[block->id]) {
+        if (block == a) return true;
+    }
+    return false;
+}
+
+const std::vector<IrBlock*>& DominatorTree::children(const IrBlock* block) const {
+    return kids[block->id];
+}
+
+// --- Listing and Checking ---
+
+void printIr(const IrFunction& function, std::ostream& out) {
+    out << "function " << functionLabel(&function) << " (" << function.arity << " params, "
+        << function.captureCount << " captures)\n";
+    for (const auto& block : function.blocks) {
+        out << "  b" << block->id << ":";
+        for (size_t i = 0; i < block->preds.size(); ++i) out << (i == 0 ? "  <- b" : ", b") << block->preds[i]->id;
+        out << "\n";
+        for (const IrInstr* instr : block->instrs) printInstr(instr, out);
+    }
+}
+
+void printIr(const IrModule& module, std::ostream& out) {
+    for (size_t i = 0; i < module.functions.size(); ++i) {
+        if (i > 0) out << "\n";
+        printIr(*module.functions[i], out);
+    }
+}
+
+std::string verifyIr(const IrFunction& function) {
+    auto where = [](const IrBlock* block) { return "b" + std::to_string(block->id) + ": "; };
+
+    // Which block (if any) holds each value, and at what position.
+    std::vector<const IrBlock*> home(function.values.size(), nullptr);
+    std::vector<size_t> slot(function.values.size(), 0);
+    std::vector<char> live(function.blockIds, 0);
+    for (const auto& block : function.blocks) {
+        live[block->id] = 1;
+        for (size_t i = 0; i < block->instrs.size(); ++i) {
+            const IrInstr* instr = block->instrs[i];
+            if (instr->block != block.get()) return where(block.get()) + "%" + std::to_string(instr->id) + " has a stale block";
+            home[instr->id] = block.get();
+            slot[instr->id] = i;
+        }
+    }
+
+    DominatorTree dominators(function);
+    for (const auto& owned : function.blocks) {
+        const IrBlock* block = owned.get();
+        if (block->instrs.empty() || !irOpIsTerminator(block->terminator()->op)) {
+            return where(block) + "does not end in a terminator";
+        }
+        for (const IrBlock* pred : block->preds) {
+            if (!live[pred->id]) return where(block) + "has a deleted predecessor b" + std::to_string(pred->id);
+        }
+        // Every edge appears exactly once in the target's predecessor list.
+        for (size_t s = 0; s < block->successorCount(); ++s) {
+            const IrBlock* successor = block->successor(s);
+            if (!live[successor->id]) return where(block) + "jumps to a deleted block";
+            size_t edges = 0;
+            for (size_t t = 0; t < block->successorCount(); ++t) edges += block->successor(t) == successor;
+            size_t listed = std::count(successor->preds.begin(), successor->preds.end(), block);
+            if (edges != listed) return where(block) + "edge to b" + std::to_string(successor->id) + " not in its predecessors";
+        }
+        for (const IrBlock* pred : block->preds) {
+            bool found = false;
+            for (size_t s = 0; s < pred->successorCount(); ++s) found |= pred->successor(s) == block;
+            if (!found) return where(block) + "lists b" + std::to_string(pred->id) + " which does not jump here";
+        }
+
+        size_t phis = block->phiCount();
+        for (size_t i = 0; i < block->instrs.size(); ++i) {
+            const IrInstr* instr = block->instrs[i];
+            std::string at = where(block) + "%" + std::to_string(instr->id) + " ";
+            if (instr->op == IrOp::PHI && i >= phis) return at + "is a PHI after the block's first instructions";
+            if (instr->op == IrOp::PHI && instr->operands.size() != block->preds.size()) return at + "has the wrong operand count";
+            if (irOpIsTerminator(instr->op) && i + 1 != block->instrs.size()) return at + "is a terminator in mid-block";
+            for (size_t k = 0; k < instr->operands.size(); ++k) {
+                const IrInstr* operand = instr->operands[k];
+                const IrBlock* defined = home[operand->id];
+                if (defined == nullptr || function.values[operand->id].get() != operand) {
+                    return at + "uses %" + std::to_string(operand->id) + " which is not in the function";
+                }
+                if (!irOpHasResult(operand->op)) return at + "uses %" + std::to_string(operand->id) + " which has no result";
+                if (!dominators.reachable(block)) continue;
+                // A PHI operand must be available at the end of its predecessor.
+                const IrBlock* user = instr->op == IrOp::PHI ? block->preds[k] : block;
+                if (!dominators.reachable(user)) continue;
+                bool dominated = defined == user ? (instr->op == IrOp::PHI || slot[operand->id] < i)
+                                                 : dominators.dominates(defined, user);
+                if (!dominated) return at + "uses %" + std::to_string(operand->id) + " before it is defined";
+            }
+        }
+    }
+    return {};
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include "shape.h"
+#include "token.h"
+#include "value.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Heap;
+struct IrBlock;
+struct IrFunction;
+
+// --- Instruction Set ---
+// X(name, has result). The IR is in SSA form: every instruction that has a
+// result defines one value, and operands point at the instructions that
+// define them. Locals that no nested function captures are SSA values (PHIs
+// join them); captured locals live in cells, globals in GlobalTable slots.
+#define DAV_IR_OPS(X)                                                                        \
+    X(CONST,          true)  /* `constant`: nil, a boolean, a number or a string */          \
+    X(PARAM,          true)  /* argument number `index` */                                   \
+    X(PHI,            true)  /* one operand per predecessor, in `block->preds` order */      \
+    X(COPY,           true)  /* a: a, assigned to the local variable `name` */                \
+    X(UNARY,          true)  /* `token` a; PLUS_PLUS and MINUS_MINUS add or subtract 1 */   \
+    X(BINARY,         true)  /* a `token` b, for every operator but && and || */             \
+    X(GET_GLOBAL,     true)  /* global slot `index` (named `name`) */                        \
+    X(SET_GLOBAL,     false) /* value: assign the declared global slot `index` */           \
+    X(DEFINE_GLOBAL,  false) /* value: declare global slot `index` */                       \
+    X(NEW_CELL,       true)  /* value: a new cell holding value */                           \
+    X(LOAD_CELL,      true)  /* cell */                                                      \
+    X(STORE_CELL,     false) /* cell value */                                                \
+    X(CAPTURE,        true)  /* cell number `index` of the running closure */               \
+    X(CLOSURE,        true)  /* `function`, capturing one cell per operand */                \
+    X(CALL,           true)  /* callee args... */                                            \
+    X(GET_INDEX,      true)  /* container key */                                             \
+    X(SET_INDEX,      false) /* container key value */                                      \
+    X(GET_FIELD,      true)  /* object, field `name` */                                      \
+    X(SET_FIELD,      false) /* object value, field `name` */                                \
+    X(PRINT,          false) /* value */                                                     \
+    X(JUMP,           false) /* to targets[0] */                                             \
+    X(BRANCH,         false) /* condition: targets[0] if truthy, else targets[1] */         \
+    X(RETURN,         false) /* value */                                                     \
+    X(INVALID_TARGET, false) /* raise "Invalid assignment target." */
+
+enum class IrOp : uint8_t {
+#define DAV_IR_OP_ENUM(name, result) name,
+    DAV_IR_OPS(DAV_IR_OP_ENUM)
+#undef DAV_IR_OP_ENUM
+};
+
+const char* irOpName(IrOp op);
+bool irOpHasResult(IrOp op);
+// JUMP, BRANCH, RETURN and INVALID_TARGET end a block; nothing else may.
+inline bool irOpIsTerminator(IrOp op) {
+    return op == IrOp::JUMP || op == IrOp::BRANCH || op == IrOp::RETURN || op == IrOp::INVALID_TARGET;
+}
+
+// --- Instructions, Blocks and Functions ---
+
+struct IrInstr {
+    IrOp op;
+    TokenType token = TokenType::END_OF_FILE; // Operator of UNARY and BINARY
+    uint32_t id = 0;       // Value number: unique in the function, never reused
+    int line = 0;          // Source line runtime errors are reported at
+    uint32_t index = 0;    // PARAM argument, global slot, CAPTURE cell or field Symbol
+    IrBlock* block = nullptr;
+    std::vector<IrInstr*> operands;
+    Value constant;        // CONST
+    std::string_view name; // Global, field or (for COPY) local variable name
+    IrFunction* function = nullptr;            // CLOSURE
+    IrBlock* targets[2] = { nullptr, nullptr }; // JUMP and BRANCH
+    std::unique_ptr<InlineCache> cache;         // GET_FIELD and SET_FIELD
+};
+
+// A straight run of instructions: PHIs first, then the body, then exactly
+// one terminator.
+struct IrBlock {
+    uint32_t id = 0; // Unique in the function, never reused
+    std::vector<IrInstr*> instrs;
+    std::vector<IrBlock*> preds; // One entry per incoming edge
+
+    IrInstr* terminator() const { return instrs.empty() ? nullptr : instrs.back(); }
+    // Successors named by the terminator (none for RETURN and INVALID_TARGET).
+    size_t successorCount() const;
+    IrBlock* successor(size_t i) const { return terminator()->targets[i]; }
+    size_t phiCount() const;
+    size_t predIndex(const IrBlock* pred) const; // Of the first edge from `pred`
+};
+
+struct IrFunction {
+    std::string_view name; // Empty for the top-level script
+    uint32_t number = 0;   // Position in the module, shown as #number
+    int arity = 0;
+    int captureCount = 0;
+    std::vector<std::unique_ptr<IrBlock>> blocks; // blocks[0] is the entry
+    // Every instruction ever created, indexed by id. Passes unlink dead ones
+    // from their blocks but they stay allocated until the function goes away.
+    std::vector<std::unique_ptr<IrInstr>> values;
+    uint32_t blockIds = 0;
+
+    IrBlock* entry() const { return blocks.front().get(); }
+    IrBlock* newBlock();
+    IrInstr* newInstr(IrOp op, int line);
+    size_t instructionCount() const; // Instructions still in a block
+};
+
+// A whole program: the script and every function declared in it.
+struct IrModule {
+    explicit IrModule(Heap& heap) : heap(heap) {}
+
+    Heap& heap; // String constants (including folded ones) are allocated here
+    std::vector<std::unique_ptr<IrFunction>> functions; // functions[0] is the script
+
+    IrFunction* script() const { return functions.front().get(); }
+    IrFunction* newFunction(std::string_view name, int arity);
+    size_t instructionCount() const;
+    size_t blockCount() const;
+};
+
+// --- Editing Helpers ---
+
+// Drops the first edge from `pred` to `block`, with the matching PHI operands.
+void removePredecessor(IrBlock* block, IrBlock* pred);
+
+// Constants that behave identically: same kind and, for numbers, the same bit
+// pattern (so 0 and -0 differ and NaN matches itself); strings by content.
+bool sameConstant(Value a, Value b);
+
+// --- Dominators ---
+
+// Immediate dominators of the blocks reachable from the entry (Cooper, Harvey
+// and Kennedy's iterative algorithm over reverse postorder).
+class DominatorTree {
+public:
+    explicit DominatorTree(const IrFunction& function);
+
+    bool reachable(const IrBlock* block) const;
+    IrBlock* idom(const IrBlock* block) const; // nullptr for the entry
+    bool dominates(const IrBlock* a, const IrBlock* b) const;
+    const std::vector<IrBlock*>& children(const IrBlock* block) const;
+    const std::vector<IrBlock*>& reversePostorder() const { return order; }
+
+private:
+    std::vector<IrBlock*> order;
+    std::vector<int> position;            // By block id: index in `order`, -1 if unreachable
+    std::vector<IrBlock*> immediate;      // By block id
+    std::vector<std::vector<IrBlock*>> kids; // By block id
+};
+
+// --- Listing and Checking ---
+
+void printIr(const IrModule& module, std::ostream& out);
+void printIr(const IrFunction& function, std::ostream& out);
+
+// Checks the structural invariants every pass must preserve (terminators,
+// PHI shape, predecessor lists, operands defined in a dominating position).
+// Returns an empty string if the function is well formed.
+std::string verifyIr(const IrFunction& function);
@@ -0,0 +1,900 @@
+#include "ir_builder.h"
+#include "declaration_nodes.h"
+#include "expr_nodes.h"
+#include "operators.h"
+#include "stmt_nodes.h"
+#include <iostream>
+
+namespace {
+
+bool isIncrement(const PostfixTail* tail) {
+    return tail->op.type == TokenType::PLUS_PLUS || tail->op.type == TokenType::MINUS_MINUS;
+}
+
+// Collects every identifier used inside the function declarations nested in
+// the statements it is given. A local whose name is not in the set can never
+// be captured, so it can be an SSA value instead of a cell.
+class CapturedNameCollector : public AstVisitor {
+public:
+    explicit CapturedNameCollector(std::unordered_set<Symbol>& names) : names(names) {}
+
+    void collect(const std::vector<Declaration*>& statements) {
+        for (Declaration* statement : statements) visit(statement);
+    }
+
+    void visitVarDecl(VarDecl* decl) override { visit(decl->initializer); }
+    void visitFuncDecl(FuncDecl* decl) override {
+        ++functionDepth;
+        collect(decl->body->statements);
+        --functionDepth;
+    }
+    void visitBlockStmt(BlockStmt* stmt) override { collect(stmt->statements); }
+    void visitIfStmt(IfStmt* stmt) override {
+        visit(stmt->condition);
+        visit(stmt->thenBranch);
+        visit(stmt->elseBranch);
+    }
+    void visitForStmt(ForStmt* stmt) override {
+        visit(stmt->initializer);
+        visit(stmt->condition);
+        visit(stmt->increment);
+        visit(stmt->body);
+    }
+    void visitWhileStmt(WhileStmt* stmt) override {
+        visit(stmt->condition);
+        visit(stmt->body);
+    }
+    void visitDoWhileStmt(DoWhileStmt* stmt) override {
+        visit(stmt->body);
+        visit(stmt->condition);
+    }
+    void visitSwitchStmt(SwitchStmt* stmt) override {
+        visit(stmt->condition);
+        for (CaseStmt* c : stmt->cases) {
+            visit(c->value);
+            collect(c->body);
+        }
+    }
+    void visitBreakStmt(BreakStmt*) override {}
+    void visitContinueStmt(ContinueStmt*) override {}
+    void visitReturnStmt(ReturnStmt* stmt) override { visit(stmt->value); }
+    void visitPrintStmt(PrintStmt* stmt) override { visit(stmt->expression); }
+    void visitExprStmt(ExprStmt* stmt) override { visit(stmt->expression); }
+    void visitAssignmentExpr(AssignmentExpr* expr) override {
+        visit(expr->left);
+        visit(expr->right);
+    }
+    void visitConditionalExpr(ConditionalExpr* expr) override {
+        visit(expr->condition);
+        visit(expr->thenExpr);
+        visit(expr->elseExpr);
+    }
+    void visitLogicalExpr(LogicalExpr* expr) override {
+        visit(expr->left);
+        visit(expr->right);
+    }
+    void visitBinaryExpr(BinaryExpr* expr) override {
+        visit(expr->left);
+        visit(expr->right);
+    }
+    void visitUnaryExpr(UnaryExpr* expr) override { visit(expr->right); }
+    void visitPostfixExpr(PostfixExpr* expr) override {
+        visit(expr->primary);
+        for (PostfixTail* tail : expr->tails) {
+            for (Expr* arg : tail->arguments) visit(arg);
+            visit(tail->indexOrCondition);
+        }
+    }
+    void visitPrimaryExpr(PrimaryExpr* expr) override {
+        if (functionDepth > 0 && expr->value.type == TokenType::IDENTIFIER) names.insert(expr->value.symbol);
+    }
+    void visitGroupingExpr(GroupingExpr* expr) override { visit(expr->expression); }
+
+private:
+    std::unordered_set<Symbol>& names;
+    int functionDepth = 0;
+
+    void visit(AstNode* node) {
+        if (node) node->accept(*this);
+    }
+};
+
+} // namespace
+
+IrBuilder::IrBuilder(Heap& heap, GlobalTable& globals) : heap(heap), globals(globals) {}
+
+std::unique_ptr<IrModule> IrBuilder::build(const std::vector<Declaration*>& program) {
+    auto built = std::make_unique<IrModule>(heap);
+    module = built.get();
+    FunctionState script{ nullptr, module->newFunction("", 0) };
+    CapturedNameCollector(script.capturedNames).collect(program);
+    current = &script;
+    block = newBlock();
+    sealBlock(block);
+    try {
+        compileStatements(program);
+        emit(IrOp::RETURN, { constant(Value::nil()) });
+    }
+    catch (CompileError&) {
+        built.reset();
+    }
+    current = nullptr;
+    module = nullptr;
+    block = nullptr;
+    return built;
+}
+
+// --- Emission ---
+
+IrInstr* IrBuilder::emit(IrOp op, std::vector<IrInstr*> operands) {
+    IrInstr* instr = current->function->newInstr(op, line);
+    instr->operands = std::move(operands);
+    instr->block = block;
+    block->instrs.push_back(instr);
+    return instr;
+}
+
+IrInstr* IrBuilder::constant(Value value) {
+    IrInstr* instr = emit(IrOp::CONST);
+    instr->constant = value;
+    return instr;
+}
+
+IrInstr* IrBuilder::stringConstant(Symbol chars) {
+    auto it = strings.find(chars);
+    if (it == strings.end()) {
+        ObjString* string = heap.makeString(std::string(symbols().text(chars)));
+        string->symbol = chars;
+        it = strings.emplace(chars, Value::object(string)).first;
+    }
+    return constant(it->second);
+}
+
+IrInstr* IrBuilder::emitField(IrOp op, std::vector<IrInstr*> operands, Symbol name) {
+    IrInstr* instr = emit(op, std::move(operands));
+    instr->index = name;
+    instr->name = symbols().text(name);
+    instr->cache = std::make_unique<InlineCache>();
+    return instr;
+}
+
+IrBlock* IrBuilder::newBlock() {
+    current->blocks.emplace_back();
+    return current->function->newBlock();
+}
+
+void IrBuilder::addEdge(IrBlock* from, IrBlock* to) {
+    to->preds.push_back(from);
+}
+
+void IrBuilder::jump(IrBlock* target) {
+    IrInstr* instr = emit(IrOp::JUMP);
+    instr->targets[0] = target;
+    addEdge(block, target);
+}
+
+void IrBuilder::branch(IrInstr* condition, IrBlock* ifTrue, IrBlock* ifFalse) {
+    IrInstr* instr = emit(IrOp::BRANCH, { condition });
+    instr->targets[0] = ifTrue;
+    instr->targets[1] = ifFalse;
+    addEdge(block, ifTrue);
+    addEdge(block, ifFalse);
+}
+
+void IrBuilder::startUnreachableBlock() {
+    block = newBlock();
+    sealBlock(block);
+}
+
+IrInstr* IrBuilder::phi(IrBlock* join, const std::vector<std::pair<IrBlock*, IrInstr*>>& incoming) {
+    IrInstr* instr = current->function->newInstr(IrOp::PHI, line);
+    instr->block = join;
+    for (IrBlock* pred : join->preds) {
+        for (const auto& [from, value] : incoming) {
+            if (from == pred) {
+                instr->operands.push_back(value);
+                break;
+            }
+        }
+    }
+    join->instrs.insert(join->instrs.begin(), instr);
+    return instr;
+}
+
+IrBuilder::CompileError IrBuilder::error(const std::string& message) {
+    std::cerr << "[Line " << line << "] Error: " << message << std::endl;
+    return CompileError();
+}
+
+// --- SSA Construction ---
+
+void IrBuilder::writeVariable(int variable, IrBlock* target, IrInstr* value) {
+    current->blocks[target->id].definitions[variable] = value;
+}
+
+IrInstr* IrBuilder::readVariable(int variable, IrBlock* source) {
+    auto& definitions = current->blocks[source->id].definitions;
+    auto it = definitions.find(variable);
+    if (it != definitions.end()) return it->second;
+    return readVariableRecursive(variable, source);
+}
+
+IrInstr* IrBuilder::readVariableRecursive(int variable, IrBlock* source) {
+    IrInstr* value;
+    if (!current->blocks[source->id].sealed) {
+        // More predecessors may come: leave the PHI's operands for sealBlock.
+        value = phi(source, {});
+        current->blocks[source->id].incompletePhis.push_back({ variable, value });
+    }
+    else if (source->preds.empty()) {
+        // Only in unreachable code: the value is never used.
+        value = current->function->newInstr(IrOp::CONST, line);
+        value->block = source;
+        source->instrs.insert(source->instrs.begin() + source->phiCount(), value);
+    }
+    else if (source->preds.size() == 1) {
+        value = readVariable(variable, source->preds[0]);
+    }
+    else {
+        // Defined before the operands are read, so a loop finds this PHI.
+        value = phi(source, {});
+        writeVariable(variable, source, value);
+        addPhiOperands(variable, value);
+    }
+    writeVariable(variable, source, value);
+    return value;
+}
+
+void IrBuilder::addPhiOperands(int variable, IrInstr* phi) {
+    for (IrBlock* pred : phi->block->preds) {
+        phi->operands.push_back(readVariable(variable, pred));
+    }
+}
+
+void IrBuilder::sealBlock(IrBlock* target) {
+    // Indexed: reading an operand may come back here through a loop.
+    std::vector<std::pair<int, IrInstr*>>& incomplete = current->blocks[target->id].incompletePhis;
+    for (size_t i = 0; i < incomplete.size(); ++i) {
+        addPhiOperands(incomplete[i].first, incomplete[i].second);
+    }
+    incomplete.clear();
+    current->blocks[target->id].sealed = true;
+}
+
+// --- Scopes and Variables ---
+
+void IrBuilder::compileStatement(Declaration* decl) {
+    if (decl) decl->accept(*this);
+}
+
+void IrBuilder::compileStatements(const std::vector<Declaration*>& statements) {
+    for (Declaration* statement : statements) {
+        compileStatement(statement);
+    }
+}
+
+IrInstr* IrBuilder::compile(Expr* expr) {
+    expr->accept(*this);
+    return result;
+}
+
+void IrBuilder::beginScope() {
+    ++current->scopeDepth;
+}
+
+void IrBuilder::endScope() {
+    --current->scopeDepth;
+    std::vector<Local>& locals = current->locals;
+    while (!locals.empty() && locals.back().depth > current->scopeDepth) {
+        locals.pop_back();
+    }
+}
+
+void IrBuilder::declareLocal(Symbol name, IrInstr* value) {
+    Local* existing = resolveLocal(current, name);
+    if (existing && existing->depth == current->scopeDepth) {
+        setVariable(name, value);
+        return;
+    }
+    if (current->capturedNames.count(name)) {
+        current->locals.push_back({ name, current->scopeDepth, -1, emit(IrOp::NEW_CELL, { value }) });
+        return;
+    }
+    current->locals.push_back({ name, current->scopeDepth, current->variables++, nullptr });
+    setVariable(name, value);
+}
+
+IrBuilder::Local* IrBuilder::resolveLocal(FunctionState* state, Symbol name) {
+    for (size_t i = state->locals.size(); i > 0; --i) {
+        if (state->locals[i - 1].name == name) return &state->locals[i - 1];
+    }
+    return nullptr;
+}
+
+int IrBuilder::resolveCapture(FunctionState* state, Symbol name) {
+    if (state->enclosing == nullptr) return -1;
+    IrInstr* source;
+    if (Local* local = resolveLocal(state->enclosing, name)) {
+        // Every name used in a nested function is a cell in the enclosing one.
+        if (local->cell == nullptr) throw error("Internal error: captured variable '" + std::string(symbols().text(name)) + "' has no cell.");
+        source = local->cell;
+    }
+    else {
+        int index = resolveCapture(state->enclosing, name);
+        if (index < 0) return -1;
+        source = state->enclosing->captures[index];
+    }
+    for (size_t i = 0; i < state->captureSources.size(); ++i) {
+        if (state->captureSources[i] == source) return static_cast<int>(i);
+    }
+    // Read once at the top of the function; the entry block dominates every use.
+    IrInstr* capture = state->function->newInstr(IrOp::CAPTURE, line);
+    capture->index = static_cast<uint32_t>(state->captures.size());
+    capture->block = state->function->entry();
+    capture->block->instrs.insert(capture->block->instrs.begin(), capture);
+    state->captures.push_back(capture);
+    state->captureSources.push_back(source);
+    return static_cast<int>(capture->index);
+}
+
+IrInstr* IrBuilder::getVariable(Symbol name) {
+    if (Local* local = resolveLocal(current, name)) {
+        if (local->cell) return emit(IrOp::LOAD_CELL, { local->cell });
+        return readVariable(local->variable, block);
+    }
+    int capture = resolveCapture(current, name);
+    if (capture >= 0) return emit(IrOp::LOAD_CELL, { current->captures[capture] });
+    int slot = globals.slotFor(name);
+    if (slot < 0) throw error("Too many global variables.");
+    IrInstr* get = emit(IrOp::GET_GLOBAL);
+    get->index = static_cast<uint32_t>(slot);
+    get->name = globals.names[slot];
+    return get;
+}
+
+void IrBuilder::setVariable(Symbol name, IrInstr* value) {
+    if (Local* local = resolveLocal(current, name)) {
+        if (local->cell) {
+            emit(IrOp::STORE_CELL, { local->cell, value });
+            return;
+        }
+        // The copy only carries the name into the listing; copyprop removes it.
+        IrInstr* copy = emit(IrOp::COPY, { value });
+        copy->name = symbols().text(name);
+        writeVariable(local->variable, block, copy);
+        return;
+    }
+    int capture = resolveCapture(current, name);
+    if (capture >= 0) {
+        emit(IrOp::STORE_CELL, { current->captures[capture], value });
+        return;
+    }
+    int slot = globals.slotFor(name);
+    if (slot < 0) throw error("Too many global variables.");
+    IrInstr* set = emit(IrOp::SET_GLOBAL, { value });
+    set->index = static_cast<uint32_t>(slot);
+    set->name = globals.names[slot];
+}
+
+IrBuilder::JumpTarget* IrBuilder::innermostTarget(bool loopOnly) {
+    for (size_t i = current->targets.size(); i > 0; --i) {
+        JumpTarget& target = current->targets[i - 1];
+        if (target.isLoop || !loopOnly) return &target;
+    }
+    return nullptr;
+}
+
+IrInstr* IrBuilder::buildFunction(FuncDecl* decl) {
+    FunctionState function{ current, module->newFunction(decl->name.lexeme, static_cast<int>(decl->params.size())) };
+    CapturedNameCollector(function.capturedNames).collect(decl->body->statements);
+    IrBlock* outerBlock = block;
+    current = &function;
+    block = newBlock();
+    sealBlock(block);
+
+    // Parameters and the body's top-level declarations share one scope.
+    beginScope();
+    for (size_t i = 0; i < decl->params.size(); ++i) {
+        line = decl->params[i].line;
+        IrInstr* param = emit(IrOp::PARAM);
+        param->index = static_cast<uint32_t>(i);
+        declareLocal(decl->params[i].symbol, param);
+    }
+    compileStatements(decl->body->statements);
+    emit(IrOp::RETURN, { constant(Value::nil()) });
+
+    function.function->captureCount = static_cast<int>(function.captures.size());
+    current = function.enclosing;
+    block = outerBlock;
+    line = decl->name.line;
+    IrInstr* closure = emit(IrOp::CLOSURE, function.captureSources);
+    closure->function = function.function;
+    return closure;
+}
+
+// --- Declarations ---
+
+void IrBuilder::visitVarDecl(VarDecl* decl) {
+    line = decl->name.line;
+    Symbol name = decl->name.symbol;
+    // The initializer is compiled before the variable exists (as in the Compiler).
+    IrInstr* value = decl->initializer ? compile(decl->initializer) : constant(Value::nil());
+    line = decl->name.line;
+
+    if (current->scopeDepth == 0) {
+        int slot = globals.slotFor(name);
+        if (slot < 0) throw error("Too many global variables.");
+        IrInstr* define = emit(IrOp::DEFINE_GLOBAL, { value });
+        define->index = static_cast<uint32_t>(slot);
+        define->name = globals.names[slot];
+        return;
+    }
+    declareLocal(name, value);
+}
+
+void IrBuilder::visitFuncDecl(FuncDecl* decl) {
+    line = decl->name.line;
+    Symbol name = decl->name.symbol;
+    if (current->scopeDepth == 0) {
+        int slot = globals.slotFor(name);
+        if (slot < 0) throw error("Too many global variables.");
+        IrInstr* define = emit(IrOp::DEFINE_GLOBAL, { buildFunction(decl) });
+        define->index = static_cast<uint32_t>(slot);
+        define->name = globals.names[slot];
+        return;
+    }
+    Local* existing = resolveLocal(current, name);
+    if ((existing && existing->depth == current->scopeDepth) || !current->capturedNames.count(name)) {
+        declareLocal(name, buildFunction(decl));
+        return;
+    }
+    // A function that may call itself: its cell exists before the body is built.
+    IrInstr* cell = emit(IrOp::NEW_CELL, { constant(Value::nil()) });
+    current->locals.push_back({ name, current->scopeDepth, -1, cell });
+    emit(IrOp::STORE_CELL, { cell, buildFunction(decl) });
+}
+
+// --- Statements ---
+
+void IrBuilder::visitBlockStmt(BlockStmt* stmt) {
+    beginScope();
+    compileStatements(stmt->statements);
+    endScope();
+}
+
+void IrBuilder::visitIfStmt(IfStmt* stmt) {
+    IrInstr* condition = compile(stmt->condition);
+    IrBlock* thenBlock = newBlock();
+    IrBlock* elseBlock = stmt->elseBranch ? newBlock() : nullptr;
+    IrBlock* endBlock = newBlock();
+    branch(condition, thenBlock, elseBlock ? elseBlock : endBlock);
+
+    sealBlock(thenBlock);
+    block = thenBlock;
+    compileStatement(stmt->thenBranch);
+    jump(endBlock);
+    if (elseBlock) {
+        sealBlock(elseBlock);
+        block = elseBlock;
+        compileStatement(stmt->elseBranch);
+        jump(endBlock);
+    }
+    sealBlock(endBlock);
+    block = endBlock;
+}
+
+void IrBuilder::visitForStmt(ForStmt* stmt) {
+    // The initializer's variable lives in a scope of its own around the loop.
+    beginScope();
+    compileStatement(stmt->initializer);
+    IrBlock* header = newBlock();
+    jump(header);
+    block = header;
+    IrBlock* exit;
+    if (stmt->condition) {
+        IrInstr* condition = compile(stmt->condition);
+        IrBlock* body = newBlock();
+        exit = newBlock();
+        branch(condition, body, exit);
+        sealBlock(body);
+        block = body;
+    }
+    else {
+        exit = newBlock();
+    }
+    IrBlock* continueBlock = newBlock();
+
+    current->targets.push_back({ true, exit, continueBlock });
+    compileStatement(stmt->body);
+    current->targets.pop_back();
+
+    jump(continueBlock);
+    sealBlock(continueBlock);
+    block = continueBlock;
+    if (stmt->increment) compile(stmt->increment);
+    jump(header);
+    sealBlock(header);
+    sealBlock(exit);
+    block = exit;
+    endScope();
+}
+
+void IrBuilder::visitWhileStmt(WhileStmt* stmt) {
+    IrBlock* header = newBlock();
+    jump(header);
+    block = header;
+    IrInstr* condition = compile(stmt->condition);
+    IrBlock* body = newBlock();
+    IrBlock* exit = newBlock();
+    branch(condition, body, exit);
+    sealBlock(body);
+    block = body;
+
+    current->targets.push_back({ true, exit, header });
+    compileStatement(stmt->body);
+    current->targets.pop_back();
+
+    jump(header);
+    sealBlock(header);
+    sealBlock(exit);
+    block = exit;
+}
+
+void IrBuilder::visitDoWhileStmt(DoWhileStmt* stmt) {
+    IrBlock* body = newBlock();
+    jump(body);
+    block = body;
+    IrBlock* continueBlock = newBlock();
+    IrBlock* exit = newBlock();
+
+    current->targets.push_back({ true, exit, continueBlock });
+    compileStatement(stmt->body);
+    current->targets.pop_back();
+
+    jump(continueBlock);
+    sealBlock(continueBlock);
+    block = continueBlock;
+    IrInstr* condition = compile(stmt->condition);
+    branch(condition, body, exit);
+    sealBlock(body);
+    sealBlock(exit);
+    block = exit;
+}
+
+void IrBuilder::visitSwitchStmt(SwitchStmt* stmt) {
+    // Case values are compared with the subject in order; a match enters its
+    // body and bodies fall through into the next. With no match control goes
+    // to the last 'default', or past the switch.
+    beginScope();
+    IrInstr* subject = compile(stmt->condition);
+    std::vector<IrBlock*> bodies;
+    for (size_t i = 0; i < stmt->cases.size(); ++i) bodies.push_back(newBlock());
+
+    IrBlock* defaultBody = nullptr;
+    for (size_t i = 0; i < stmt->cases.size(); ++i) {
+        if (stmt->cases[i]->value == nullptr) {
+            defaultBody = bodies[i];
+            continue;
+        }
+        IrInstr* value = compile(stmt->cases[i]->value);
+        IrInstr* equal = emit(IrOp::BINARY, { subject, value });
+        equal->token = TokenType::EQUAL_EQUAL;
+        IrBlock* next = newBlock();
+        branch(equal, bodies[i], next);
+        sealBlock(next);
+        block = next;
+    }
+    IrBlock* exit = newBlock();
+    jump(defaultBody ? defaultBody : exit);
+
+    current->targets.push_back({ false, exit, nullptr });
+    for (size_t i = 0; i < stmt->cases.size(); ++i) {
+        if (i > 0) jump(bodies[i]);
+        sealBlock(bodies[i]);
+        block = bodies[i];
+        // Each case body is a scope of its own.
+        beginScope();
+        compileStatements(stmt->cases[i]->body);
+        endScope();
+    }
+    if (!stmt->cases.empty()) jump(exit);
+    current->targets.pop_back();
+
+    sealBlock(exit);
+    block = exit;
+    endScope();
+}
+
+void IrBuilder::visitBreakStmt(BreakStmt*) {
+    JumpTarget* target = innermostTarget(false);
+    if (target == nullptr) throw error("Can't use 'break' outside of a loop or switch.");
+    jump(target->breakBlock);
+    startUnreachableBlock();
+}
+
+void IrBuilder::visitContinueStmt(ContinueStmt*) {
+    JumpTarget* target = innermostTarget(true);
+    if (target == nullptr) throw error("Can't use 'continue' outside of a loop.");
+    jump(target->continueBlock);
+    startUnreachableBlock();
+}
+
+void IrBuilder::visitReturnStmt(ReturnStmt* stmt) {
+    if (current->enclosing == nullptr) throw error("Can't return from top-level code.");
+    IrInstr* value = stmt->value ? compile(stmt->value) : constant(Value::nil());
+    emit(IrOp::RETURN, { value });
+    startUnreachableBlock();
+}
+
+void IrBuilder::visitPrintStmt(PrintStmt* stmt) {
+    emit(IrOp::PRINT, { compile(stmt->expression) });
+}
+
+void IrBuilder::visitExprStmt(ExprStmt* stmt) {
+    // An empty statement (';') has no expression.
+    if (stmt->expression) compile(stmt->expression);
+}
+
+// --- Assignment Targets ---
+
+IrBuilder::Place IrBuilder::compilePlace(Expr* target) {
+    Place place;
+    if (PrimaryExpr* primary = dynamic_cast<PrimaryExpr*>(target)) {
+        if (primary->value.type == TokenType::IDENTIFIER) {
+            place.kind = PlaceKind::Variable;
+            place.name = primary->value.symbol;
+            return place;
+        }
+    }
+    else if (PostfixExpr* postfix = dynamic_cast<PostfixExpr*>(target)) {
+        // Everything but the last tail is evaluated; the last one names the place.
+        place.container = compileChain(postfix, postfix->tails.size() - 1);
+        PostfixTail* last = postfix->tails.back();
+        line = last->op.line;
+        if (last->op.type == TokenType::LEFT_BRACKET) {
+            place.key = compile(last->indexOrCondition);
+            place.kind = PlaceKind::Index;
+            return place;
+        }
+        if (last->op.type == TokenType::DOT) {
+            place.name = static_cast<PrimaryExpr*>(last->indexOrCondition)->value.symbol;
+            place.kind = PlaceKind::Field;
+            return place;
+        }
+    }
+    emit(IrOp::INVALID_TARGET);
+    startUnreachableBlock();
+    return place;
+}
+
+// --- Expressions ---
+
+void IrBuilder::visitAssignmentExpr(AssignmentExpr* expr) {
+    Place place = compilePlace(expr->left);
+    TokenType op = compoundAssignmentOperator(expr->op.type);
+    bool compound = op != TokenType::EQUAL;
+    IrInstr* old = nullptr;
+
+    switch (place.kind) {
+    case PlaceKind::Variable:
+        if (compound) {
+            line = expr->op.line;
+            old = getVariable(place.name);
+        }
+        break;
+    case PlaceKind::Index:
+        line = expr->op.line;
+        if (compound) old = emit(IrOp::GET_INDEX, { place.container, place.key });
+        break;
+    case PlaceKind::Field:
+        line = expr->op.line;
+        if (compound) old = emitField(IrOp::GET_FIELD, { place.container }, place.name);
+        break;
+    default:
+        result = constant(Value::nil()); // Unreachable: the target raised an error
+        return;
+    }
+
+    IrInstr* value = compile(expr->right);
+    line = expr->op.line;
+    if (compound) {
+        value = emit(IrOp::BINARY, { old, value });
+        value->token = op;
+    }
+    if (place.kind == PlaceKind::Variable) {
+        setVariable(place.name, value);
+    }
+    else if (place.kind == PlaceKind::Index) {
+        emit(IrOp::SET_INDEX, { place.container, place.key, value });
+    }
+    else {
+        emitField(IrOp::SET_FIELD, { place.container, value }, place.name);
+    }
+    result = value;
+}
+
+void IrBuilder::visitConditionalExpr(ConditionalExpr* expr) {
+    IrInstr* condition = compile(expr->condition);
+    IrBlock* thenBlock = newBlock();
+    IrBlock* elseBlock = newBlock();
+    IrBlock* endBlock = newBlock();
+    branch(condition, thenBlock, elseBlock);
+
+    sealBlock(thenBlock);
+    block = thenBlock;
+    IrInstr* thenValue = compile(expr->thenExpr);
+    IrBlock* thenEnd = block;
+    jump(endBlock);
+
+    sealBlock(elseBlock);
+    block = elseBlock;
+    IrInstr* elseValue = compile(expr->elseExpr);
+    IrBlock* elseEnd = block;
+    jump(endBlock);
+
+    sealBlock(endBlock);
+    block = endBlock;
+    result = phi(endBlock, { { thenEnd, thenValue }, { elseEnd, elseValue } });
+}
+
+void IrBuilder::visitLogicalExpr(LogicalExpr* expr) {
+    // Short-circuits and yields the deciding operand, not a boolean.
+    IrInstr* left = compile(expr->left);
+    line = expr->op.line;
+    IrBlock* leftEnd = block;
+    IrBlock* rightBlock = newBlock();
+    IrBlock* endBlock = newBlock();
+    if (expr->op.type == TokenType::PIPE_PIPE) branch(left, endBlock, rightBlock);
+    else branch(left, rightBlock, endBlock);
+
+    sealBlock(rightBlock);
+    block = rightBlock;
+    IrInstr* right = compile(expr->right);
+    IrBlock* rightEnd = block;
+    jump(endBlock);
+
+    sealBlock(endBlock);
+    block = endBlock;
+    result = phi(endBlock, { { leftEnd, left }, { rightEnd, right } });
+}
+
+void IrBuilder::visitBinaryExpr(BinaryExpr* expr) {
+    IrInstr* left = compile(expr->left);
+    IrInstr* right = compile(expr->right);
+    line = expr->op.line;
+    result = emit(IrOp::BINARY, { left, right });
+    result->token = expr->op.type;
+}
+
+void IrBuilder::visitUnaryExpr(UnaryExpr* expr) {
+    TokenType op = expr->op.type;
+    if (op != TokenType::PLUS_PLUS && op != TokenType::MINUS_MINUS) {
+        IrInstr* operand = compile(expr->right);
+        line = expr->op.line;
+        result = emit(IrOp::UNARY, { operand });
+        result->token = op;
+        return;
+    }
+
+    // Prefix increment: yields the updated value.
+    line = expr->op.line;
+    Place place = compilePlace(expr->right);
+    line = expr->op.line;
+    IrInstr* old;
+    switch (place.kind) {
+    case PlaceKind::Variable: old = getVariable(place.name); break;
+    case PlaceKind::Index: old = emit(IrOp::GET_INDEX, { place.container, place.key }); break;
+    case PlaceKind::Field: old = emitField(IrOp::GET_FIELD, { place.container }, place.name); break;
+    default:
+        result = constant(Value::nil());
+        return;
+    }
+    IrInstr* updated = emit(IrOp::UNARY, { old });
+    updated->token = op;
+    if (place.kind == PlaceKind::Variable) setVariable(place.name, updated);
+    else if (place.kind == PlaceKind::Index) emit(IrOp::SET_INDEX, { place.container, place.key, updated });
+    else emitField(IrOp::SET_FIELD, { place.container, updated }, place.name);
+    result = updated;
+}
+
+IrInstr* IrBuilder::compileChain(PostfixExpr* expr, size_t count) {
+    size_t i = 0;
+    IrInstr* value;
+    PrimaryExpr* primary = dynamic_cast<PrimaryExpr*>(expr->primary);
+    if (count > 0 && isIncrement(expr->tails[0]) && primary && primary->value.type == TokenType::IDENTIFIER) {
+        // Postfix increment of a variable: yields the value before the update.
+        line = primary->value.line;
+        value = getVariable(primary->value.symbol);
+        line = expr->tails[0]->op.line;
+        IrInstr* updated = emit(IrOp::UNARY, { value });
+        updated->token = expr->tails[0]->op.type;
+        setVariable(primary->value.symbol, updated);
+        i = 1;
+    }
+    else {
+        value = compile(expr->primary);
+    }
+
+    for (; i < count; ++i) {
+        PostfixTail* tail = expr->tails[i];
+        // An element or field followed by ++/-- is updated in place.
+        PostfixTail* increment = i + 1 < count && isIncrement(expr->tails[i + 1]) ? expr->tails[i + 1] : nullptr;
+        switch (tail->op.type) {
+        case TokenType::LEFT_PAREN: {
+            std::vector<IrInstr*> operands{ value };
+            for (Expr* arg : tail->arguments) {
+                operands.push_back(compile(arg));
+            }
+            line = tail->op.line;
+            value = emit(IrOp::CALL, std::move(operands));
+            break;
+        }
+        case TokenType::LEFT_BRACKET: {
+            IrInstr* key = compile(tail->indexOrCondition);
+            if (increment) {
+                line = increment->op.line;
+                IrInstr* old = emit(IrOp::GET_INDEX, { value, key });
+                IrInstr* updated = emit(IrOp::UNARY, { old });
+                updated->token = increment->op.type;
+                emit(IrOp::SET_INDEX, { value, key, updated });
+                value = old;
+                ++i;
+            }
+            else {
+                line = tail->op.line;
+                value = emit(IrOp::GET_INDEX, { value, key });
+            }
+            break;
+        }
+        case TokenType::DOT: {
+            Symbol name = static_cast<PrimaryExpr*>(tail->indexOrCondition)->value.symbol;
+            if (increment) {
+                line = increment->op.line;
+                IrInstr* old = emitField(IrOp::GET_FIELD, { value }, name);
+                IrInstr* updated = emit(IrOp::UNARY, { old });
+                updated->token = increment->op.type;
+                emitField(IrOp::SET_FIELD, { value, updated }, name);
+                value = old;
+                ++i;
+            }
+            else {
+                line = tail->op.line;
+                value = emitField(IrOp::GET_FIELD, { value }, name);
+            }
+            break;
+        }
+        default: {
+            // ++/-- on something that is not a place (a call result, say).
+            line = tail->op.line;
+            IrInstr* updated = emit(IrOp::UNARY, { value });
+            updated->token = TokenType::PLUS_PLUS;
+            emit(IrOp::INVALID_TARGET);
+            startUnreachableBlock();
+            value = constant(Value::nil());
+            break;
+        }
+        }
+    }
+    return value;
+}
+
+void IrBuilder::visitPostfixExpr(PostfixExpr* expr) {
+    result = compileChain(expr, expr->tails.size());
+}
+
+void IrBuilder::visitPrimaryExpr(PrimaryExpr* expr) {
+    const TokenRef& token = expr->value;
+    line = token.line;
+    switch (token.type) {
+    case TokenType::NUMBER: result = constant(Value::number(token.numberValue())); break;
+    case TokenType::STRING: result = stringConstant(token.symbol); break;
+    case TokenType::TRUE: result = constant(Value::boolean(true)); break;
+    case TokenType::FALSE: result = constant(Value::boolean(false)); break;
+    case TokenType::NIL: result = constant(Value::nil()); break;
+    default: result = getVariable(token.symbol); break;
+    }
+}
+
+void IrBuilder::visitGroupingExpr(GroupingExpr* expr) {
+    compile(expr->expression);
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include "ast_visitor.h"
+#include "compiler.h"
+#include "ir.h"
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class Expr;
+class PostfixExpr;
+
+// Lowers a parsed program to SSA form IR (ir.h), following the same scoping
+// and evaluation order as the bytecode Compiler so every engine agrees.
+// SSA construction is Braun et al.'s on-the-fly algorithm: a variable read
+// looks for a definition in the current block and otherwise asks the
+// predecessors, placing PHIs at joins; loop headers stay "unsealed" (their
+// PHIs incomplete) until the back edges are known.
+class IrBuilder : public AstVisitor {
+public:
+    // String constants are allocated on `heap`; globals get slots in `globals`.
+    IrBuilder(Heap& heap, GlobalTable& globals);
+
+    // nullptr after a compile error (reported on std::cerr like a parse error).
+    std::unique_ptr<IrModule> build(const std::vector<Declaration*>& program);
+
+    // --- Visitor Methods ---
+    void visitVarDecl(VarDecl* decl) override;
+    void visitFuncDecl(FuncDecl* decl) override;
+    void visitBlockStmt(BlockStmt* stmt) override;
+    void visitIfStmt(IfStmt* stmt) override;
+    void visitForStmt(ForStmt* stmt) override;
+    void visitWhileStmt(WhileStmt* stmt) override;
+    void visitDoWhileStmt(DoWhileStmt* stmt) override;
+    void visitSwitchStmt(SwitchStmt* stmt) override;
+    void visitBreakStmt(BreakStmt* stmt) override;
+    void visitContinueStmt(ContinueStmt* stmt) override;
+    void visitReturnStmt(ReturnStmt* stmt) override;
+    void visitPrintStmt(PrintStmt* stmt) override;
+    void visitExprStmt(ExprStmt* stmt) override;
+    void visitAssignmentExpr(AssignmentExpr* expr) override;
+    void visitConditionalExpr(ConditionalExpr* expr) override;
+    void visitLogicalExpr(LogicalExpr* expr) override;
+    void visitBinaryExpr(BinaryExpr* expr) override;
+    void visitUnaryExpr(UnaryExpr* expr) override;
+    void visitPostfixExpr(PostfixExpr* expr) override;
+    void visitPrimaryExpr(PrimaryExpr* expr) override;
+    void visitGroupingExpr(GroupingExpr* expr) override;
+
+private:
+    class CompileError {}; // Unwinds to build() after the error is reported
+
+    struct Local {
+        Symbol name;
+        int depth;
+        int variable;   // SSA variable number, or -1 for a cell
+        IrInstr* cell;  // NEW_CELL holding a captured local
+    };
+
+    // A loop or switch that break (and, for loops, continue) can leave.
+    struct JumpTarget {
+        bool isLoop;
+        IrBlock* breakBlock;
+        IrBlock* continueBlock;
+    };
+
+    // Braun et al.'s per-block state.
+    struct BlockState {
+        std::unordered_map<int, IrInstr*> definitions; // Current value of each variable
+        std::vector<std::pair<int, IrInstr*>> incompletePhis;
+        bool sealed = false;
+    };
+
+    struct FunctionState {
+        FunctionState(FunctionState* enclosing, IrFunction* function) : enclosing(enclosing), function(function) {}
+
+        FunctionState* enclosing;
+        IrFunction* function;
+        std::vector<Local> locals;
+        std::vector<IrInstr*> captures;        // CAPTURE instructions, by cell index
+        std::vector<IrInstr*> captureSources;  // Enclosing cell each capture refers to
+        std::vector<JumpTarget> targets;
+        std::vector<BlockState> blocks;        // By block id
+        // Names used inside nested functions: locals with these names are
+        // kept in cells so closures can share them.
+        std::unordered_set<Symbol> capturedNames;
+        int scopeDepth = 0;
+        int variables = 0;
+    };
+
+    Heap& heap;
+    GlobalTable& globals;
+    IrModule* module = nullptr;
+    FunctionState* current = nullptr;
+    IrBlock* block = nullptr; // Where new instructions go
+    IrInstr* result = nullptr; // Value of the expression just compiled
+    int line = 1;
+    std::unordered_map<Symbol, Value> strings; // One ObjString per literal text
+
+    // --- Emission ---
+    IrInstr* emit(IrOp op, std::vector<IrInstr*> operands = {});
+    IrInstr* constant(Value value);
+    IrInstr* stringConstant(Symbol chars);
+    // GET_FIELD or SET_FIELD of the field `name`.
+    IrInstr* emitField(IrOp op, std::vector<IrInstr*> operands, Symbol name);
+    IrBlock* newBlock();
+    void addEdge(IrBlock* from, IrBlock* to);
+    void jump(IrBlock* target);
+    void branch(IrInstr* condition, IrBlock* ifTrue, IrBlock* ifFalse);
+    // Continues in a fresh block nothing jumps to (after return, break, ...).
+    void startUnreachableBlock();
+    IrInstr* phi(IrBlock* join, const std::vector<std::pair<IrBlock*, IrInstr*>>& incoming);
+    CompileError error(const std::string& message);
+
+    // --- SSA Construction ---
+    void writeVariable(int variable, IrBlock* target, IrInstr* value);
+    IrInstr* readVariable(int variable, IrBlock* source);
+    IrInstr* readVariableRecursive(int variable, IrBlock* source);
+    void addPhiOperands(int variable, IrInstr* phi);
+    void sealBlock(IrBlock* target);
+
+    // --- Scopes and Variables ---
+    IrInstr* buildFunction(FuncDecl* decl); // Returns the CLOSURE
+    void compileStatement(Declaration* decl);
+    void compileStatements(const std::vector<Declaration*>& statements);
+    IrInstr* compile(Expr* expr);
+    void beginScope();
+    void endScope();
+    // Declares `name` in the current scope (assigns it if the scope already
+    // has it) with `value`.
+    void declareLocal(Symbol name, IrInstr* value);
+    Local* resolveLocal(FunctionState* state, Symbol name);
+    int resolveCapture(FunctionState* state, Symbol name);
+    IrInstr* getVariable(Symbol name);
+    void setVariable(Symbol name, IrInstr* value);
+    JumpTarget* innermostTarget(bool loopOnly);
+
+    // --- Assignment Targets ---
+    enum class PlaceKind { None, Variable, Index, Field };
+    struct Place {
+        PlaceKind kind = PlaceKind::None;
+        Symbol name = noSymbol; // Variable or field name
+        IrInstr* container = nullptr;
+        IrInstr* key = nullptr;
+    };
+    // Compiles the parts of an assignment target evaluated before the value
+    // (see Compiler::compilePlace).
+    Place compilePlace(Expr* target);
+    IrInstr* compileChain(PostfixExpr* expr, size_t count);
+};
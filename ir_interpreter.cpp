@@ -0,0 +1,245 @@
+#include "ir_interpreter.h"
+#include "ir_builder.h"
+#include "natives.h"
+#include "operators.h"
+#include <algorithm>
+
+namespace {
+
+std::string argumentCountMessage(int expected, int got) {
+    return "Expected " + std::to_string(expected) + " arguments but got " + std::to_string(got) + ".";
+}
+
+} // namespace
+
+// Gives back the registers allocated while it lives, however the frame (or
+// call) that made it is left.
+class IrInterpreter::RegisterWindow {
+public:
+    explicit RegisterWindow(IrInterpreter& interpreter)
+        : interpreter(interpreter), segment(interpreter.segment), top(interpreter.top) {
+    }
+    ~RegisterWindow() {
+        if (interpreter.segment != segment) {
+            const RegisterSegment& back = interpreter.segments[segment];
+            interpreter.segment = segment;
+            interpreter.limit = back.values.get() + back.size;
+        }
+        interpreter.top = top;
+    }
+
+private:
+    IrInterpreter& interpreter;
+    size_t segment;
+    Value* top;
+};
+
+IrInterpreter::IrInterpreter(std::ostream& output, size_t nurseryBytes)
+    : output(output),
+    heap(nurseryBytes) {
+    segments.push_back({ std::unique_ptr<Value[]>(new Value[segmentSlots]), segmentSlots, 0 });
+    for (const NativeEntry& native : builtinNatives()) {
+        int slot = globals.slotFor(native.name);
+        globals.values[slot] = Value::object(heap.makeNative(native.name, native.function, native.arity));
+        globals.defined[slot] = 1;
+    }
+    heap.setRoots([this] { traceRoots(); });
+}
+
+std::unique_ptr<IrModule> IrInterpreter::build(const std::vector<Declaration*>& program) {
+    Heap::PermanentScope permanent(heap);
+    IrBuilder builder(heap, globals);
+    return builder.build(program);
+}
+
+bool IrInterpreter::run(IrModule& module) {
+    segment = 0;
+    top = segments[0].values.get();
+    limit = top + segments[0].size;
+    depth = 0;
+    try {
+        execute(*module.script(), nullptr, nullptr);
+    }
+    catch (const RuntimeError& error) {
+        std::cerr << "[Line " << error.line << "] Runtime error: " << error.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The frames' registers (closures, arguments and values alike) and the
+// globals. Constants in the IR are permanent.
+void IrInterpreter::traceRoots() {
+    for (size_t s = 0; s < segment; ++s) {
+        for (size_t i = 0; i < segments[s].used; ++i) heap.traceRoot(segments[s].values[i]);
+    }
+    for (Value* value = segments[segment].values.get(); value < top; ++value) heap.traceRoot(*value);
+    for (Value& value : globals.values) heap.traceRoot(value);
+}
+
+// `count` registers in a row: the next ones in the current segment, or the
+// start of the next segment if they do not fit.
+Value* IrInterpreter::allocateRegisters(size_t count) {
+    if (static_cast<size_t>(limit - top) < count) enterNextSegment(count);
+    Value* block = top;
+    top += count;
+    return block;
+}
+
+void IrInterpreter::enterNextSegment(size_t count) {
+    segments[segment].used = static_cast<size_t>(top - segments[segment].values.get());
+    ++segment;
+    if (segment == segments.size() || segments[segment].size < count) {
+        size_t size = std::max(segmentSlots, count);
+        RegisterSegment fresh{ std::unique_ptr<Value[]>(new Value[size]), size, 0 };
+        if (segment == segments.size()) segments.push_back(std::move(fresh));
+        else segments[segment] = std::move(fresh);
+    }
+    top = segments[segment].values.get();
+    limit = top + segments[segment].size;
+}
+
+Value IrInterpreter::call(Value callee, const Value* args, int argCount) {
+    if (callee.isObjType(ObjType::IrClosure)) {
+        ObjIrClosure* closure = asIrClosure(callee);
+        const IrFunction& function = *closure->function;
+        if (argCount != function.arity) throw RuntimeError(argumentCountMessage(function.arity, argCount));
+        if (depth == maxDepth) throw RuntimeError("Stack overflow.");
+        ++depth;
+        try {
+            Value value = execute(function, closure, args);
+            --depth;
+            return value;
+        }
+        catch (...) {
+            --depth;
+            throw;
+        }
+    }
+    if (callee.isObjType(ObjType::Native)) {
+        ObjNative* native = asNative(callee);
+        if (native->arity >= 0 && argCount != native->arity) {
+            throw RuntimeError(argumentCountMessage(native->arity, argCount));
+        }
+        return native->function(heap, args, argCount);
+    }
+    throw RuntimeError("Can only call functions.");
+}
+
+Value IrInterpreter::execute(const IrFunction& function, ObjIrClosure* closure, const Value* args) {
+    RegisterWindow window(*this);
+    Value* values = allocateRegisters(function.values.size() + 1) + 1;
+    // Registers not written yet must not hold what an earlier frame left,
+    // which a collection may have freed since.
+    std::fill(values, values + function.values.size(), Value::nil());
+    values[-1] = closure != nullptr ? Value::object(closure) : Value::nil();
+
+#define OPERAND(i) values[instr->operands[i]->id]
+
+    const IrBlock* block = function.entry();
+    const IrBlock* from = nullptr;
+    const IrInstr* instr = nullptr;
+    std::vector<Value> phiValues;
+    try {
+        for (;;) {
+            // Entering a block is a safepoint: every value is in a register.
+            heap.safepoint();
+            const std::vector<IrInstr*>& instrs = block->instrs;
+            size_t i = 0;
+            if (from != nullptr) {
+                // PHIs read their operands for the edge just taken, all at once.
+                size_t pred = block->predIndex(from);
+                size_t phis = block->phiCount();
+                phiValues.resize(phis);
+                for (size_t k = 0; k < phis; ++k) phiValues[k] = values[instrs[k]->operands[pred]->id];
+                for (size_t k = 0; k < phis; ++k) values[instrs[k]->id] = phiValues[k];
+                i = phis;
+            }
+
+            for (bool jumped = false; !jumped;) {
+                instr = instrs[i++];
+                Value* out = &values[instr->id];
+                switch (instr->op) {
+                case IrOp::CONST: *out = instr->constant; break;
+                case IrOp::PARAM: *out = args[instr->index]; break;
+                case IrOp::PHI: break;
+                case IrOp::COPY: *out = OPERAND(0); break;
+                case IrOp::UNARY:
+                    if (instr->token == TokenType::PLUS_PLUS || instr->token == TokenType::MINUS_MINUS) {
+                        *out = applyIncrement(instr->token, OPERAND(0));
+                    }
+                    else {
+                        *out = applyUnary(instr->token, OPERAND(0));
+                    }
+                    break;
+                case IrOp::BINARY: *out = applyBinary(heap, instr->token, OPERAND(0), OPERAND(1)); break;
+
+                case IrOp::GET_GLOBAL:
+                case IrOp::SET_GLOBAL:
+                    if (!globals.defined[instr->index]) {
+                        throw RuntimeError("Undefined variable '" + std::string(globals.names[instr->index]) + "'.");
+                    }
+                    if (instr->op == IrOp::GET_GLOBAL) *out = globals.values[instr->index];
+                    else globals.values[instr->index] = OPERAND(0);
+                    break;
+                case IrOp::DEFINE_GLOBAL:
+                    globals.values[instr->index] = OPERAND(0);
+                    globals.defined[instr->index] = 1;
+                    break;
+
+                case IrOp::NEW_CELL: *out = Value::object(heap.makeCell(OPERAND(0))); break;
+                case IrOp::LOAD_CELL: *out = *static_cast<ObjUpvalue*>(OPERAND(0).asObject())->location; break;
+                case IrOp::STORE_CELL: {
+                    ObjUpvalue* cell = static_cast<ObjUpvalue*>(OPERAND(0).asObject());
+                    *cell->location = OPERAND(1);
+                    heap.writeBarrier(cell, OPERAND(1));
+                    break;
+                }
+                case IrOp::CAPTURE: *out = Value::object(asIrClosure(values[-1])->cells[instr->index]); break;
+                case IrOp::CLOSURE: {
+                    ObjIrClosure* created = heap.makeIrClosure(instr->function);
+                    for (size_t k = 0; k < instr->operands.size(); ++k) {
+                        created->cells.push_back(static_cast<ObjUpvalue*>(OPERAND(k).asObject()));
+                    }
+                    *out = Value::object(created);
+                    break;
+                }
+                case IrOp::CALL: {
+                    // Arguments go just above this frame's registers.
+                    RegisterWindow arguments(*this);
+                    int argCount = static_cast<int>(instr->operands.size()) - 1;
+                    Value* callArgs = allocateRegisters(static_cast<size_t>(argCount));
+                    for (int k = 0; k < argCount; ++k) callArgs[k] = OPERAND(k + 1);
+                    *out = call(OPERAND(0), callArgs, argCount);
+                    break;
+                }
+
+                case IrOp::GET_INDEX: *out = getIndex(heap, OPERAND(0), OPERAND(1)); break;
+                case IrOp::SET_INDEX: setIndex(heap, OPERAND(0), OPERAND(1), OPERAND(2)); break;
+                case IrOp::GET_FIELD: *out = getField(OPERAND(0), instr->index, *instr->cache); break;
+                case IrOp::SET_FIELD: setField(heap, OPERAND(0), instr->index, OPERAND(1), *instr->cache); break;
+                case IrOp::PRINT: output << valueToString(OPERAND(0)) << '\n'; break;
+
+                case IrOp::JUMP:
+                    from = block;
+                    block = instr->targets[0];
+                    jumped = true;
+                    break;
+                case IrOp::BRANCH:
+                    from = block;
+                    block = instr->targets[OPERAND(0).isTruthy() ? 0 : 1];
+                    jumped = true;
+                    break;
+                case IrOp::RETURN: return OPERAND(0);
+                case IrOp::INVALID_TARGET: throw RuntimeError("Invalid assignment target.");
+                }
+            }
+        }
+    }
+    catch (RuntimeError& error) {
+        if (error.line == 0 && instr != nullptr) error.line = instr->line;
+        throw;
+    }
+
+#undef OPERAND
+}
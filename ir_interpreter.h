@@ -0,0 +1,62 @@
+#pragma once
+#include "compiler.h"
+#include "ir.h"
+#include "object.h"
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+class Declaration;
+
+// Runs programs lowered to IR (ir.h), optimized or not. It exists so the
+// optimization passes can be checked against the other engines: each
+// instruction is interpreted directly, with one register per value number.
+class IrInterpreter {
+public:
+    // `print` writes to `output`; errors are reported on std::cerr.
+    explicit IrInterpreter(std::ostream& output, size_t nurseryBytes = Heap::defaultNurseryBytes);
+
+    IrInterpreter(const IrInterpreter&) = delete;
+    IrInterpreter& operator=(const IrInterpreter&) = delete;
+
+    // Builds the IR for `program` (nullptr after a compile error). Run the
+    // passes on it, then run() it. Globals persist across calls.
+    std::unique_ptr<IrModule> build(const std::vector<Declaration*>& program);
+    // Returns false if a runtime error stopped the program.
+    bool run(IrModule& module);
+
+    const Heap::Stats& heapStats() const { return heap.stats(); }
+
+private:
+    static constexpr int maxDepth = 1000;            // Nested calls, as in the VM
+    static constexpr size_t segmentSlots = 1 << 18; // Unless a frame needs more
+
+    // A block of registers. `used` counts those in use, from the start, once
+    // a frame has moved on to the next segment.
+    struct RegisterSegment {
+        std::unique_ptr<Value[]> values;
+        size_t size;
+        size_t used;
+    };
+    class RegisterWindow;
+
+    std::ostream& output;
+    Heap heap;
+    GlobalTable globals;
+    // Frames are windows of these segments, each starting with its closure
+    // (nil for the script) so that a collection can find and move it. A
+    // window that does not fit in the current segment starts the next one:
+    // registers never move, and only maxDepth limits recursion.
+    std::vector<RegisterSegment> segments;
+    size_t segment = 0;     // The innermost frame's
+    Value* top = nullptr;   // Its first free register
+    Value* limit = nullptr; // And the end of its segment
+    int depth = 0;
+
+    Value* allocateRegisters(size_t count);
+    void enterNextSegment(size_t count);
+    void traceRoots();
+    Value execute(const IrFunction& function, ObjIrClosure* closure, const Value* args);
+    Value call(Value callee, const Value* args, int argCount);
+};
@@ -0,0 +1,707 @@
+#include "ir_passes.h"
+#include "object.h"
+#include "operators.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// --- Shared Helpers ---
+
+// Instructions being replaced, by id: forward[id] is the value their uses
+// should name instead (nullptr for instructions that stay).
+using Forwarding = std::vector<IrInstr*>;
+
+IrInstr* resolve(Forwarding& forward, IrInstr* value) {
+    IrInstr* target = value;
+    while (forward[target->id] != nullptr) target = forward[target->id];
+    // Shorten the chain for the next lookup.
+    while (forward[value->id] != nullptr && forward[value->id] != target) {
+        IrInstr* next = forward[value->id];
+        forward[value->id] = target;
+        value = next;
+    }
+    return target;
+}
+
+// Points every use at its replacement and unlinks the replaced instructions.
+void applyForwarding(IrFunction& function, Forwarding& forward) {
+    for (auto& block : function.blocks) {
+        std::vector<IrInstr*>& instrs = block->instrs;
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+            [&](const IrInstr* instr) { return forward[instr->id] != nullptr; }), instrs.end());
+        for (IrInstr* instr : instrs) {
+            for (IrInstr*& operand : instr->operands) operand = resolve(forward, operand);
+        }
+    }
+}
+
+// The one value a PHI's operands name, ignoring the PHI itself, or nullptr.
+IrInstr* trivialPhiValue(Forwarding& forward, IrInstr* phi) {
+    IrInstr* unique = nullptr;
+    for (IrInstr* operand : phi->operands) {
+        IrInstr* value = resolve(forward, operand);
+        if (value == phi || value == unique) continue;
+        if (unique != nullptr) return nullptr;
+        unique = value;
+    }
+    return unique;
+}
+
+// Forwards trivial PHIs until none is left (removing one can make another
+// trivial). Returns whether any was found.
+bool forwardTrivialPhis(IrFunction& function, Forwarding& forward) {
+    bool found = false;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto& block : function.blocks) {
+            for (size_t i = 0, phis = block->phiCount(); i < phis; ++i) {
+                IrInstr* phi = block->instrs[i];
+                if (forward[phi->id] != nullptr) continue;
+                if (IrInstr* value = trivialPhiValue(forward, phi)) {
+                    forward[phi->id] = value;
+                    changed = found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+bool isIncrement(TokenType op) {
+    return op == TokenType::PLUS_PLUS || op == TokenType::MINUS_MINUS;
+}
+
+// Computes a UNARY or BINARY instruction from constant operands. False if
+// the operation fails: the error must still happen at run time.
+bool evaluate(Heap& heap, const IrInstr* instr, const Value* operands, Value& out) {
+    try {
+        if (instr->op == IrOp::BINARY) out = applyBinary(heap, instr->token, operands[0], operands[1]);
+        else if (isIncrement(instr->token)) out = applyIncrement(instr->token, operands[0]);
+        else out = applyUnary(instr->token, operands[0]);
+        return true;
+    }
+    catch (const RuntimeError&) {
+        return false;
+    }
+}
+
+void makeConstant(IrInstr* instr, Value value) {
+    instr->op = IrOp::CONST;
+    instr->token = TokenType::END_OF_FILE;
+    instr->operands.clear();
+    instr->constant = value;
+}
+
+// Replaces the BRANCH ending `block` by a JUMP to its target number `taken`.
+void takeBranch(IrBlock* block, size_t taken) {
+    IrInstr* branch = block->terminator();
+    removePredecessor(branch->targets[1 - taken], block);
+    branch->op = IrOp::JUMP;
+    branch->operands.clear();
+    branch->targets[0] = branch->targets[taken];
+    branch->targets[1] = nullptr;
+}
+
+// --- copyprop ---
+
+bool runCopyPropagation(IrModule&, IrFunction& function) {
+    Forwarding forward(function.values.size(), nullptr);
+    bool changed = false;
+    for (auto& block : function.blocks) {
+        for (IrInstr* instr : block->instrs) {
+            if (instr->op == IrOp::COPY) {
+                forward[instr->id] = instr->operands[0];
+                changed = true;
+            }
+        }
+    }
+    changed |= forwardTrivialPhis(function, forward);
+    if (changed) applyForwarding(function, forward);
+    return changed;
+}
+
+// --- fold ---
+
+bool runConstantFolding(IrModule& module, IrFunction& function) {
+    bool changed = false;
+    // Reverse postorder, so a folded result is seen by the instructions using it.
+    DominatorTree dominators(function);
+    for (IrBlock* block : dominators.reversePostorder()) {
+        for (IrInstr* instr : block->instrs) {
+            if (instr->op == IrOp::UNARY || instr->op == IrOp::BINARY) {
+                Value operands[2];
+                bool constant = true;
+                for (size_t k = 0; k < instr->operands.size(); ++k) {
+                    constant &= instr->operands[k]->op == IrOp::CONST;
+                    operands[k] = instr->operands[k]->constant;
+                }
+                Value value;
+                if (constant && evaluate(module.heap, instr, operands, value)) {
+                    makeConstant(instr, value);
+                    changed = true;
+                }
+            }
+            else if (instr->op == IrOp::BRANCH && instr->operands[0]->op == IrOp::CONST) {
+                takeBranch(block, instr->operands[0]->constant.isTruthy() ? 0 : 1);
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+// --- constprop ---
+
+// Sparse conditional constant propagation. Every value starts Unknown (no
+// path computing it has run yet) and only moves down to Constant and then
+// Varying; blocks are only evaluated once an edge into them is known to be
+// taken, so a branch on a constant keeps the other side's values out.
+class ConstantPropagation {
+public:
+    ConstantPropagation(Heap& heap, IrFunction& function)
+        : heap(heap), function(function), cells(function.values.size()), users(function.values.size()),
+        executableEdges(function.blockIds), executableBlocks(function.blockIds, 0) {
+        for (auto& block : function.blocks) {
+            executableEdges[block->id].assign(block->preds.size(), 0);
+            for (IrInstr* instr : block->instrs) {
+                for (IrInstr* operand : instr->operands) users[operand->id].push_back(instr);
+            }
+        }
+    }
+
+    bool run() {
+        IrBlock* entry = function.entry();
+        executableBlocks[entry->id] = 1;
+        for (IrInstr* instr : entry->instrs) visit(instr);
+        while (!edgeWork.empty() || !valueWork.empty()) {
+            if (!edgeWork.empty()) {
+                auto [block, index] = edgeWork.back();
+                edgeWork.pop_back();
+                if (!executableBlocks[block->id]) {
+                    executableBlocks[block->id] = 1;
+                    for (IrInstr* instr : block->instrs) visit(instr);
+                }
+                else {
+                    for (size_t i = 0, phis = block->phiCount(); i < phis; ++i) visit(block->instrs[i]);
+                }
+                continue;
+            }
+            IrInstr* instr = valueWork.back();
+            valueWork.pop_back();
+            if (executableBlocks[instr->block->id]) visit(instr);
+        }
+        return rewrite();
+    }
+
+private:
+    enum class Level : uint8_t { Unknown, Constant, Varying };
+    struct Cell {
+        Level level = Level::Unknown;
+        Value value;
+    };
+
+    Heap& heap;
+    IrFunction& function;
+    std::vector<Cell> cells;                       // By value id
+    std::vector<std::vector<IrInstr*>> users;      // By value id
+    std::vector<std::vector<char>> executableEdges; // By block id, then predecessor index
+    std::vector<char> executableBlocks;            // By block id
+    std::vector<std::pair<IrBlock*, size_t>> edgeWork;
+    std::vector<IrInstr*> valueWork;
+
+    static Cell meet(const Cell& a, const Cell& b) {
+        if (a.level == Level::Unknown) return b;
+        if (b.level == Level::Unknown) return a;
+        if (a.level == Level::Constant && b.level == Level::Constant && sameConstant(a.value, b.value)) return a;
+        return { Level::Varying, Value() };
+    }
+
+    void lower(IrInstr* instr, const Cell& cell) {
+        Cell& current = cells[instr->id];
+        Cell next = meet(current, cell);
+        if (next.level == current.level) return;
+        current = next;
+        for (IrInstr* user : users[instr->id]) valueWork.push_back(user);
+    }
+
+    void markEdge(IrBlock* from, IrBlock* to) {
+        size_t index = to->predIndex(from);
+        if (executableEdges[to->id][index]) return;
+        executableEdges[to->id][index] = 1;
+        edgeWork.push_back({ to, index });
+    }
+
+    void visit(IrInstr* instr) {
+        switch (instr->op) {
+        case IrOp::CONST: lower(instr, { Level::Constant, instr->constant }); break;
+        case IrOp::COPY: lower(instr, cells[instr->operands[0]->id]); break;
+        case IrOp::PHI: {
+            Cell cell;
+            const std::vector<char>& edges = executableEdges[instr->block->id];
+            for (size_t k = 0; k < instr->operands.size(); ++k) {
+                if (edges[k]) cell = meet(cell, cells[instr->operands[k]->id]);
+            }
+            lower(instr, cell);
+            break;
+        }
+        case IrOp::UNARY:
+        case IrOp::BINARY: {
+            Value operands[2];
+            bool unknown = false;
+            for (size_t k = 0; k < instr->operands.size(); ++k) {
+                const Cell& operand = cells[instr->operands[k]->id];
+                if (operand.level == Level::Varying) {
+                    lower(instr, { Level::Varying, Value() });
+                    return;
+                }
+                unknown |= operand.level == Level::Unknown;
+                operands[k] = operand.value;
+            }
+            if (unknown) break;
+            Value value;
+            if (evaluate(heap, instr, operands, value)) lower(instr, { Level::Constant, value });
+            else lower(instr, { Level::Varying, Value() });
+            break;
+        }
+        case IrOp::JUMP: markEdge(instr->block, instr->targets[0]); break;
+        case IrOp::BRANCH: {
+            const Cell& condition = cells[instr->operands[0]->id];
+            if (condition.level == Level::Unknown) break;
+            if (condition.level == Level::Varying || condition.value.isTruthy()) markEdge(instr->block, instr->targets[0]);
+            if (condition.level == Level::Varying || !condition.value.isTruthy()) markEdge(instr->block, instr->targets[1]);
+            break;
+        }
+        default:
+            if (irOpHasResult(instr->op)) lower(instr, { Level::Varying, Value() });
+            break;
+        }
+    }
+
+    // Turns every value found constant into a CONST, and branches on them
+    // into jumps. Blocks that never became executable are left for dce.
+    bool rewrite() {
+        bool changed = false;
+        for (auto& owned : function.blocks) {
+            IrBlock* block = owned.get();
+            if (!executableBlocks[block->id]) continue;
+            bool phisConverted = false;
+            for (IrInstr* instr : block->instrs) {
+                const Cell& cell = cells[instr->id];
+                if (instr->op != IrOp::CONST && irOpHasResult(instr->op) && cell.level == Level::Constant) {
+                    phisConverted |= instr->op == IrOp::PHI;
+                    makeConstant(instr, cell.value);
+                    changed = true;
+                }
+            }
+            // The CONSTs that were PHIs go after the remaining PHIs.
+            if (phisConverted) {
+                std::stable_partition(block->instrs.begin(), block->instrs.end(),
+                    [](const IrInstr* instr) { return instr->op == IrOp::PHI; });
+            }
+            IrInstr* last = block->terminator();
+            if (last->op == IrOp::BRANCH && cells[last->operands[0]->id].level == Level::Constant) {
+                takeBranch(block, cells[last->operands[0]->id].value.isTruthy() ? 0 : 1);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+};
+
+bool runConstantPropagation(IrModule& module, IrFunction& function) {
+    return ConstantPropagation(module.heap, function).run();
+}
+
+// --- dce ---
+
+bool removeUnreachableBlocks(IrFunction& function) {
+    DominatorTree dominators(function);
+    bool removed = false;
+    for (auto& block : function.blocks) {
+        if (dominators.reachable(block.get())) continue;
+        for (size_t s = 0; s < block->successorCount(); ++s) removePredecessor(block->successor(s), block.get());
+        block->instrs.clear();
+        removed = true;
+    }
+    if (removed) {
+        function.blocks.erase(std::remove_if(function.blocks.begin(), function.blocks.end(),
+            [](const std::unique_ptr<IrBlock>& block) { return block->instrs.empty(); }), function.blocks.end());
+    }
+    return removed;
+}
+
+bool isArithmetic(TokenType op) {
+    switch (op) {
+    case TokenType::MINUS:
+    case TokenType::STAR:
+    case TokenType::SLASH:
+    case TokenType::PERCENT:
+    case TokenType::AMP:
+    case TokenType::PIPE:
+    case TokenType::CARET:
+    case TokenType::SHIFT_LEFT:
+    case TokenType::SHIFT_RIGHT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Which values are numbers whenever they are computed, by id. Optimistic
+// about PHIs (so loop counters qualify) and lowered until nothing changes.
+std::vector<char> numericValues(const IrFunction& function) {
+    std::vector<char> numeric(function.values.size(), 1);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const auto& block : function.blocks) {
+            for (const IrInstr* instr : block->instrs) {
+                auto operand = [&](size_t k) { return numeric[instr->operands[k]->id] != 0; };
+                bool number;
+                switch (instr->op) {
+                case IrOp::CONST: number = instr->constant.isNumber(); break;
+                case IrOp::COPY: number = operand(0); break;
+                case IrOp::PHI:
+                    number = true;
+                    for (size_t k = 0; k < instr->operands.size(); ++k) number &= operand(k);
+                    break;
+                case IrOp::UNARY: number = instr->token != TokenType::BANG; break;
+                case IrOp::BINARY:
+                    number = isArithmetic(instr->token) || (instr->token == TokenType::PLUS && operand(0) && operand(1));
+                    break;
+                default: number = false; break;
+                }
+                if (!number && numeric[instr->id]) {
+                    numeric[instr->id] = 0;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return numeric;
+}
+
+// Whether removing `instr` (if its result is unused) could change what the
+// program does: it has an effect, or it may raise a runtime error.
+bool mustKeep(const IrInstr* instr, const std::vector<char>& numeric) {
+    auto operand = [&](size_t k) { return numeric[instr->operands[k]->id] != 0; };
+    switch (instr->op) {
+    case IrOp::CONST:
+    case IrOp::PARAM:
+    case IrOp::PHI:
+    case IrOp::COPY:
+    case IrOp::NEW_CELL:
+    case IrOp::LOAD_CELL:
+    case IrOp::CAPTURE:
+    case IrOp::CLOSURE:
+        return false;
+    case IrOp::UNARY:
+        return instr->token != TokenType::BANG && !operand(0);
+    case IrOp::BINARY:
+        if (instr->token == TokenType::EQUAL_EQUAL || instr->token == TokenType::BANG_EQUAL) return false;
+        return !(operand(0) && operand(1));
+    default:
+        return true;
+    }
+}
+
+bool removeDeadInstructions(IrFunction& function) {
+    std::vector<char> numeric = numericValues(function);
+    std::vector<char> live(function.values.size(), 0);
+    std::vector<IrInstr*> work;
+    for (auto& block : function.blocks) {
+        for (IrInstr* instr : block->instrs) {
+            if (mustKeep(instr, numeric)) {
+                live[instr->id] = 1;
+                work.push_back(instr);
+            }
+        }
+    }
+    while (!work.empty()) {
+        IrInstr* instr = work.back();
+        work.pop_back();
+        for (IrInstr* operand : instr->operands) {
+            if (!live[operand->id]) {
+                live[operand->id] = 1;
+                work.push_back(operand);
+            }
+        }
+    }
+    bool removed = false;
+    for (auto& block : function.blocks) {
+        std::vector<IrInstr*>& instrs = block->instrs;
+        size_t before = instrs.size();
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+            [&](const IrInstr* instr) { return !live[instr->id]; }), instrs.end());
+        removed |= instrs.size() != before;
+    }
+    return removed;
+}
+
+// Skips blocks that only jump on (to a block without PHIs), then appends
+// each block to the one before it when that is its only predecessor.
+bool mergeBlocks(IrFunction& function) {
+    IrBlock* entry = function.entry();
+    bool changed = false;
+    for (auto& owned : function.blocks) {
+        IrBlock* empty = owned.get();
+        if (empty == entry || empty->instrs.size() != 1 || empty->terminator()->op != IrOp::JUMP) continue;
+        IrBlock* target = empty->successor(0);
+        if (target == empty || target->phiCount() != 0) continue;
+        std::vector<IrBlock*> preds = empty->preds;
+        for (IrBlock* pred : preds) {
+            IrInstr* last = pred->terminator();
+            // Would give `pred` two edges to `target`.
+            if (last->op == IrOp::BRANCH && (last->targets[0] == target || last->targets[1] == target)) continue;
+            for (size_t s = 0; s < pred->successorCount(); ++s) {
+                if (last->targets[s] != empty) continue;
+                last->targets[s] = target;
+                removePredecessor(empty, pred);
+                target->preds.push_back(pred);
+            }
+            changed = true;
+        }
+        if (empty->preds.empty()) {
+            removePredecessor(target, empty);
+            empty->instrs.clear();
+        }
+    }
+
+    for (size_t i = 0; i < function.blocks.size();) {
+        IrBlock* block = function.blocks[i].get();
+        IrInstr* last = block->terminator();
+        IrBlock* next = last != nullptr && last->op == IrOp::JUMP ? last->targets[0] : nullptr;
+        if (next == nullptr || next == block || next == entry || next->preds.size() != 1 || next->phiCount() != 0) {
+            ++i;
+            continue;
+        }
+        block->instrs.pop_back();
+        for (IrInstr* instr : next->instrs) {
+            instr->block = block;
+            block->instrs.push_back(instr);
+        }
+        next->instrs.clear();
+        next->preds.clear();
+        for (size_t s = 0; s < block->successorCount(); ++s) {
+            std::vector<IrBlock*>& preds = block->successor(s)->preds;
+            std::replace(preds.begin(), preds.end(), next, block);
+        }
+        changed = true; // Look at `block` again: it may end in another JUMP
+    }
+
+    function.blocks.erase(std::remove_if(function.blocks.begin(), function.blocks.end(),
+        [](const std::unique_ptr<IrBlock>& block) { return block->instrs.empty(); }), function.blocks.end());
+    return changed;
+}
+
+bool runDeadCodeElimination(IrModule&, IrFunction& function) {
+    bool changed = removeUnreachableBlocks(function);
+    // Removed edges leave PHIs with a single operand.
+    Forwarding forward(function.values.size(), nullptr);
+    if (forwardTrivialPhis(function, forward)) {
+        applyForwarding(function, forward);
+        changed = true;
+    }
+    changed |= removeDeadInstructions(function);
+    changed |= mergeBlocks(function);
+    return changed;
+}
+
+// --- cse ---
+
+// What an instruction computes, as a string of bytes; empty for
+// instructions CSE leaves alone (effects, memory reads, calls).
+std::string expressionKey(const IrInstr* instr) {
+    std::string key;
+    auto append = [&key](const void* data, size_t size) { key.append(static_cast<const char*>(data), size); };
+    key += static_cast<char>(instr->op);
+    switch (instr->op) {
+    case IrOp::CONST: {
+        Value value = instr->constant;
+        key += static_cast<char>(value.kind());
+        if (value.isNumber()) {
+            double number = value.asNumber();
+            append(&number, sizeof number);
+        }
+        else if (value.isBool()) {
+            key += value.asBool() ? '1' : '0';
+        }
+        else if (value.isString()) {
+            key += asString(value)->chars;
+        }
+        else if (!value.isNil()) {
+            return {};
+        }
+        return key;
+    }
+    case IrOp::CAPTURE:
+        append(&instr->index, sizeof instr->index);
+        return key;
+    case IrOp::PHI:
+        // Only PHIs of the same block are interchangeable.
+        append(&instr->block->id, sizeof instr->block->id);
+        [[fallthrough]];
+    case IrOp::UNARY:
+    case IrOp::BINARY:
+        key += static_cast<char>(instr->token);
+        for (const IrInstr* operand : instr->operands) append(&operand->id, sizeof operand->id);
+        return key;
+    default:
+        return {};
+    }
+}
+
+bool runCommonSubexpressionElimination(IrModule&, IrFunction& function) {
+    DominatorTree dominators(function);
+    Forwarding forward(function.values.size(), nullptr);
+    std::unordered_map<std::string, IrInstr*> available;
+    std::vector<std::string> added; // Keys in scope, innermost last
+    bool changed = false;
+
+    // Preorder walk of the dominator tree: an instruction is available in the
+    // blocks its own block dominates.
+    struct Frame {
+        IrBlock* block;
+        size_t child;
+        size_t scope; // Size of `added` on entry
+    };
+    std::vector<Frame> stack{ { function.entry(), 0, 0 } };
+    for (bool entering = true; !stack.empty();) {
+        Frame& frame = stack.back();
+        if (entering) {
+            for (IrInstr* instr : frame.block->instrs) {
+                for (IrInstr*& operand : instr->operands) operand = resolve(forward, operand);
+                std::string key = expressionKey(instr);
+                if (key.empty()) continue;
+                auto [it, inserted] = available.emplace(key, instr);
+                if (inserted) {
+                    added.push_back(std::move(key));
+                }
+                else {
+                    forward[instr->id] = it->second;
+                    changed = true;
+                }
+            }
+        }
+        const std::vector<IrBlock*>& children = dominators.children(frame.block);
+        if (frame.child < children.size()) {
+            IrBlock* child = children[frame.child++];
+            stack.push_back({ child, 0, added.size() });
+            entering = true;
+            continue;
+        }
+        while (added.size() > frame.scope) {
+            available.erase(added.back());
+            added.pop_back();
+        }
+        stack.pop_back();
+        entering = false;
+    }
+    if (changed) applyForwarding(function, forward);
+    return changed;
+}
+
+const std::vector<IrPass> passes = {
+    { "copyprop", "forward copies and trivial PHIs", runCopyPropagation },
+    { "fold", "fold operators on constants and branches on constants", runConstantFolding },
+    { "constprop", "sparse conditional constant propagation", runConstantPropagation },
+    { "dce", "remove unreachable blocks and unused values, merge blocks", runDeadCodeElimination },
+    { "cse", "reuse dominating identical computations", runCommonSubexpressionElimination },
+};
+
+} // namespace
+
+const std::vector<IrPass>& irPasses() {
+    return passes;
+}
+
+const IrPass* findIrPass(std::string_view name) {
+    for (const IrPass& pass : passes) {
+        if (name == pass.name) return &pass;
+    }
+    return nullptr;
+}
+
+// --- Pass Manager ---
+
+bool PassManager::addPipeline(std::string_view names) {
+    for (size_t start = 0; start < names.size();) {
+        size_t comma = names.find(',', start);
+        if (comma == std::string_view::npos) comma = names.size();
+        std::string_view name = names.substr(start, comma - start);
+        start = comma + 1;
+        if (name.empty()) continue;
+        const IrPass* pass = findIrPass(name);
+        if (pass == nullptr) {
+            std::cerr << "Error: Unknown IR pass: " << name << " (known:";
+            for (const IrPass& known : passes) std::cerr << " " << known.name;
+            std::cerr << ")\n";
+            return false;
+        }
+        Step step;
+        step.pass = pass;
+        steps.push_back(step);
+    }
+    return true;
+}
+
+bool PassManager::run(IrModule& module) {
+    auto verified = [&](const char* after) {
+        if (!verify) return true;
+        for (const auto& function : module.functions) {
+            std::string problem = verifyIr(*function);
+            if (problem.empty()) continue;
+            std::cerr << "Error: Invalid IR after " << after << " in function #" << function->number << ": "
+                << problem << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    if (dump) {
+        *dump << "=== IR before passes ===\n";
+        printIr(module, *dump);
+    }
+    if (!verified("building")) return false;
+    // Strings the passes fold become constants in the IR, out of the
+    // collector's sight.
+    Heap::PermanentScope permanent(module.heap);
+    for (Step& step : steps) {
+        step.instructionsBefore = module.instructionCount();
+        step.blocksBefore = module.blockCount();
+        step.changed = false;
+        auto begin = std::chrono::steady_clock::now();
+        for (const auto& function : module.functions) step.changed |= step.pass->run(module, *function);
+        auto end = std::chrono::steady_clock::now();
+        step.seconds = std::chrono::duration<double>(end - begin).count();
+        step.instructionsAfter = module.instructionCount();
+        step.blocksAfter = module.blockCount();
+
+        if (dump) {
+            *dump << "\n=== IR after " << step.pass->name << (step.changed ? "" : " (unchanged)") << " ===\n";
+            if (step.changed) printIr(module, *dump);
+        }
+        if (!verified(step.pass->name)) return false;
+    }
+    return true;
+}
+
+void PassManager::printTimings(std::ostream& out) const {
+    char line[128];
+    std::snprintf(line, sizeof line, "%-10s %10s %18s %14s\n", "pass", "time (ms)", "instructions", "blocks");
+    out << line;
+    double total = 0;
+    for (const Step& step : steps) {
+        total += step.seconds;
+        std::snprintf(line, sizeof line, "%-10s %10.3f %8zu -> %-6zu %6zu -> %-6zu\n", step.pass->name,
+            step.seconds * 1000.0, step.instructionsBefore, step.instructionsAfter, step.blocksBefore, step.blocksAfter);
+        out << line;
+    }
+    std::snprintf(line, sizeof line, "%-10s %10.3f\n", "total", total * 1000.0);
+    out << line;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "ir.h"
+#include <cstddef>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+// --- Passes ---
+// Each pass rewrites one function in place and reports whether it changed
+// anything. Passes keep the IR valid (see verifyIr) and never change what a
+// program prints or which runtime error it stops with, or on which line.
+//
+//  - copyprop:  forwards COPY instructions and PHIs whose operands all name
+//               the same value to that value.
+//  - fold:      evaluates UNARY and BINARY instructions whose operands are
+//               constants, and turns BRANCHes on constants into JUMPs.
+//  - constprop: sparse conditional constant propagation (Wegman and Zadeck):
+//               finds the values that are constant along every path that can
+//               actually run, including through PHIs and loops.
+//  - dce:       deletes unreachable blocks (`if (false)` bodies, code after
+//               return or break), instructions whose results are never used
+//               and that cannot fail, and merges straight-line blocks.
+//  - cse:       replaces an instruction by an identical one that dominates it
+//               (same operator and operands), including repeated constants.
+struct IrPass {
+    const char* name;
+    const char* description;
+    bool (*run)(IrModule& module, IrFunction& function);
+};
+
+const std::vector<IrPass>& irPasses();
+const IrPass* findIrPass(std::string_view name); // nullptr if unknown
+
+// --- Pass Manager ---
+
+// Runs a list of passes over every function of a module, optionally listing
+// the IR between passes, verifying it, and timing each pass.
+class PassManager {
+public:
+    static constexpr const char* defaultPipeline = "copyprop,fold,constprop,dce,cse";
+
+    // Appends the comma-separated passes in `names` (which may be empty).
+    // Returns false, after reporting it on std::cerr, for an unknown name.
+    bool addPipeline(std::string_view names);
+    // Lists the IR before the first pass and after each pass on `out`
+    // (nullptr, the default, lists nothing).
+    void setDump(std::ostream* out) { dump = out; }
+    // Runs verifyIr after each pass.
+    void setVerify(bool enabled) { verify = enabled; }
+
+    // Returns false if verification failed (reported on std::cerr).
+    bool run(IrModule& module);
+    // One line per pass run: time and instruction and block counts.
+    void printTimings(std::ostream& out) const;
+
+private:
+    struct Step {
+        const IrPass* pass;
+        double seconds = 0;
+        size_t instructionsBefore = 0, instructionsAfter = 0;
+        size_t blocksBefore = 0, blocksAfter = 0;
+        bool changed = false;
+    };
+
+    std::vector<Step> steps;
+    std::ostream* dump = nullptr;
+    bool verify = false;
+};
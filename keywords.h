@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "token.h"
+
+// Reserved words of the language. This list is the single source of truth:
+// the perfect hash below is built from it at compile time.
+struct KeywordEntry {
+    std::string_view text;
+    TokenType type;
+};
+
+inline constexpr KeywordEntry keywordList[] = {
+    { "var", TokenType::VAR },
+    { "fun", TokenType::FUN },
+    { "return", TokenType::RETURN },
+    { "if", TokenType::IF },
+    { "else", TokenType::ELSE },
+    { "for", TokenType::FOR },
+    { "while", TokenType::WHILE },
+    { "do", TokenType::DO },
+    { "switch", TokenType::SWITCH },
+    { "case", TokenType::CASE },
+    { "default", TokenType::DEFAULT },
+    { "break", TokenType::BREAK },
+    { "continue", TokenType::CONTINUE },
+    { "true", TokenType::TRUE },
+    { "false", TokenType::FALSE },
+    { "nil", TokenType::NIL },
+    { "print", TokenType::PRINT },
+};
+
+namespace keyword_detail {
+
+constexpr size_t keywordCount = sizeof(keywordList) / sizeof(keywordList[0]);
+constexpr uint32_t tableSize = 64; // Power of two, comfortably above keywordCount
+
+constexpr size_t minLength() {
+    size_t result = keywordList[0].text.size();
+    for (const KeywordEntry& entry : keywordList) {
+        if (entry.text.size() < result) result = entry.text.size();
+    }
+    return result;
+}
+
+constexpr size_t maxLength() {
+    size_t result = 0;
+    for (const KeywordEntry& entry : keywordList) {
+        if (entry.text.size() > result) result = entry.text.size();
+    }
+    return result;
+}
+
+constexpr size_t minKeywordLength = minLength();
+constexpr size_t maxKeywordLength = maxLength();
+static_assert(minKeywordLength >= 2, "hash reads the first two characters");
+
+// Mixes the length, the first two and the last character. Only called with
+// texts whose length is within [minKeywordLength, maxKeywordLength].
+constexpr uint32_t hash(std::string_view text, uint32_t seed) {
+    uint32_t h = seed ^ static_cast<uint32_t>(text.size());
+    h = h * 0x01000193u + static_cast<unsigned char>(text[0]);
+    h = h * 0x01000193u + static_cast<unsigned char>(text[1]);
+    h = h * 0x01000193u + static_cast<unsigned char>(text[text.size() - 1]);
+    return (h ^ (h >> 15)) & (tableSize - 1);
+}
+
+constexpr bool isPerfect(uint32_t seed) {
+    bool used[tableSize] = {};
+    for (const KeywordEntry& entry : keywordList) {
+        uint32_t slot = hash(entry.text, seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 0; seed < 100000; ++seed) {
+        if (isPerfect(seed)) return seed;
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t seed = findSeed();
+static_assert(seed != UINT32_MAX, "no collision-free seed for the keyword list");
+
+// Slot -> index into keywordList, or -1 for an empty slot.
+constexpr std::array<int8_t, tableSize> buildTable() {
+    std::array<int8_t, tableSize> table{};
+    for (int8_t& slot : table) slot = -1;
+    for (size_t i = 0; i < keywordCount; ++i) {
+        table[hash(keywordList[i].text, seed)] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+constexpr std::array<int8_t, tableSize> table = buildTable();
+
+} // namespace keyword_detail
+
+// Classifies an identifier lexeme: the keyword's TokenType, or IDENTIFIER.
+// One hash and at most one string comparison, with no allocation.
+constexpr TokenType lookupKeyword(std::string_view text) {
+    using namespace keyword_detail;
+    if (text.size() < minKeywordLength || text.size() > maxKeywordLength) {
+        return TokenType::IDENTIFIER;
+    }
+    int8_t index = table[hash(text, seed)];
+    if (index >= 0 && keywordList[index].text == text) {
+        return keywordList[index].type;
+    }
+    return TokenType::IDENTIFIER;
+}
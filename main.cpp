@@ -2,35 +2,270 @@
 #include "parser.h"        // For building the AST
 #include "ast_print.h"   // For generating the DOT output
 #include "declaration_nodes.h" // Ensures Declaration* type is known
+#include "benchmark.h"     // For the --bench modes
+#include "source_file.h"   // For loading the input without copies
+#include "parallel_scanner.h" // For chunked multi-threaded scanning
+#include "parallel_parser.h"  // For parsing top-level declarations on several threads
+#include "ast_arena.h"     // Owns every AST node
+#include "interpreter.h"   // For --run --engine=ast
+#include "resolver.h"      // For the name resolution diagnostics
+#include "vm.h"            // For --run (bytecode) and --dump-bytecode
+#include "ir_interpreter.h" // For --run --engine=ir and --dump-ir
+#include "ir_passes.h"     // For the IR optimization pipeline
+#include "flat_ast.h"      // For --flat-ast
+#include "ast_cache.h"     // For --ast-cache
 
 #include <iostream>
 #include <fstream>
-#include <sstream>
+#include <cstdlib>
 #include <vector>
 #include <string>
+#include <string_view>
 
 
-int main() {
-	std::ifstream inputFile("lang.dav");
-	if (!inputFile.is_open()) {
-		std::cerr << "Error: Could not open input file: lang.dav\n";
-		return 1;
+// --gc-stats: what the heap did during a run, on std::cerr.
+static void printHeapStats(const Heap::Stats& stats) {
+	std::cerr << "GC: " << stats.minorCollections << " minor and " << stats.fullCollections << " full collections, "
+		<< stats.nurseryBytes / 1024 << " KB nursery\n";
+	std::cerr << "  allocated " << stats.allocatedBytes / 1024 << " KB, promoted " << stats.promotedBytes / 1024
+		<< " KB, freed " << stats.freedObjects << " objects\n";
+	std::cerr << "  old generation " << stats.oldBytes / 1024 << " KB in " << stats.oldObjects << " objects, "
+		<< stats.permanentObjects << " permanent\n";
+	std::cerr << "  pauses: total " << static_cast<long long>(stats.pauseSeconds * 1e6) << " us, longest "
+		<< static_cast<long long>(stats.maxPauseSeconds * 1e6) << " us\n";
+}
+
+// --ic-stats: how the field access sites' inline caches did, on std::cerr.
+static void printInlineCacheStats() {
+	const InlineCacheStats& stats = inlineCacheStats;
+	uint64_t lookups = stats.hits + stats.misses;
+	std::cerr << "Inline caches: " << stats.hits << " hits, " << stats.misses << " misses";
+	if (lookups > 0) std::cerr << " (" << stats.hits * 1000 / lookups / 10.0 << "% hit rate)";
+	std::cerr << "\n  sites: " << stats.monomorphic << " monomorphic, " << stats.polymorphic << " polymorphic, "
+		<< stats.megamorphic << " megamorphic; " << Shape::count() << " shapes\n";
+}
+
+int main(int argc, char* argv[]) {
+	// 0. BENCHMARKS: `--bench <name> [args...]` runs a benchmark instead of the pipeline.
+	if (argc >= 3 && std::string(argv[1]) == "--bench") {
+		return runBenchmark(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+	}
+	// Options: [--scanner=auto|scalar|sse2|avx2] [--scan-threads=N] [--parse-threads=N] [--stream]
+	//          [--token-buffer]
+	//          [--parser=pratt|descent] [--run [--engine=vm|ast|ir]] [--nursery=KB] [--gc-stats] [--ic-stats]
+	//          [--dump-bytecode] [--dump-ir] [--passes=name,...] [--time-passes] [--verify-ir]
+	//          [--flat-ast] [--ast-cache[=dir]] [input file]
+	std::string inputPath = "lang.dav";
+	ScanBackend scanBackend = ScanBackend::Auto;
+	unsigned scanThreads = 1;
+	unsigned parseThreads = 1;
+	bool streamTokens = false;
+	bool tokenBuffer = false;
+	ExpressionParser expressionParser = ExpressionParser::Pratt;
+	bool runProgram = false;
+	std::string engine = "vm";
+	size_t nurseryBytes = Heap::defaultNurseryBytes;
+	bool gcStats = false;
+	bool icStats = false;
+	bool dumpBytecode = false;
+	bool dumpIr = false;
+	bool timePasses = false;
+	bool verifyIr = false;
+	bool flatAst = false;
+	std::string astCacheDirectory; // Empty: no cache
+	std::string passes = PassManager::defaultPipeline;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg.rfind("--scanner=", 0) == 0) {
+			if (!parseScanBackend(arg.c_str() + 10, scanBackend)) {
+				std::cerr << "Error: Unknown scanner backend: " << arg.substr(10) << "\n";
+				return 1;
+			}
+		}
+		else if (arg.rfind("--scan-threads=", 0) == 0) {
+			scanThreads = static_cast<unsigned>(std::strtoul(arg.c_str() + 15, nullptr, 10));
+		}
+		else if (arg.rfind("--parse-threads=", 0) == 0) {
+			parseThreads = static_cast<unsigned>(std::strtoul(arg.c_str() + 16, nullptr, 10));
+		}
+		else if (arg == "--stream") {
+			streamTokens = true;
+		}
+		else if (arg == "--token-buffer") {
+			tokenBuffer = true;
+		}
+		else if (arg == "--parser=pratt" || arg == "--parser=descent") {
+			expressionParser = arg == "--parser=pratt" ? ExpressionParser::Pratt : ExpressionParser::Descent;
+		}
+		else if (arg == "--run") {
+			runProgram = true;
+		}
+		else if (arg == "--engine=vm" || arg == "--engine=ast" || arg == "--engine=ir") {
+			engine = arg.substr(9);
+		}
+		else if (arg.rfind("--nursery=", 0) == 0) {
+			nurseryBytes = static_cast<size_t>(std::strtoul(arg.c_str() + 10, nullptr, 10)) * 1024;
+		}
+		else if (arg == "--gc-stats") {
+			gcStats = true;
+		}
+		else if (arg == "--ic-stats") {
+			icStats = true;
+		}
+		else if (arg == "--dump-bytecode") {
+			dumpBytecode = true;
+		}
+		else if (arg == "--dump-ir") {
+			dumpIr = true;
+		}
+		else if (arg.rfind("--passes=", 0) == 0) {
+			passes = arg.substr(9);
+		}
+		else if (arg == "--time-passes") {
+			timePasses = true;
+		}
+		else if (arg == "--verify-ir") {
+			verifyIr = true;
+		}
+		else if (arg == "--flat-ast") {
+			flatAst = true;
+		}
+		else if (arg == "--ast-cache") {
+			astCacheDirectory = ".dav-cache";
+		}
+		else if (arg.rfind("--ast-cache=", 0) == 0) {
+			astCacheDirectory = arg.substr(12);
+		}
+		else if (arg.rfind("--", 0) == 0) {
+			std::cerr << "Error: Unknown option: " << arg << "\n";
+			return 1;
+		}
+		else {
+			inputPath = arg;
+		}
 	}
-	std::stringstream buffer;
-	buffer << inputFile.rdbuf();
-	std::string sourceCode = buffer.str();
-	inputFile.close();
-	// 2. SCANNING: Convert source code into a stream of tokens.
-	Scanner scanner(sourceCode);
-	std::vector<Token> tokens = scanner.scanTokens();
-	if (tokens.empty()) {
-		std::cerr << "Error: Scanner returned no tokens or encountered a critical error.\n";
+	// 1. LOADING: Map the source file (or read it once) - the scanner works on it in place.
+	SourceFile sourceFile;
+	if (!sourceFile.open(inputPath)) {
+		std::cerr << "Error: Could not open input file: " << inputPath << "\n";
 		return 1;
 	}
-	// 3. PARSING: Convert the token stream into an Abstract Syntax Tree (AST).
-	Parser parser(tokens);
-	std::vector<Declaration*> ast = parser.parse();
-	if (parser.Error()) {
+	std::string_view sourceCode = sourceFile.text();
+	AstArena astArena; // Frees the whole AST at once when main returns
+	std::vector<Declaration*> ast;
+	bool parseErrors = false;
+	bool scanErrors = false;
+	// 2-3. CACHE: With --ast-cache, a program parsed before (same text) is
+	// loaded from its cached flat AST, skipping scanning and parsing.
+	AstCache astCache(astCacheDirectory);
+	bool fromCache = false;
+	if (!astCacheDirectory.empty()) {
+		if (astCache.load(sourceCode, astArena, ast)) {
+			fromCache = true;
+		}
+		else if (!astCache.error().empty()) {
+			std::cerr << "Warning: Ignoring AST cache entry (" << astCache.error() << ").\n";
+		}
+	}
+	if (fromCache) {
+		// Nothing to scan or parse.
+	}
+	else if (streamTokens) {
+		// 2+3. SCANNING AND PARSING: The parser pulls tokens from the scanner as it
+		// needs them, so no token vector is ever built.
+		Scanner scanner(sourceCode, scanBackend);
+		Parser parser(scanner, astArena, expressionParser);
+		ast = parser.parse();
+		parseErrors = parser.Error();
+		scanErrors = scanner.didEncounterError();
+	}
+	else {
+		// 2. SCANNING: Convert source code into a stream of tokens (in chunks on
+		// several threads when --scan-threads asks for it). --token-buffer stores
+		// them as a structure of arrays (TokenBuffer) instead of a vector of Token.
+		ParallelScanner scanner(sourceCode, scanThreads, scanBackend);
+		// 3. PARSING: Convert the token stream into an Abstract Syntax Tree (AST),
+		// a piece per thread when --parse-threads asks for it.
+		auto parseTokens = [&](const auto& tokens) {
+			if (tokens.empty()) return false;
+			ParallelParser parser(tokens, astArena, parseThreads, expressionParser);
+			ast = parser.parse();
+			parseErrors = parser.Error();
+			return true;
+		};
+		bool scanned = tokenBuffer ? parseTokens(scanner.scanBuffer()) : parseTokens(scanner.scanTokens());
+		if (!scanned) {
+			std::cerr << "Error: Scanner returned no tokens or encountered a critical error.\n";
+			return 1;
+		}
+		scanErrors = scanner.didEncounterError();
+	}
+	// Only clean programs are cached: a cached run would not repeat the diagnostics.
+	if (!astCacheDirectory.empty() && !fromCache && !parseErrors && !scanErrors) {
+		if (!astCache.store(sourceCode, toFlatAst(ast))) {
+			std::cerr << "Warning: Could not write the AST cache (" << astCache.error() << ").\n";
+		}
+	}
+	// 3b. `--flat-ast` converts the tree to the flat index-based encoding and
+	// back, so everything below runs on the round-tripped nodes.
+	AstArena flatArena;
+	if (flatAst) {
+		ast = toPointerAst(toFlatAst(ast), flatArena);
+	}
+	// 4a. EXECUTION: `--run` compiles the program to bytecode and runs it (or
+	// walks the AST with --engine=ast, or runs the optimized IR with
+	// --engine=ir) instead of drawing it.
+	if (runProgram || dumpBytecode || dumpIr) {
+		if (parseErrors) {
+			std::cerr << "Error: Not running a program with parse errors.\n";
+			return 1;
+		}
+		// Every engine scopes names the same way, so the resolver's warnings
+		// (duplicate declarations, uses before a declaration) apply to all.
+		GlobalTable resolverGlobals;
+		Resolver resolver(resolverGlobals);
+		if (!resolver.resolve(ast)) return 1;
+		for (const Resolver::Diagnostic& diagnostic : resolver.diagnostics()) {
+			std::cerr << "[Line " << diagnostic.line << "] Warning: " << diagnostic.message << "\n";
+		}
+		if (runProgram && engine == "ast") {
+			Interpreter interpreter(std::cout);
+			bool ok = interpreter.interpret(ast);
+			if (gcStats) printHeapStats(interpreter.heapStats());
+			if (icStats) printInlineCacheStats();
+			return ok ? 0 : 1;
+		}
+		if ((runProgram && engine == "ir") || dumpIr) {
+			// The IR is listed before the first pass and after each one.
+			PassManager passManager;
+			if (!passManager.addPipeline(passes)) return 1;
+			passManager.setDump(dumpIr ? &std::cout : nullptr);
+			passManager.setVerify(verifyIr);
+			IrInterpreter irInterpreter(std::cout, nurseryBytes);
+			std::unique_ptr<IrModule> module = irInterpreter.build(ast);
+			if (module == nullptr) return 1;
+			bool valid = passManager.run(*module);
+			if (timePasses) passManager.printTimings(std::cerr);
+			if (!valid) return 1;
+			if (runProgram && engine == "ir") {
+				bool ok = irInterpreter.run(*module);
+				if (gcStats) printHeapStats(irInterpreter.heapStats());
+				if (icStats) printInlineCacheStats();
+				return ok ? 0 : 1;
+			}
+			if (!runProgram && !dumpBytecode) return 0;
+		}
+		Vm vm(std::cout, nurseryBytes);
+		ObjProto* script = vm.compile(ast);
+		if (script == nullptr) return 1;
+		if (dumpBytecode) disassembleChunk(script->chunk, "<script>", std::cout);
+		if (!runProgram) return 0;
+		bool ok = vm.run(script);
+		if (gcStats) printHeapStats(vm.heapStats());
+		if (icStats) printInlineCacheStats();
+		return ok ? 0 : 1;
+	}
+	if (parseErrors) {
 		std::cerr << "Warning: Parsing encountered errors. AST visualization may be incomplete.\n";
 	}
 	if (ast.empty()) {
@@ -54,9 +289,5 @@ int main() {
 		std::cerr << "Visualization Error: " << e.what() << "\n";
 	}
 
-	// Cleanup: Delete the AST to free memory.
-	for (Declaration* decl : ast) {
-		delete decl;
-	}
 	return 0;
 }
\ No newline at end of file
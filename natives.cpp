@@ -0,0 +1,83 @@
+#include "natives.h"
+#include <chrono>
+
+namespace {
+
+const auto startTime = std::chrono::steady_clock::now();
+
+// clock(): seconds since the program started.
+Value nativeClock(Heap&, const Value*, int) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    return Value::number(elapsed.count());
+}
+
+// array() or array(n): a new array, empty or holding n nils.
+Value nativeArray(Heap& heap, const Value* args, int argCount) {
+    ObjArray* array = heap.makeArray();
+    if (argCount > 1) throw RuntimeError("array() takes at most one argument.");
+    if (argCount == 1) {
+        if (!args[0].isNumber() || args[0].asNumber() < 0) {
+            throw RuntimeError("array() size must be a non-negative number.");
+        }
+        array->elements.resize(static_cast<size_t>(args[0].asNumber()));
+        heap.noteGrowth(array, array->elements.capacity() * sizeof(Value));
+    }
+    return Value::object(array);
+}
+
+// push(array, value): appends and returns the new length.
+Value nativePush(Heap& heap, const Value* args, int) {
+    if (!args[0].isObjType(ObjType::Array)) throw RuntimeError("push() expects an array.");
+    ObjArray* array = asArray(args[0]);
+    std::vector<Value>& elements = array->elements;
+    size_t capacity = elements.capacity();
+    elements.push_back(args[1]);
+    heap.writeBarrier(array, args[1]);
+    if (elements.capacity() != capacity) heap.noteGrowth(array, (elements.capacity() - capacity) * sizeof(Value));
+    return Value::number(static_cast<double>(elements.size()));
+}
+
+// pop(array): removes and returns the last element (nil when empty).
+Value nativePop(Heap&, const Value* args, int) {
+    if (!args[0].isObjType(ObjType::Array)) throw RuntimeError("pop() expects an array.");
+    std::vector<Value>& elements = asArray(args[0])->elements;
+    if (elements.empty()) return Value::nil();
+    Value last = elements.back();
+    elements.pop_back();
+    return last;
+}
+
+// len(x): length of a string or array, field count of an object.
+Value nativeLen(Heap&, const Value* args, int) {
+    Value value = args[0];
+    if (value.isString()) return Value::number(static_cast<double>(asString(value)->chars.size()));
+    if (value.isObjType(ObjType::Array)) return Value::number(static_cast<double>(asArray(value)->elements.size()));
+    if (value.isObjType(ObjType::Instance)) return Value::number(static_cast<double>(asInstance(value)->slots.size()));
+    throw RuntimeError("len() expects a string, array or object.");
+}
+
+// object(): a new object with no fields.
+Value nativeObject(Heap& heap, const Value*, int) {
+    return Value::object(heap.makeInstance());
+}
+
+// str(x): the text print would show.
+Value nativeStr(Heap& heap, const Value* args, int) {
+    if (args[0].isString()) return args[0];
+    return Value::object(heap.makeString(valueToString(args[0])));
+}
+
+} // namespace
+
+const std::vector<NativeEntry>& builtinNatives() {
+    static const std::vector<NativeEntry> natives = {
+        { "clock", nativeClock, 0 },
+        { "array", nativeArray, -1 },
+        { "push", nativePush, 2 },
+        { "pop", nativePop, 1 },
+        { "len", nativeLen, 1 },
+        { "object", nativeObject, 0 },
+        { "str", nativeStr, 1 },
+    };
+    return natives;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "object.h"
+#include <string_view>
+#include <vector>
+
+// A builtin function every execution engine defines as a global.
+struct NativeEntry {
+    std::string_view name;
+    NativeFn function;
+    int arity; // -1 accepts any number of arguments
+};
+
+// clock, array, push, pop, len, object and str.
+const std::vector<NativeEntry>& builtinNatives();
@@ -0,0 +1,344 @@
+#include "object.h"
+#include "environment.h"
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+
+namespace {
+
+// Runs `body` on `object` as its concrete type.
+template <typename F>
+void withType(Obj* object, F&& body) {
+    switch (object->type) {
+    case ObjType::String: body(static_cast<ObjString*>(object)); break;
+    case ObjType::Array: body(static_cast<ObjArray*>(object)); break;
+    case ObjType::Instance: body(static_cast<ObjInstance*>(object)); break;
+    case ObjType::Function: body(static_cast<ObjFunction*>(object)); break;
+    case ObjType::Native: body(static_cast<ObjNative*>(object)); break;
+    case ObjType::Proto: body(static_cast<ObjProto*>(object)); break;
+    case ObjType::Closure: body(static_cast<ObjClosure*>(object)); break;
+    case ObjType::Upvalue: body(static_cast<ObjUpvalue*>(object)); break;
+    case ObjType::IrClosure: body(static_cast<ObjIrClosure*>(object)); break;
+    }
+}
+
+void freeObject(Obj* object) {
+    withType(object, [](auto* typed) { delete typed; });
+}
+
+// Bytes an object holds outside itself, roughly: what a collection frees or
+// keeps on top of the object.
+size_t ownedBytes(Obj* object) {
+    switch (object->type) {
+    case ObjType::String: return static_cast<ObjString*>(object)->chars.capacity();
+    case ObjType::Array: return static_cast<ObjArray*>(object)->elements.capacity() * sizeof(Value);
+    case ObjType::Instance: {
+        ObjInstance* instance = static_cast<ObjInstance*>(object);
+        size_t bytes = instance->slots.capacity() * sizeof(Value);
+        if (instance->dictionary != nullptr) {
+            auto& names = *instance->dictionary;
+            bytes += names.size() * (sizeof(Symbol) + sizeof(uint32_t) + 2 * sizeof(void*)) +
+                names.bucket_count() * sizeof(void*);
+        }
+        return bytes;
+    }
+    case ObjType::Closure: return static_cast<ObjClosure*>(object)->upvalues.capacity() * sizeof(ObjUpvalue*);
+    case ObjType::IrClosure: return static_cast<ObjIrClosure*>(object)->cells.capacity() * sizeof(ObjUpvalue*);
+    default: return 0;
+    }
+}
+
+size_t objectBytes(Obj* object) {
+    size_t size = 0;
+    withType(object, [&](auto* typed) { size = sizeof(*typed); });
+    return size + ownedBytes(object);
+}
+
+} // namespace
+
+Heap::Heap(size_t nurseryBytes) : minimumFullBytes(nurseryBytes * 8), fullThreshold(minimumFullBytes) {
+    counters.nurseryBytes = nurseryBytes;
+}
+
+Heap::~Heap() {
+    for (char* at = nursery.get(); at < nurseryTop;) {
+        Obj* object = reinterpret_cast<Obj*>(at);
+        withType(object, [&](auto* typed) {
+            at += (sizeof(*typed) + alignment - 1) & ~(alignment - 1);
+            using T = std::remove_pointer_t<decltype(typed)>;
+            typed->~T();
+        });
+    }
+    for (Obj* head : { oldHead, permanentHead }) {
+        while (head != nullptr) {
+            Obj* next = head->next;
+            freeObject(head);
+            head = next;
+        }
+    }
+}
+
+// --- Allocation ---
+
+ObjString* Heap::makeString(std::string chars) {
+    ObjString* string = allocate<ObjString>(std::move(chars));
+    noteGrowth(string, string->chars.capacity());
+    return string;
+}
+
+ObjArray* Heap::makeArray() {
+    return allocate<ObjArray>();
+}
+
+ObjInstance* Heap::makeInstance() {
+    return allocate<ObjInstance>();
+}
+
+ObjFunction* Heap::makeFunction(FuncDecl* declaration, std::shared_ptr<Environment> closure) {
+    return allocate<ObjFunction>(declaration, std::move(closure));
+}
+
+ObjNative* Heap::makeNative(std::string_view name, NativeFn function, int arity) {
+    return allocate<ObjNative>(name, function, arity);
+}
+
+ObjProto* Heap::makeProto() {
+    return allocate<ObjProto>();
+}
+
+ObjClosure* Heap::makeClosure(ObjProto* proto) {
+    return allocate<ObjClosure>(proto);
+}
+
+ObjUpvalue* Heap::makeUpvalue(Value* location) {
+    return allocate<ObjUpvalue>(location);
+}
+
+ObjUpvalue* Heap::makeCell(Value value) {
+    ObjUpvalue* cell = allocate<ObjUpvalue>(nullptr);
+    cell->closed = value;
+    cell->location = &cell->closed;
+    writeBarrier(cell, value);
+    return cell;
+}
+
+ObjIrClosure* Heap::makeIrClosure(IrFunction* function) {
+    return allocate<ObjIrClosure>(function);
+}
+
+void Heap::adoptObject(Obj* object, size_t size) {
+    counters.allocatedBytes += size;
+    if (permanentDepth > 0) {
+        object->generation = Generation::Permanent;
+        object->next = permanentHead;
+        permanentHead = object;
+        ++counters.permanentObjects;
+        return;
+    }
+    object->generation = Generation::Old;
+    object->next = oldHead;
+    oldHead = object;
+    ++counters.oldObjects;
+    counters.oldBytes += size;
+    if (traceRoots) {
+        // The nursery is full. The object is filled in after this, maybe
+        // with nursery objects, so it starts out remembered.
+        remember(object);
+        requestCollection();
+    }
+}
+
+void Heap::noteGrowth(Obj* object, size_t bytes) {
+    counters.allocatedBytes += bytes;
+    if (object->generation == Generation::Nursery) {
+        nurseryGrowth += bytes;
+        if (static_cast<size_t>(nurseryTop - nursery.get()) + nurseryGrowth >= counters.nurseryBytes) {
+            requestCollection();
+        }
+    }
+    else if (object->generation == Generation::Old) {
+        counters.oldBytes += bytes;
+        if (traceRoots && counters.oldBytes >= fullThreshold) requestCollection();
+    }
+}
+
+void Heap::remember(Obj* object) {
+    object->remembered = true;
+    remembered.push_back(object);
+}
+
+void Heap::requestCollection() {
+    pending = true;
+}
+
+// --- Collection ---
+
+void Heap::setRoots(std::function<void()> roots) {
+    traceRoots = std::move(roots);
+    if (nursery == nullptr && counters.nurseryBytes > 0) {
+        nursery.reset(new char[counters.nurseryBytes]);
+        nurseryTop = nursery.get();
+        nurseryEnd = nursery.get() + counters.nurseryBytes;
+    }
+}
+
+void Heap::traceRoot(Value& value) {
+    if (!value.isObject()) return;
+    Obj* object = value.asObject();
+    Obj* traced = object;
+    visit(traced);
+    if (traced != object) value = Value::object(traced);
+}
+
+void Heap::visit(Obj*& object) {
+    if (object == nullptr) return;
+    if (phase == Phase::Evacuate) {
+        if (object->generation != Generation::Nursery) return;
+        // A moved object leaves its new address behind in `next`.
+        object = object->marked ? object->next : promote(object);
+        return;
+    }
+    if (object->generation != Generation::Old || object->marked) return;
+    object->marked = true;
+    grey.push_back(object);
+}
+
+void Heap::traceFields(Obj* object) {
+    switch (object->type) {
+    case ObjType::Array:
+        for (Value& element : static_cast<ObjArray*>(object)->elements) traceRoot(element);
+        break;
+    case ObjType::Instance:
+        for (Value& slot : static_cast<ObjInstance*>(object)->slots) traceRoot(slot);
+        break;
+    case ObjType::Proto:
+        for (Value& constant : static_cast<ObjProto*>(object)->chunk.constants) traceRoot(constant);
+        break;
+    case ObjType::Closure: {
+        ObjClosure* closure = static_cast<ObjClosure*>(object);
+        traceRoot(closure->proto);
+        for (ObjUpvalue*& upvalue : closure->upvalues) traceRoot(upvalue);
+        break;
+    }
+    case ObjType::Upvalue: {
+        // An open upvalue's variable is on the VM's stack, a root already;
+        // the open list itself is the VM's to trace.
+        ObjUpvalue* upvalue = static_cast<ObjUpvalue*>(object);
+        traceRoot(upvalue->closed);
+        break;
+    }
+    case ObjType::IrClosure:
+        for (ObjUpvalue*& cell : static_cast<ObjIrClosure*>(object)->cells) traceRoot(cell);
+        break;
+    case ObjType::Function:
+        // Its environment is reference counted, and only the tree-walking
+        // interpreter, which never collects, makes these.
+    case ObjType::String:
+    case ObjType::Native:
+        break;
+    }
+}
+
+Obj* Heap::promote(Obj* object) {
+    Obj* moved = nullptr;
+    withType(object, [&](auto* typed) {
+        using T = std::remove_pointer_t<decltype(typed)>;
+        moved = new T(std::move(*typed));
+    });
+    if (object->type == ObjType::Upvalue) {
+        ObjUpvalue* from = static_cast<ObjUpvalue*>(object);
+        ObjUpvalue* to = static_cast<ObjUpvalue*>(moved);
+        if (from->location == &from->closed) to->location = &to->closed;
+    }
+    moved->generation = Generation::Old;
+    moved->marked = false;
+    moved->remembered = false;
+    moved->next = oldHead;
+    oldHead = moved;
+    ++counters.oldObjects;
+    size_t bytes = objectBytes(moved);
+    counters.oldBytes += bytes;
+    counters.promotedBytes += bytes;
+
+    object->marked = true;
+    object->next = moved;
+    grey.push_back(moved);
+    return moved;
+}
+
+void Heap::collect(bool full) {
+    pending = false;
+    if (!traceRoots) return;
+    auto begin = std::chrono::steady_clock::now();
+    collectNursery();
+    if (full || counters.oldBytes >= fullThreshold) collectOld();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    counters.pauseSeconds += seconds;
+    counters.maxPauseSeconds = std::max(counters.maxPauseSeconds, seconds);
+    counters.pauses.push_back(seconds);
+}
+
+void Heap::collectNursery() {
+    ++counters.minorCollections;
+    phase = Phase::Evacuate;
+    traceRoots();
+    for (Obj* object : remembered) {
+        object->remembered = false;
+        traceFields(object);
+    }
+    remembered.clear();
+    while (!grey.empty()) {
+        Obj* object = grey.back();
+        grey.pop_back();
+        traceFields(object);
+    }
+    phase = Phase::Idle;
+
+    // What is left in the nursery is garbage or the husk of a moved object.
+    for (char* at = nursery.get(); at < nurseryTop;) {
+        Obj* object = reinterpret_cast<Obj*>(at);
+        if (!object->marked) ++counters.freedObjects;
+        withType(object, [&](auto* typed) {
+            at += (sizeof(*typed) + alignment - 1) & ~(alignment - 1);
+            using T = std::remove_pointer_t<decltype(typed)>;
+            typed->~T();
+        });
+    }
+    nurseryTop = nursery.get();
+    nurseryObjects = 0;
+    nurseryGrowth = 0;
+}
+
+void Heap::collectOld() {
+    // Runs right after a minor collection: the nursery is empty, so every
+    // reachable object is old or permanent.
+    ++counters.fullCollections;
+    phase = Phase::Mark;
+    traceRoots();
+    while (!grey.empty()) {
+        Obj* object = grey.back();
+        grey.pop_back();
+        traceFields(object);
+    }
+    phase = Phase::Idle;
+
+    size_t liveBytes = 0;
+    size_t liveObjects = 0;
+    Obj** link = &oldHead;
+    while (Obj* object = *link) {
+        if (object->marked) {
+            object->marked = false;
+            liveBytes += objectBytes(object);
+            ++liveObjects;
+            link = &object->next;
+        }
+        else {
+            *link = object->next;
+            freeObject(object);
+            ++counters.freedObjects;
+        }
+    }
+    counters.oldBytes = liveBytes;
+    counters.oldObjects = liveObjects;
+    fullThreshold = std::max(minimumFullBytes, liveBytes * 2);
+}
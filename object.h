@@ -0,0 +1,289 @@
+#pragma once
+#include "chunk.h"
+#include "interner.h"
+#include "shape.h"
+#include "value.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Environment;
+class FuncDecl;
+class Heap;
+struct IrFunction;
+
+// --- Heap Objects ---
+
+struct ObjString : Obj {
+    explicit ObjString(std::string chars) : Obj(ObjType::String), chars(std::move(chars)) {}
+
+    std::string chars;
+    Symbol symbol = noSymbol; // `chars` interned, once it has been used as a key
+};
+
+// The symbol of a string used as a field name or object key.
+inline Symbol symbolOf(ObjString* string) {
+    if (string->symbol == noSymbol) string->symbol = symbols().intern(string->chars);
+    return string->symbol;
+}
+
+struct ObjArray : Obj {
+    ObjArray() : Obj(ObjType::Array) {}
+
+    std::vector<Value> elements;
+};
+
+// A bag of named fields, created by object() and accessed with '.' or '[]'.
+// The values sit in `slots`; which field is in which slot is the shape's to
+// say, or, once the object has outgrown shapes (Shape::maxFields), its own
+// dictionary's.
+struct ObjInstance : Obj {
+    ObjInstance() : Obj(ObjType::Instance), shape(Shape::empty()) {}
+
+    Shape* shape; // nullptr in dictionary mode
+    std::vector<Value> slots;
+    std::unique_ptr<std::unordered_map<Symbol, uint32_t>> dictionary; // Name -> slot, in dictionary mode
+};
+
+// A function declared in the program, closed over the environment it was
+// declared in.
+struct ObjFunction : Obj {
+    ObjFunction(FuncDecl* declaration, std::shared_ptr<Environment> closure)
+        : Obj(ObjType::Function), declaration(declaration), closure(std::move(closure)) {
+    }
+
+    FuncDecl* declaration;
+    std::shared_ptr<Environment> closure;
+};
+
+// Builtins receive their arguments as an array and report misuse by throwing
+// a RuntimeError (line 0; the caller supplies the call's line).
+using NativeFn = Value (*)(Heap& heap, const Value* args, int argCount);
+
+struct ObjNative : Obj {
+    ObjNative(std::string_view name, NativeFn function, int arity)
+        : Obj(ObjType::Native), name(name), function(function), arity(arity) {
+    }
+
+    std::string_view name;
+    NativeFn function;
+    int arity; // -1 accepts any number of arguments
+};
+
+// A function compiled to bytecode by the Compiler.
+struct ObjProto : Obj {
+    ObjProto() : Obj(ObjType::Proto) {}
+
+    Chunk chunk;
+    std::string_view name; // Empty for the top-level script
+    int arity = 0;
+    int upvalueCount = 0;
+    int maxStack = 0;      // Stack slots a call needs, including its locals
+};
+
+// A variable captured by a closure. While the variable's frame is live,
+// `location` points at its stack slot; when the frame goes away the value
+// moves into `closed` and `location` points there instead.
+struct ObjUpvalue : Obj {
+    explicit ObjUpvalue(Value* location) : Obj(ObjType::Upvalue), location(location) {}
+
+    Value* location;
+    Value closed;
+    ObjUpvalue* nextOpen = nullptr; // VM's list of open upvalues, highest slot first
+};
+
+// What a FuncDecl evaluates to in the VM: its Proto and captured variables.
+struct ObjClosure : Obj {
+    explicit ObjClosure(ObjProto* proto)
+        : Obj(ObjType::Closure), proto(proto), upvalues(proto->upvalueCount, nullptr) {
+    }
+
+    ObjProto* proto;
+    std::vector<ObjUpvalue*> upvalues;
+};
+
+// What a FuncDecl evaluates to in the IrInterpreter. Captured variables are
+// cells: upvalues that are closed from the start.
+struct ObjIrClosure : Obj {
+    explicit ObjIrClosure(IrFunction* function) : Obj(ObjType::IrClosure), function(function) {}
+
+    IrFunction* function;
+    std::vector<ObjUpvalue*> cells;
+};
+
+inline ObjString* asString(Value value) { return static_cast<ObjString*>(value.asObject()); }
+inline ObjArray* asArray(Value value) { return static_cast<ObjArray*>(value.asObject()); }
+inline ObjInstance* asInstance(Value value) { return static_cast<ObjInstance*>(value.asObject()); }
+inline ObjFunction* asFunction(Value value) { return static_cast<ObjFunction*>(value.asObject()); }
+inline ObjNative* asNative(Value value) { return static_cast<ObjNative*>(value.asObject()); }
+inline ObjProto* asProto(Value value) { return static_cast<ObjProto*>(value.asObject()); }
+inline ObjClosure* asClosure(Value value) { return static_cast<ObjClosure*>(value.asObject()); }
+inline ObjIrClosure* asIrClosure(Value value) { return static_cast<ObjIrClosure*>(value.asObject()); }
+
+// --- Heap ---
+
+// Owns every object a running program creates, in two generations.
+//
+// New objects are bump-allocated in the nursery, one fixed block. When it
+// fills up, a minor collection copies the objects still reachable into the
+// old generation (individually allocated, on an intrusive list) and starts
+// the nursery over; the rest are destroyed in one linear pass. Once the old
+// generation has grown to twice what the last full collection left (and to
+// at least eight nurseries), the next collection is also a full one: a
+// mark-sweep of the old generation.
+//
+// Collections only happen at safepoints, where the engine has every value it
+// holds in places it reports to setRoots' callback: the engines poll with
+// safepoint() on backward jumps and calls, and an allocation only ever asks
+// for a collection. Between safepoints an allocation that does not fit in
+// the nursery goes straight to the old generation.
+//
+// Minor collections find old objects that point into the nursery through
+// the remembered set, which writeBarrier() fills: every store of a value
+// into an object's fields must go through it. Objects allocated directly
+// into the old generation start out remembered.
+//
+// A heap without roots (the tree-walking interpreter's, whose frames and
+// temporaries live on the C++ stack) never collects: its objects all go to
+// the old generation and live until the Heap is destroyed.
+class Heap {
+public:
+    static constexpr size_t defaultNurseryBytes = 1 << 20;
+
+    explicit Heap(size_t nurseryBytes = defaultNurseryBytes);
+    ~Heap();
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    ObjString* makeString(std::string chars);
+    ObjArray* makeArray();
+    ObjInstance* makeInstance();
+    ObjFunction* makeFunction(FuncDecl* declaration, std::shared_ptr<Environment> closure);
+    ObjNative* makeNative(std::string_view name, NativeFn function, int arity);
+    ObjProto* makeProto();
+    ObjClosure* makeClosure(ObjProto* proto);
+    ObjUpvalue* makeUpvalue(Value* location);
+    ObjUpvalue* makeCell(Value value); // An upvalue closed over `value`
+    ObjIrClosure* makeIrClosure(IrFunction* function);
+
+    // While one of these is alive, new objects are permanent: compilers
+    // allocate their constants (string literals, prototypes, folded strings)
+    // this way, since compiled code refers to them from outside the heap.
+    class PermanentScope {
+    public:
+        explicit PermanentScope(Heap& heap) : heap(heap) { ++heap.permanentDepth; }
+        ~PermanentScope() { --heap.permanentDepth; }
+
+    private:
+        Heap& heap;
+    };
+
+    // --- Collection ---
+
+    // Registers the engine's roots and turns on the nursery. During a
+    // collection `traceRoots` passes every reference held outside the heap
+    // to traceRoot(), which may update it.
+    void setRoots(std::function<void()> traceRoots);
+    void traceRoot(Value& value);
+    template <typename T>
+    void traceRoot(T*& object) {
+        Obj* traced = object;
+        visit(traced);
+        object = static_cast<T*>(traced);
+    }
+
+    bool collectionPending() const { return pending; }
+    // Collects if an allocation asked for it. The caller's roots must be
+    // up to date, and it must reload any object pointer it keeps elsewhere.
+    void safepoint() {
+        if (pending) collect(false);
+    }
+    // A minor collection, followed by a full one if `full` is set or the old
+    // generation has reached its threshold.
+    void collect(bool full);
+
+    // Call after storing `value` into `container`'s fields.
+    void writeBarrier(Obj* container, Value value) {
+        if (container->generation != Generation::Nursery && !container->remembered && value.isObject() &&
+            value.asObject()->generation == Generation::Nursery) {
+            remember(container);
+        }
+    }
+
+    // Memory `object` took on after it was created (array elements, say),
+    // so that it counts toward the next collection.
+    void noteGrowth(Obj* object, size_t bytes);
+
+    struct Stats {
+        size_t minorCollections = 0;
+        size_t fullCollections = 0;
+        size_t nurseryBytes = 0;      // Capacity; 0 when the heap never collects
+        size_t allocatedBytes = 0;    // Every object ever made, with what it owned when made
+        size_t promotedBytes = 0;     // Copied out of the nursery
+        size_t oldBytes = 0;          // Old generation, as last counted
+        size_t oldObjects = 0;
+        size_t permanentObjects = 0;
+        size_t freedObjects = 0;      // By all collections
+        double pauseSeconds = 0.0;    // Total
+        double maxPauseSeconds = 0.0;
+        std::vector<double> pauses;   // Every collection's pause in seconds, in order
+    };
+    const Stats& stats() const { return counters; }
+    size_t objectCount() const { return counters.oldObjects + counters.permanentObjects + nurseryObjects; }
+
+private:
+    enum class Phase : uint8_t { Idle, Evacuate, Mark };
+    static constexpr size_t alignment = alignof(std::max_align_t);
+
+    std::unique_ptr<char[]> nursery;
+    char* nurseryTop = nullptr;
+    char* nurseryEnd = nullptr;
+    size_t nurseryObjects = 0;
+    size_t nurseryGrowth = 0;   // noteGrowth() bytes since the last collection
+    Obj* oldHead = nullptr;
+    Obj* permanentHead = nullptr;
+    int permanentDepth = 0;
+    size_t minimumFullBytes;     // Eight nurseries
+    size_t fullThreshold;        // Old generation size that makes the next collection full
+    std::vector<Obj*> remembered;
+    std::vector<Obj*> grey;      // Reached, fields not traced yet
+    std::function<void()> traceRoots;
+    bool pending = false;
+    Phase phase = Phase::Idle;
+    Stats counters;
+
+    template <typename T, typename... Args>
+    T* allocate(Args&&... args) {
+        constexpr size_t size = (sizeof(T) + alignment - 1) & ~(alignment - 1);
+        if (permanentDepth == 0 && static_cast<size_t>(nurseryEnd - nurseryTop) >= size) {
+            T* object = new (nurseryTop) T(std::forward<Args>(args)...);
+            object->generation = Generation::Nursery;
+            nurseryTop += size;
+            ++nurseryObjects;
+            counters.allocatedBytes += size;
+            return object;
+        }
+        return adopt(new T(std::forward<Args>(args)...), sizeof(T));
+    }
+    // Puts an object allocated outside the nursery on its generation's list.
+    template <typename T>
+    T* adopt(T* object, size_t size) {
+        adoptObject(object, size);
+        return object;
+    }
+    void adoptObject(Obj* object, size_t size);
+    void remember(Obj* object);
+    void requestCollection();
+
+    void visit(Obj*& object);
+    void traceFields(Obj* object);
+    Obj* promote(Obj* object);
+    void collectNursery();
+    void collectOld();
+};
@@ -0,0 +1,259 @@
+#include "operators.h"
+#include <cmath>
+#include <memory>
+
+namespace {
+
+double numberOperand(Value value) {
+    if (!value.isNumber()) throw RuntimeError("Operands must be numbers.");
+    return value.asNumber();
+}
+
+Value concatenate(Heap& heap, Value left, Value right) {
+    std::string chars = left.isString() ? asString(left)->chars : valueToString(left);
+    if (right.isString()) chars += asString(right)->chars;
+    else chars += valueToString(right);
+    return Value::object(heap.makeString(std::move(chars)));
+}
+
+Value compare(TokenType op, Value left, Value right) {
+    int order;
+    if (left.isNumber() && right.isNumber()) {
+        double a = left.asNumber(), b = right.asNumber();
+        // NaN compares false every way.
+        if (a != a || b != b) return Value::boolean(false);
+        order = a < b ? -1 : (a > b ? 1 : 0);
+    }
+    else if (left.isString() && right.isString()) {
+        order = asString(left)->chars.compare(asString(right)->chars);
+    }
+    else {
+        throw RuntimeError("Operands must be two numbers or two strings.");
+    }
+
+    switch (op) {
+    case TokenType::LESS: return Value::boolean(order < 0);
+    case TokenType::LESS_EQUAL: return Value::boolean(order <= 0);
+    case TokenType::GREATER: return Value::boolean(order > 0);
+    default: return Value::boolean(order >= 0);
+    }
+}
+
+} // namespace
+
+Value applyBinary(Heap& heap, TokenType op, Value left, Value right) {
+    switch (op) {
+    case TokenType::PLUS:
+        if (left.isNumber() && right.isNumber()) return Value::number(left.asNumber() + right.asNumber());
+        if (left.isString() || right.isString()) return concatenate(heap, left, right);
+        throw RuntimeError("Operands must be two numbers or include a string.");
+    case TokenType::MINUS: return Value::number(numberOperand(left) - numberOperand(right));
+    case TokenType::STAR: return Value::number(numberOperand(left) * numberOperand(right));
+    case TokenType::SLASH: return Value::number(numberOperand(left) / numberOperand(right));
+    case TokenType::PERCENT: return Value::number(std::fmod(numberOperand(left), numberOperand(right)));
+
+    case TokenType::AMP:
+        return Value::number(static_cast<double>(toInteger(numberOperand(left)) & toInteger(numberOperand(right))));
+    case TokenType::PIPE:
+        return Value::number(static_cast<double>(toInteger(numberOperand(left)) | toInteger(numberOperand(right))));
+    case TokenType::CARET:
+        return Value::number(static_cast<double>(toInteger(numberOperand(left)) ^ toInteger(numberOperand(right))));
+    case TokenType::SHIFT_LEFT: {
+        uint64_t bits = static_cast<uint64_t>(toInteger(numberOperand(left)));
+        return Value::number(static_cast<double>(static_cast<int64_t>(bits << (toInteger(numberOperand(right)) & 63))));
+    }
+    case TokenType::SHIFT_RIGHT:
+        return Value::number(static_cast<double>(toInteger(numberOperand(left)) >> (toInteger(numberOperand(right)) & 63)));
+
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+        return compare(op, left, right);
+
+    case TokenType::EQUAL_EQUAL: return Value::boolean(valuesEqual(left, right));
+    case TokenType::BANG_EQUAL: return Value::boolean(!valuesEqual(left, right));
+
+    default:
+        throw RuntimeError("Unknown binary operator.");
+    }
+}
+
+Value applyUnary(TokenType op, Value operand) {
+    switch (op) {
+    case TokenType::BANG: return Value::boolean(!operand.isTruthy());
+    case TokenType::MINUS:
+        if (!operand.isNumber()) throw RuntimeError("Operand must be a number.");
+        return Value::number(-operand.asNumber());
+    case TokenType::PLUS:
+        if (!operand.isNumber()) throw RuntimeError("Operand must be a number.");
+        return operand;
+    case TokenType::TILDE:
+        if (!operand.isNumber()) throw RuntimeError("Operand must be a number.");
+        return Value::number(static_cast<double>(~toInteger(operand.asNumber())));
+    default:
+        throw RuntimeError("Unknown unary operator.");
+    }
+}
+
+Value applyIncrement(TokenType op, Value operand) {
+    if (!operand.isNumber()) throw RuntimeError("Operand must be a number.");
+    return Value::number(operand.asNumber() + (op == TokenType::MINUS_MINUS ? -1 : 1));
+}
+
+TokenType compoundAssignmentOperator(TokenType assignment) {
+    switch (assignment) {
+    case TokenType::PLUS_EQUAL: return TokenType::PLUS;
+    case TokenType::MINUS_EQUAL: return TokenType::MINUS;
+    case TokenType::STAR_EQUAL: return TokenType::STAR;
+    case TokenType::SLASH_EQUAL: return TokenType::SLASH;
+    case TokenType::PERCENT_EQUAL: return TokenType::PERCENT;
+    case TokenType::SHIFT_LEFT_EQUAL: return TokenType::SHIFT_LEFT;
+    case TokenType::SHIFT_RIGHT_EQUAL: return TokenType::SHIFT_RIGHT;
+    case TokenType::AMP_EQUAL: return TokenType::AMP;
+    case TokenType::CARET_EQUAL: return TokenType::CARET;
+    case TokenType::PIPE_EQUAL: return TokenType::PIPE;
+    default: return TokenType::EQUAL;
+    }
+}
+
+namespace {
+
+size_t elementIndex(Value key, size_t size, const char* kind) {
+    if (!key.isNumber()) throw RuntimeError(std::string(kind) + " index must be a number.");
+    double index = key.asNumber();
+    if (!(index >= 0 && index < static_cast<double>(size))) {
+        throw RuntimeError(std::string(kind) + " index out of range.");
+    }
+    return static_cast<size_t>(index);
+}
+
+ObjInstance* fieldOwner(Value object) {
+    if (!object.isObjType(ObjType::Instance)) throw RuntimeError("Only objects have fields.");
+    return asInstance(object);
+}
+
+uint32_t slotOf(ObjInstance* instance, Symbol name) {
+    if (instance->shape != nullptr) return instance->shape->slotOf(name);
+    auto it = instance->dictionary->find(name);
+    return it == instance->dictionary->end() ? Shape::missing : it->second;
+}
+
+Value fieldAt(ObjInstance* instance, uint32_t slot) {
+    return slot == Shape::missing ? Value::nil() : instance->slots[slot];
+}
+
+// Memory the object holds beyond itself, for Heap::noteGrowth.
+size_t fieldBytes(const ObjInstance* instance) {
+    size_t bytes = instance->slots.capacity() * sizeof(Value);
+    if (instance->dictionary != nullptr) {
+        bytes += instance->dictionary->size() * (sizeof(Symbol) + sizeof(uint32_t) + 2 * sizeof(void*)) +
+            instance->dictionary->bucket_count() * sizeof(void*);
+    }
+    return bytes;
+}
+
+// Adds the field `name`, which `instance` lacks. An object whose shape has
+// no room for another field moves to a dictionary.
+void addField(Heap& heap, ObjInstance* instance, Symbol name, Value value) {
+    size_t before = fieldBytes(instance);
+    if (instance->shape != nullptr) {
+        Shape* grown = instance->shape->withField(name);
+        if (grown == nullptr) {
+            instance->dictionary = std::make_unique<std::unordered_map<Symbol, uint32_t>>();
+            for (uint32_t slot = 0; slot < instance->shape->fieldCount(); ++slot) {
+                instance->dictionary->emplace(instance->shape->nameAt(slot), slot);
+            }
+        }
+        instance->shape = grown;
+    }
+    if (instance->dictionary != nullptr) {
+        instance->dictionary->emplace(name, static_cast<uint32_t>(instance->slots.size()));
+    }
+    instance->slots.push_back(value);
+    heap.writeBarrier(instance, value);
+    size_t after = fieldBytes(instance);
+    if (after > before) heap.noteGrowth(instance, after - before);
+}
+
+void storeField(Heap& heap, ObjInstance* instance, Symbol name, Value value) {
+    uint32_t slot = slotOf(instance, name);
+    if (slot == Shape::missing) {
+        addField(heap, instance, name, value);
+        return;
+    }
+    instance->slots[slot] = value;
+    heap.writeBarrier(instance, value);
+}
+
+} // namespace
+
+Value getIndex(Heap& heap, Value container, Value key) {
+    if (container.isObjType(ObjType::Array)) {
+        std::vector<Value>& elements = asArray(container)->elements;
+        return elements[elementIndex(key, elements.size(), "Array")];
+    }
+    if (container.isObjType(ObjType::Instance)) {
+        if (!key.isString()) throw RuntimeError("Object key must be a string.");
+        ObjInstance* instance = asInstance(container);
+        return fieldAt(instance, slotOf(instance, symbolOf(asString(key))));
+    }
+    if (container.isString()) {
+        const std::string& chars = asString(container)->chars;
+        return Value::object(heap.makeString(std::string(1, chars[elementIndex(key, chars.size(), "String")])));
+    }
+    throw RuntimeError("Only arrays, strings and objects can be indexed.");
+}
+
+void setIndex(Heap& heap, Value container, Value key, Value value) {
+    if (container.isObjType(ObjType::Array)) {
+        std::vector<Value>& elements = asArray(container)->elements;
+        elements[elementIndex(key, elements.size(), "Array")] = value;
+        heap.writeBarrier(container.asObject(), value);
+        return;
+    }
+    if (container.isObjType(ObjType::Instance)) {
+        if (!key.isString()) throw RuntimeError("Object key must be a string.");
+        setField(heap, container, symbolOf(asString(key)), value);
+        return;
+    }
+    // Strings are immutable.
+    if (container.isString()) throw RuntimeError("Invalid assignment target.");
+    throw RuntimeError("Only arrays, strings and objects can be indexed.");
+}
+
+Value getField(Value object, Symbol name) {
+    ObjInstance* instance = fieldOwner(object);
+    return fieldAt(instance, slotOf(instance, name));
+}
+
+void setField(Heap& heap, Value object, Symbol name, Value value) {
+    storeField(heap, fieldOwner(object), name, value);
+}
+
+Value getFieldMiss(Value object, Symbol name, InlineCache& cache) {
+    ObjInstance* instance = fieldOwner(object);
+    ++inlineCacheStats.misses;
+    uint32_t slot = slotOf(instance, name);
+    if (instance->shape != nullptr && !cache.megamorphic) cache.add({ instance->shape, nullptr, slot });
+    return fieldAt(instance, slot);
+}
+
+void setFieldMiss(Heap& heap, Value object, Symbol name, Value value, InlineCache& cache) {
+    ObjInstance* instance = fieldOwner(object);
+    ++inlineCacheStats.misses;
+    Shape* before = instance->shape;
+    if (before == nullptr) {
+        storeField(heap, instance, name, value);
+        return;
+    }
+    uint32_t slot = before->slotOf(name);
+    if (slot != Shape::missing) {
+        instance->slots[slot] = value;
+        heap.writeBarrier(instance, value);
+        cache.add({ before, nullptr, slot });
+        return;
+    }
+    addField(heap, instance, name, value);
+    if (instance->shape != nullptr) cache.add({ before, instance->shape, Shape::missing });
+}
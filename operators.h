@@ -0,0 +1,94 @@
+#pragma once
+#include "object.h"
+#include "token.h"
+
+// Semantics of the language's operators, shared by every execution engine.
+// Errors are thrown as RuntimeError with line 0; callers add the line.
+//
+//  - Arithmetic (+ - * / %) works on numbers; '+' concatenates when either
+//    operand is a string, printing the other one as `print` would.
+//  - Bitwise operators (& | ^ ~ << >>) truncate their operands to 64-bit
+//    integers; shift counts use the low six bits.
+//  - Comparisons (< <= > >=) work on two numbers or two strings.
+//  - == and != never fail (see valuesEqual).
+
+// Integer view of a number for the bitwise operators (0 for NaN and infinities).
+inline int64_t toInteger(double value) {
+    if (!(value > -9.2e18 && value < 9.2e18)) return 0;
+    return static_cast<int64_t>(value);
+}
+
+// `left op right` for every binary operator except && and ||.
+Value applyBinary(Heap& heap, TokenType op, Value left, Value right);
+
+// `op operand` for ! ~ - +. (Prefix ++ and -- are assignments.)
+Value applyUnary(TokenType op, Value operand);
+
+// The value ++ (PLUS_PLUS) or -- (MINUS_MINUS) stores: the operand plus or
+// minus one. Only numbers can be incremented.
+Value applyIncrement(TokenType op, Value operand);
+
+// The operator a compound assignment applies: PLUS_EQUAL -> PLUS and so on.
+// Returns EQUAL for plain assignment.
+TokenType compoundAssignmentOperator(TokenType assignment);
+
+// --- Element and Field Access ---
+// `container[key]`: arrays take a number index, objects a string key (missing
+// keys read as nil) and strings a number index (yielding a one-character
+// string).
+Value getIndex(Heap& heap, Value container, Value key);
+
+// `container[key] = value` for arrays and objects (through the heap's write
+// barrier).
+void setIndex(Heap& heap, Value container, Value key, Value value);
+
+// `object.name` (nil if the field is missing) and `object.name = value`.
+Value getField(Value object, Symbol name);
+void setField(Heap& heap, Value object, Symbol name, Value value);
+
+// The same at a field access site with an inline cache: a shape the site has
+// met before skips the lookup by name. The misses, and every access at a
+// megamorphic site, are out of line.
+Value getFieldMiss(Value object, Symbol name, InlineCache& cache);
+void setFieldMiss(Heap& heap, Value object, Symbol name, Value value, InlineCache& cache);
+
+inline Value getField(Value object, Symbol name, InlineCache& cache) {
+    if (object.isObjType(ObjType::Instance) && !cache.megamorphic) {
+        ObjInstance* instance = asInstance(object);
+        for (int i = 0; i < cache.size; ++i) {
+            const InlineCache::Entry& entry = cache.entries[i];
+            if (entry.shape != instance->shape) continue;
+            ++inlineCacheStats.hits;
+            return entry.slot == Shape::missing ? Value::nil() : instance->slots[entry.slot];
+        }
+    }
+    return getFieldMiss(object, name, cache);
+}
+
+inline void setField(Heap& heap, Value object, Symbol name, Value value, InlineCache& cache) {
+    if (object.isObjType(ObjType::Instance) && !cache.megamorphic) {
+        ObjInstance* instance = asInstance(object);
+        for (int i = 0; i < cache.size; ++i) {
+            const InlineCache::Entry& entry = cache.entries[i];
+            if (entry.shape != instance->shape) continue;
+            if (entry.grown != nullptr) {
+                size_t capacity = instance->slots.capacity();
+                instance->slots.push_back(value);
+                instance->shape = entry.grown;
+                if (instance->slots.capacity() != capacity) {
+                    heap.noteGrowth(instance, (instance->slots.capacity() - capacity) * sizeof(Value));
+                }
+            }
+            else if (entry.slot != Shape::missing) {
+                instance->slots[entry.slot] = value;
+            }
+            else {
+                continue; // A read found the field missing; this store adds it
+            }
+            heap.writeBarrier(instance, value);
+            ++inlineCacheStats.hits;
+            return;
+        }
+    }
+    setFieldMiss(heap, object, name, value, cache);
+}
@@ -0,0 +1,194 @@
+#include "parallel_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Runs `task(worker, index)` for every index below `count` on `threadCount`
+// threads (the calling one included). Each worker starts with a contiguous
+// share of the indices, so neighbouring pieces stay on one thread, and takes
+// them from the front. A worker whose share runs out steals single indices
+// from the back of another's. A share is one word (front << 32 | back)
+// updated by compare-and-swap, so owner and thieves never take the same index.
+// Returns the number of stolen indices.
+template <typename Task>
+size_t runWorkStealing(size_t count, unsigned threadCount, Task task) {
+    struct alignas(64) Share {
+        std::atomic<uint64_t> bounds{ 0 };
+    };
+    auto pack = [](uint64_t front, uint64_t back) { return front << 32 | back; };
+    auto take = [&](Share& share, bool fromBack, size_t& index) {
+        uint64_t bounds = share.bounds.load();
+        while (true) {
+            uint64_t front = bounds >> 32;
+            uint64_t back = bounds & 0xFFFFFFFFu;
+            if (front >= back) return false;
+            uint64_t next = fromBack ? pack(front, back - 1) : pack(front + 1, back);
+            if (share.bounds.compare_exchange_weak(bounds, next)) {
+                index = static_cast<size_t>(fromBack ? back - 1 : front);
+                return true;
+            }
+        }
+    };
+
+    const unsigned workers = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threadCount, count)));
+    std::vector<Share> shares(workers);
+    for (unsigned w = 0; w < workers; ++w) {
+        shares[w].bounds = pack(count * w / workers, count * (w + 1) / workers);
+    }
+    std::atomic<size_t> stolen{ 0 };
+    auto worker = [&](unsigned self) {
+        size_t index;
+        while (take(shares[self], false, index)) task(self, index);
+        // No work is ever added, so one sweep finding every share empty ends it.
+        for (unsigned victim = (self + 1) % workers; victim != self; victim = (victim + 1) % workers) {
+            while (take(shares[victim], true, index)) {
+                stolen.fetch_add(1, std::memory_order_relaxed);
+                task(self, index);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 1; w < workers; ++w) {
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return stolen.load();
+}
+
+} // namespace
+
+ParallelParser::ParallelParser(const std::vector<Token>& tokens, AstArena& arena, unsigned threadCount,
+    ExpressionParser expressionParser)
+    : tokenVector(&tokens), arena(arena), threadCount(threadCount), expressionParser(expressionParser) {
+}
+
+ParallelParser::ParallelParser(const TokenBuffer& tokens, AstArena& arena, unsigned threadCount,
+    ExpressionParser expressionParser)
+    : tokenBuffer(&tokens), arena(arena), threadCount(threadCount), expressionParser(expressionParser) {
+}
+
+TokenType ParallelParser::typeAt(size_t index) const {
+    return tokenBuffer != nullptr ? tokenBuffer->type(index) : (*tokenVector)[index].type;
+}
+
+size_t ParallelParser::tokenCount() const {
+    return tokenBuffer != nullptr ? tokenBuffer->size() : tokenVector->size();
+}
+
+Parser ParallelParser::makeParser(AstArena& target) const {
+    if (tokenBuffer != nullptr) return Parser(*tokenBuffer, target, expressionParser);
+    return Parser(*tokenVector, target, expressionParser);
+}
+
+std::vector<size_t> ParallelParser::findPieces(size_t targetCount) const {
+    // Brackets of all three kinds are matched, so a `var` in a for loop's
+    // header or a `fun` inside a body is never a cut. This follows the parser
+    // through broken code too: after a missing closing brace it also nests
+    // everything that follows. A cut that turns out not to be a boundary
+    // only costs its piece being parsed again.
+    const size_t count = tokenCount();
+    const size_t step = count / targetCount + 1;
+    std::vector<size_t> starts{ 0 };
+    int depth = 0;
+    for (size_t i = 0; i < count; ++i) {
+        switch (typeAt(i)) {
+        case TokenType::LEFT_BRACE:
+        case TokenType::LEFT_PAREN:
+        case TokenType::LEFT_BRACKET:
+            ++depth;
+            break;
+        case TokenType::RIGHT_BRACE:
+        case TokenType::RIGHT_PAREN:
+        case TokenType::RIGHT_BRACKET:
+            depth = std::max(depth - 1, 0);
+            break;
+        case TokenType::FUN:
+        case TokenType::VAR:
+            if (depth == 0 && i >= starts.back() + step) starts.push_back(i);
+            break;
+        default:
+            break;
+        }
+    }
+    return starts;
+}
+
+std::vector<Declaration*> ParallelParser::parse() {
+    lastStats = Stats();
+    hadError = false;
+    if (threadCount <= 1) {
+        Parser parser = makeParser(arena);
+        std::vector<Declaration*> declarations = parser.parse();
+        hadError = parser.Error();
+        return declarations;
+    }
+
+    // --- Parse the pieces ---
+    // Several pieces per thread give the stealing something to balance.
+    std::vector<size_t> starts = findPieces(static_cast<size_t>(threadCount) * 8);
+    const size_t pieceCount = starts.size();
+    struct Piece {
+        std::vector<Declaration*> declarations;
+        size_t stop = 0; // Where the declaration after the piece's last starts
+        std::ostringstream diagnostics;
+        bool hadError = false;
+    };
+    std::vector<Piece> pieces(pieceCount);
+    std::vector<AstArena> workerArenas(std::min<size_t>(threadCount, pieceCount));
+    lastStats.pieces = pieceCount;
+    lastStats.stolen = runWorkStealing(pieceCount, threadCount, [&](unsigned worker, size_t i) {
+        Piece& piece = pieces[i];
+        size_t end = i + 1 < pieceCount ? starts[i + 1] : tokenCount();
+        Parser parser = makeParser(workerArenas[worker]);
+        parser.setErrorOutput(piece.diagnostics);
+        size_t position = starts[i];
+        while (position < end && typeAt(position) != TokenType::END_OF_FILE) {
+            Declaration* declaration = parser.parseDeclarationAt(position);
+            if (declaration != nullptr) piece.declarations.push_back(declaration);
+            position = parser.position();
+        }
+        piece.stop = position;
+        piece.hadError = parser.Error();
+    });
+
+    // --- Merge in source order ---
+    // A piece is used when parsing reached exactly its start; the gaps left
+    // by the others are parsed here, on the caller's arena, in order.
+    std::vector<Declaration*> declarations;
+    Parser serial = makeParser(arena);
+    size_t position = 0;
+    for (size_t i = 0; i < pieceCount; ++i) {
+        Piece& piece = pieces[i];
+        if (position == starts[i]) {
+            declarations.insert(declarations.end(), piece.declarations.begin(), piece.declarations.end());
+            std::cerr << piece.diagnostics.str();
+            hadError = hadError || piece.hadError;
+            position = piece.stop;
+        }
+        else {
+            ++lastStats.piecesReparsed;
+        }
+        size_t end = i + 1 < pieceCount ? starts[i + 1] : tokenCount();
+        while (position < end && typeAt(position) != TokenType::END_OF_FILE) {
+            Declaration* declaration = serial.parseDeclarationAt(position);
+            if (declaration != nullptr) declarations.push_back(declaration);
+            position = serial.position();
+        }
+    }
+    hadError = hadError || serial.Error();
+
+    // Unused pieces' nodes come along too; they are freed with the rest.
+    for (AstArena& workerArena : workerArenas) {
+        arena.adopt(workerArena);
+    }
+    return declarations;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "ast_arena.h"
+#include "parser.h"
+#include "token.h"
+#include "token_buffer.h"
+
+class Declaration;
+
+// Parses a token vector or TokenBuffer on several threads.
+// A pass over the token types cuts the program before `fun` and `var`
+// tokens outside any brackets, which is where top-level declarations start. The pieces are parsed concurrently on a work-stealing pool, each
+// worker allocating into an arena of its own (adopted by the caller's arena
+// afterwards), and merged in source order.
+//
+// The result matches Parser::parse() exactly, diagnostics on std::cerr
+// included. The parser is LL(1), so a declaration depends only on the tokens
+// from its first one on: a piece is used only if the declarations before it
+// end exactly where it starts. Otherwise (a cut that was not a boundary after
+// all, say after a syntax error) the merge parses serially from where the
+// previous piece stopped up to the next piece.
+class ParallelParser {
+public:
+    ParallelParser(const std::vector<Token>& tokens, AstArena& arena, unsigned threadCount,
+        ExpressionParser expressionParser = ExpressionParser::Pratt);
+    ParallelParser(const TokenBuffer& tokens, AstArena& arena, unsigned threadCount,
+        ExpressionParser expressionParser = ExpressionParser::Pratt);
+
+    std::vector<Declaration*> parse();
+    bool Error() const { return hadError; }
+
+    // How the last parse() split up.
+    struct Stats {
+        size_t pieces = 0;
+        size_t piecesReparsed = 0; // Not starting on a boundary, so parsed again
+        size_t stolen = 0;         // Taken by a worker from another's share
+    };
+    const Stats& stats() const { return lastStats; }
+
+private:
+    const std::vector<Token>* tokenVector = nullptr;
+    const TokenBuffer* tokenBuffer = nullptr;
+    AstArena& arena;
+    const unsigned threadCount;
+    const ExpressionParser expressionParser;
+    bool hadError = false;
+    Stats lastStats;
+
+    TokenType typeAt(size_t index) const;
+    size_t tokenCount() const;
+    // Where the pieces start: token 0, then cuts chosen so that there are
+    // about `targetCount` pieces of similar size.
+    std::vector<size_t> findPieces(size_t targetCount) const;
+    Parser makeParser(AstArena& arena) const;
+};
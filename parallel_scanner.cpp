@@ -0,0 +1,180 @@
+#include "parallel_scanner.h"
+#include "scanner.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+ParallelScanner::ParallelScanner(std::string_view source, unsigned threadCount, ScanBackend backend)
+    : source(source), threadCount(threadCount), backend(backend) {
+}
+
+std::vector<ParallelScanner::Chunk> ParallelScanner::findChunks(size_t targetCount) const {
+    // Tracks just enough lexical state to know when a newline is outside strings
+    // and comments. Every newline is counted (the Scanner counts those inside
+    // strings and comments too) so each chunk knows its starting line.
+    //
+    // Cuts are also restricted to line ends that directly follow a token (only
+    // spaces, tabs or '\r' in between), and a chunk begins right after that
+    // token. There the sequential Scanner has just reset `start`, which is the
+    // state a fresh chunk Scanner begins in (an unterminated block comment
+    // reports its column relative to that `start`).
+    const ScanKernels& kernels = scanKernels(backend);
+    const char* text = source.data();
+    const size_t length = source.size();
+    const size_t step = length / targetCount + 1;
+
+    std::vector<Chunk> chunks{ { 0, 1 } };
+    size_t nextCut = step;
+    size_t lastNewline = 0;
+    int line = 1;
+    bool afterToken = false;
+    size_t tokenEnd = 0;
+    size_t pos = 0;
+    while (pos < length) {
+        char c = text[pos];
+        if (c == '\n') {
+            // The chunk's first newline then sets lineStart exactly like the
+            // sequential scan does.
+            if (pos >= nextCut && afterToken) {
+                chunks.push_back({ tokenEnd, line });
+                nextCut = pos + step;
+            }
+            line++;
+            pos++;
+            afterToken = false;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r') {
+            pos++;
+        }
+        else if (c == '"') {
+            int newlines = 0;
+            pos = kernels.findQuote(text, pos + 1, length, newlines, lastNewline) + 1;
+            line += newlines;
+            afterToken = true;
+            tokenEnd = pos;
+        }
+        else if (c == '/' && pos + 1 < length && text[pos + 1] == '/') {
+            pos = kernels.findNewline(text, pos + 2, length);
+            afterToken = false;
+        }
+        else if (c == '/' && pos + 1 < length && text[pos + 1] == '*') {
+            int newlines = 0;
+            pos = kernels.findCommentEnd(text, pos + 2, length, newlines, lastNewline) + 2;
+            line += newlines;
+            afterToken = false;
+        }
+        else {
+            pos++;
+            afterToken = true;
+            tokenEnd = pos;
+        }
+    }
+    return chunks;
+}
+
+template <typename Result, typename Scan>
+std::vector<Result> ParallelScanner::scanChunks(const std::vector<Chunk>& chunks, Scan scan) {
+    const size_t chunkCount = chunks.size();
+    std::vector<Result> results(chunkCount);
+    std::vector<std::ostringstream> diagnostics(chunkCount);
+    std::vector<char> chunkErrors(chunkCount, 0);
+
+    std::atomic<size_t> nextChunk{ 0 };
+    auto worker = [&] {
+        for (size_t i = nextChunk.fetch_add(1); i < chunkCount; i = nextChunk.fetch_add(1)) {
+            size_t begin = chunks[i].begin;
+            size_t end = i + 1 < chunkCount ? chunks[i + 1].begin : source.size();
+            Scanner scanner(source.substr(begin, end - begin), chunks[i].firstLine, diagnostics[i], backend);
+            results[i] = scan(scanner);
+            chunkErrors[i] = scanner.didEncounterError();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    size_t helperCount = std::min<size_t>(threadCount, chunkCount) - 1;
+    for (size_t t = 0; t < helperCount; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Replay diagnostics in source order.
+    for (size_t i = 0; i < chunkCount; ++i) {
+        std::cerr << diagnostics[i].str();
+        hadError = hadError || chunkErrors[i];
+    }
+    return results;
+}
+
+std::vector<Token> ParallelScanner::scanTokens() {
+    if (threadCount <= 1) {
+        Scanner scanner(source, backend);
+        std::vector<Token> tokens = scanner.scanTokens();
+        hadError = scanner.didEncounterError();
+        return tokens;
+    }
+
+    // A few chunks per thread keeps the threads busy when chunks scan unevenly.
+    std::vector<Chunk> chunks = findChunks(static_cast<size_t>(threadCount) * 4);
+    std::vector<std::vector<Token>> results =
+        scanChunks<std::vector<Token>>(chunks, [](Scanner& scanner) { return scanner.scanTokens(); });
+
+    // Stitch: drop every chunk's EOF but the last. Columns are already right
+    // (every token of a chunk follows its first newline); the EOF token alone
+    // records absolute offsets, so rebase it.
+    size_t total = 1;
+    for (const std::vector<Token>& chunkTokens : results) {
+        total += chunkTokens.size() - 1;
+    }
+    std::vector<Token> tokens;
+    tokens.reserve(total);
+    for (const std::vector<Token>& chunkTokens : results) {
+        tokens.insert(tokens.end(), chunkTokens.begin(), chunkTokens.end() - 1);
+    }
+    Token eof = results.back().back();
+    eof.start += static_cast<int>(chunks.back().begin);
+    tokens.push_back(eof);
+    return tokens;
+}
+
+TokenBuffer ParallelScanner::scanBuffer() {
+    if (threadCount <= 1) {
+        Scanner scanner(source, backend);
+        TokenBuffer tokens = scanner.scanBuffer();
+        hadError = scanner.didEncounterError();
+        return tokens;
+    }
+
+    std::vector<Chunk> chunks = findChunks(static_cast<size_t>(threadCount) * 4);
+    std::vector<TokenBuffer> results =
+        scanChunks<TokenBuffer>(chunks, [](Scanner& scanner) { return scanner.scanBuffer(); });
+
+    // Stitch as in scanTokens(); offsets are relative to each chunk as well.
+    size_t total = 1;
+    for (const TokenBuffer& chunkTokens : results) {
+        total += chunkTokens.size() - 1;
+    }
+    TokenBuffer tokens(source);
+    tokens.reserve(total);
+    for (size_t c = 0; c < results.size(); ++c) {
+        const TokenBuffer& chunkTokens = results[c];
+        uint32_t base = static_cast<uint32_t>(chunks[c].begin);
+        size_t rank = 0;
+        for (size_t i = 0; i + 1 < chunkTokens.size(); ++i) {
+            TokenType type = chunkTokens.type(i);
+            Token token = chunkTokens.token(i, rank);
+            rank += TokenBuffer::hasSymbol(type);
+            tokens.push(type, chunkTokens.offset(i) + base, static_cast<uint32_t>(token.lexeme.size()),
+                token.line, token.start, token.symbol);
+        }
+    }
+    const TokenBuffer& last = results.back();
+    size_t eof = last.size() - 1;
+    uint32_t base = static_cast<uint32_t>(chunks.back().begin);
+    tokens.push(TokenType::END_OF_FILE, last.offset(eof) + base, 0, last.line(eof), last.column(eof) + static_cast<int>(base), noSymbol);
+    return tokens;
+}
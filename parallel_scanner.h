@@ -0,0 +1,39 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include "scan_kernels.h"
+#include "token.h"
+#include "token_buffer.h"
+
+// Scans a large source buffer on several threads.
+// A quick pre-pass finds newlines that are provably outside strings and block
+// comments, the buffer is cut there, each chunk is scanned by its own Scanner,
+// and the token vectors are stitched back together. The result (tokens and the
+// diagnostics written to std::cerr) matches Scanner::scanTokens() (or
+// scanBuffer()) exactly.
+class ParallelScanner {
+public:
+    ParallelScanner(std::string_view source, unsigned threadCount, ScanBackend backend = ScanBackend::Auto);
+
+    std::vector<Token> scanTokens();
+    TokenBuffer scanBuffer();
+    bool didEncounterError() const { return hadError; }
+
+private:
+    struct Chunk {
+        size_t begin;   // Offset in the source: 0, or just past a token at a line end
+        int firstLine;  // Line number in effect at `begin`
+    };
+
+    const std::string_view source;
+    const unsigned threadCount;
+    const ScanBackend backend;
+    bool hadError = false;
+
+    // Splits the source into roughly `targetCount` chunks at safe newlines.
+    std::vector<Chunk> findChunks(size_t targetCount) const;
+    // Runs `scan` on a Scanner for each chunk, on the worker threads, then
+    // replays the chunks' diagnostics in order.
+    template <typename Result, typename Scan>
+    std::vector<Result> scanChunks(const std::vector<Chunk>& chunks, Scan scan);
+};
@@ -2,16 +2,29 @@
 #include "expr_nodes.h"
 #include "stmt_nodes.h"
 #include "declaration_nodes.h"
+#include <array>
 #include <iostream>
 
-Parser::Parser(const std::vector<Token>& tokens)
-    : tokens(tokens)
+Parser::Parser(const std::vector<Token>& tokens, AstArena& arena, ExpressionParser expressionParser)
+    : tokens(tokens), arena(arena), expressionParser(expressionParser)
 {
     // The parser is initialized with the token stream received from the scanner.
-    // 'current' is automatically 0, pointing to the first token.
+    // The stream starts on the first token.
     // 'hadError' is automatically false.
 }
 
+Parser::Parser(const TokenBuffer& tokens, AstArena& arena, ExpressionParser expressionParser)
+    : tokens(tokens), arena(arena), expressionParser(expressionParser)
+{
+    // Lookahead reads only the buffer's type array.
+}
+
+Parser::Parser(Scanner& scanner, AstArena& arena, ExpressionParser expressionParser)
+    : tokens(scanner), arena(arena), expressionParser(expressionParser)
+{
+    // Tokens are scanned on demand; only the lookahead window is kept.
+}
+
 std::vector<Declaration*> Parser::parse() { 
     std::vector<Declaration*> declarations;
     // The program is a list of declarations until the EOF is hit.
@@ -25,20 +38,26 @@ std::vector<Declaration*> Parser::parse() {
     return declarations;
 }
 
+Declaration* Parser::parseDeclarationAt(size_t position) {
+    // Consecutive calls continue where the last one stopped, without a seek.
+    if (position != tokens.position()) tokens.seek(position);
+    return declaration();
+}
+
 Declaration* Parser::varDeclaration() { 
-	Token name = consume(TokenType::IDENTIFIER, "Expect variable name.");
+	TokenRef name = consume(TokenType::IDENTIFIER, "Expect variable name.");
 	Expr* initializer = nullptr;
 	if (match(TokenType::EQUAL)) {
 		initializer = expression();
 	}
 	consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
-	return new VarDecl(name, initializer);
+	return arena.make<VarDecl>(name, initializer);
 }
 
 Declaration* Parser::funDeclaration() { 
-	Token name = consume(TokenType::IDENTIFIER, "Expect function name.");
+	TokenRef name = consume(TokenType::IDENTIFIER, "Expect function name.");
 	consume(TokenType::LEFT_PAREN, "Expect '(' after function name.");
-	std::vector<Token> parameters;
+	std::vector<TokenRef> parameters;
 	if (!check(TokenType::RIGHT_PAREN)) {
 		do {
 			if (parameters.size() >= 255) {
@@ -48,13 +67,16 @@ Declaration* Parser::funDeclaration() {
 		} while (match(TokenType::COMMA));
 	}
 	consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters.");
-	consume(TokenType::LEFT_BRACE, "Expect '{' before function body.");
+	// blockStatement() consumes the '{' itself.
+	if (!check(TokenType::LEFT_BRACE)) {
+		throw error(peek(), "Expect '{' before function body.");
+	}
 	BlockStmt* body = dynamic_cast<BlockStmt*>(blockStatement());
-	return new FuncDecl(name, parameters, body);
+	return arena.make<FuncDecl>(name, std::move(parameters), body);
 }
 
 Stmt* Parser::statement() {
-    switch (peek().type) {
+    switch (tokens.peekType()) {
     case TokenType::LEFT_BRACE:
 		return blockStatement();
 	case TokenType::IF:
@@ -77,7 +99,7 @@ Stmt* Parser::statement() {
 		return printStatement();
 	case TokenType::SEMICOLON:
 		advance(); // Consume the semicolon
-		return new ExprStmt(nullptr); // Empty statement
+		return arena.make<ExprStmt>(nullptr); // Empty statement
     default:
 		return exprStatement();
     }
@@ -113,7 +135,7 @@ Stmt* Parser::blockStatement() {
 		statements.push_back(declaration());
 	}
     consume(TokenType::RIGHT_BRACE, "Expect '}' after block.");
-	return new BlockStmt(statements);
+	return arena.make<BlockStmt>(std::move(statements));
 }
 
 Stmt* Parser::ifStatement() {
@@ -126,7 +148,7 @@ Stmt* Parser::ifStatement() {
 	if (match(TokenType::ELSE)) {
 		elseBranch = statement();
 	}
-	return new IfStmt(condition, thenBranch, elseBranch);
+	return arena.make<IfStmt>(condition, thenBranch, elseBranch);
 }
 Stmt* Parser::forStatement() { 
 	// Consume 'for'
@@ -153,7 +175,7 @@ Stmt* Parser::forStatement() {
 	}
 	consume(TokenType::RIGHT_PAREN, "Expect ')' after for clauses.");
 	Stmt* body = statement();
-	return new ForStmt(initializer, condition, increment, body);
+	return arena.make<ForStmt>(initializer, condition, increment, body);
 }
 Stmt* Parser::whileStatement() {
 	// Consume 'while'
@@ -162,7 +184,7 @@ Stmt* Parser::whileStatement() {
 	Expr* condition = expression();
 	consume(TokenType::RIGHT_PAREN, "Expect ')' after condition.");
 	Stmt* body = statement();
-	return new WhileStmt(condition, body);
+	return arena.make<WhileStmt>(condition, body);
 }
 Stmt* Parser::doWhileStatement() {
 	// Consume 'do'
@@ -172,7 +194,7 @@ Stmt* Parser::doWhileStatement() {
 	consume(TokenType::LEFT_PAREN, "Expect '(' after 'while'.");
 	Expr* condition = expression();
 	consume(TokenType::RIGHT_PAREN, "Expect ')' after condition.");
-	return new DoWhileStmt(body, condition);
+	return arena.make<DoWhileStmt>(body, condition);
 }
 
 Stmt* Parser::switchStatement() { 
@@ -191,32 +213,34 @@ Stmt* Parser::switchStatement() {
 			while (!isAtEnd() && !check(TokenType::CASE) && !check(TokenType::DEFAULT) && !check(TokenType::RIGHT_BRACE)) {
 				statements.push_back(declaration());
 			}
-			cases.push_back(new CaseStmt{ caseValue,  });
+			cases.push_back(arena.make<CaseStmt>(caseValue, std::move(statements)));
 		}
 		else if (match(TokenType::DEFAULT)) {
 			consume(TokenType::COLON, "Expect ':' after 'default'.");
 			std::vector<Declaration*> statements;
-			while (!isAtEnd() && !check(TokenType::RIGHT_BRACE)) {
+			while (!isAtEnd() && !check(TokenType::CASE) && !check(TokenType::DEFAULT) && !check(TokenType::RIGHT_BRACE)) {
 				statements.push_back(declaration());
 			}
-			cases.push_back(new CaseStmt{ nullptr, statements });
+			cases.push_back(arena.make<CaseStmt>(nullptr, std::move(statements)));
 		}
 		else {
 			throw error(peek(), "Expect 'case' or 'default' in switch statement.");
 		}
 	}
+	consume(TokenType::RIGHT_BRACE, "Expect '}' after switch cases.");
+	return arena.make<SwitchStmt>(condition, std::move(cases));
 }
 Stmt* Parser::breakStatement() {
 	// Consume 'break'
 	advance();
 	consume(TokenType::SEMICOLON, "Expect ';' after 'break'.");
-	return new BreakStmt();
+	return arena.make<BreakStmt>();
 }
 Stmt* Parser::continueStatement() {
 	// Consume 'continue'
 	advance();
 	consume(TokenType::SEMICOLON, "Expect ';' after 'continue'.");
-	return new ContinueStmt();
+	return arena.make<ContinueStmt>();
 }
 
 Stmt* Parser::returnStatement() { 
@@ -226,19 +250,19 @@ Stmt* Parser::returnStatement() {
 		value = expression();
 	}
 	consume(TokenType::SEMICOLON, "Expect ';' after return value.");
-	return new ReturnStmt(value);
+	return arena.make<ReturnStmt>(value);
 }
 Stmt* Parser::printStatement() { 
 	advance(); // Consume 'print'
 	Expr* value = expression();
 	consume(TokenType::SEMICOLON, "Expect ';' after value.");
-	return new PrintStmt(value);
+	return arena.make<PrintStmt>(value);
 }
 
 Stmt* Parser::exprStatement() {
 	Expr* expr = expression();
 	consume(TokenType::SEMICOLON, "Expect ';' after expression.");
-	return new ExprStmt(expr);
+	return arena.make<ExprStmt>(expr);
 }
 
 
@@ -247,12 +271,73 @@ Stmt* Parser::exprStatement() {
 // Note: parse, expression, assignment, conditional, logicalOr, etc. 
 // must be fully defined, even as simple placeholders that call the next rule.
 
+// --- Pratt Binding Powers ---
+// One entry per TokenType that can appear between two operands. A higher power
+// binds tighter; the levels mirror the grammar rules below, from ASSIGNMENT
+// (loosest) to FACTOR. UNARY, POSTFIX and PRIMARY are shared with the
+// recursive descent chain.
+
+namespace {
+
+enum class InfixKind : unsigned char { None, Assignment, Conditional, Logical, Binary };
+
+struct InfixRule {
+    InfixKind kind = InfixKind::None;
+    unsigned char power = 0;
+};
+
+constexpr int assignmentPower = 1;  // Right-associative
+constexpr int conditionalPower = 2; // Right-associative, "?" EXPR ":" CONDITIONAL
+constexpr int tokenTypeCount = static_cast<int>(TokenType::END_OF_FILE) + 1;
+
+constexpr std::array<InfixRule, tokenTypeCount> makeInfixRules() {
+    std::array<InfixRule, tokenTypeCount> rules{};
+    auto set = [&rules](TokenType type, InfixKind kind, int power) {
+        rules[static_cast<int>(type)] = InfixRule{ kind, static_cast<unsigned char>(power) };
+    };
+    for (TokenType type : { TokenType::EQUAL, TokenType::PLUS_EQUAL, TokenType::MINUS_EQUAL,
+        TokenType::STAR_EQUAL, TokenType::SLASH_EQUAL, TokenType::PERCENT_EQUAL,
+        TokenType::SHIFT_LEFT_EQUAL, TokenType::SHIFT_RIGHT_EQUAL,
+        TokenType::AMP_EQUAL, TokenType::CARET_EQUAL, TokenType::PIPE_EQUAL }) {
+        set(type, InfixKind::Assignment, assignmentPower);
+    }
+    set(TokenType::QUESTION, InfixKind::Conditional, conditionalPower);
+    set(TokenType::PIPE_PIPE, InfixKind::Logical, 3);
+    set(TokenType::AMP_AMP, InfixKind::Logical, 4);
+    set(TokenType::PIPE, InfixKind::Binary, 5);
+    set(TokenType::CARET, InfixKind::Binary, 6);
+    set(TokenType::AMP, InfixKind::Binary, 7);
+    for (TokenType type : { TokenType::EQUAL_EQUAL, TokenType::BANG_EQUAL }) {
+        set(type, InfixKind::Binary, 8);
+    }
+    for (TokenType type : { TokenType::LESS, TokenType::LESS_EQUAL, TokenType::GREATER, TokenType::GREATER_EQUAL }) {
+        set(type, InfixKind::Binary, 9);
+    }
+    for (TokenType type : { TokenType::SHIFT_LEFT, TokenType::SHIFT_RIGHT }) {
+        set(type, InfixKind::Binary, 10);
+    }
+    for (TokenType type : { TokenType::PLUS, TokenType::MINUS }) {
+        set(type, InfixKind::Binary, 11);
+    }
+    for (TokenType type : { TokenType::STAR, TokenType::SLASH, TokenType::PERCENT }) {
+        set(type, InfixKind::Binary, 12);
+    }
+    return rules;
+}
+
+constexpr std::array<InfixRule, tokenTypeCount> infixRules = makeInfixRules();
+
+} // namespace
+
 Expr* Parser::expression() { 
     return assignment(); 
 }
 
 Expr* Parser::assignment() {
 	// ASSIGNMENT -> CONDITIONAL ( ("=" | "+=" | "-=" | "*=" | "/=" | "%=" | "<<=" | ">>=" | "&=" | "^=" | "|=") ASSIGNMENT )? ;
+    if (expressionParser == ExpressionParser::Pratt) {
+        return prattExpression(assignmentPower);
+    }
     Expr* expr = conditional();
 
     if (match(TokenType::EQUAL, TokenType::PLUS_EQUAL, TokenType::MINUS_EQUAL,
@@ -260,21 +345,25 @@ Expr* Parser::assignment() {
         TokenType::SHIFT_LEFT_EQUAL, TokenType::SHIFT_RIGHT_EQUAL,
         TokenType::AMP_EQUAL, TokenType::CARET_EQUAL, TokenType::PIPE_EQUAL)) {
 
-        Token op = previous();
+        TokenRef op = previous();
         Expr* value = assignment();
-        if (dynamic_cast<PrimaryExpr*>(expr) && dynamic_cast<PrimaryExpr*>(expr)->value.type == TokenType::IDENTIFIER) {
-            return new AssignmentExpr(expr, op, value);
-        }
-
-        if (dynamic_cast<PostfixExpr*>(expr)) {
-            return new AssignmentExpr(expr, op, value);
-        }
-        error(op, "Invalid assignment target.");
-        return new AssignmentExpr(expr, op, value);
+        return assignmentExpr(expr, op, value);
     }
 
     return expr;
 }
+
+Expr* Parser::assignmentExpr(Expr* target, const TokenRef& op, Expr* value) {
+    if (dynamic_cast<PrimaryExpr*>(target) && dynamic_cast<PrimaryExpr*>(target)->value.type == TokenType::IDENTIFIER) {
+        return arena.make<AssignmentExpr>(target, op, value);
+    }
+
+    if (dynamic_cast<PostfixExpr*>(target)) {
+        return arena.make<AssignmentExpr>(target, op, value);
+    }
+    error(op, "Invalid assignment target.");
+    return arena.make<AssignmentExpr>(target, op, value);
+}
 Expr* Parser::conditional() {
 	// CONDITIONAL -> LOGICAL_OR ( "?" EXPR ":" CONDITIONAL )? ;
     // Start with the expression of higher precedence (the condition)
@@ -288,7 +377,7 @@ Expr* Parser::conditional() {
         Expr* elseExpr = conditional();
 
         // Return the ConditionalExpr node
-        return new ConditionalExpr(expr, thenExpr, elseExpr);
+        return arena.make<ConditionalExpr>(expr, thenExpr, elseExpr);
     }
 
     // If no '?', return the logicalOr expression as is
@@ -298,9 +387,9 @@ Expr* Parser::logicalOr() {
 	// LOGICAL_OR -> LOGICAL_AND ( "||" LOGICAL_AND )* ;
     Expr* expr = logicalAnd();
     while (match(TokenType::PIPE_PIPE)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = logicalAnd();
-        expr = new LogicalExpr(expr, op, right);
+        expr = arena.make<LogicalExpr>(expr, op, right);
     }
 
     return expr;
@@ -310,9 +399,9 @@ Expr* Parser::logicalAnd() {
 	// LOGICAL_AND -> BITWISE_OR ( "&&" BITWISE_OR )* ;
     Expr* expr = bitwiseOr();
     while (match(TokenType::AMP_AMP)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = bitwiseOr();
-        expr = new LogicalExpr(expr, op, right);
+        expr = arena.make<LogicalExpr>(expr, op, right);
     }
 
     return expr;
@@ -321,9 +410,9 @@ Expr* Parser::bitwiseOr() {
 	// BITWISE_OR -> BITWISE_XOR ( "|" BITWISE_XOR )* ;
     Expr* expr = bitwiseXor();
     while (match(TokenType::PIPE)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = bitwiseXor();
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
     return expr;
 }
@@ -331,9 +420,9 @@ Expr* Parser::bitwiseXor() {
 	// BITWISE_XOR -> BITWISE_AND ( "^" BITWISE_AND )* ;
     Expr* expr = bitwiseAnd();
     while (match(TokenType::CARET)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = bitwiseAnd();
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
@@ -344,11 +433,11 @@ Expr* Parser::bitwiseAnd() {
 
     while (match(TokenType::AMP)) {
 
-        Token op = previous();
+        TokenRef op = previous();
 
         Expr* right = equality();
 
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
     return expr;
 }
@@ -358,9 +447,9 @@ Expr* Parser::equality() {
     Expr* expr = comparison();
 
     while (match(TokenType::EQUAL_EQUAL, TokenType::BANG_EQUAL)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = comparison();
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
@@ -370,9 +459,9 @@ Expr* Parser::comparison() {
     Expr* expr = shift();
     while (match(TokenType::LESS, TokenType::LESS_EQUAL,
         TokenType::GREATER, TokenType::GREATER_EQUAL)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = shift();
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
     return expr;
 }
@@ -382,9 +471,9 @@ Expr* Parser::shift() {
     Expr* expr = term();
 
     while (match(TokenType::SHIFT_LEFT, TokenType::SHIFT_RIGHT)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = term();
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
     return expr;
 }
@@ -394,9 +483,9 @@ Expr* Parser::term() {
     // TERM -> FACTOR ( ("+" | "-") FACTOR )* ;
     Expr* expr = factor();
     while (match(TokenType::PLUS, TokenType::MINUS)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = factor();
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
     return expr;
 }
@@ -405,23 +494,61 @@ Expr* Parser::factor() {
     Expr* expr = unary();
     // Loop to handle left-associative operators: *, /, %
     while (match(TokenType::STAR, TokenType::SLASH, TokenType::PERCENT)) {
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = unary();
 		//this enforced left associativity
-        expr = new BinaryExpr(expr, op, right);
+        expr = arena.make<BinaryExpr>(expr, op, right);
     }
     return expr;
 }
 
+// --- Pratt Expression Parser ---
+
+Expr* Parser::prattExpression(int minPower) {
+    // Same trees as assignment() -> ... -> factor(): left-associative levels
+    // parse their right operand one power higher, ASSIGNMENT and CONDITIONAL
+    // recurse at their own power.
+    Expr* expr = unary();
+    for (;;) {
+        InfixRule rule = infixRules[static_cast<int>(tokens.peekType())];
+        if (rule.kind == InfixKind::None || rule.power < minPower) {
+            return expr;
+        }
+        advance();
+        TokenRef op = previous();
+
+        switch (rule.kind) {
+        case InfixKind::Assignment: {
+            Expr* value = prattExpression(assignmentPower);
+            expr = assignmentExpr(expr, op, value);
+            break;
+        }
+        case InfixKind::Conditional: {
+            Expr* thenExpr = expression();
+            consume(TokenType::COLON, "Expect ':' after true expression in conditional operator.");
+            Expr* elseExpr = prattExpression(conditionalPower);
+            expr = arena.make<ConditionalExpr>(expr, thenExpr, elseExpr);
+            break;
+        }
+        case InfixKind::Logical:
+            expr = arena.make<LogicalExpr>(expr, op, prattExpression(rule.power + 1));
+            break;
+        default:
+            expr = arena.make<BinaryExpr>(expr, op, prattExpression(rule.power + 1));
+            break;
+        }
+    }
+}
+
 Expr* Parser::unary() { // <<< Definition for unresolved external symbol 2
     // UNARY -> ( "!" | "~" | "++" | "--" | "+" | "-" ) UNARY | POSTFIX ;
 
     if (match(TokenType::BANG, TokenType::TILDE, TokenType::PLUS_PLUS,
         TokenType::MINUS_MINUS, TokenType::PLUS, TokenType::MINUS)) {
 
-        Token op = previous();
+        TokenRef op = previous();
         Expr* right = unary(); // Recursive call for right-associativity
-        return new UnaryExpr(op, right);
+        return arena.make<UnaryExpr>(op, right);
     }
 
     return postfix();
@@ -443,13 +570,13 @@ Expr* Parser::postfix() {
         PostfixExpr* postfix = dynamic_cast<PostfixExpr*>(expr);
         if (!postfix) {
             // First postfix operation, wrap the base expression
-            postfix = new PostfixExpr(expr);
+            postfix = arena.make<PostfixExpr>(expr);
             expr = postfix;
         }
 
         advance(); // Consume the operator/delimiter token
-        Token op = previous();
-        PostfixTail* tail = new PostfixTail(op);
+        TokenRef op = previous();
+        PostfixTail* tail = arena.make<PostfixTail>(op);
         switch (op.type) {
         case TokenType::LEFT_PAREN: { // Function call: ( ARG_LIST? )
             // ARG_LIST -> ASSIGNMENT ( "," ASSIGNMENT )*
@@ -467,7 +594,7 @@ Expr* Parser::postfix() {
             break;
         }
         case TokenType::DOT: { // Member access: . IDENTIFIER
-            tail->indexOrCondition = new PrimaryExpr(
+            tail->indexOrCondition = arena.make<PrimaryExpr>(
                 consume(TokenType::IDENTIFIER, "Expect property name after '.'.")
             );
             break;
@@ -479,7 +606,6 @@ Expr* Parser::postfix() {
         }
         default:
             // Should be unreachable due to the initial check/advance block, but included for safety.
-            delete tail;
             break;
         }
 
@@ -493,16 +619,16 @@ Expr* Parser::primary() {
     // PRIMARY -> "(" EXPR ")" | IDENTIFIER | NUMBER | STRING
     //           | "true" | "false" | "nil" ;
 
-    if (match(TokenType::FALSE)) return new PrimaryExpr(previous());
-    if (match(TokenType::TRUE)) return new PrimaryExpr(previous());
-    if (match(TokenType::NIL)) return new PrimaryExpr(previous());
+    if (match(TokenType::FALSE)) return arena.make<PrimaryExpr>(previous());
+    if (match(TokenType::TRUE)) return arena.make<PrimaryExpr>(previous());
+    if (match(TokenType::NIL)) return arena.make<PrimaryExpr>(previous());
 
     if (match(TokenType::NUMBER, TokenType::STRING)) {
-        return new PrimaryExpr(previous());
+        return arena.make<PrimaryExpr>(previous());
     }
 
     if (match(TokenType::IDENTIFIER)) {
-        return new PrimaryExpr(previous());
+        return arena.make<PrimaryExpr>(previous());
     }
 
     if (match(TokenType::LEFT_PAREN)) {
@@ -518,52 +644,50 @@ Expr* Parser::primary() {
 
 
 bool Parser::isAtEnd() const {
-    return peek().type == TokenType::END_OF_FILE;
+    return tokens.peekType() == TokenType::END_OF_FILE;
 }
 
-Token Parser::peek() const {
-    if (current >= tokens.size()) {
-        // Safe check: If we're past the last token, return the actual EOF token 
-        // which should be the last element in the vector.
-        return tokens.back();
-    }
-    return tokens[current];
+const Token& Parser::peek() const {
+    // The stream never moves past the EOF token, so this is always valid.
+    return tokens.peek();
 }
 
-Token Parser::previous() const {
-    // Returns the token that was just consumed.
-    if (current > 0) return tokens[current - 1];
-    // Should ideally not be called when current is 0, but return first token as a fallback.
-    return tokens[0];
+const Token& Parser::previous() const {
+    // Returns the token that was just consumed (the first token before any).
+    return tokens.previous();
 }
 
-Token Parser::advance() {
-    // Consumes the current token and moves 'current' pointer forward.
-    if (!isAtEnd()) current++;
-    return previous();
+void Parser::advance() {
+    // Consumes the current token and moves the stream forward.
+    tokens.advance(); // No-op on END_OF_FILE
 }
 
 bool Parser::check(TokenType type) const {
     // Checks if the current token is of the given type, without consuming it.
-    if (isAtEnd()) return false;
-    return peek().type == type;
+    // END_OF_FILE never matches, so callers cannot run off the end.
+    TokenType current = tokens.peekType();
+    return current == type && current != TokenType::END_OF_FILE;
 }
 
 template <typename... Args>
 bool Parser::match(Args... types) {
     // Checks if the current token matches any of the given types.
     // If it matches, the token is consumed (advance is called), and returns true.
-    bool found = false;
-    // C++17 fold expression to check all types
-    if ((check(types) || ...)) {
-        found = true;
-        advance();
+    // The current type is read once and compared against every candidate
+    // (C++17 fold expression); END_OF_FILE never matches, as in check().
+    TokenType current = tokens.peekType();
+    if (current == TokenType::END_OF_FILE || ((current != types) && ...)) {
+        return false;
     }
-    return found;
+    advance();
+    return true;
 }
 
-Token Parser::consume(TokenType type, const std::string& message) {
-    if (check(type)) return advance();
+const Token& Parser::consume(TokenType type, const std::string& message) {
+    if (check(type)) {
+        advance();
+        return previous();
+    }
 
     // If we reach here, we found an error.
     throw error(peek(), message);
@@ -571,20 +695,22 @@ Token Parser::consume(TokenType type, const std::string& message) {
 
 // --- ERROR REPORTING AND SYNCHRONIZATION HELPERS ---
 
-void Parser::reportError(const Token& token, const std::string& message) {
+void Parser::reportError(const TokenRef& token, const std::string& message) {
     // Prints a detailed error message to the console.
-    std::cerr << "[Line " << token.line << "] Error";
+    std::ostream& out = *errorOutput;
+    out << "[Line " << token.line << "] Error";
     if (token.type == TokenType::END_OF_FILE) {
-        std::cerr << " at end";
+        out << " at end";
     }
     else if (token.type != TokenType::IDENTIFIER) {
-        std::cerr << " at '" << token.lexeme << "'";
+        out << " at '" << token.lexeme << "'";
     }
-    std::cerr << ": " << message << std::endl;
+    out << ": " << message << std::endl;
     hadError = true;
+    ++errors;
 }
 
-Parser::ParseError Parser::error(const Token& token, const std::string& message) {
+Parser::ParseError Parser::error(const TokenRef& token, const std::string& message) {
     // Helper function to call reportError and return the ParseError exception.
     reportError(token, message);
     return ParseError();
@@ -600,7 +726,7 @@ void Parser::synchronize() {
         if (previous().type == TokenType::SEMICOLON) return;
 
         // Look ahead for keywords that start a new top-level construct.
-        switch (peek().type) {
+        switch (tokens.peekType()) {
         case TokenType::VAR:
         case TokenType::FUN:
         case TokenType::FOR:
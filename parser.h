@@ -3,27 +3,58 @@
 #include <vector>
 #include <stdexcept>
 #include <memory> // Often used for smart pointers to manage the AST
+#include <iostream>
 #include "token.h"
+#include "token_stream.h"
+#include "ast_arena.h"
 #include "ast_node.h" // Includes Stmt and Expr base classes
 
 // Forward declaration for the Declaration base class
 class Declaration;
+class Scanner;
+
+// How expressions are parsed. Both produce the same AST:
+//  - Pratt: one loop driven by a per-TokenType binding-power table
+//  - Descent: one function per precedence level (expression -> ... -> primary)
+enum class ExpressionParser { Pratt, Descent };
 
 class Parser {
 public:
     // Takes the vector of tokens generated by the Scanner.
-    Parser(const std::vector<Token>& tokens);
+    // Every node is allocated in `arena`, which owns the resulting AST.
+    Parser(const std::vector<Token>& tokens, AstArena& arena,
+        ExpressionParser expressionParser = ExpressionParser::Pratt);
+    // Parses a structure-of-arrays TokenBuffer (see Scanner::scanBuffer()).
+    Parser(const TokenBuffer& tokens, AstArena& arena,
+        ExpressionParser expressionParser = ExpressionParser::Pratt);
+    // Pulls tokens from the Scanner as it goes; no token vector is built.
+    Parser(Scanner& scanner, AstArena& arena,
+        ExpressionParser expressionParser = ExpressionParser::Pratt);
 
     // The main entry point for the parser, matching the PROGRAM rule.
     std::vector<Declaration*> parse();
 	bool Error() const { return hadError; }
 
+    // Partial parsing (see IncrementalDocument and ParallelParser), token
+    // vector and buffer backends only: parses the one top-level declaration
+    // that starts at token `position` (nullptr after a syntax error, as in
+    // parse()). position() is then the token the next declaration starts at.
+    Declaration* parseDeclarationAt(size_t position);
+    size_t position() const { return tokens.position(); }
+
+    size_t errorCount() const { return errors; }
+    // Syntax errors go to std::cerr unless redirected here.
+    void setErrorOutput(std::ostream& output) { errorOutput = &output; }
+
 private:
-    const std::vector<Token>& tokens;
-    int current = 0;
+    TokenStream tokens;
+    AstArena& arena;
+    const ExpressionParser expressionParser;
 
     // Flag to indicate if parsing encountered an error.
     bool hadError = false;
+    size_t errors = 0;
+    std::ostream* errorOutput = &std::cerr;
 
     // --- Core Recursive Descent Methods (Matching Grammar Rules) ---
 
@@ -64,22 +95,30 @@ private:
     Expr* postfix();         // POSTFIX
     Expr* primary();         // PRIMARY
 
+    // Pratt parser: everything from ASSIGNMENT down to FACTOR in one loop.
+    // Parses operators binding at least as tightly as `minPower`.
+    Expr* prattExpression(int minPower);
+    // Builds the AssignmentExpr, reporting (without throwing) a bad target.
+    Expr* assignmentExpr(Expr* target, const TokenRef& op, Expr* value);
+
     // --- Helper Methods ---
     bool isAtEnd() const;
-    Token peek() const;
-    Token previous() const;
-    Token advance();
+    // Tokens are returned by reference into the TokenStream; a reference is
+    // only valid until the next advance(), so keep a TokenRef to hold on to one.
+    const Token& peek() const;
+    const Token& previous() const;
+    void advance();
     bool check(TokenType type) const;
 
     // Consume and expect a specific token type, reporting an error if mismatched.
-    Token consume(TokenType type, const std::string& message);
+    const Token& consume(TokenType type, const std::string& message);
 
     // Check if the current token matches any of the types, consuming it if it does.
     template <typename... Args>
     bool match(Args... types);
 
     // Error Reporting and Synchronization
-    void reportError(const Token& token, const std::string& message);
+    void reportError(const TokenRef& token, const std::string& message);
     void synchronize();
 
     // Custom Exception for immediate error unwinding
@@ -89,5 +128,5 @@ private:
     };
 
     // Helper for generating ParseError exception
-    ParseError error(const Token& token, const std::string& message);
+    ParseError error(const TokenRef& token, const std::string& message);
 };
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "resolver.h"
+#include "declaration_nodes.h"
+#include "expr_nodes.h"
+#include "stmt_nodes.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+// The case index (or, with no match, the index of the last 'default', else
+// the case count) by subject, when the cases are integer constants and there
+// are enough of them to pay for a table.
+std::unique_ptr<SwitchTable> makeSwitchTable(const SwitchStmt* stmt) {
+    std::vector<int64_t> values;
+    std::vector<uint32_t> targets;
+    uint32_t missTarget = static_cast<uint32_t>(stmt->cases.size());
+    for (size_t i = 0; i < stmt->cases.size(); ++i) {
+        int64_t value = 0;
+        if (stmt->cases[i]->value == nullptr) {
+            missTarget = static_cast<uint32_t>(i);
+            continue;
+        }
+        if (!integerCaseValue(stmt->cases[i]->value, value)) return nullptr;
+        values.push_back(value);
+        targets.push_back(static_cast<uint32_t>(i));
+    }
+    if (values.size() < SwitchTable::minimumCases) return nullptr;
+    return std::make_unique<SwitchTable>(values, targets, missTarget);
+}
+
+} // namespace
+
+Resolver::Resolver(GlobalTable& globals) : globals(globals) {}
+
+bool Resolver::resolve(const std::vector<Declaration*>& program) {
+    scopes.clear();
+    uses.clear();
+    declaredGlobals.clear();
+    found.clear();
+    current = -1;
+    try {
+        resolveStatements(program);
+    }
+    catch (ResolveError&) {
+        return false;
+    }
+
+    // Every scope's size is known now: count the frames between each use and
+    // its variable.
+    for (const LocalUse& use : uses) {
+        int depth = 0;
+        for (int scope = use.from; scope != use.to; scope = scopes[scope].parent) {
+            if (scopes[scope].size > 0) ++depth;
+        }
+        use.variable->depth = depth;
+    }
+    std::stable_sort(found.begin(), found.end(),
+        [](const Diagnostic& a, const Diagnostic& b) { return a.line < b.line; });
+    return true;
+}
+
+// --- Helpers ---
+
+void Resolver::resolveStatement(Declaration* decl) {
+    if (decl) decl->accept(*this);
+}
+
+void Resolver::resolveStatements(const std::vector<Declaration*>& statements) {
+    for (Declaration* statement : statements) {
+        resolveStatement(statement);
+    }
+}
+
+void Resolver::resolveExpr(Expr* expr) {
+    if (expr) expr->accept(*this);
+}
+
+void Resolver::beginScope() {
+    scopes.push_back(Scope(current));
+    current = static_cast<int>(scopes.size() - 1);
+}
+
+uint32_t Resolver::endScope() {
+    Scope& scope = scopes[current];
+    // Only the size is needed from here on.
+    scope.slots = {};
+    scope.passedThrough = {};
+    uint32_t size = scope.size;
+    current = scope.parent;
+    return size;
+}
+
+void Resolver::declare(const TokenRef& name, VariableSlot& variable) {
+    int line = name.line;
+    if (current < 0) {
+        if (!declaredGlobals.insert(name.symbol).second) {
+            found.push_back({ line, "'" + std::string(name.lexeme) + "' is already declared in this scope." });
+        }
+        int slot = globals.slotFor(name.symbol);
+        if (slot < 0) throw error(line, "Too many global variables.");
+        variable.depth = VariableSlot::Global;
+        variable.slot = static_cast<uint32_t>(slot);
+        return;
+    }
+
+    Scope& scope = scopes[current];
+    auto passed = scope.passedThrough.find(name.symbol);
+    if (passed != scope.passedThrough.end()) {
+        found.push_back({ passed->second, "'" + std::string(name.lexeme) + "' is used before its declaration on line " +
+            std::to_string(line) + "; the use refers to an outer variable." });
+        scope.passedThrough.erase(passed);
+    }
+    auto [it, added] = scope.slots.emplace(name.symbol, scope.size);
+    if (added) {
+        ++scope.size;
+    }
+    else {
+        found.push_back({ line, "'" + std::string(name.lexeme) + "' is already declared in this scope." });
+    }
+    variable.depth = 0;
+    variable.slot = it->second;
+}
+
+void Resolver::resolveName(const TokenRef& name, VariableSlot& variable) {
+    for (int scope = current; scope >= 0; scope = scopes[scope].parent) {
+        auto it = scopes[scope].slots.find(name.symbol);
+        if (it != scopes[scope].slots.end()) {
+            variable.slot = it->second;
+            uses.push_back({ &variable, current, scope });
+            return;
+        }
+        scopes[scope].passedThrough.emplace(name.symbol, name.line);
+    }
+    // Globals are bound late: the slot may be declared (or even created)
+    // after this use, as long as that happens before it runs.
+    int slot = globals.slotFor(name.symbol);
+    if (slot < 0) throw error(name.line, "Too many global variables.");
+    variable.depth = VariableSlot::Global;
+    variable.slot = static_cast<uint32_t>(slot);
+}
+
+Resolver::ResolveError Resolver::error(int line, const std::string& message) {
+    std::cerr << "[Line " << line << "] Error: " << message << std::endl;
+    return ResolveError();
+}
+
+// --- Declarations ---
+
+void Resolver::visitVarDecl(VarDecl* decl) {
+    // Resolved before the variable exists: the initializer sees outer ones.
+    resolveExpr(decl->initializer);
+    declare(decl->name, decl->variable);
+}
+
+void Resolver::visitFuncDecl(FuncDecl* decl) {
+    // Declared first so the body can call the function.
+    declare(decl->name, decl->variable);
+    beginScope();
+    decl->paramSlots.clear();
+    for (const TokenRef& param : decl->params) {
+        VariableSlot slot;
+        declare(param, slot);
+        decl->paramSlots.push_back(slot.slot);
+    }
+    // The body's top-level declarations share the parameters' scope.
+    resolveStatements(decl->body->statements);
+    decl->frameSize = endScope();
+}
+
+// --- Statements ---
+
+void Resolver::visitBlockStmt(BlockStmt* stmt) {
+    beginScope();
+    resolveStatements(stmt->statements);
+    stmt->frameSize = endScope();
+}
+
+void Resolver::visitIfStmt(IfStmt* stmt) {
+    resolveExpr(stmt->condition);
+    resolveStatement(stmt->thenBranch);
+    resolveStatement(stmt->elseBranch);
+}
+
+void Resolver::visitForStmt(ForStmt* stmt) {
+    beginScope();
+    resolveStatement(stmt->initializer);
+    resolveExpr(stmt->condition);
+    resolveExpr(stmt->increment);
+    resolveStatement(stmt->body);
+    stmt->frameSize = endScope();
+}
+
+void Resolver::visitWhileStmt(WhileStmt* stmt) {
+    resolveExpr(stmt->condition);
+    resolveStatement(stmt->body);
+}
+
+void Resolver::visitDoWhileStmt(DoWhileStmt* stmt) {
+    resolveStatement(stmt->body);
+    resolveExpr(stmt->condition);
+}
+
+void Resolver::visitSwitchStmt(SwitchStmt* stmt) {
+    resolveExpr(stmt->condition);
+    for (CaseStmt* c : stmt->cases) {
+        resolveExpr(c->value);
+        beginScope();
+        resolveStatements(c->body);
+        c->frameSize = endScope();
+    }
+    if (stmt->table == nullptr) stmt->table = makeSwitchTable(stmt);
+}
+
+void Resolver::visitBreakStmt(BreakStmt*) {}
+
+void Resolver::visitContinueStmt(ContinueStmt*) {}
+
+void Resolver::visitReturnStmt(ReturnStmt* stmt) {
+    resolveExpr(stmt->value);
+}
+
+void Resolver::visitPrintStmt(PrintStmt* stmt) {
+    resolveExpr(stmt->expression);
+}
+
+void Resolver::visitExprStmt(ExprStmt* stmt) {
+    resolveExpr(stmt->expression);
+}
+
+// --- Expressions ---
+
+void Resolver::visitAssignmentExpr(AssignmentExpr* expr) {
+    resolveExpr(expr->left);
+    resolveExpr(expr->right);
+}
+
+void Resolver::visitConditionalExpr(ConditionalExpr* expr) {
+    resolveExpr(expr->condition);
+    resolveExpr(expr->thenExpr);
+    resolveExpr(expr->elseExpr);
+}
+
+void Resolver::visitLogicalExpr(LogicalExpr* expr) {
+    resolveExpr(expr->left);
+    resolveExpr(expr->right);
+}
+
+void Resolver::visitBinaryExpr(BinaryExpr* expr) {
+    resolveExpr(expr->left);
+    resolveExpr(expr->right);
+}
+
+void Resolver::visitUnaryExpr(UnaryExpr* expr) {
+    resolveExpr(expr->right);
+}
+
+void Resolver::visitPostfixExpr(PostfixExpr* expr) {
+    resolveExpr(expr->primary);
+    for (PostfixTail* tail : expr->tails) {
+        for (Expr* arg : tail->arguments) resolveExpr(arg);
+        // A field name after '.' is not a variable; the access gets the
+        // inline cache the Interpreter looks it up through.
+        if (tail->op.type != TokenType::DOT) resolveExpr(tail->indexOrCondition);
+        else if (tail->cache == nullptr) tail->cache = std::make_unique<InlineCache>();
+    }
+}
+
+void Resolver::visitPrimaryExpr(PrimaryExpr* expr) {
+    if (expr->value.type == TokenType::IDENTIFIER) {
+        resolveName(expr->value, expr->variable);
+    }
+}
+
+void Resolver::visitGroupingExpr(GroupingExpr* expr) {
+    resolveExpr(expr->expression);
+}
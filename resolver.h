@@ -0,0 +1,108 @@
+#pragma once
+#include "ast_visitor.h"
+#include "compiler.h"
+#include "token.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class Expr;
+struct VariableSlot;
+
+// Resolves every variable use ahead of execution, so the tree-walking
+// Interpreter can keep locals in flat frames instead of name-keyed maps.
+//
+// Each function body (with its parameters), block, for-loop initializer and
+// switch case is a scope; the scopes that declare something get a frame of
+// `frameSize` slots at run time. A use is annotated with how many frames out
+// its variable lives and its slot there, or with a GlobalTable slot when no
+// enclosing scope declares the name by that point. A name is declared once
+// its declaration has been passed: an initializer still sees the outer
+// variable, and a function can call itself. Field accesses ('.' tails) are
+// given their inline caches, and switches on integer constants their
+// SwitchTables.
+//
+// Diagnostics (warnings, the program still runs):
+//  - a name declared twice in the same scope (the declarations share a slot);
+//  - a local scope using a name before declaring it, which resolves the use
+//    to an outer or global variable rather than the later declaration.
+class Resolver : public AstVisitor {
+public:
+    struct Diagnostic {
+        int line;
+        std::string message;
+    };
+
+    // Globals get their slots in `globals`.
+    explicit Resolver(GlobalTable& globals);
+
+    // Annotates `program`. Returns false after an error (reported on
+    // std::cerr like a parse error); diagnostics are collected, not printed.
+    bool resolve(const std::vector<Declaration*>& program);
+    const std::vector<Diagnostic>& diagnostics() const { return found; }
+
+    // --- Visitor Methods ---
+    void visitVarDecl(VarDecl* decl) override;
+    void visitFuncDecl(FuncDecl* decl) override;
+    void visitBlockStmt(BlockStmt* stmt) override;
+    void visitIfStmt(IfStmt* stmt) override;
+    void visitForStmt(ForStmt* stmt) override;
+    void visitWhileStmt(WhileStmt* stmt) override;
+    void visitDoWhileStmt(DoWhileStmt* stmt) override;
+    void visitSwitchStmt(SwitchStmt* stmt) override;
+    void visitBreakStmt(BreakStmt* stmt) override;
+    void visitContinueStmt(ContinueStmt* stmt) override;
+    void visitReturnStmt(ReturnStmt* stmt) override;
+    void visitPrintStmt(PrintStmt* stmt) override;
+    void visitExprStmt(ExprStmt* stmt) override;
+    void visitAssignmentExpr(AssignmentExpr* expr) override;
+    void visitConditionalExpr(ConditionalExpr* expr) override;
+    void visitLogicalExpr(LogicalExpr* expr) override;
+    void visitBinaryExpr(BinaryExpr* expr) override;
+    void visitUnaryExpr(UnaryExpr* expr) override;
+    void visitPostfixExpr(PostfixExpr* expr) override;
+    void visitPrimaryExpr(PrimaryExpr* expr) override;
+    void visitGroupingExpr(GroupingExpr* expr) override;
+
+private:
+    class ResolveError {}; // Unwinds to resolve() after the error is reported
+
+    struct Scope {
+        explicit Scope(int parent) : parent(parent) {}
+
+        int parent;     // Index in `scopes`, -1 for the outermost local scope
+        uint32_t size = 0;
+        std::unordered_map<Symbol, uint32_t> slots;
+        // Names looked up through this scope before it declared them, with
+        // the line of the first such use.
+        std::unordered_map<Symbol, int> passedThrough;
+    };
+
+    // A use whose depth is computed once every scope's size is known: only
+    // scopes with a frame count.
+    struct LocalUse {
+        VariableSlot* variable;
+        int from; // Scope of the use
+        int to;   // Scope declaring the variable
+    };
+
+    GlobalTable& globals;
+    std::vector<Scope> scopes; // Every scope seen, in order of entry
+    int current = -1;          // Innermost scope, -1 at top level
+    std::vector<LocalUse> uses;
+    std::unordered_set<Symbol> declaredGlobals;
+    std::vector<Diagnostic> found;
+
+    void resolveStatement(Declaration* decl);
+    void resolveStatements(const std::vector<Declaration*>& statements);
+    void resolveExpr(Expr* expr);
+    void beginScope();
+    uint32_t endScope(); // Returns the scope's frame size
+
+    // Declares `name` in the innermost scope (a global at top level).
+    void declare(const TokenRef& name, VariableSlot& variable);
+    void resolveName(const TokenRef& name, VariableSlot& variable);
+    ResolveError error(int line, const std::string& message);
+};
@@ -0,0 +1,397 @@
+#include "scan_kernels.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCAN_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit SSE2/AVX2 instructions inside functions that ask for
+// them, which lets the AVX2 kernels live in a file built for the base ISA.
+// MSVC accepts the intrinsics anywhere.
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+// --- Bit Helpers ---
+
+inline int popcount32(uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return static_cast<int>((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+inline unsigned lowestBit(uint32_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+}
+
+inline unsigned highestBit(uint32_t x) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return index;
+#else
+    return 31u - static_cast<unsigned>(__builtin_clz(x));
+#endif
+}
+
+// Consumes one block whose stop bytes are `stop` and newline bytes are `newlineMask`.
+// Returns true (with `pos` set) when the block contains a stop byte; otherwise
+// counts every newline in the block and returns false.
+inline bool consumeBlock(uint32_t stop, uint32_t newlineMask, size_t base,
+    size_t& pos, int& newlines, size_t& lastNewline) {
+    if (stop) {
+        unsigned offset = lowestBit(stop);
+        newlineMask &= (1u << offset) - 1u;
+        if (newlineMask) {
+            newlines += popcount32(newlineMask);
+            lastNewline = base + highestBit(newlineMask);
+        }
+        pos = base + offset;
+        return true;
+    }
+    if (newlineMask) {
+        newlines += popcount32(newlineMask);
+        lastNewline = base + highestBit(newlineMask);
+    }
+    return false;
+}
+
+// --- Scalar Kernels ---
+
+inline bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Most whitespace and identifier runs are only a few bytes long. The vector
+// kernels first look at this many bytes one at a time and only switch to full
+// blocks for longer runs (indentation, long names).
+constexpr size_t shortRun = 8;
+
+// Scalar whitespace skip over at most `shortRun` bytes. Returns true if the run
+// ended within them.
+inline bool skipShortWhitespace(const char* text, size_t& pos, size_t length, int& newlines, size_t& lastNewline) {
+    size_t limit = length - pos < shortRun ? length : pos + shortRun;
+    for (; pos < limit; ++pos) {
+        char c = text[pos];
+        if (c == '\n') {
+            newlines++;
+            lastNewline = pos;
+        }
+        else if (c != ' ' && c != '\t' && c != '\r') {
+            return true;
+        }
+    }
+    return pos == length;
+}
+
+inline bool skipShortIdentifier(const char* text, size_t& pos, size_t length) {
+    size_t limit = length - pos < shortRun ? length : pos + shortRun;
+    for (; pos < limit; ++pos) {
+        if (!isIdentifierChar(text[pos])) return true;
+    }
+    return pos == length;
+}
+
+size_t scalarSkipWhitespace(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    for (; pos < length; ++pos) {
+        char c = text[pos];
+        if (c == '\n') {
+            newlines++;
+            lastNewline = pos;
+        }
+        else if (c != ' ' && c != '\t' && c != '\r') {
+            break;
+        }
+    }
+    return pos;
+}
+
+size_t scalarSkipIdentifier(const char* text, size_t pos, size_t length) {
+    while (pos < length && isIdentifierChar(text[pos])) pos++;
+    return pos;
+}
+
+size_t scalarFindQuote(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    for (; pos < length && text[pos] != '"'; ++pos) {
+        if (text[pos] == '\n') {
+            newlines++;
+            lastNewline = pos;
+        }
+    }
+    return pos;
+}
+
+size_t scalarFindNewline(const char* text, size_t pos, size_t length) {
+    const void* found = std::memchr(text + pos, '\n', length - pos);
+    return found ? static_cast<size_t>(static_cast<const char*>(found) - text) : length;
+}
+
+size_t scalarFindCommentEnd(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    for (; pos < length; ++pos) {
+        if (text[pos] == '*' && pos + 1 < length && text[pos + 1] == '/') break;
+        if (text[pos] == '\n') {
+            newlines++;
+            lastNewline = pos;
+        }
+    }
+    return pos;
+}
+
+const ScanKernels scalarKernels = {
+    scalarSkipWhitespace, scalarSkipIdentifier, scalarFindQuote, scalarFindNewline, scalarFindCommentEnd
+};
+
+#ifdef SCAN_KERNELS_X86
+
+// --- SSE2 Kernels (16 bytes per step) ---
+
+TARGET_SSE2 size_t sse2SkipWhitespace(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    if (skipShortWhitespace(text, pos, length, newlines, lastNewline)) return pos;
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        __m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), nl));
+        uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFFu;
+        if (consumeBlock(stop, static_cast<uint32_t>(_mm_movemask_epi8(nl)), pos, pos, newlines, lastNewline)) {
+            return pos;
+        }
+        pos += 16;
+    }
+    return scalarSkipWhitespace(text, pos, length, newlines, lastNewline);
+}
+
+TARGET_SSE2 size_t sse2SkipIdentifier(const char* text, size_t pos, size_t length) {
+    if (skipShortIdentifier(text, pos, length)) return pos;
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        // Signed compares are fine: bytes >= 0x80 are negative and never match.
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+            _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+            _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        __m128i ident = _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(ident)) & 0xFFFFu;
+        if (stop) return pos + lowestBit(stop);
+        pos += 16;
+    }
+    return scalarSkipIdentifier(text, pos, length);
+}
+
+TARGET_SSE2 size_t sse2FindQuote(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        uint32_t stop = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))));
+        uint32_t nl = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        if (consumeBlock(stop, nl, pos, pos, newlines, lastNewline)) return pos;
+        pos += 16;
+    }
+    return scalarFindQuote(text, pos, length, newlines, lastNewline);
+}
+
+TARGET_SSE2 size_t sse2FindNewline(const char* text, size_t pos, size_t length) {
+    while (pos + 16 <= length) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        uint32_t stop = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        if (stop) return pos + lowestBit(stop);
+        pos += 16;
+    }
+    return scalarFindNewline(text, pos, length);
+}
+
+TARGET_SSE2 size_t sse2FindCommentEnd(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    // The second load reads one byte ahead to pair each '*' with the byte after it.
+    while (pos + 17 <= length) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos + 1));
+        __m128i end = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(next, _mm_set1_epi8('/')));
+        uint32_t stop = static_cast<uint32_t>(_mm_movemask_epi8(end));
+        uint32_t nl = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        if (consumeBlock(stop, nl, pos, pos, newlines, lastNewline)) return pos;
+        pos += 16;
+    }
+    return scalarFindCommentEnd(text, pos, length, newlines, lastNewline);
+}
+
+const ScanKernels sse2Kernels = {
+    sse2SkipWhitespace, sse2SkipIdentifier, sse2FindQuote, sse2FindNewline, sse2FindCommentEnd
+};
+
+// --- AVX2 Kernels (32 bytes per step) ---
+
+TARGET_AVX2 size_t avx2SkipWhitespace(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    if (skipShortWhitespace(text, pos, length, newlines, lastNewline)) return pos;
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        __m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), nl));
+        uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+        if (consumeBlock(stop, static_cast<uint32_t>(_mm256_movemask_epi8(nl)), pos, pos, newlines, lastNewline)) {
+            return pos;
+        }
+        pos += 32;
+    }
+    return sse2SkipWhitespace(text, pos, length, newlines, lastNewline);
+}
+
+TARGET_AVX2 size_t avx2SkipIdentifier(const char* text, size_t pos, size_t length) {
+    if (skipShortIdentifier(text, pos, length)) return pos;
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        __m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(ident));
+        if (stop) return pos + lowestBit(stop);
+        pos += 32;
+    }
+    return sse2SkipIdentifier(text, pos, length);
+}
+
+TARGET_AVX2 size_t avx2FindQuote(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))));
+        uint32_t nl = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        if (consumeBlock(stop, nl, pos, pos, newlines, lastNewline)) return pos;
+        pos += 32;
+    }
+    return sse2FindQuote(text, pos, length, newlines, lastNewline);
+}
+
+TARGET_AVX2 size_t avx2FindNewline(const char* text, size_t pos, size_t length) {
+    while (pos + 32 <= length) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        if (stop) return pos + lowestBit(stop);
+        pos += 32;
+    }
+    return sse2FindNewline(text, pos, length);
+}
+
+TARGET_AVX2 size_t avx2FindCommentEnd(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline) {
+    while (pos + 33 <= length) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos + 1));
+        __m256i end = _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')),
+            _mm256_cmpeq_epi8(next, _mm256_set1_epi8('/')));
+        uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(end));
+        uint32_t nl = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        if (consumeBlock(stop, nl, pos, pos, newlines, lastNewline)) return pos;
+        pos += 32;
+    }
+    return sse2FindCommentEnd(text, pos, length, newlines, lastNewline);
+}
+
+const ScanKernels avx2Kernels = {
+    avx2SkipWhitespace, avx2SkipIdentifier, avx2FindQuote, avx2FindNewline, avx2FindCommentEnd
+};
+
+// --- CPU Feature Detection ---
+
+bool cpuHasSse2() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return true; // Part of the x86-64 baseline
+#elif defined(__GNUC__)
+    return __builtin_cpu_supports("sse2");
+#else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#endif
+}
+
+bool cpuHasAvx2() {
+#if defined(__GNUC__)
+    return __builtin_cpu_supports("avx2");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+    if (!osSavesAvx || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif // SCAN_KERNELS_X86
+
+} // namespace
+
+ScanBackend resolveScanBackend(ScanBackend backend) {
+#ifdef SCAN_KERNELS_X86
+    static const bool hasSse2 = cpuHasSse2();
+    static const bool hasAvx2 = hasSse2 && cpuHasAvx2();
+    switch (backend) {
+    case ScanBackend::Auto:
+    case ScanBackend::AVX2:
+        if (hasAvx2) return ScanBackend::AVX2;
+        [[fallthrough]];
+    case ScanBackend::SSE2:
+        if (hasSse2) return ScanBackend::SSE2;
+        [[fallthrough]];
+    default:
+        return ScanBackend::Scalar;
+    }
+#else
+    (void)backend;
+    return ScanBackend::Scalar;
+#endif
+}
+
+const ScanKernels& scanKernels(ScanBackend backend) {
+    switch (resolveScanBackend(backend)) {
+#ifdef SCAN_KERNELS_X86
+    case ScanBackend::AVX2: return avx2Kernels;
+    case ScanBackend::SSE2: return sse2Kernels;
+#endif
+    default: return scalarKernels;
+    }
+}
+
+const char* scanBackendName(ScanBackend backend) {
+    switch (backend) {
+    case ScanBackend::Auto: return "auto";
+    case ScanBackend::Scalar: return "scalar";
+    case ScanBackend::SSE2: return "sse2";
+    case ScanBackend::AVX2: return "avx2";
+    default: return "unknown";
+    }
+}
+
+bool parseScanBackend(const char* name, ScanBackend& backend) {
+    static const ScanBackend all[] = { ScanBackend::Auto, ScanBackend::Scalar, ScanBackend::SSE2, ScanBackend::AVX2 };
+    for (ScanBackend candidate : all) {
+        if (std::strcmp(name, scanBackendName(candidate)) == 0) {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+
+// Instruction set used by the Scanner's bulk character-class loops.
+enum class ScanBackend {
+    Auto,   // Best backend supported by the running CPU
+    Scalar, // One byte at a time (portable)
+    SSE2,   // 16 bytes per step
+    AVX2    // 32 bytes per step
+};
+
+// Run-skipping kernels for the Scanner's hot loops. Each takes the source text,
+// a start position and the text length, and returns the index of the first byte
+// at or after `pos` that ends the run (or `length` if the run reaches the end).
+// Kernels that cross lines add the newlines they pass to `newlines` and store
+// the index of the last one in `lastNewline`.
+struct ScanKernels {
+    // Runs of ' ', '\t', '\r' and '\n'.
+    size_t (*skipWhitespace)(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline);
+    // Runs of [A-Za-z0-9_].
+    size_t (*skipIdentifier)(const char* text, size_t pos, size_t length);
+    // String bodies: stops at the next '"'.
+    size_t (*findQuote)(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline);
+    // Line comment bodies: stops at the next '\n'.
+    size_t (*findNewline)(const char* text, size_t pos, size_t length);
+    // Block comment bodies: stops at the '*' of the next "*/".
+    size_t (*findCommentEnd)(const char* text, size_t pos, size_t length, int& newlines, size_t& lastNewline);
+};
+
+// Maps Auto to the best supported backend, and any backend the CPU cannot run
+// to the next best one.
+ScanBackend resolveScanBackend(ScanBackend backend);
+
+// Kernels for `backend` (resolved first, so this never returns unsupported code).
+const ScanKernels& scanKernels(ScanBackend backend);
+
+const char* scanBackendName(ScanBackend backend);
+
+// Parses "auto", "scalar", "sse2" or "avx2". Returns false for anything else.
+bool parseScanBackend(const char* name, ScanBackend& backend);
@@ -1,43 +1,65 @@
 #include "scanner.h"
+#include "keywords.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <charconv>
 
-std::map<std::string, TokenType> Scanner::initializeKeywords() const {
-    std::map<std::string, TokenType> keywordMap;
-    keywordMap["var"] = TokenType::VAR;
-    keywordMap["fun"] = TokenType::FUN;
-    keywordMap["return"] = TokenType::RETURN;
-    keywordMap["if"] = TokenType::IF;
-    keywordMap["else"] = TokenType::ELSE;
-    keywordMap["for"] = TokenType::FOR;
-    keywordMap["while"] = TokenType::WHILE;
-    keywordMap["do"] = TokenType::DO;
-    keywordMap["switch"] = TokenType::SWITCH;
-    keywordMap["case"] = TokenType::CASE;
-    keywordMap["default"] = TokenType::DEFAULT;
-    keywordMap["break"] = TokenType::BREAK;
-    keywordMap["continue"] = TokenType::CONTINUE;
-    keywordMap["true"] = TokenType::TRUE;
-    keywordMap["false"] = TokenType::FALSE;
-    keywordMap["nil"] = TokenType::NIL;
-    keywordMap["print"] = TokenType::PRINT;
-    return keywordMap;
+Scanner::Scanner(std::string_view source, ScanBackend backend)
+    : source(source), kernels(scanKernels(backend)), errorOutput(std::cerr), symbolCache(symbols()) {
 }
 
-Scanner::Scanner(const std::string& source)
-    : source(source), keywords(initializeKeywords()) {
+Scanner::Scanner(std::string_view source, int firstLine, std::ostream& errorOutput, ScanBackend backend)
+    : source(source), kernels(scanKernels(backend)), errorOutput(errorOutput), symbolCache(symbols()),
+    line(firstLine) {
+}
+
+Scanner::Scanner(std::string_view source, size_t offset, int line, int lineStart, std::ostream& errorOutput, ScanBackend backend)
+    : source(source), kernels(scanKernels(backend)), errorOutput(errorOutput), symbolCache(symbols()),
+    start(static_cast<int>(offset)), current(static_cast<int>(offset)), line(line), lineStart(lineStart) {
 }
 
 std::vector<Token> Scanner::scanTokens() {
+    // Even dense code averages about four source bytes per token. Reserving up
+    // front avoids repeatedly copying the (large) token vector while it grows;
+    // the unused tail of the reservation is never touched.
+    tokens.reserve(source.size() / 4 + 16);
     while (!isAtEnd()) {
         start = current;
         scanToken();
     }
 
-    tokens.emplace_back(TokenType::END_OF_FILE, "", std::nullopt, line, start, current);
-    return tokens;
+    tokens.emplace_back(TokenType::END_OF_FILE, std::string_view(), line, current);
+    return std::move(tokens);
+}
+
+TokenBuffer Scanner::scanBuffer() {
+    TokenBuffer result(source);
+    result.reserve(source.size() / 4 + 16); // As in scanTokens()
+    buffer = &result;
+    while (!isAtEnd()) {
+        start = current;
+        scanToken();
+    }
+    buffer = nullptr;
+    result.push(TokenType::END_OF_FILE, static_cast<uint32_t>(current), 0, line, current, noSymbol);
+    return result;
+}
+
+Token Scanner::nextToken() {
+    // scanToken() appends at most one token, so `tokens` never holds more than
+    // the one being handed out.
+    while (tokens.empty() && !isAtEnd()) {
+        start = current;
+        scanToken();
+    }
+    if (tokens.empty()) {
+        return Token(TokenType::END_OF_FILE, std::string_view(), line, current);
+    }
+    Token token = tokens.back();
+    tokens.clear();
+    return token;
 }
 
 void Scanner::scanToken() {
@@ -74,21 +96,10 @@ void Scanner::scanToken() {
 }
 
 void Scanner::scanIdentifier() {
-    while (isAlphaNumeric(peek())) {
-        advance();
-    }
-
-    std::string text = source.substr(start, current - start);
-    TokenType type;
-
-    if (keywords.count(text)) {
-        type = keywords.at(text);
-    }
-    else {
-        type = TokenType::IDENTIFIER;
-    }
+    current = static_cast<int>(kernels.skipIdentifier(source.data(), current, source.size()));
 
-    addToken(type);
+    // Keywords are recognized by a compile-time perfect hash (see keywords.h).
+    addToken(lookupKeyword(source.substr(start, current - start)));
 }
 
 void Scanner::scanNumber() {
@@ -118,23 +129,22 @@ void Scanner::scanNumber() {
         }
     }
 
-    std::string text = source.substr(start, current - start);
-
-    try {
-        double value = std::stod(text);
-        addToken(TokenType::NUMBER, value);
-    }
-    catch (const std::exception& e) {
+    // Only validate here; the value itself is decoded lazily by Token::numberValue().
+    std::string_view text = source.substr(start, current - start);
+    double value;
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) {
         reportError("Invalid numeric literal.");
-        addToken(TokenType::NUMBER);
     }
+    addToken(TokenType::NUMBER);
 }
 
 void Scanner::scanString() {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n') line++;
-        advance();
-    }
+    // Newlines inside the string advance the line count (lineStart is left alone).
+    int newlines = 0;
+    size_t lastNewline = 0;
+    current = static_cast<int>(kernels.findQuote(source.data(), current, source.size(), newlines, lastNewline));
+    line += newlines;
 
     if (isAtEnd()) {
         reportError("Unterminated string literal.");
@@ -143,9 +153,8 @@ void Scanner::scanString() {
 
     advance();
 
-    std::string value = source.substr(start + 1, current - start - 2);
-
-    addToken(TokenType::STRING, value);
+    // The body is not copied out; Token::stringValue() strips the quotes on demand.
+    addToken(TokenType::STRING);
 }
 
 void Scanner::scanOperatorOrSymbol(char firstChar) {
@@ -225,14 +234,15 @@ void Scanner::scanOperatorOrSymbol(char firstChar) {
 }
 
 void Scanner::addToken(TokenType type) {
-    std::string lexeme = source.substr(start, current - start);
-    tokens.emplace_back(type, std::move(lexeme), std::nullopt, line, start - lineStart, current - lineStart);
-}
-
-
-void Scanner::addToken(TokenType type, std::variant<double, std::string, bool> literal) {
-    std::string lexeme = source.substr(start, current - start);
-    tokens.emplace_back(type, std::move(lexeme), std::move(literal), line, start - lineStart, current - lineStart);
+    std::string_view lexeme = source.substr(start, current - start);
+    Symbol symbol = noSymbol;
+    if (type == TokenType::IDENTIFIER) symbol = symbolCache.intern(lexeme);
+    else if (type == TokenType::STRING) symbol = symbolCache.intern(stringFromLexeme(lexeme));
+    if (buffer != nullptr) {
+        buffer->push(type, static_cast<uint32_t>(start), static_cast<uint32_t>(lexeme.size()), line, start - lineStart, symbol);
+        return;
+    }
+    tokens.emplace_back(type, lexeme, line, start - lineStart, symbol);
 }
 
 bool Scanner::isAtEnd() const {
@@ -262,32 +272,34 @@ bool Scanner::match(char expected) {
 }
 
 void Scanner::skipWhitespace() {
+    // Runs of whitespace and comment bodies are skipped by the bulk kernels;
+    // lineStart tracks the index of the last newline passed.
     while (true) {
         char c = peek();
+        int newlines = 0;
+        size_t lastNewline = 0;
         switch (c) {
         case ' ':
         case '\r':
         case '\t':
-            advance();
-            break;
         case '\n':
-            line++;
-			lineStart = current;
-            advance();
+            current = static_cast<int>(kernels.skipWhitespace(source.data(), current, source.size(), newlines, lastNewline));
+            if (newlines > 0) {
+                line += newlines;
+                lineStart = static_cast<int>(lastNewline);
+            }
             break;
         case '/':
             if (peekNext() == '/') {
-                while (peek() != '\n' && !isAtEnd()) advance();
+                current = static_cast<int>(kernels.findNewline(source.data(), current, source.size()));
             }
             else if (peekNext() == '*') {
                 advance();
                 advance();
-                while (!(peek() == '*' && peekNext() == '/') && !isAtEnd()) {
-                    if (peek() == '\n') {
-                        line++;
-						lineStart = current;
-                    }
-                    advance();
+                current = static_cast<int>(kernels.findCommentEnd(source.data(), current, source.size(), newlines, lastNewline));
+                if (newlines > 0) {
+                    line += newlines;
+                    lineStart = static_cast<int>(lastNewline);
                 }
                 if (isAtEnd()) {
                     reportError("Unterminated block comment.");
@@ -322,8 +334,9 @@ bool Scanner::isAlphaNumeric(char c) const {
 }
 
 void Scanner::reportError(const std::string& message)  {
-    std::cerr << "[Line " << line << ", Col " << start - lineStart << "] Error: " << message << std::endl;
+    errorOutput << "[Line " << line << ", Col " << start - lineStart << "] Error: " << message << std::endl;
 	hadError = true;
+    ++errors;
 }
 
 bool Scanner::didEncounterError() const 
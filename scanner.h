@@ -3,32 +3,62 @@
 #define SCANNER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map> // Added for keyword map
+#include <iostream>
 #include "token.h"
+#include "interner.h"
+#include "token_buffer.h"
+#include "scan_kernels.h"
 
 
 class Scanner {
 public:
-    explicit Scanner(const std::string& source);
+    // The scanner does not copy the source: tokens hold views into it, so the
+    // buffer must outlive the returned tokens and any AST built from them.
+    // `backend` selects the instruction set for the bulk whitespace, comment,
+    // identifier and string loops; Auto picks the best one the CPU supports.
+    explicit Scanner(std::string_view source, ScanBackend backend = ScanBackend::Auto);
+
+    // Scans one piece of a larger file as if it started on line `firstLine`.
+    // Diagnostics go to `errorOutput` so that ParallelScanner can replay them in
+    // source order.
+    Scanner(std::string_view source, int firstLine, std::ostream& errorOutput,
+        ScanBackend backend = ScanBackend::Auto);
+
+    // Resumes a scan of the whole of `source` at `offset`, in the state a scan
+    // from the beginning is in there: on `line`, with the current line starting
+    // at `lineStart` (columns are counted from it). IncrementalDocument re-lexes
+    // an edited region this way, starting at a token boundary.
+    Scanner(std::string_view source, size_t offset, int line, int lineStart, std::ostream& errorOutput,
+        ScanBackend backend = ScanBackend::Auto);
 
     std::vector<Token> scanTokens();
+    // Scans the whole source into a structure-of-arrays TokenBuffer instead.
+    TokenBuffer scanBuffer();
+
+    // Pull interface: scans and returns the next token, then END_OF_FILE on
+    // every call once the input is exhausted. Use either this or scanTokens().
+    Token nextToken();
     void reportError(const std::string& message);
     bool didEncounterError() const;
+    size_t errorCount() const { return errors; }
 
 private:
     // --- Data Members ---
-    const std::string source;
+    const std::string_view source;
     std::vector<Token> tokens;
-
-    // This is crucial for distinguishing keywords from general identifiers
-    const std::map<std::string, TokenType> keywords;
+    TokenBuffer* buffer = nullptr; // Where addToken() goes during scanBuffer()
+    const ScanKernels& kernels;
+    std::ostream& errorOutput;
+    SymbolCache symbolCache; // Interns IDENTIFIER and STRING tokens into symbols()
 
     int start = 0;   // Start of the current lexeme
     int current = 0; // Current position in the source
     int line = 1;    // Current line number
 	int lineStart = 0; // Start index of the current line
     bool hadError = false;
+    size_t errors = 0;
 
     // --- Core Scanning Logic ---
     void scanToken();
@@ -54,11 +84,8 @@ private:
 
     // --- Token Creation ---
     // Changed to void, as they should add the token directly to the 'tokens' vector
+    // Literal values are decoded lazily from the lexeme (see Token::literal)
     void addToken(TokenType type);
-    void addToken(TokenType type, std::variant<double, std::string, bool> literal);
-
-    // Helper to initialize the keyword map.
-    std::map<std::string, TokenType> initializeKeywords() const;
 };
 
 #endif // SCANNER_H
\ No newline at end of file
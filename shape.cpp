@@ -0,0 +1,75 @@
+#include "shape.h"
+
+InlineCacheStats inlineCacheStats;
+
+namespace {
+
+size_t shapesCreated = 1; // The empty shape
+
+// Direct-mapped: a collision simply replaces the older answer. Shapes are
+// never freed, so an entry never goes stale.
+struct Lookup {
+    const Shape* shape = nullptr;
+    Symbol name = noSymbol;
+    uint32_t slot = Shape::missing;
+};
+constexpr size_t lookupCacheSize = 1024;
+Lookup lookupCache[lookupCacheSize];
+
+} // namespace
+
+Shape* Shape::empty() {
+    static Shape root;
+    return &root;
+}
+
+size_t Shape::count() {
+    return shapesCreated;
+}
+
+uint32_t Shape::slotOf(Symbol name) const {
+    size_t hash = (reinterpret_cast<uintptr_t>(this) >> 4) ^ (name * 0x9E3779B1u);
+    Lookup& lookup = lookupCache[hash & (lookupCacheSize - 1)];
+    if (lookup.shape == this && lookup.name == name) return lookup.slot;
+
+    uint32_t found = missing;
+    for (uint32_t slot = 0; slot < names.size(); ++slot) {
+        if (names[slot] == name) {
+            found = slot;
+            break;
+        }
+    }
+    lookup = { this, name, found };
+    return found;
+}
+
+Shape* Shape::withField(Symbol name) {
+    if (names.size() >= maxFields) return nullptr;
+    std::unique_ptr<Shape>& child = transitions[name];
+    if (child == nullptr) {
+        child.reset(new Shape());
+        child->names.reserve(names.size() + 1);
+        child->names = names;
+        child->names.push_back(name);
+        ++shapesCreated;
+    }
+    return child.get();
+}
+
+void InlineCache::add(const Entry& entry) {
+    if (megamorphic) return;
+    if (size == ways) {
+        megamorphic = true;
+        --inlineCacheStats.polymorphic;
+        ++inlineCacheStats.megamorphic;
+        return;
+    }
+    entries[size++] = entry;
+    if (size == 1) {
+        ++inlineCacheStats.monomorphic;
+    }
+    else if (size == 2) {
+        --inlineCacheStats.monomorphic;
+        ++inlineCacheStats.polymorphic;
+    }
+}
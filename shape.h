@@ -0,0 +1,87 @@
+#pragma once
+#include "interner.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// --- Shapes ---
+
+// The layout of an object (a hidden class): its field names in the order
+// they were added, each naming a slot of the object's `slots`. Objects that
+// gained the same fields in the same order share one Shape, so a site that
+// has learned "shape S keeps `x` in slot 2" can skip the lookup by name
+// whenever it meets S again (see InlineCache).
+//
+// Shapes form a tree rooted at the empty shape: adding a field follows (or
+// creates) the transition to a child. They are never freed, so caches may
+// keep them across heaps and runs. An object that grows past maxFields fields
+// leaves the tree for a dictionary of its own (see ObjInstance).
+//
+// The engines run on one thread; the tree is not locked.
+class Shape {
+public:
+    static constexpr uint32_t missing = UINT32_MAX;
+    static constexpr uint32_t maxFields = 32;
+
+    // The root: an object with no fields.
+    static Shape* empty();
+    // Shapes created so far, the empty one included.
+    static size_t count();
+
+    uint32_t fieldCount() const { return static_cast<uint32_t>(names.size()); }
+    Symbol nameAt(uint32_t slot) const { return names[slot]; }
+    // Slot of the field `name`, or `missing`. Answers are remembered in a
+    // small table shared by all shapes, which is what megamorphic sites and
+    // computed keys (object["name"]) fall back on.
+    uint32_t slotOf(Symbol name) const;
+    // The shape after adding `name`, which this shape must lack; nullptr if
+    // it already has maxFields fields.
+    Shape* withField(Symbol name);
+
+private:
+    std::vector<Symbol> names; // By slot
+    std::unordered_map<Symbol, std::unique_ptr<Shape>> transitions;
+};
+
+// --- Inline Caches ---
+
+// What one field access site (a '.' tail, or the instruction compiled from
+// it) has learned about the objects it met: up to `ways` shapes, each with
+// the slot the field is in. One entry makes the site monomorphic, more make
+// it polymorphic. A site that meets yet another shape goes megamorphic: it
+// stops using its entries, whose hit rate would no longer pay for scanning
+// them, and looks every access up by name (see Shape::slotOf).
+//
+// A store that adds the field caches the transition as well: objects built
+// by the same code take the same path through the shape tree, so the stores
+// in a constructor-like function hit too.
+struct InlineCache {
+    static constexpr int ways = 4;
+
+    struct Entry {
+        const Shape* shape = nullptr;
+        Shape* grown = nullptr;        // For a store that adds the field: the shape after
+        uint32_t slot = Shape::missing; // Of the field; missing if `shape` lacks it
+    };
+
+    Entry entries[ways];
+    uint8_t size = 0;
+    bool megamorphic = false;
+
+    // Remembers what a lookup by name found.
+    void add(const Entry& entry);
+};
+
+struct InlineCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;    // Lookups by name at a site, megamorphic ones included
+    size_t monomorphic = 0; // Sites, by their state now
+    size_t polymorphic = 0;
+    size_t megamorphic = 0;
+};
+
+// Counters for every inline cache in the process. Plain data: the hit path
+// bumps it directly. --ic-stats and the benchmarks read and reset it.
+extern InlineCacheStats inlineCacheStats;
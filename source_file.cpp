@@ -0,0 +1,174 @@
+#include "source_file.h"
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceFile::~SourceFile() {
+    close();
+}
+
+SourceFile::SourceFile(SourceFile&& other) noexcept {
+    moveFrom(other);
+}
+
+SourceFile& SourceFile::operator=(SourceFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        moveFrom(other);
+    }
+    return *this;
+}
+
+void SourceFile::moveFrom(SourceFile& other) {
+    mapped = other.mapped;
+    length = other.length;
+    buffer = std::move(other.buffer);
+    data = mapped ? other.data : buffer.data();
+#ifdef _WIN32
+    fileHandle = other.fileHandle;
+    mappingHandle = other.mappingHandle;
+    other.fileHandle = nullptr;
+    other.mappingHandle = nullptr;
+#endif
+    other.data = "";
+    other.length = 0;
+    other.mapped = false;
+}
+
+bool SourceFile::open(const std::string& path, LoadMode mode) {
+    close();
+    if (mode == LoadMode::Auto && map(path)) {
+        return true;
+    }
+    return read(path);
+}
+
+void SourceFile::close() {
+    if (mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<char*>(data), length);
+#endif
+    }
+    buffer.clear();
+    buffer.shrink_to_fit();
+    data = "";
+    length = 0;
+    mapped = false;
+}
+
+#ifdef _WIN32
+
+bool SourceFile::map(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    // Empty files cannot be mapped; let read() handle them.
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const char*>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    mapped = true;
+    return true;
+}
+
+#else
+
+bool SourceFile::map(const std::string& path) {
+    // Only regular files map. Pipes and FIFOs are left to read(): opening one
+    // here and closing it again could lose what the writer sends.
+    struct stat pathInfo;
+    if (::stat(path.c_str(), &pathInfo) != 0 || !S_ISREG(pathInfo.st_mode)) return false;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    // Empty files cannot be mapped; let read() handle them.
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+
+    // The scanner makes a single forward pass over the text.
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(view);
+    length = static_cast<size_t>(info.st_size);
+    mapped = true;
+    return true;
+}
+
+#endif
+
+bool SourceFile::read(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) return false;
+
+    // Read straight into a buffer of the final size: one copy, no stringstream.
+    input.seekg(0, std::ios::end);
+    std::streamoff fileSize = input.tellg();
+    if (fileSize >= 0) {
+        input.seekg(0, std::ios::beg);
+        buffer.resize(static_cast<size_t>(fileSize));
+        if (fileSize > 0 && !input.read(&buffer[0], fileSize)) {
+            buffer.clear();
+            return false;
+        }
+    }
+    else {
+        // Not seekable (a pipe, a FIFO, /dev/stdin): stream it in chunks until EOF.
+        input.clear();
+        char chunk[64 * 1024];
+        while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+            buffer.append(chunk, static_cast<size_t>(input.gcount()));
+        }
+        if (input.bad()) {
+            buffer.clear();
+            return false;
+        }
+    }
+
+    data = buffer.data();
+    length = buffer.size();
+    return true;
+}
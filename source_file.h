@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a source file on disk.
+// The file is memory-mapped when the platform allows it, so the Scanner can run
+// straight over the mapping without the text ever being copied. If mapping is
+// not possible (or not requested) the file is read once into an owned buffer;
+// one that cannot be sized up front (a pipe, a FIFO) is streamed into it.
+class SourceFile {
+public:
+    enum class LoadMode {
+        Auto,   // Map the file, fall back to reading it
+        Read    // Always read into an owned buffer
+    };
+
+    SourceFile() = default;
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+    SourceFile(SourceFile&& other) noexcept;
+    SourceFile& operator=(SourceFile&& other) noexcept;
+
+    // Loads `path`. Returns false (and leaves the object empty) on failure.
+    bool open(const std::string& path, LoadMode mode = LoadMode::Auto);
+    void close();
+
+    // The file contents; valid until close() or destruction.
+    std::string_view text() const { return std::string_view(data, length); }
+    size_t size() const { return length; }
+    bool isMapped() const { return mapped; }
+
+private:
+    const char* data = "";
+    size_t length = 0;
+    bool mapped = false;
+    std::string buffer; // Owned contents when the file is not mapped
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    bool map(const std::string& path);
+    bool read(const std::string& path);
+    void moveFrom(SourceFile& other);
+};
@@ -2,13 +2,15 @@
 #include "ast_node.h"
 #include "ast_visitor.h"
 #include "expr_nodes.h"
+#include "switch_table.h"
 #include "token.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 class ExprStmt : public Stmt {
 public:
     ExprStmt(Expr* expression) : expression(expression) {}
-    ~ExprStmt() { delete expression; }
 
     Expr* expression;
 
@@ -18,7 +20,6 @@ public:
 class PrintStmt : public Stmt {
 public:
     PrintStmt(Expr* expression) : expression(expression) {}
-    ~PrintStmt() { delete expression; }
 
     Expr* expression;
 
@@ -28,7 +29,6 @@ public:
 class ReturnStmt : public Stmt {
 public:
     ReturnStmt(Expr* value) : value(value) {}
-    ~ReturnStmt() { delete value; }
 
     Expr* value;
 
@@ -54,9 +54,9 @@ public:
 class BlockStmt : public Stmt {
 public:
     BlockStmt(std::vector<Declaration*> statements) : statements(std::move(statements)) {}
-    ~BlockStmt(); // Requires definition in .cpp
 
     std::vector<Declaration*> statements;
+    uint32_t frameSize = 0; // Locals declared directly in the block (no frame if 0)
 
     void accept(AstVisitor& visitor) override { visitor.visitBlockStmt(this); }
 };
@@ -66,7 +66,6 @@ public:
     IfStmt(Expr* condition, Stmt* thenBranch, Stmt* elseBranch)
         : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {
     }
-    ~IfStmt() { delete condition; delete thenBranch; delete elseBranch; }
 
     Expr* condition;
     Stmt* thenBranch;
@@ -78,7 +77,6 @@ public:
 class WhileStmt : public Stmt {
 public:
     WhileStmt(Expr* condition, Stmt* body) : condition(condition), body(body) {}
-    ~WhileStmt() { delete condition; delete body; }
 
     Expr* condition;
     Stmt* body;
@@ -89,7 +87,6 @@ public:
 class DoWhileStmt : public Stmt {
 public:
     DoWhileStmt(Stmt* body, Expr* condition) : body(body), condition(condition) {}
-    ~DoWhileStmt() { delete body; delete condition; }
 
     Stmt* body;
     Expr* condition;
@@ -102,20 +99,24 @@ public:
     ForStmt(Declaration* initializer, Expr* condition, Expr* increment, Stmt* body)
         : initializer(initializer), condition(condition), increment(increment), body(body) {
     }
-    ~ForStmt() { delete initializer; delete condition; delete increment; delete body; }
 
     Declaration* initializer;
     Expr* condition;
     Expr* increment;
     Stmt* body;
+    uint32_t frameSize = 0; // Locals declared by the initializer
 
     void accept(AstVisitor& visitor) override { visitor.visitForStmt(this); }
 };
 
 struct CaseStmt {
-    ~CaseStmt(); // Requires definition in .cpp
-    Expr* value;
+    CaseStmt(Expr* value, std::vector<Declaration*> body)
+        : value(value), body(std::move(body)) {
+    }
+
+    Expr* value; // nullptr for 'default'
     std::vector<Declaration*> body;
+    uint32_t frameSize = 0; // Locals declared in the case body
 };
 
 class SwitchStmt : public Stmt {
@@ -123,10 +124,10 @@ public:
     SwitchStmt(Expr* condition, std::vector<CaseStmt*> cases)
         : condition(condition), cases(std::move(cases)) {
     }
-    ~SwitchStmt(); // Requires definition in .cpp
 
     Expr* condition;
     std::vector<CaseStmt*> cases;
+    std::unique_ptr<SwitchTable> table; // Case index by value, made by the Resolver
 
     void accept(AstVisitor& visitor) override { visitor.visitSwitchStmt(this); }
 };
@@ -0,0 +1,92 @@
+#include "switch_table.h"
+#include "expr_nodes.h"
+#include <algorithm>
+
+namespace {
+
+constexpr double maxExactInteger = 9007199254740992.0; // 2^53
+
+} // namespace
+
+SwitchTable::SwitchTable(const std::vector<int64_t>& values, const std::vector<uint32_t>& targets,
+    uint32_t missTarget)
+    : missTarget(missTarget) {
+    // Drop repeated values, keeping the first; sort what is left.
+    std::vector<std::pair<int64_t, uint32_t>> entries;
+    for (size_t i = 0; i < values.size(); ++i) entries.push_back({ values[i], targets[i] });
+    std::stable_sort(entries.begin(), entries.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    entries.erase(std::unique(entries.begin(), entries.end(),
+        [](const auto& a, const auto& b) { return a.first == b.first; }), entries.end());
+    cases = entries.size();
+    if (entries.empty()) return;
+
+    minimum = entries.front().first;
+    low = static_cast<double>(minimum);
+    high = static_cast<double>(entries.back().first);
+    uint64_t range = static_cast<uint64_t>(entries.back().first - minimum) + 1;
+    if (range <= 2 * static_cast<uint64_t>(cases)) {
+        kind_ = Kind::Dense;
+        dense.assign(static_cast<size_t>(range), missTarget);
+        for (const auto& entry : entries) dense[static_cast<size_t>(entry.first - minimum)] = entry.second;
+    }
+    else if (cases <= sparseLimit) {
+        kind_ = Kind::Sparse;
+        for (const auto& entry : entries) {
+            keys.push_back(entry.first);
+            keyTargets.push_back(entry.second);
+        }
+    }
+    else {
+        kind_ = Kind::Hash;
+        size_t capacity = 1;
+        while (capacity < 2 * cases) capacity *= 2;
+        slots.assign(capacity, { 0, empty });
+        for (const auto& entry : entries) slots[slotFor(entry.first)] = { entry.first, entry.second };
+    }
+}
+
+uint32_t SwitchTable::lookupSparse(int64_t key) const {
+    auto found = std::lower_bound(keys.begin(), keys.end(), key);
+    if (found == keys.end() || *found != key) return missTarget;
+    return keyTargets[static_cast<size_t>(found - keys.begin())];
+}
+
+uint32_t SwitchTable::lookupHash(int64_t key) const {
+    const Slot& slot = slots[slotFor(key)];
+    return slot.target == empty ? missTarget : slot.target;
+}
+
+// The slot holding `key`, or the free one where it would go (linear probing).
+size_t SwitchTable::slotFor(int64_t key) const {
+    size_t mask = slots.size() - 1;
+    size_t index = static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (slots[index].target != empty && slots[index].key != key) index = (index + 1) & mask;
+    return index;
+}
+
+bool integerCaseValue(const Expr* expr, int64_t& value) {
+    if (auto grouping = dynamic_cast<const GroupingExpr*>(expr)) {
+        return integerCaseValue(grouping->expression, value);
+    }
+    if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
+        if (unary->op.type != TokenType::MINUS && unary->op.type != TokenType::PLUS) return false;
+        if (!integerCaseValue(unary->right, value)) return false;
+        if (unary->op.type == TokenType::MINUS) value = -value;
+        return true;
+    }
+    auto primary = dynamic_cast<const PrimaryExpr*>(expr);
+    if (primary == nullptr || primary->value.type != TokenType::NUMBER) return false;
+    double number = primary->value.numberValue();
+    if (!(number >= -maxExactInteger && number <= maxExactInteger)) return false;
+    value = static_cast<int64_t>(number);
+    return static_cast<double>(value) == number;
+}
+
+const char* switchTableKindName(SwitchTable::Kind kind) {
+    switch (kind) {
+    case SwitchTable::Kind::Dense: return "dense";
+    case SwitchTable::Kind::Sparse: return "sparse";
+    default: return "hash";
+    }
+}
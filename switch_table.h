@@ -0,0 +1,76 @@
+#pragma once
+#include "value.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Expr;
+
+// --- Switch Tables ---
+
+// Where a switch whose case values are all integer constants goes for a
+// given subject, found in one step instead of comparing the subject with
+// every case in turn. A target is whatever the engine jumps to (a code
+// offset in the VM, a case index in the tree-walker); a subject equal to
+// none of the values (or not a number at all) gets `missTarget`.
+//
+// The layout follows the values' density:
+//  - Dense: a target per integer from the smallest value to the largest,
+//    when at least half of them are case values;
+//  - Sparse: the sorted values, binary searched, up to sparseLimit values;
+//  - Hash: an open-addressed table, for more values than that.
+class SwitchTable {
+public:
+    enum class Kind : uint8_t { Dense, Sparse, Hash };
+
+    // Smallest switch worth a table; shorter ones compare in sequence.
+    static constexpr size_t minimumCases = 4;
+    static constexpr size_t sparseLimit = 32;
+
+    SwitchTable() = default;
+    // `values[i]` selects `targets[i]`; when values repeat, the first wins,
+    // as it would comparing in order.
+    SwitchTable(const std::vector<int64_t>& values, const std::vector<uint32_t>& targets, uint32_t missTarget);
+
+    uint32_t lookup(Value subject) const {
+        if (!subject.isNumber()) return missTarget;
+        double number = subject.asNumber();
+        // Rejects NaN, out of range and fractional subjects alike.
+        if (!(number >= low && number <= high)) return missTarget;
+        int64_t key = static_cast<int64_t>(number);
+        if (static_cast<double>(key) != number) return missTarget;
+        if (kind_ == Kind::Dense) return dense[static_cast<size_t>(key - minimum)];
+        return kind_ == Kind::Sparse ? lookupSparse(key) : lookupHash(key);
+    }
+
+    Kind kind() const { return kind_; }
+    size_t caseCount() const { return cases; }
+
+private:
+    struct Slot {
+        int64_t key;
+        uint32_t target; // `empty` for a free slot
+    };
+    static constexpr uint32_t empty = UINT32_MAX;
+
+    Kind kind_ = Kind::Sparse;
+    size_t cases = 0;
+    int64_t minimum = 0;
+    double low = 1.0, high = 0.0; // Range of the values; empty until built
+    uint32_t missTarget = 0;
+    std::vector<uint32_t> dense;     // Dense: target by value - minimum
+    std::vector<int64_t> keys;       // Sparse: sorted
+    std::vector<uint32_t> keyTargets; // Sparse: by position in `keys`
+    std::vector<Slot> slots;         // Hash: a power of two, at most half full
+
+    uint32_t lookupSparse(int64_t key) const;
+    uint32_t lookupHash(int64_t key) const;
+    size_t slotFor(int64_t key) const;
+};
+
+// The value of a case label a switch table can hold: an integer literal,
+// possibly negated or parenthesized, of magnitude up to 2^53 (where every
+// integer is still a distinct double).
+bool integerCaseValue(const Expr* expr, int64_t& value);
+
+const char* switchTableKindName(SwitchTable::Kind kind);
@@ -2,9 +2,12 @@
 #define TOKEN_H
 
 #include <string>
+#include <string_view>
 #include <variant>
 #include <optional>
+#include <charconv>
 #include <iostream>
+#include "interner.h"
 
 // All token types in your language
 enum class TokenType {
@@ -44,44 +47,79 @@ enum class TokenType {
     END_OF_FILE
 };
 
-// Represents a single lexeme from the source code
+// Decoded value of a NUMBER or STRING token
+using LiteralValue = std::variant<double, std::string, bool>;
+
+// Value of a NUMBER lexeme
+inline double numberFromLexeme(std::string_view lexeme) {
+    double value = 0.0;
+    std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+    return value;
+}
+
+// Body of a STRING lexeme without the surrounding quotes
+inline std::string_view stringFromLexeme(std::string_view lexeme) {
+    if (lexeme.size() < 2) return {};
+    return lexeme.substr(1, lexeme.size() - 2);
+}
+
+// Represents a single lexeme from the source code.
+// The lexeme is a view into the source buffer handed to the Scanner, so that
+// buffer must outlive every Token (and every AST node) built from it.
 class Token {
 public:
     TokenType type;                      // Kind of token
-    std::string lexeme;                  // Actual text
-    std::optional<std::variant<double, std::string, bool>> literal;  // Literal value (if any)
     int line;                            // Line number in source
     int start;                           // Starting column (0-based)
-    int end;                             // Ending column (inclusive or exclusive, your choice)
+    Symbol symbol;                       // Interned name (IDENTIFIER) or body (STRING), else noSymbol
+    std::string_view lexeme;             // Actual text (view into the source)
 
-    Token(TokenType type, std::string lexeme,
-        std::optional<std::variant<double, std::string, bool>> literal,
-        int line, int start, int end)
+    Token(TokenType type, std::string_view lexeme, int line, int start, Symbol symbol = noSymbol)
         : type(type),
-        lexeme(std::move(lexeme)),
-        literal(std::move(literal)),
         line(line),
         start(start),
-        end(end) {
+        symbol(symbol),
+        lexeme(lexeme) {
+    }
+
+    // Column just past the lexeme. Derived rather than stored so the symbol
+    // fits without growing the token past 32 bytes; a string spanning lines
+    // still counts from its first line, as the scanner always has.
+    int end() const { return start + static_cast<int>(lexeme.size()); }
+
+    // Numeric value of a NUMBER token, parsed from the lexeme on demand
+    double numberValue() const { return numberFromLexeme(lexeme); }
+
+    // Body of a STRING token without the surrounding quotes (no copy)
+    std::string_view stringValue() const { return stringFromLexeme(lexeme); }
+
+    // Literal value (if any), decoded lazily from the lexeme
+    std::optional<LiteralValue> literal() const {
+        switch (type) {
+        case TokenType::NUMBER: return LiteralValue(numberValue());
+        case TokenType::STRING: return LiteralValue(std::string(stringValue()));
+        default: return std::nullopt;
+        }
     }
 
     // Returns a human-readable representation
     std::string toString() const {
         std::string typeStr = tokenTypeToString(type);
         std::string litStr;
-        if (literal.has_value()) {
-            if (std::holds_alternative<double>(*literal))
-                litStr = std::to_string(std::get<double>(*literal));
-            else if (std::holds_alternative<std::string>(*literal))
-                litStr = "\"" + std::get<std::string>(*literal) + "\"";
-            else if (std::holds_alternative<bool>(*literal))
-                litStr = std::get<bool>(*literal) ? "true" : "false";
+        std::optional<LiteralValue> value = literal();
+        if (value.has_value()) {
+            if (std::holds_alternative<double>(*value))
+                litStr = std::to_string(std::get<double>(*value));
+            else if (std::holds_alternative<std::string>(*value))
+                litStr = "\"" + std::get<std::string>(*value) + "\"";
+            else if (std::holds_alternative<bool>(*value))
+                litStr = std::get<bool>(*value) ? "true" : "false";
         }
 
-        return "Token(" + typeStr + ", \"" + lexeme + "\"" +
+        return "Token(" + typeStr + ", \"" + std::string(lexeme) + "\"" +
             (litStr.empty() ? "" : ", " + litStr) +
             ", line=" + std::to_string(line) +
-            ", col=" + std::to_string(start) + "-" + std::to_string(end) + ")";
+            ", col=" + std::to_string(start) + "-" + std::to_string(end()) + ")";
     }
 
 private:
@@ -157,4 +195,21 @@ private:
     }
 };
 
+// What the AST keeps of a token: its kind, text, symbol and line. Nodes store
+// this instead of a full Token (no columns), and it converts from a Token
+// implicitly.
+struct TokenRef {
+    std::string_view lexeme;
+    int line;
+    TokenType type;
+    Symbol symbol;
+
+    TokenRef(const Token& token)
+        : lexeme(token.lexeme), line(token.line), type(token.type), symbol(token.symbol) {
+    }
+
+    double numberValue() const { return numberFromLexeme(lexeme); }
+    std::string_view stringValue() const { return stringFromLexeme(lexeme); }
+};
+
 #endif // TOKEN_H
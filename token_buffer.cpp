@@ -0,0 +1,59 @@
+#include "token_buffer.h"
+#include <algorithm>
+
+static_assert(static_cast<int>(TokenType::END_OF_FILE) <= UINT8_MAX, "TokenType must fit in a byte");
+
+void TokenBuffer::reserve(size_t count) {
+    types.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    positions.reserve(count);
+    symbolCheckpoints.reserve((count >> checkpointBits) + 1);
+}
+
+void TokenBuffer::push(TokenType type, uint32_t offset, uint32_t length, int line, int column, Symbol symbol) {
+    if ((types.size() & ((size_t(1) << checkpointBits) - 1)) == 0) {
+        symbolCheckpoints.push_back(static_cast<uint32_t>(symbols.size()));
+    }
+    types.push_back(static_cast<uint8_t>(type));
+    offsets.push_back(offset);
+    lengths.push_back(length);
+    // Negative values wrap around and land in the overflow table too.
+    if (static_cast<uint32_t>(line) < lineLimit && static_cast<uint32_t>(column) < columnMask) {
+        positions.push_back(static_cast<uint32_t>(line) << columnBits | static_cast<uint32_t>(column));
+    }
+    else {
+        positions.push_back(farPosition);
+        farPositions.push_back({ static_cast<uint32_t>(types.size() - 1), line, column });
+    }
+    if (hasSymbol(type)) symbols.push_back(symbol);
+}
+
+size_t TokenBuffer::symbolRank(size_t i) const {
+    size_t block = i >> checkpointBits;
+    size_t rank = symbolCheckpoints[block];
+    for (size_t j = block << checkpointBits; j < i; ++j) {
+        rank += hasSymbol(type(j));
+    }
+    return rank;
+}
+
+const TokenBuffer::FarPosition& TokenBuffer::farPositionOf(size_t i) const {
+    return *std::lower_bound(farPositions.begin(), farPositions.end(), i,
+        [](const FarPosition& position, size_t index) { return position.index < index; });
+}
+
+Symbol TokenBuffer::symbol(size_t i) const {
+    return hasSymbol(type(i)) ? symbols[symbolRank(i)] : noSymbol;
+}
+
+Token TokenBuffer::token(size_t i, size_t rank) const {
+    TokenType tokenType = type(i);
+    return Token(tokenType, lexeme(i), line(i), column(i), hasSymbol(tokenType) ? symbols[rank] : noSymbol);
+}
+
+size_t TokenBuffer::memoryBytes() const {
+    return types.capacity() * sizeof(uint8_t) + offsets.capacity() * sizeof(uint32_t) +
+        lengths.capacity() * sizeof(uint32_t) + positions.capacity() * sizeof(uint32_t) +
+        farPositions.capacity() * sizeof(FarPosition) + symbols.capacity() * sizeof(Symbol) + symbolCheckpoints.capacity() * sizeof(uint32_t);
+}
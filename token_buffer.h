@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "token.h"
+
+// Tokens as a structure of arrays instead of a vector of Token.
+// The parser's lookahead (check, match, the Pratt loop) only needs a token's
+// type; here the types are one byte each, 64 to a cache line, and the other
+// fields are read only when a token is consumed into the AST.
+//
+// Per token: the type byte, the lexeme's offset and length in the source, and
+// its line and column packed into 32 bits (20 for the line, 12 for the
+// column). The rare position that does not fit - past line 1M or column
+// 4K - is kept whole in an overflow table instead. Symbols sit in a side table that
+// holds only the IDENTIFIER and STRING tokens, in order; a token's entry is
+// found by counting from a checkpoint kept every 64 tokens (or, when reading
+// in order, by keeping a running count as TokenStream does).
+//
+// Lexemes are views into the source, which must outlive the buffer. Offsets
+// are 32-bit, so sources are limited to 4 GB.
+class TokenBuffer {
+public:
+    explicit TokenBuffer(std::string_view source = {}) : source(source) {}
+
+    void reserve(size_t count);
+    void push(TokenType type, uint32_t offset, uint32_t length, int line, int column, Symbol symbol);
+
+    size_t size() const { return types.size(); }
+    bool empty() const { return types.empty(); }
+    std::string_view text() const { return source; }
+
+    TokenType type(size_t i) const { return static_cast<TokenType>(types[i]); }
+    uint32_t offset(size_t i) const { return offsets[i]; }
+    std::string_view lexeme(size_t i) const { return std::string_view(source.data() + offsets[i], lengths[i]); }
+    int line(size_t i) const {
+        uint32_t packed = positions[i];
+        return packed != farPosition ? static_cast<int>(packed >> columnBits) : farPositionOf(i).line;
+    }
+    int column(size_t i) const {
+        uint32_t packed = positions[i];
+        return packed != farPosition ? static_cast<int>(packed & columnMask) : farPositionOf(i).column;
+    }
+    Symbol symbol(size_t i) const;
+
+    // Token `i` reassembled. The second form takes the number of tokens with
+    // symbols before `i`, saving the count from the checkpoint.
+    Token token(size_t i) const { return token(i, symbolRank(i)); }
+    Token token(size_t i, size_t rank) const;
+
+    static bool hasSymbol(TokenType type) { return type == TokenType::IDENTIFIER || type == TokenType::STRING; }
+    // Tokens with symbols before `i`.
+    size_t symbolRank(size_t i) const;
+
+    // Bytes held by all the arrays (their capacity).
+    size_t memoryBytes() const;
+
+private:
+    static constexpr size_t checkpointBits = 6;
+    static constexpr uint32_t columnBits = 12;
+    static constexpr uint32_t columnMask = (uint32_t(1) << columnBits) - 1;
+    static constexpr uint32_t lineLimit = uint32_t(1) << (32 - columnBits);
+    static constexpr uint32_t farPosition = UINT32_MAX; // See farPositions
+
+    struct FarPosition {
+        uint32_t index; // The token's
+        int line;
+        int column;
+    };
+
+    std::string_view source;
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> positions;         // line << columnBits | column, or farPosition
+    std::vector<FarPosition> farPositions;   // By token index
+    std::vector<Symbol> symbols;             // The side table
+    std::vector<uint32_t> symbolCheckpoints; // Side table entries before each 64-token block
+
+    const FarPosition& farPositionOf(size_t i) const;
+};
@@ -0,0 +1,79 @@
+#include "token_stream.h"
+#include "scanner.h"
+
+TokenStream::TokenStream(const std::vector<Token>& tokens)
+    : tokens(&tokens) {
+    // Before anything is consumed, previous() falls back to the first token.
+    currentToken = &tokens[0];
+    previousToken = currentToken;
+}
+
+TokenStream::TokenStream(const TokenBuffer& buffer)
+    : buffer(&buffer) {
+    slots.reserve(2);
+    slots.push_back(buffer.token(0, 0));
+    slots.push_back(slots[0]);
+    currentToken = &slots[0];
+    previousToken = &slots[1];
+    currentBuilt = 0;
+    previousBuilt = 0;
+}
+
+TokenStream::TokenStream(Scanner& scanner)
+    : scanner(&scanner) {
+    ring.reserve(ringSize);
+    ring.push_back(scanner.nextToken());
+    currentToken = &ring[0];
+    previousToken = currentToken;
+}
+
+void TokenStream::advance() {
+    if (buffer != nullptr) {
+        TokenType type = buffer->type(index);
+        if (type == TokenType::END_OF_FILE) return;
+        previousIndex = index++;
+        previousSymbolRank = symbolRank;
+        symbolRank += TokenBuffer::hasSymbol(type);
+        return;
+    }
+    if (currentToken->type == TokenType::END_OF_FILE) return;
+
+    previousToken = currentToken;
+    if (tokens != nullptr) {
+        currentToken = &(*tokens)[++index];
+        return;
+    }
+
+    ringPosition = (ringPosition + 1) % ringSize;
+    if (ring.size() < ringSize) {
+        ring.push_back(scanner->nextToken());
+    }
+    else {
+        ring[ringPosition] = scanner->nextToken();
+    }
+    currentToken = &ring[ringPosition];
+}
+
+void TokenStream::seek(size_t position) {
+    index = position;
+    if (buffer != nullptr) {
+        previousIndex = position > 0 ? position - 1 : 0;
+        symbolRank = buffer->symbolRank(position);
+        previousSymbolRank = buffer->symbolRank(previousIndex);
+        currentBuilt = notBuilt;
+        previousBuilt = notBuilt;
+        return;
+    }
+    currentToken = &(*tokens)[position];
+    previousToken = position > 0 ? &(*tokens)[position - 1] : currentToken;
+}
+
+void TokenStream::buildCurrent() const {
+    slots[0] = buffer->token(index, symbolRank);
+    currentBuilt = index;
+}
+
+void TokenStream::buildPrevious() const {
+    slots[1] = buffer->token(previousIndex, previousSymbolRank);
+    previousBuilt = previousIndex;
+}
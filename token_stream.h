@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "token.h"
+#include "token_buffer.h"
+
+class Scanner;
+
+// The Parser's view of its input: the current token and the one just consumed.
+// Three backends:
+//  - a token vector produced up front by Scanner::scanTokens(),
+//  - a TokenBuffer from Scanner::scanBuffer(): peekType() reads only its
+//    type array, and a full Token is assembled only when asked for, or
+//  - a Scanner pulled on demand through a small ring buffer, so the parser
+//    runs in bounded memory and can start before the whole file is lexed.
+// References returned by peek()/previous() stay valid until the next advance().
+class TokenStream {
+public:
+    explicit TokenStream(const std::vector<Token>& tokens);
+    explicit TokenStream(const TokenBuffer& buffer);
+    explicit TokenStream(Scanner& scanner);
+
+    TokenStream(const TokenStream&) = delete;
+    TokenStream& operator=(const TokenStream&) = delete;
+
+    TokenType peekType() const {
+        return buffer != nullptr ? buffer->type(index) : currentToken->type;
+    }
+    const Token& peek() const {
+        if (buffer != nullptr && currentBuilt != index) buildCurrent();
+        return *currentToken;
+    }
+    const Token& previous() const {
+        if (buffer != nullptr && previousBuilt != previousIndex) buildPrevious();
+        return *previousToken;
+    }
+
+    // Consumes the current token. Does nothing once END_OF_FILE is current.
+    void advance();
+
+    // Index of the current token (vector and buffer backends only).
+    size_t position() const { return index; }
+    // Moves to token `position`, with the token before it as previous(); used
+    // to parse part of the tokens (see IncrementalDocument, ParallelParser).
+    // Vector and buffer backends only.
+    void seek(size_t position);
+
+private:
+    // Two slots are enough for peek + previous; the spare slots keep a token
+    // alive a little longer for callers holding a reference across advance().
+    static constexpr size_t ringSize = 4;
+
+    const std::vector<Token>* tokens = nullptr; // Vector backend
+    size_t index = 0;
+
+    // Buffer backend: tokens are assembled into these slots on demand.
+    static constexpr size_t notBuilt = static_cast<size_t>(-1);
+    const TokenBuffer* buffer = nullptr;
+    size_t previousIndex = 0;
+    size_t symbolRank = 0;         // Tokens with symbols before `index`
+    size_t previousSymbolRank = 0; // ... before `previousIndex`
+    mutable std::vector<Token> slots;
+    mutable size_t currentBuilt = notBuilt;
+    mutable size_t previousBuilt = notBuilt;
+    void buildCurrent() const;
+    void buildPrevious() const;
+
+    Scanner* scanner = nullptr;                 // Pull backend
+    std::vector<Token> ring;
+    size_t ringPosition = 0;
+
+    mutable const Token* currentToken = nullptr;
+    mutable const Token* previousToken = nullptr;
+};
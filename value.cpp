@@ -0,0 +1,101 @@
+#include "value.h"
+#include "object.h"
+#include "declaration_nodes.h"
+#include "ir.h"
+#include <cstdio>
+
+bool valuesEqual(Value a, Value b) {
+    if (a.kind() != b.kind()) return false;
+    switch (a.kind()) {
+    case Value::Type::Nil: return true;
+    case Value::Type::Bool: return a.asBool() == b.asBool();
+    case Value::Type::Number: return a.asNumber() == b.asNumber();
+    case Value::Type::Object:
+        if (a.isString() && b.isString()) {
+            ObjString* x = asString(a);
+            ObjString* y = asString(b);
+            // Literals and keys are interned: equal texts have equal symbols.
+            if (x->symbol != noSymbol && y->symbol != noSymbol) return x->symbol == y->symbol;
+            return x->chars == y->chars;
+        }
+        return a.asObject() == b.asObject();
+    }
+    return false;
+}
+
+static void appendValue(std::string& out, Value value, int depth) {
+    switch (value.kind()) {
+    case Value::Type::Nil: out += "nil"; return;
+    case Value::Type::Bool: out += value.asBool() ? "true" : "false"; return;
+    case Value::Type::Number: {
+        // Integral values print without a fraction; everything else with enough
+        // digits to read back the same double in practice.
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.14g", value.asNumber());
+        out += buffer;
+        return;
+    }
+    case Value::Type::Object:
+        break;
+    }
+
+    switch (value.asObject()->type) {
+    case ObjType::String:
+        out += asString(value)->chars;
+        break;
+    case ObjType::Array: {
+        // Arrays can contain themselves; stop descending after a few levels.
+        if (depth > 4) {
+            out += "[...]";
+            break;
+        }
+        out += '[';
+        const std::vector<Value>& elements = asArray(value)->elements;
+        for (size_t i = 0; i < elements.size(); ++i) {
+            if (i > 0) out += ", ";
+            appendValue(out, elements[i], depth + 1);
+        }
+        out += ']';
+        break;
+    }
+    case ObjType::Instance:
+        out += "<object>";
+        break;
+    case ObjType::Function:
+        out += "<fn ";
+        out += asFunction(value)->declaration->name.lexeme;
+        out += '>';
+        break;
+    case ObjType::Native:
+        out += "<native fn ";
+        out += asNative(value)->name;
+        out += '>';
+        break;
+    case ObjType::Proto:
+    case ObjType::Closure: {
+        ObjProto* proto = value.isObjType(ObjType::Closure) ? asClosure(value)->proto : asProto(value);
+        if (proto->name.empty()) {
+            out += "<script>";
+            break;
+        }
+        out += "<fn ";
+        out += proto->name;
+        out += '>';
+        break;
+    }
+    case ObjType::Upvalue:
+        out += "<upvalue>";
+        break;
+    case ObjType::IrClosure:
+        out += "<fn ";
+        out += asIrClosure(value)->function->name;
+        out += '>';
+        break;
+    }
+}
+
+std::string valueToString(Value value) {
+    std::string out;
+    appendValue(out, value, 0);
+    return out;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Kinds of heap object a Value can point to (see object.h)
+enum class ObjType : uint8_t {
+    String,
+    Array,
+    Instance,  // Created by object(); fields are read and written with '.' and '[]'
+    Function,  // A FuncDecl closed over its defining environment
+    Native,    // A builtin implemented in C++
+    Proto,     // A function compiled to bytecode (vm.h)
+    Closure,   // A Proto with the variables it captured
+    Upvalue,   // A captured variable
+    IrClosure  // A function compiled to IR (ir.h) with the cells it captured
+};
+
+// Where a heap object lives (see Heap in object.h).
+enum class Generation : uint8_t {
+    Nursery,  // Bump-allocated, moved out by the next minor collection if it survives
+    Old,      // Allocated individually, freed by a full collection once unreachable
+    Permanent // Compiled code's constants; freed with the Heap
+};
+
+// Header shared by every heap object; the concrete layouts are in object.h.
+struct Obj {
+    ObjType type;
+    Generation generation = Generation::Old;
+    bool marked = false;     // Reached by a full collection; for a nursery object, moved
+    bool remembered = false; // Old and in the remembered set
+    Obj* next = nullptr;     // Heap's list of its generation; where a moved nursery object went
+
+    explicit Obj(ObjType type) : type(type) {}
+};
+
+// A runtime value: nil, a boolean, a number or a pointer to a heap object,
+// NaN-boxed into 64 bits. Values are small and trivially copyable; the objects
+// they point to belong to a Heap. Construct with the static factories, inspect
+// with is*/as* (object.h adds typed accessors such as asString()).
+//
+// A number is stored as its own bits. Everything else lives in the quiet NaNs
+// with bits 50 and 51 set, which arithmetic never produces once number()
+// folds every incoming NaN into the canonical one: nil, false and true are 1,
+// 2 and 3 in the low bits, and an object has the sign bit set as well, with
+// its pointer (48 bits on every 64-bit target we build for) below.
+class Value {
+public:
+    enum class Type : uint8_t { Nil, Bool, Number, Object };
+
+    Value() : bits(nilBits) {}
+
+    static Value nil() { return Value(); }
+    static Value boolean(bool b) { return Value(b ? trueBits : falseBits); }
+    static Value number(double n) {
+        uint64_t raw;
+        std::memcpy(&raw, &n, sizeof raw);
+        if ((raw & quietNaN) == quietNaN) raw = canonicalNaN;
+        return Value(raw);
+    }
+    static Value object(Obj* o) { return Value(signBit | quietNaN | static_cast<uint64_t>(reinterpret_cast<uintptr_t>(o))); }
+
+    Type kind() const {
+        if (isNumber()) return Type::Number;
+        if (isObject()) return Type::Object;
+        return bits == nilBits ? Type::Nil : Type::Bool;
+    }
+    bool isNil() const { return bits == nilBits; }
+    bool isBool() const { return (bits | 1) == trueBits; }
+    bool isNumber() const { return (bits & quietNaN) != quietNaN; }
+    bool isObject() const { return (bits & (signBit | quietNaN)) == (signBit | quietNaN); }
+    bool isObjType(ObjType objType) const { return isObject() && asObject()->type == objType; }
+    bool isString() const { return isObjType(ObjType::String); }
+
+    bool asBool() const { return bits == trueBits; }
+    double asNumber() const {
+        double n;
+        std::memcpy(&n, &bits, sizeof n);
+        return n;
+    }
+    Obj* asObject() const { return reinterpret_cast<Obj*>(static_cast<uintptr_t>(bits & ~(signBit | quietNaN))); }
+
+    // nil and false are falsey; everything else (including 0 and "") is truthy.
+    bool isTruthy() const {
+        return bits != falseBits && bits != nilBits;
+    }
+
+    // The raw encoding; two values with equal bits are the same value.
+    uint64_t rawBits() const { return bits; }
+
+private:
+    static constexpr uint64_t signBit = 0x8000000000000000ull;
+    static constexpr uint64_t quietNaN = 0x7FFC000000000000ull;
+    static constexpr uint64_t canonicalNaN = 0x7FF8000000000000ull;
+    static constexpr uint64_t nilBits = quietNaN | 1;
+    static constexpr uint64_t falseBits = quietNaN | 2;
+    static constexpr uint64_t trueBits = quietNaN | 3;
+
+    explicit Value(uint64_t bits) : bits(bits) {}
+
+    uint64_t bits;
+};
+
+static_assert(sizeof(Value) == sizeof(uint64_t), "Value must stay one machine word");
+
+// Equality as the language defines it: same kind and same value, strings by
+// content, every other object by identity.
+bool valuesEqual(Value a, Value b);
+
+// Text printed by `print` (and used by string concatenation).
+std::string valueToString(Value value);
+
+// Error raised while running a program. `line` is 0 when the error comes from
+// somewhere without a token at hand (a native); the caller fills it in.
+class RuntimeError : public std::runtime_error {
+public:
+    RuntimeError(const std::string& message, int line = 0)
+        : std::runtime_error(message), line(line) {
+    }
+
+    int line;
+};
@@ -0,0 +1,569 @@
+#include "vm.h"
+#include "natives.h"
+#include "operators.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#ifndef DAV_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define DAV_COMPUTED_GOTO 1
+#else
+#define DAV_COMPUTED_GOTO 0
+#endif
+#endif
+
+namespace {
+
+std::string argumentCountMessage(int expected, int got) {
+    return "Expected " + std::to_string(expected) + " arguments but got " + std::to_string(got) + ".";
+}
+
+double incrementOperand(Value value) {
+    if (!value.isNumber()) throw RuntimeError("Operand must be a number.");
+    return value.asNumber();
+}
+
+} // namespace
+
+Vm::Vm(std::ostream& output, size_t nurseryBytes)
+    : output(output),
+    heap(nurseryBytes),
+    stack(new Value[initialStackSlots]),
+    frames(maxFrames) {
+    for (const NativeEntry& native : builtinNatives()) {
+        int slot = globals.slotFor(native.name);
+        globals.values[slot] = Value::object(heap.makeNative(native.name, native.function, native.arity));
+        globals.defined[slot] = 1;
+    }
+    heap.setRoots([this] { traceRoots(); });
+}
+
+bool Vm::interpret(const std::vector<Declaration*>& program) {
+    ObjProto* script = compile(program);
+    return script != nullptr && run(script);
+}
+
+ObjProto* Vm::compile(const std::vector<Declaration*>& program) {
+    Heap::PermanentScope permanent(heap);
+    Compiler compiler(heap, globals, compilerOptions);
+    return compiler.compile(program);
+}
+
+bool Vm::run(ObjProto* script) {
+    ObjClosure* closure = heap.makeClosure(script);
+    stack[0] = Value::object(closure);
+    frames[0] = { closure, script->chunk.code.data(), stack.get() };
+    frameCount = 1;
+    try {
+        if (static_cast<size_t>(script->maxStack) > stackSlots) growStack(script->maxStack);
+        if (profile != nullptr) execute<true>();
+        else execute<false>();
+    }
+    catch (const RuntimeError& error) {
+        std::cerr << "[Line " << error.line << "] Runtime error: " << error.what() << std::endl;
+        resetStack();
+        return false;
+    }
+    resetStack();
+    return true;
+}
+
+// Everything the VM refers to from outside the heap: the live part of the
+// stack, the frames' closures, the open upvalues and the globals.
+void Vm::traceRoots() {
+    for (Value* slot = stack.get(); slot < stackTop; ++slot) heap.traceRoot(*slot);
+    for (int i = 0; i < frameCount; ++i) heap.traceRoot(frames[i].closure);
+    heap.traceRoot(openUpvalues);
+    for (ObjUpvalue* upvalue = openUpvalues; upvalue != nullptr; upvalue = upvalue->nextOpen) {
+        heap.traceRoot(upvalue->nextOpen);
+    }
+    for (Value& value : globals.values) heap.traceRoot(value);
+}
+
+void Vm::resetStack() {
+    // Closures that outlive an aborted run keep the values they captured.
+    closeUpvalues(stack.get());
+    frameCount = 0;
+}
+
+ObjUpvalue* Vm::captureUpvalue(Value* local) {
+    // The open list is sorted by slot, highest first, so each variable gets
+    // exactly one upvalue however many closures capture it.
+    ObjUpvalue* previous = nullptr;
+    ObjUpvalue* upvalue = openUpvalues;
+    while (upvalue != nullptr && upvalue->location > local) {
+        previous = upvalue;
+        upvalue = upvalue->nextOpen;
+    }
+    if (upvalue != nullptr && upvalue->location == local) return upvalue;
+
+    ObjUpvalue* created = heap.makeUpvalue(local);
+    created->nextOpen = upvalue;
+    if (previous == nullptr) openUpvalues = created;
+    else previous->nextOpen = created;
+    return created;
+}
+
+void Vm::closeUpvalues(const Value* last) {
+    while (openUpvalues != nullptr && openUpvalues->location >= last) {
+        ObjUpvalue* upvalue = openUpvalues;
+        upvalue->closed = *upvalue->location;
+        upvalue->location = &upvalue->closed;
+        heap.writeBarrier(upvalue, upvalue->closed);
+        openUpvalues = upvalue->nextOpen;
+    }
+}
+
+// Moves the stack to a block of at least `needed` slots, and every pointer
+// into it along: the frames' slots, the open upvalues and stackTop. The
+// dispatch loop rebuilds its own pointers from offsets.
+void Vm::growStack(size_t needed) {
+    size_t capacity = stackSlots;
+    while (capacity < needed) capacity *= 2;
+    std::unique_ptr<Value[]> grown(new Value[capacity]);
+    Value* old = stack.get();
+    std::copy(old, old + stackSlots, grown.get());
+    for (int i = 0; i < frameCount; ++i) frames[i].slots = grown.get() + (frames[i].slots - old);
+    for (ObjUpvalue* upvalue = openUpvalues; upvalue != nullptr; upvalue = upvalue->nextOpen) {
+        upvalue->location = grown.get() + (upvalue->location - old);
+    }
+    if (stackTop != nullptr) stackTop = grown.get() + (stackTop - old);
+    stack = std::move(grown);
+    stackSlots = capacity;
+}
+
+// --- Dispatch Loop ---
+
+template <bool profiling>
+void Vm::execute() {
+    // The innermost frame's state is kept in locals (registers) and written
+    // back to the frame only around calls.
+    CallFrame* frame = &frames[frameCount - 1];
+    ObjClosure* closure = frame->closure;
+    const uint8_t* ip = frame->ip;
+    const Value* constants = closure->proto->chunk.constants.data();
+    InlineCache* caches = closure->proto->chunk.caches.data();
+    Value* slots = frame->slots;
+    Value* sp = slots + 1;
+    Value* stackEnd = stack.get() + stackSlots; // Moves when the stack grows
+    Value* const globalValues = globals.values.data();
+    const uint8_t* const globalDefined = globals.defined.data();
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>(ip[-2] | (ip[-1] << 8)))
+#define PUSH(value) (*sp++ = (value))
+#define UNDEFINED(slot) RuntimeError("Undefined variable '" + std::string(globals.names[slot]) + "'.")
+// Lets the heap collect on backward jumps and calls. Every value is on the
+// stack there; closures may move, so the innermost one is read back.
+#define SAFEPOINT()                                                      \
+    if (heap.collectionPending()) {                                      \
+        frame->ip = ip;                                                  \
+        stackTop = sp;                                                   \
+        heap.safepoint();                                                \
+        closure = frame->closure;                                        \
+    }
+
+// Arithmetic and comparisons on two numbers stay inline; anything else goes
+// through the shared operator semantics.
+#define NUMBER_BINARY(resultExpr, token)                                 \
+    {                                                                    \
+        Value b = sp[-1];                                                \
+        Value a = sp[-2];                                                \
+        if (a.isNumber() && b.isNumber()) {                              \
+            double x = a.asNumber(), y = b.asNumber();                   \
+            sp[-2] = resultExpr;                                         \
+        }                                                                \
+        else {                                                           \
+            sp[-2] = applyBinary(heap, token, a, b);                     \
+        }                                                                \
+        --sp;                                                            \
+        DISPATCH();                                                      \
+    }
+
+// A comparison whose result only decides a POP_JUMP_IF_FALSE: two numbers
+// branch on the comparison itself, without making a boolean.
+#define COMPARE_JUMP(condition, token)                                   \
+    {                                                                    \
+        uint16_t offset = READ_SHORT();                                  \
+        Value b = sp[-1];                                                \
+        Value a = sp[-2];                                                \
+        sp -= 2;                                                         \
+        bool taken;                                                      \
+        if (a.isNumber() && b.isNumber()) {                              \
+            double x = a.asNumber(), y = b.asNumber();                   \
+            taken = !(condition);                                        \
+        }                                                                \
+        else {                                                           \
+            taken = !applyBinary(heap, token, a, b).isTruthy();          \
+        }                                                                \
+        if (taken) ip += offset;                                         \
+        DISPATCH();                                                      \
+    }
+
+// Reads the next opcode, counting it first in a profiled run.
+#define NEXT_OPCODE() ((profiling ? profile->record(ip) : void()), *ip++)
+
+#if DAV_COMPUTED_GOTO
+    static void* const dispatchTable[] = {
+#define DAV_OPCODE_LABEL(name, operands, effect) &&op_##name,
+        DAV_OPCODES(DAV_OPCODE_LABEL)
+#undef DAV_OPCODE_LABEL
+#define DAV_SUPERINSTRUCTION_LABEL(name, first, second) &&op_##name,
+        DAV_SUPERINSTRUCTIONS(DAV_SUPERINSTRUCTION_LABEL)
+#undef DAV_SUPERINSTRUCTION_LABEL
+    };
+#define DISPATCH() goto *dispatchTable[NEXT_OPCODE()]
+#define TARGET(name) case OpCode::name: op_##name
+#else
+#define DISPATCH() continue
+#define TARGET(name) case OpCode::name
+#endif
+
+    if (profiling) profile->previous = nullptr;
+    try {
+#if DAV_COMPUTED_GOTO
+        DISPATCH();
+#endif
+        for (;;) {
+            switch (static_cast<OpCode>(NEXT_OPCODE())) {
+            TARGET(CONSTANT): PUSH(constants[READ_SHORT()]); DISPATCH();
+            TARGET(NIL): PUSH(Value::nil()); DISPATCH();
+            TARGET(TRUE): PUSH(Value::boolean(true)); DISPATCH();
+            TARGET(FALSE): PUSH(Value::boolean(false)); DISPATCH();
+            TARGET(POP): --sp; DISPATCH();
+            TARGET(DUP): *sp = sp[-1]; ++sp; DISPATCH();
+            TARGET(DUP2): sp[0] = sp[-2]; sp[1] = sp[-1]; sp += 2; DISPATCH();
+
+            TARGET(GET_LOCAL): PUSH(slots[READ_BYTE()]); DISPATCH();
+            TARGET(SET_LOCAL): slots[READ_BYTE()] = sp[-1]; DISPATCH();
+            TARGET(GET_GLOBAL): {
+                uint16_t slot = READ_SHORT();
+                if (!globalDefined[slot]) throw UNDEFINED(slot);
+                PUSH(globalValues[slot]);
+                DISPATCH();
+            }
+            TARGET(SET_GLOBAL): {
+                uint16_t slot = READ_SHORT();
+                if (!globalDefined[slot]) throw UNDEFINED(slot);
+                globalValues[slot] = sp[-1];
+                DISPATCH();
+            }
+            TARGET(DEFINE_GLOBAL): {
+                uint16_t slot = READ_SHORT();
+                globalValues[slot] = *--sp;
+                globals.defined[slot] = 1;
+                DISPATCH();
+            }
+            TARGET(GET_UPVALUE): PUSH(*closure->upvalues[READ_BYTE()]->location); DISPATCH();
+            TARGET(SET_UPVALUE): {
+                ObjUpvalue* upvalue = closure->upvalues[READ_BYTE()];
+                *upvalue->location = sp[-1];
+                heap.writeBarrier(upvalue, sp[-1]);
+                DISPATCH();
+            }
+
+            TARGET(GET_INDEX): {
+                Value key = sp[-1];
+                Value container = sp[-2];
+                if (container.isObjType(ObjType::Array) && key.isNumber()) {
+                    std::vector<Value>& elements = asArray(container)->elements;
+                    double index = key.asNumber();
+                    if (index >= 0 && index < static_cast<double>(elements.size())) {
+                        sp[-2] = elements[static_cast<size_t>(index)];
+                        --sp;
+                        DISPATCH();
+                    }
+                }
+                sp[-2] = getIndex(heap, container, key);
+                --sp;
+                DISPATCH();
+            }
+            TARGET(SET_INDEX): {
+                Value value = sp[-1];
+                setIndex(heap, sp[-3], sp[-2], value);
+                sp -= 2;
+                sp[-1] = value;
+                DISPATCH();
+            }
+            TARGET(GET_FIELD): {
+                Symbol name = symbolOf(asString(constants[READ_SHORT()]));
+                InlineCache& cache = caches[READ_SHORT()];
+                sp[-1] = getField(sp[-1], name, cache);
+                DISPATCH();
+            }
+            TARGET(SET_FIELD): {
+                Symbol name = symbolOf(asString(constants[READ_SHORT()]));
+                InlineCache& cache = caches[READ_SHORT()];
+                Value value = sp[-1];
+                setField(heap, sp[-2], name, value, cache);
+                --sp;
+                sp[-1] = value;
+                DISPATCH();
+            }
+            TARGET(INCREMENT_INDEX): {
+                uint8_t flags = READ_BYTE();
+                Value old = getIndex(heap, sp[-2], sp[-1]);
+                double delta = (flags & INCREMENT_DECREMENT) ? -1 : 1;
+                Value updated = Value::number(incrementOperand(old) + delta);
+                setIndex(heap, sp[-2], sp[-1], updated);
+                --sp;
+                sp[-1] = (flags & INCREMENT_POSTFIX) ? old : updated;
+                DISPATCH();
+            }
+            TARGET(INCREMENT_FIELD): {
+                Symbol name = symbolOf(asString(constants[READ_SHORT()]));
+                InlineCache& cache = caches[READ_SHORT()];
+                uint8_t flags = READ_BYTE();
+                Value old = getField(sp[-1], name, cache);
+                double delta = (flags & INCREMENT_DECREMENT) ? -1 : 1;
+                Value updated = Value::number(incrementOperand(old) + delta);
+                setField(heap, sp[-1], name, updated, cache);
+                sp[-1] = (flags & INCREMENT_POSTFIX) ? old : updated;
+                DISPATCH();
+            }
+
+            TARGET(EQUAL): sp[-2] = Value::boolean(valuesEqual(sp[-2], sp[-1])); --sp; DISPATCH();
+            TARGET(NOT_EQUAL): sp[-2] = Value::boolean(!valuesEqual(sp[-2], sp[-1])); --sp; DISPATCH();
+            TARGET(LESS): NUMBER_BINARY(Value::boolean(x < y), TokenType::LESS)
+            TARGET(LESS_EQUAL): NUMBER_BINARY(Value::boolean(x <= y), TokenType::LESS_EQUAL)
+            TARGET(GREATER): NUMBER_BINARY(Value::boolean(x > y), TokenType::GREATER)
+            TARGET(GREATER_EQUAL): NUMBER_BINARY(Value::boolean(x >= y), TokenType::GREATER_EQUAL)
+            TARGET(ADD): NUMBER_BINARY(Value::number(x + y), TokenType::PLUS)
+            TARGET(SUBTRACT): NUMBER_BINARY(Value::number(x - y), TokenType::MINUS)
+            TARGET(MULTIPLY): NUMBER_BINARY(Value::number(x * y), TokenType::STAR)
+            TARGET(DIVIDE): NUMBER_BINARY(Value::number(x / y), TokenType::SLASH)
+            TARGET(MODULO): NUMBER_BINARY(Value::number(std::fmod(x, y)), TokenType::PERCENT)
+            TARGET(BIT_AND): NUMBER_BINARY(Value::number(static_cast<double>(toInteger(x) & toInteger(y))), TokenType::AMP)
+            TARGET(BIT_OR): NUMBER_BINARY(Value::number(static_cast<double>(toInteger(x) | toInteger(y))), TokenType::PIPE)
+            TARGET(BIT_XOR): NUMBER_BINARY(Value::number(static_cast<double>(toInteger(x) ^ toInteger(y))), TokenType::CARET)
+            TARGET(SHIFT_LEFT): {
+                sp[-2] = applyBinary(heap, TokenType::SHIFT_LEFT, sp[-2], sp[-1]);
+                --sp;
+                DISPATCH();
+            }
+            TARGET(SHIFT_RIGHT): {
+                sp[-2] = applyBinary(heap, TokenType::SHIFT_RIGHT, sp[-2], sp[-1]);
+                --sp;
+                DISPATCH();
+            }
+
+            TARGET(NOT): sp[-1] = Value::boolean(!sp[-1].isTruthy()); DISPATCH();
+            TARGET(NEGATE): {
+                if (sp[-1].isNumber()) sp[-1] = Value::number(-sp[-1].asNumber());
+                else sp[-1] = applyUnary(TokenType::MINUS, sp[-1]);
+                DISPATCH();
+            }
+            TARGET(UNARY_PLUS): sp[-1] = applyUnary(TokenType::PLUS, sp[-1]); DISPATCH();
+            TARGET(BIT_NOT): sp[-1] = applyUnary(TokenType::TILDE, sp[-1]); DISPATCH();
+            TARGET(INCREMENT): sp[-1] = Value::number(incrementOperand(sp[-1]) + 1); DISPATCH();
+            TARGET(DECREMENT): sp[-1] = Value::number(incrementOperand(sp[-1]) - 1); DISPATCH();
+
+            TARGET(JUMP): {
+                uint16_t offset = READ_SHORT();
+                ip += offset;
+                DISPATCH();
+            }
+            TARGET(JUMP_IF_FALSE): {
+                uint16_t offset = READ_SHORT();
+                if (!sp[-1].isTruthy()) ip += offset;
+                DISPATCH();
+            }
+            TARGET(JUMP_IF_TRUE): {
+                uint16_t offset = READ_SHORT();
+                if (sp[-1].isTruthy()) ip += offset;
+                DISPATCH();
+            }
+            TARGET(POP_JUMP_IF_FALSE): {
+                uint16_t offset = READ_SHORT();
+                if (!(--sp)->isTruthy()) ip += offset;
+                DISPATCH();
+            }
+            TARGET(JUMP_IF_EQUAL): {
+                uint16_t offset = READ_SHORT();
+                --sp;
+                if (valuesEqual(sp[-1], *sp)) ip += offset;
+                DISPATCH();
+            }
+            TARGET(SWITCH): {
+                const SwitchTable& table = closure->proto->chunk.switches[READ_SHORT()];
+                ip += table.lookup(sp[-1]);
+                DISPATCH();
+            }
+            TARGET(LOOP): {
+                uint16_t offset = READ_SHORT();
+                ip -= offset;
+                SAFEPOINT();
+                DISPATCH();
+            }
+
+            TARGET(CALL): {
+                int argCount = READ_BYTE();
+                Value* base = sp - argCount - 1;
+                Value callee = *base;
+                if (callee.isObjType(ObjType::Closure)) {
+                    ObjClosure* function = asClosure(callee);
+                    ObjProto* proto = function->proto;
+                    if (argCount != proto->arity) throw RuntimeError(argumentCountMessage(proto->arity, argCount));
+                    if (frameCount == maxFrames) throw RuntimeError("Stack overflow.");
+                    if (proto->maxStack > stackEnd - base) {
+                        std::ptrdiff_t baseOffset = base - stack.get();
+                        std::ptrdiff_t spOffset = sp - stack.get();
+                        growStack(static_cast<size_t>(baseOffset + proto->maxStack));
+                        base = stack.get() + baseOffset;
+                        sp = stack.get() + spOffset;
+                        slots = frame->slots;
+                        stackEnd = stack.get() + stackSlots;
+                    }
+                    frame->ip = ip;
+                    frame = &frames[frameCount++];
+                    frame->closure = function;
+                    frame->slots = base;
+                    closure = function;
+                    ip = proto->chunk.code.data();
+                    constants = proto->chunk.constants.data();
+                    caches = proto->chunk.caches.data();
+                    slots = base;
+                    SAFEPOINT();
+                    DISPATCH();
+                }
+                if (callee.isObjType(ObjType::Native)) {
+                    ObjNative* native = asNative(callee);
+                    if (native->arity >= 0 && argCount != native->arity) {
+                        throw RuntimeError(argumentCountMessage(native->arity, argCount));
+                    }
+                    Value result = native->function(heap, base + 1, argCount);
+                    sp = base;
+                    PUSH(result);
+                    DISPATCH();
+                }
+                throw RuntimeError("Can only call functions.");
+            }
+            TARGET(CLOSURE): {
+                ObjProto* proto = asProto(constants[READ_SHORT()]);
+                ObjClosure* created = heap.makeClosure(proto);
+                for (int i = 0; i < proto->upvalueCount; ++i) {
+                    uint8_t isLocal = READ_BYTE();
+                    uint8_t index = READ_BYTE();
+                    created->upvalues[i] = isLocal ? captureUpvalue(slots + index) : closure->upvalues[index];
+                }
+                PUSH(Value::object(created));
+                DISPATCH();
+            }
+            TARGET(CLOSE_UPVALUE): {
+                closeUpvalues(sp - 1);
+                --sp;
+                DISPATCH();
+            }
+            TARGET(RETURN): {
+                Value result = sp[-1];
+                closeUpvalues(slots);
+                if (--frameCount == 0) return;
+                sp = slots;
+                PUSH(result);
+                frame = &frames[frameCount - 1];
+                closure = frame->closure;
+                ip = frame->ip;
+                constants = closure->proto->chunk.constants.data();
+                caches = closure->proto->chunk.caches.data();
+                slots = frame->slots;
+                DISPATCH();
+            }
+            TARGET(PRINT): {
+                output << valueToString(*--sp) << '\n';
+                DISPATCH();
+            }
+            TARGET(INVALID_TARGET): throw RuntimeError("Invalid assignment target.");
+
+            // Superinstructions: each pair's work in one dispatch, the
+            // operands read in the same order.
+            TARGET(GET_LOCAL_CONSTANT): {
+                sp[0] = slots[READ_BYTE()];
+                sp[1] = constants[READ_SHORT()];
+                sp += 2;
+                DISPATCH();
+            }
+            TARGET(GET_FIELD_GET_FIELD): {
+                Symbol name = symbolOf(asString(constants[READ_SHORT()]));
+                InlineCache& cache = caches[READ_SHORT()];
+                Value object = getField(sp[-1], name, cache);
+                Symbol innerName = symbolOf(asString(constants[READ_SHORT()]));
+                InlineCache& innerCache = caches[READ_SHORT()];
+                sp[-1] = getField(object, innerName, innerCache);
+                DISPATCH();
+            }
+            TARGET(SET_LOCAL_POP): slots[READ_BYTE()] = *--sp; DISPATCH();
+            TARGET(SET_GLOBAL_POP): {
+                uint16_t slot = READ_SHORT();
+                if (!globalDefined[slot]) throw UNDEFINED(slot);
+                globalValues[slot] = *--sp;
+                DISPATCH();
+            }
+            TARGET(POP_POP): sp -= 2; DISPATCH();
+            TARGET(POP_LOOP): {
+                --sp;
+                uint16_t offset = READ_SHORT();
+                ip -= offset;
+                SAFEPOINT();
+                DISPATCH();
+            }
+            TARGET(GET_LOCAL_DUP): {
+                Value value = slots[READ_BYTE()];
+                sp[0] = value;
+                sp[1] = value;
+                sp += 2;
+                DISPATCH();
+            }
+            TARGET(INCREMENT_SET_LOCAL): {
+                sp[-1] = Value::number(incrementOperand(sp[-1]) + 1);
+                slots[READ_BYTE()] = sp[-1];
+                DISPATCH();
+            }
+            TARGET(DECREMENT_SET_LOCAL): {
+                sp[-1] = Value::number(incrementOperand(sp[-1]) - 1);
+                slots[READ_BYTE()] = sp[-1];
+                DISPATCH();
+            }
+            TARGET(GET_LOCAL_PRINT): {
+                output << valueToString(slots[READ_BYTE()]) << '\n';
+                DISPATCH();
+            }
+            TARGET(EQUAL_POP_JUMP_IF_FALSE): {
+                uint16_t offset = READ_SHORT();
+                sp -= 2;
+                if (!valuesEqual(sp[0], sp[1])) ip += offset;
+                DISPATCH();
+            }
+            TARGET(NOT_EQUAL_POP_JUMP_IF_FALSE): {
+                uint16_t offset = READ_SHORT();
+                sp -= 2;
+                if (valuesEqual(sp[0], sp[1])) ip += offset;
+                DISPATCH();
+            }
+            TARGET(LESS_POP_JUMP_IF_FALSE): COMPARE_JUMP(x < y, TokenType::LESS)
+            TARGET(LESS_EQUAL_POP_JUMP_IF_FALSE): COMPARE_JUMP(x <= y, TokenType::LESS_EQUAL)
+            TARGET(GREATER_POP_JUMP_IF_FALSE): COMPARE_JUMP(x > y, TokenType::GREATER)
+            TARGET(GREATER_EQUAL_POP_JUMP_IF_FALSE): COMPARE_JUMP(x >= y, TokenType::GREATER_EQUAL)
+            }
+        }
+    }
+    catch (RuntimeError& error) {
+        // Errors carry no line of their own; it comes from the line table.
+        if (error.line == 0) {
+            const Chunk& chunk = closure->proto->chunk;
+            error.line = chunk.lineAt(static_cast<size_t>(ip - 1 - chunk.code.data()));
+        }
+        throw;
+    }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef PUSH
+#undef UNDEFINED
+#undef SAFEPOINT
+#undef NUMBER_BINARY
+#undef COMPARE_JUMP
+#undef NEXT_OPCODE
+#undef DISPATCH
+#undef TARGET
+}
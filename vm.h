@@ -0,0 +1,90 @@
+#pragma once
+#include "compiler.h"
+#include "object.h"
+#include <iostream>
+#include <memory>
+#include <vector>
+
+class Declaration;
+
+// What the dispatch loop ran (see Vm::setProfile): every instruction, and
+// every pair of instructions where the second came straight after the first
+// in the code, without a jump in between: the pairs a superinstruction
+// could stand for.
+struct DispatchProfile {
+    uint64_t dispatches = 0;
+    uint64_t counts[opCodeCount] = {};
+    uint64_t pairs[opCodeCount][opCodeCount] = {}; // [first][second]
+    const uint8_t* previous = nullptr;             // Last instruction dispatched
+
+    void record(const uint8_t* ip) {
+        ++dispatches;
+        ++counts[*ip];
+        if (previous != nullptr && previous + 1 + opCodeOperandBytes(static_cast<OpCode>(*previous)) == ip) {
+            ++pairs[*previous][*ip];
+        }
+        previous = ip;
+    }
+};
+
+// Runs programs compiled to bytecode by the Compiler.
+// The dispatch loop uses computed goto (a table of label addresses indexed
+// by opcode) where the compiler supports it and a switch elsewhere; define
+// DAV_COMPUTED_GOTO to 0 or 1 to choose explicitly. Values live on one fixed
+// stack shared by every call frame, so a frame's locals are a window of it.
+class Vm {
+public:
+    // `print` writes to `output`; errors are reported on std::cerr.
+    explicit Vm(std::ostream& output, size_t nurseryBytes = Heap::defaultNurseryBytes);
+
+    Vm(const Vm&) = delete;
+    Vm& operator=(const Vm&) = delete;
+
+    // Compiles and runs `program`. Returns false on a compile or runtime
+    // error. Globals persist across calls.
+    bool interpret(const std::vector<Declaration*>& program);
+
+    // The two halves of interpret(): compile() returns nullptr on error.
+    ObjProto* compile(const std::vector<Declaration*>& program);
+    bool run(ObjProto* script);
+
+    const Heap::Stats& heapStats() const { return heap.stats(); }
+
+    // How compile() lowers programs from now on, for comparing the code with
+    // and without an optimization.
+    void setCompilerOptions(const CompilerOptions& options) { compilerOptions = options; }
+    // Counts every dispatch of the following runs into `profile` (nullptr
+    // stops counting). Profiled runs take a separate, slower copy of the
+    // dispatch loop; the ordinary one pays nothing for it.
+    void setProfile(DispatchProfile* profile) { this->profile = profile; }
+
+private:
+    struct CallFrame {
+        ObjClosure* closure;
+        const uint8_t* ip; // Saved while the frame is not the innermost one
+        Value* slots;      // Slot 0 is the callee, then arguments and locals
+    };
+
+    static constexpr int maxFrames = 1001;              // The script plus 1000 nested calls
+    static constexpr size_t initialStackSlots = 1 << 16; // Grown on demand
+
+    std::ostream& output;
+    Heap heap;
+    GlobalTable globals;
+    std::unique_ptr<Value[]> stack;
+    size_t stackSlots = initialStackSlots;
+    Value* stackTop = nullptr; // Saved at safepoints, for the collector
+    std::vector<CallFrame> frames;
+    int frameCount = 0;
+    ObjUpvalue* openUpvalues = nullptr;
+    CompilerOptions compilerOptions;
+    DispatchProfile* profile = nullptr;
+
+    template <bool profiling>
+    void execute();
+    void traceRoots();
+    ObjUpvalue* captureUpvalue(Value* local);
+    void closeUpvalues(const Value* last);
+    void growStack(size_t needed);
+    void resetStack();
+};